@@ -0,0 +1,363 @@
+#include "config.h"
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "logger.h"
+#include "utils.h"
+
+#define DEFAULT_WARMUP 2
+#define DEFAULT_REPETITIONS 11
+
+typedef enum {
+  FORMAT_TEXT,
+  FORMAT_CSV,
+  FORMAT_JSON,
+} OutputFormat;
+
+typedef struct {
+  double min_ns;
+  double median_ns;
+  double allocations;
+  double mb_per_sec;
+  size_t ops;
+} BenchResult;
+
+static const BenchSuite *const SUITES[] = {
+    &BENCH_SUITE_DICT,
+    &BENCH_SUITE_LIST,
+    &BENCH_SUITE_BUFFER,
+    &BENCH_SUITE_ARRAY,
+    &BENCH_SUITE_CONCURRENT_DICT,
+    &BENCH_SUITE_SORT,
+    &BENCH_SUITE_QUEUE,
+    &BENCH_SUITE_AIO,
+    &BENCH_SUITE_COMPRESS,
+    &BENCH_SUITE_LOGGER,
+    &BENCH_SUITE_METRICS,
+    &BENCH_SUITE_COLLISION,
+    &BENCH_SUITE_ANIMATION,
+    &BENCH_SUITE_SNAPSHOT,
+};
+
+static const struct option LONG_OPTIONS[] = {
+    {"filter", required_argument, NULL, 'f'},
+    {"format", required_argument, NULL, 'o'},
+    {"repetitions", required_argument, NULL, 'r'},
+    {"warmup", required_argument, NULL, 'w'},
+    {"debug", no_argument, NULL, 'd'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+};
+
+static const char *const DESCRIPTIONS[] = {
+    "only run benchmarks whose name contains argument",
+    "output format: text, csv or json",
+    "number of timed repetitions",
+    "number of untimed warmup runs",
+    "enable debug logging",
+    "print help message",
+};
+
+/******************************************************************************/
+/* Allocation counting                                                        */
+/******************************************************************************/
+
+#ifdef __GLIBC__
+
+/* Interpose the allocator using the glibc internal entry points, so that
+ * allocations done inside libc (e.g. strdup(3)) are counted as well. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static atomic_size_t ALLOCATIONS = 0;
+
+void *malloc(size_t size) {
+  atomic_fetch_add_explicit(&ALLOCATIONS, 1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+  atomic_fetch_add_explicit(&ALLOCATIONS, 1, memory_order_relaxed);
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+  atomic_fetch_add_explicit(&ALLOCATIONS, 1, memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+size_t BenchAllocations(void) {
+  return atomic_load_explicit(&ALLOCATIONS, memory_order_relaxed);
+}
+
+bool BenchAllocationsCounted(void) { return true; }
+
+#else /* __GLIBC__ */
+
+size_t BenchAllocations(void) { return 0; }
+
+bool BenchAllocationsCounted(void) { return false; }
+
+#endif /* __GLIBC__ */
+
+/******************************************************************************/
+/* Harness                                                                    */
+/******************************************************************************/
+
+static double Now(void) {
+  struct timespec ts;
+  NDEBUG_UNUSED int ret = clock_gettime(CLOCK_MONOTONIC, &ts);
+  assert(ret == 0);
+  return ((double)ts.tv_sec * 1e9) + (double)ts.tv_nsec;
+}
+
+static int CompareDouble(const void *a, const void *b) {
+  const double lhs = *(const double *)a;
+  const double rhs = *(const double *)b;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+char *BenchCreateTempFile(const size_t size) {
+  char *const path = xstrdup("/tmp/eterno-bench-XXXXXX");
+  const int fd = mkstemp(path);
+  if (fd < 0) {
+    LOG_CRITICAL("Failed to create temporary file: %s", strerror(errno));
+  }
+
+  char chunk[4096];
+  for (size_t i = 0; i < sizeof(chunk); i++) {
+    chunk[i] = ((i % 64) == 63) ? '\n' : (char)('a' + (i % 26));
+  }
+
+  size_t written = 0;
+  while (written < size) {
+    const size_t n = MIN(sizeof(chunk), size - written);
+    const ssize_t ret = write(fd, chunk, n);
+    if (ret < 0) {
+      LOG_CRITICAL("Failed to write temporary file '%s': %s", path,
+                   strerror(errno));
+    }
+    written += (size_t)ret;
+  }
+
+  close(fd);
+  return path;
+}
+
+static BenchResult RunBenchmark(const Benchmark *const bench,
+                                const unsigned warmup,
+                                const unsigned repetitions) {
+  assert(bench != NULL);
+  assert(bench->run != NULL);
+  assert(repetitions > 0);
+
+  for (unsigned i = 0; i < warmup; i++) {
+    void *const ctx =
+        (bench->setup != NULL) ? bench->setup(bench->param) : NULL;
+    bench->run(ctx, bench->param);
+    if (bench->teardown != NULL) {
+      bench->teardown(ctx);
+    }
+  }
+
+  double *const samples = xcalloc(repetitions, sizeof(double));
+  size_t allocations = SIZE_MAX;
+  size_t ops = 0;
+
+  for (unsigned i = 0; i < repetitions; i++) {
+    void *const ctx =
+        (bench->setup != NULL) ? bench->setup(bench->param) : NULL;
+
+    const size_t alloc_start = BenchAllocations();
+    const double start = Now();
+    ops = bench->run(ctx, bench->param);
+    const double stop = Now();
+    const size_t alloc_stop = BenchAllocations();
+
+    if (bench->teardown != NULL) {
+      bench->teardown(ctx);
+    }
+
+    assert(ops > 0);
+    samples[i] = (stop - start) / (double)ops;
+    allocations = MIN(allocations, alloc_stop - alloc_start);
+  }
+
+  qsort(samples, repetitions, sizeof(double), CompareDouble);
+
+  BenchResult result = {
+      .min_ns = samples[0],
+      .median_ns = samples[repetitions / 2],
+      .allocations = (double)allocations / (double)ops,
+      .mb_per_sec = 0.0,
+      .ops = ops,
+  };
+  if (bench->bytes > 0) {
+    const double run_ns = result.median_ns * (double)ops;
+    result.mb_per_sec = ((double)bench->bytes / (1024.0 * 1024.0)) /
+                        (run_ns / 1e9);
+  }
+
+  free(samples);
+  return result;
+}
+
+static void PrintHeader(const OutputFormat format) {
+  switch (format) {
+  case FORMAT_TEXT:
+    printf("%-32s %10s %10s %14s %14s %12s %10s\n", "benchmark", "param",
+           "ops", "min ns/op", "median ns/op", "allocs/op", "MB/s");
+    break;
+  case FORMAT_CSV:
+    printf("suite,benchmark,param,ops,min_ns_per_op,median_ns_per_op,"
+           "allocs_per_op,mb_per_sec\n");
+    break;
+  case FORMAT_JSON:
+    printf("{\n  \"version\": \"%s\",\n  \"allocations_counted\": %s,\n"
+           "  \"results\": [",
+           PACKAGE_VERSION, BenchAllocationsCounted() ? "true" : "false");
+    break;
+  }
+}
+
+static void PrintResult(const OutputFormat format, const BenchSuite *suite,
+                        const Benchmark *bench, const BenchResult *result,
+                        const bool first) {
+  switch (format) {
+  case FORMAT_TEXT:
+    printf("%-32s %10zu %10zu %14.2f %14.2f %12.3f %10.1f\n", bench->name,
+           bench->param, result->ops, result->min_ns, result->median_ns,
+           result->allocations, result->mb_per_sec);
+    break;
+  case FORMAT_CSV:
+    printf("%s,%s,%zu,%zu,%.3f,%.3f,%.4f,%.3f\n", suite->name, bench->name,
+           bench->param, result->ops, result->min_ns, result->median_ns,
+           result->allocations, result->mb_per_sec);
+    break;
+  case FORMAT_JSON:
+    printf("%s\n    {\"suite\": \"%s\", \"benchmark\": \"%s\", "
+           "\"param\": %zu, \"ops\": %zu, \"min_ns_per_op\": %.3f, "
+           "\"median_ns_per_op\": %.3f, \"allocs_per_op\": %.4f, "
+           "\"mb_per_sec\": %.3f}",
+           first ? "" : ",", suite->name, bench->name, bench->param,
+           result->ops, result->min_ns, result->median_ns,
+           result->allocations, result->mb_per_sec);
+    break;
+  }
+  fflush(stdout);
+}
+
+static void PrintFooter(const OutputFormat format) {
+  if (format == FORMAT_JSON) {
+    printf("\n  ]\n}\n");
+  }
+}
+
+static void PrintHelp(const char *prog) {
+  printf("%s %s: Benchmarks\n\n", PACKAGE_NAME, PACKAGE_VERSION);
+  printf("Usage: %s [OPTIONS]\n\n", prog);
+  printf("OPTIONS:\n");
+  for (int i = 0; LONG_OPTIONS[i].val != 0; i++) {
+    printf("  --%-12s    %s\n", LONG_OPTIONS[i].name, DESCRIPTIONS[i]);
+  }
+}
+
+static bool ParseUnsigned(const char *const str, unsigned *const value) {
+  char *end;
+  errno = 0;
+  const unsigned long ret = strtoul(str, &end, 10);
+  if (errno != 0 || *end != '\0' || end == str || ret > UINT_MAX) {
+    return false;
+  }
+  *value = (unsigned)ret;
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  const char *filter = NULL;
+  OutputFormat format = FORMAT_TEXT;
+  unsigned warmup = DEFAULT_WARMUP;
+  unsigned repetitions = DEFAULT_REPETITIONS;
+
+  int c;
+  while ((c = getopt_long(argc, argv, "f:o:r:w:dh", LONG_OPTIONS, NULL)) !=
+         -1) {
+    switch (c) {
+    case 'f':
+      filter = optarg;
+      break;
+
+    case 'o':
+      if (StringEqual(optarg, "text")) {
+        format = FORMAT_TEXT;
+      } else if (StringEqual(optarg, "csv")) {
+        format = FORMAT_CSV;
+      } else if (StringEqual(optarg, "json")) {
+        format = FORMAT_JSON;
+      } else {
+        LOG_ERROR("Bad output format '%s'", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'r':
+      if (!ParseUnsigned(optarg, &repetitions) || repetitions == 0) {
+        LOG_ERROR("Bad number of repetitions '%s'", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'w':
+      if (!ParseUnsigned(optarg, &warmup)) {
+        LOG_ERROR("Bad number of warmup runs '%s'", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'd':
+      SetDebugLogging(true);
+      break;
+
+    case 'h':
+      PrintHelp(argv[0]);
+      return EXIT_SUCCESS;
+
+    case '?':
+      /* Error already printed by getopt_long(3) */
+      return EXIT_FAILURE;
+
+    default:
+      LOG_CRITICAL("Unhandled option '%c'", c);
+    }
+  }
+
+  PrintHeader(format);
+
+  bool first = true;
+  for (size_t i = 0; i < LENGTH(SUITES); i++) {
+    const BenchSuite *const suite = SUITES[i];
+    for (size_t j = 0; j < suite->length; j++) {
+      const Benchmark *const bench = &suite->benchmarks[j];
+      if (filter != NULL && strstr(bench->name, filter) == NULL) {
+        continue;
+      }
+
+      const BenchResult result = RunBenchmark(bench, warmup, repetitions);
+      PrintResult(format, suite, bench, &result, first);
+      first = false;
+    }
+  }
+
+  PrintFooter(format);
+  return EXIT_SUCCESS;
+}
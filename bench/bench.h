@@ -0,0 +1,67 @@
+#ifndef __ETERNO_BENCH_H__
+#define __ETERNO_BENCH_H__
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct Benchmark {
+  const char *name;
+  size_t param;
+  size_t bytes; /* Bytes processed per run or 0 */
+  void *(*setup)(size_t param);
+  size_t (*run)(void *ctx, size_t param); /* Returns number of operations */
+  void (*teardown)(void *ctx);
+} Benchmark;
+
+typedef struct BenchSuite {
+  const char *name;
+  const Benchmark *benchmarks;
+  size_t length;
+} BenchSuite;
+
+#define BENCH_SUITE(name, benchmarks)                                          \
+  { name, benchmarks, sizeof(benchmarks) / sizeof(benchmarks[0]) }
+
+/**
+ * @brief Get number of heap allocations performed by the process so far.
+ * @return Number of allocations or 0 if allocation counting is unavailable.
+ */
+size_t BenchAllocations(void);
+
+/**
+ * @brief Check whether allocations are counted on this platform.
+ * @return True if BenchAllocations() is meaningful.
+ */
+bool BenchAllocationsCounted(void);
+
+/**
+ * @brief Prevent the compiler from optimizing away a computed value.
+ * @param ptr Pointer to the value.
+ */
+static inline void BenchDoNotOptimize(const void *ptr) {
+  __asm__ volatile("" : : "g"(ptr) : "memory");
+}
+
+/**
+ * @brief Create a temporary file filled with printable data.
+ * @param size Size of file in bytes.
+ * @return Path to file. Caller must unlink(2) and free(3) it.
+ */
+char *BenchCreateTempFile(size_t size);
+
+extern const BenchSuite BENCH_SUITE_DICT;
+extern const BenchSuite BENCH_SUITE_LIST;
+extern const BenchSuite BENCH_SUITE_BUFFER;
+extern const BenchSuite BENCH_SUITE_ARRAY;
+extern const BenchSuite BENCH_SUITE_CONCURRENT_DICT;
+extern const BenchSuite BENCH_SUITE_SORT;
+extern const BenchSuite BENCH_SUITE_QUEUE;
+extern const BenchSuite BENCH_SUITE_AIO;
+extern const BenchSuite BENCH_SUITE_COMPRESS;
+extern const BenchSuite BENCH_SUITE_LOGGER;
+extern const BenchSuite BENCH_SUITE_METRICS;
+extern const BenchSuite BENCH_SUITE_COLLISION;
+extern const BenchSuite BENCH_SUITE_ANIMATION;
+extern const BenchSuite BENCH_SUITE_SNAPSHOT;
+
+#endif // __ETERNO_BENCH_H__
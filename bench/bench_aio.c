@@ -0,0 +1,104 @@
+#include "config.h"
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "aio.h"
+#include "bench.h"
+#include "buffer.h"
+#include "utils.h"
+
+#define FILE_SIZE (64 * 1024)
+#define MAX_FILES 64
+
+static char *TEMP_FILES[MAX_FILES];
+static size_t NUM_TEMP_FILES = 0;
+
+static void RemoveTempFiles(void) {
+  for (size_t i = 0; i < NUM_TEMP_FILES; i++) {
+    unlink(TEMP_FILES[i]);
+    free(TEMP_FILES[i]);
+  }
+  NUM_TEMP_FILES = 0;
+}
+
+/* Files are created once and reused across benchmarks and repetitions, so
+ * they are served from the page cache and the I/O path itself is measured */
+static void CreateTempFiles(const size_t n) {
+  assert(n <= MAX_FILES);
+  if (NUM_TEMP_FILES == 0) {
+    atexit(RemoveTempFiles);
+  }
+  while (NUM_TEMP_FILES < n) {
+    TEMP_FILES[NUM_TEMP_FILES++] = BenchCreateTempFile(FILE_SIZE);
+  }
+}
+
+static void *SetupSync(const size_t param) {
+  CreateTempFiles(param);
+  return NULL;
+}
+
+static void *SetupThreads(const size_t param) {
+  CreateTempFiles(param);
+  return AioCreate(0, AIO_BACKEND_THREADS);
+}
+
+static void *SetupIoUring(const size_t param) {
+  CreateTempFiles(param);
+  AioContext *const aio = AioCreate(0, AIO_BACKEND_IO_URING);
+  if (strcmp(AioBackendName(aio), "io_uring") != 0) {
+    LOG_WARNING("io_uring is unavailable, measuring the thread backend");
+  }
+  return aio;
+}
+
+static void TeardownSync(ARG_UNUSED void *const ptr) {}
+
+static void TeardownAio(void *const ptr) { AioDestroy(ptr); }
+
+static size_t RunSync(ARG_UNUSED void *const ptr, const size_t param) {
+  for (size_t i = 0; i < param; i++) {
+    Buffer *const buf = BufferCreate();
+    NDEBUG_UNUSED const bool success = BufferReadFile(buf, TEMP_FILES[i]);
+    assert(success);
+    assert(BufferLength(buf) == FILE_SIZE);
+    BufferDestroy(buf);
+  }
+  return param;
+}
+
+static size_t RunAio(void *const ptr, const size_t param) {
+  AioContext *const aio = ptr;
+  for (size_t i = 0; i < param; i++) {
+    AioRead(aio, TEMP_FILES[i], NULL);
+  }
+  AioSubmit(aio);
+
+  AioCompletion completions[MAX_FILES];
+  size_t n_completed = 0;
+  while (n_completed < param) {
+    const size_t n = AioWait(aio, completions, LENGTH(completions), -1);
+    for (size_t i = 0; i < n; i++) {
+      assert(completions[i].error == 0);
+      assert(BufferLength(completions[i].buffer) == FILE_SIZE);
+      BufferDestroy(completions[i].buffer);
+    }
+    n_completed += n;
+  }
+  return param;
+}
+
+/* The parameter is the number of files read per batch */
+#define AIO_BENCHMARKS(name, setup, run, teardown)                             \
+  {name, 16, 16 * FILE_SIZE, setup, run, teardown},                            \
+      {name, 64, 64 * FILE_SIZE, setup, run, teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    AIO_BENCHMARKS("aio/sync", SetupSync, RunSync, TeardownSync),
+    AIO_BENCHMARKS("aio/threads", SetupThreads, RunAio, TeardownAio),
+    AIO_BENCHMARKS("aio/io_uring", SetupIoUring, RunAio, TeardownAio),
+};
+
+const BenchSuite BENCH_SUITE_AIO = BENCH_SUITE("aio", BENCHMARKS);
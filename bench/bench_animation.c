@@ -0,0 +1,98 @@
+#include "config.h"
+
+#include <stdint.h>
+
+#include "animation.h"
+#include "bench.h"
+#include "utils.h"
+
+/* States and conditions of a typical enemy */
+enum { IDLE, WALK, RUN, JUMP, FALL, ATTACK, DIE };
+enum {
+  RISING = 1 << 0,
+  FALLING = 1 << 1,
+  MOVING = 1 << 2,
+  RUNNING = 1 << 3,
+  ATTACKING = 1 << 4,
+  DEAD = 1 << 5,
+};
+
+static const AnimationClip CLIPS[] = {
+    {"idle", 4, 0.1f, true},   {"walk", 8, 0.1f, true},
+    {"run", 8, 0.08f, true},   {"jump", 3, 0.1f, false},
+    {"fall", 3, 0.1f, true},   {"attack", 6, 0.05f, false},
+    {"die", 10, 0.1f, false},
+};
+
+static const AnimationTransition TRANSITIONS[] = {
+    {ANIMATION_ANY_STATE, DIE, DEAD, 0},
+    {DIE, DIE, 0, 0},
+    {ANIMATION_ANY_STATE, ATTACK, ATTACKING, 0},
+    {ATTACK, IDLE, ANIMATION_FINISHED, 0},
+    {ATTACK, ATTACK, 0, 0},
+    {ANIMATION_ANY_STATE, JUMP, RISING, 0},
+    {ANIMATION_ANY_STATE, FALL, FALLING, 0},
+    {ANIMATION_ANY_STATE, RUN, MOVING | RUNNING, RISING | FALLING},
+    {ANIMATION_ANY_STATE, WALK, MOVING, RUNNING | RISING | FALLING},
+    {ANIMATION_ANY_STATE, IDLE, 0, MOVING | RISING | FALLING},
+};
+
+typedef struct {
+  AnimationGraph *graph;
+  AnimationSystem *system;
+  AnimatorId *ids;
+  uint64_t state;
+} Context;
+
+static uint64_t NextRandom(uint64_t *const state) {
+  /* xorshift64, deterministic so every run takes the same transitions */
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/* The param is the number of animators */
+static void *Setup(const size_t param) {
+  Context *const ctx = xmalloc(sizeof(Context));
+  ctx->graph = AnimationGraphCreate(CLIPS, LENGTH(CLIPS), TRANSITIONS,
+                                    LENGTH(TRANSITIONS), IDLE);
+  ctx->system = AnimationSystemCreate();
+  ctx->ids = xmalloc(param * sizeof(AnimatorId));
+  for (size_t i = 0; i < param; i++) {
+    ctx->ids[i] = AnimationSystemAdd(ctx->system, ctx->graph);
+  }
+  ctx->state = 0x9E3779B97F4A7C15u;
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  AnimationSystemDestroy(ctx->system);
+  AnimationGraphDestroy(ctx->graph);
+  free(ctx->ids);
+  free(ctx);
+}
+
+/* One tick: every enemy sets its conditions, then all are advanced. About
+ * one in sixteen changes what it is doing. */
+static size_t RunTick(void *const ptr, const size_t param) {
+  Context *const ctx = ptr;
+  for (size_t i = 0; i < param; i++) {
+    const uint64_t random = NextRandom(&ctx->state);
+    const uint32_t conditions =
+        ((random & 0xF) == 0) ? (uint32_t)(random >> 4) & 0x1F : MOVING;
+    AnimationSystemSetConditions(ctx->system, ctx->ids[i], conditions);
+  }
+  AnimationSystemUpdate(ctx->system, 1.0f / DEFAULT_TICK_RATE);
+  return param;
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"animation/tick", 1000, 0, Setup, RunTick, Teardown},
+    {"animation/tick", 5000, 0, Setup, RunTick, Teardown},
+    {"animation/tick", 50000, 0, Setup, RunTick, Teardown},
+};
+
+const BenchSuite BENCH_SUITE_ANIMATION =
+    BENCH_SUITE("animation", BENCHMARKS);
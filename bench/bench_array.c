@@ -0,0 +1,85 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "array.h"
+#include "bench.h"
+#include "utils.h"
+
+typedef struct {
+  float x, y;
+  uint32_t layer;
+  uint32_t texture;
+} DrawCommand;
+
+ARRAY_DEFINE(DrawList, DrawCommand, 16)
+
+static void *SetupEmpty(ARG_UNUSED size_t param) {
+  DrawList *const array = xmalloc(sizeof(DrawList));
+  DrawListInit(array);
+  return array;
+}
+
+static void *SetupFilled(const size_t param) {
+  DrawList *const array = SetupEmpty(param);
+  for (size_t i = 0; i < param; i++) {
+    const DrawCommand cmd = {(float)i, (float)i, (uint32_t)i % 4, 0};
+    DrawListAppend(array, cmd);
+  }
+  return array;
+}
+
+static void Teardown(void *const ptr) {
+  DrawListDestroy(ptr);
+  free(ptr);
+}
+
+static size_t RunAppend(void *const ptr, const size_t param) {
+  DrawList *const array = ptr;
+  for (size_t i = 0; i < param; i++) {
+    const DrawCommand cmd = {(float)i, (float)i, (uint32_t)i % 4, 0};
+    DrawListAppend(array, cmd);
+  }
+  return param;
+}
+
+/* Steady state per-frame use: clear and refill without allocating */
+static size_t RunClearRefill(void *const ptr, const size_t param) {
+  DrawList *const array = ptr;
+  DrawListClear(array);
+  return RunAppend(array, param);
+}
+
+static size_t RunIterate(void *const ptr, const size_t param) {
+  DrawList *const array = ptr;
+  const DrawCommand *const data = DrawListData(array);
+  float sum = 0.0f;
+  for (size_t i = 0; i < DrawListLength(array); i++) {
+    sum += data[i].x + data[i].y;
+  }
+  BenchDoNotOptimize(&sum);
+  return param;
+}
+
+static size_t RunSwapRemove(void *const ptr, const size_t param) {
+  DrawList *const array = ptr;
+  for (size_t i = 0; i < param; i++) {
+    const DrawCommand cmd = DrawListSwapRemove(array, 0);
+    BenchDoNotOptimize(&cmd);
+  }
+  return param;
+}
+
+#define ARRAY_BENCHMARKS(name, setup, run)                                     \
+  {name, 10, 0, setup, run, Teardown}, {name, 1000, 0, setup, run, Teardown},  \
+      {name, 100000, 0, setup, run, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    ARRAY_BENCHMARKS("array/append", SetupEmpty, RunAppend),
+    ARRAY_BENCHMARKS("array/clear_refill", SetupFilled, RunClearRefill),
+    ARRAY_BENCHMARKS("array/iterate", SetupFilled, RunIterate),
+    ARRAY_BENCHMARKS("array/swap_remove", SetupFilled, RunSwapRemove),
+};
+
+const BenchSuite BENCH_SUITE_ARRAY = BENCH_SUITE("array", BENCHMARKS);
@@ -0,0 +1,184 @@
+#include "config.h"
+
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "buffer.h"
+#include "utils.h"
+
+#define TEXT "The quick brown fox jumps over the lazy dog, again and again.\n"
+
+typedef struct {
+  size_t size;
+  char *path;
+} TempFile;
+
+static TempFile TEMP_FILES[8];
+static size_t NUM_TEMP_FILES = 0;
+
+static void RemoveTempFiles(void) {
+  for (size_t i = 0; i < NUM_TEMP_FILES; i++) {
+    unlink(TEMP_FILES[i].path);
+    free(TEMP_FILES[i].path);
+  }
+  NUM_TEMP_FILES = 0;
+}
+
+/* Files are created once per size and reused across repetitions */
+static const char *GetTempFile(const size_t size) {
+  for (size_t i = 0; i < NUM_TEMP_FILES; i++) {
+    if (TEMP_FILES[i].size == size) {
+      return TEMP_FILES[i].path;
+    }
+  }
+
+  assert(NUM_TEMP_FILES < LENGTH(TEMP_FILES));
+  if (NUM_TEMP_FILES == 0) {
+    atexit(RemoveTempFiles);
+  }
+
+  TEMP_FILES[NUM_TEMP_FILES].size = size;
+  TEMP_FILES[NUM_TEMP_FILES].path = BenchCreateTempFile(size);
+  return TEMP_FILES[NUM_TEMP_FILES++].path;
+}
+
+static void *Setup(ARG_UNUSED size_t param) { return BufferCreate(); }
+
+static void *SetupFile(const size_t param) {
+  GetTempFile(param);
+  return BufferCreate();
+}
+
+static void Teardown(void *const ptr) { BufferDestroy(ptr); }
+
+static size_t RunAppend(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferAppend(buf, (char)('a' + (i % 26)));
+  }
+  return param;
+}
+
+static size_t RunPrint(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferPrint(buf, TEXT);
+  }
+  return param;
+}
+
+static size_t RunPrintFormatLog(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferPrintFormat(buf, "<dbg>  %s:%d  Loading texture '%s' (%zu)\n",
+                      "texture.c", 42, "player/idle", i);
+  }
+  return param;
+}
+
+static size_t RunPrintFormatNumbers(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferPrintFormat(buf, "%zu,%d,%.3f\n", i, -(int)i, (double)i * 0.25);
+  }
+  return param;
+}
+
+/* Same output as RunPrintFormatNumbers(), using the typed append functions */
+static size_t RunAppendNumbers(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferAppendUnsigned(buf, i);
+    BufferAppend(buf, ',');
+    BufferAppendInt(buf, -(int)i);
+    BufferAppend(buf, ',');
+    BufferAppendFloat(buf, (double)i * 0.25, 3);
+    BufferAppend(buf, '\n');
+  }
+  return param;
+}
+
+static size_t RunPrintFormatHex(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferPrintFormat(buf, "%08zx ", i * 2654435761u);
+  }
+  return param;
+}
+
+static size_t RunAppendHex(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BufferAppendHex(buf, i * 2654435761u, 8);
+    BufferAppend(buf, ' ');
+  }
+  return param;
+}
+
+static size_t RunReadFile(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  NDEBUG_UNUSED const bool success = BufferReadFile(buf, GetTempFile(param));
+  assert(success);
+  assert(BufferLength(buf) == param);
+  return 1;
+}
+
+/* Count lines so that every byte of the file is actually touched */
+static size_t CountLines(const Buffer *const buf) {
+  const char *data = BufferData(buf);
+  const char *const end = data + BufferLength(buf);
+  size_t n_lines = 0;
+  while ((data = memchr(data, '\n', (size_t)(end - data))) != NULL) {
+    n_lines += 1;
+    data += 1;
+  }
+  return n_lines;
+}
+
+static size_t RunReadFileScan(void *const ptr, const size_t param) {
+  Buffer *const buf = ptr;
+  NDEBUG_UNUSED const bool success = BufferReadFile(buf, GetTempFile(param));
+  assert(success);
+  const size_t n_lines = CountLines(buf);
+  BenchDoNotOptimize(&n_lines);
+  return 1;
+}
+
+static size_t RunMapFileScan(ARG_UNUSED void *const ptr, const size_t param) {
+  Buffer *const buf = BufferMapFile(GetTempFile(param));
+  assert(buf != NULL);
+  assert(BufferLength(buf) == param);
+  const size_t n_lines = CountLines(buf);
+  BenchDoNotOptimize(&n_lines);
+  BufferDestroy(buf);
+  return 1;
+}
+
+#define BUFFER_BENCHMARKS(name, run)                                           \
+  {name, 100, 0, Setup, run, Teardown},                                        \
+      {name, 10000, 0, Setup, run, Teardown},                                  \
+      {name, 1000000, 0, Setup, run, Teardown}
+
+#define READ_FILE_BENCHMARK(size)                                              \
+  {"buffer/read_file", size, size, SetupFile, RunReadFile, Teardown},          \
+      {"buffer/read_file_scan", size, size, SetupFile, RunReadFileScan,        \
+       Teardown},                                                              \
+      {"buffer/map_file_scan", size, size, SetupFile, RunMapFileScan, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    BUFFER_BENCHMARKS("buffer/append", RunAppend),
+    BUFFER_BENCHMARKS("buffer/print", RunPrint),
+    BUFFER_BENCHMARKS("buffer/print_format_log", RunPrintFormatLog),
+    BUFFER_BENCHMARKS("buffer/print_format_numbers", RunPrintFormatNumbers),
+    BUFFER_BENCHMARKS("buffer/append_numbers", RunAppendNumbers),
+    BUFFER_BENCHMARKS("buffer/print_format_hex", RunPrintFormatHex),
+    BUFFER_BENCHMARKS("buffer/append_hex", RunAppendHex),
+    READ_FILE_BENCHMARK(64 * 1024),
+    READ_FILE_BENCHMARK(1024 * 1024),
+    READ_FILE_BENCHMARK(16 * 1024 * 1024),
+    READ_FILE_BENCHMARK(64 * 1024 * 1024),
+};
+
+const BenchSuite BENCH_SUITE_BUFFER = BENCH_SUITE("buffer", BENCHMARKS);
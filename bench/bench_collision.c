@@ -0,0 +1,82 @@
+#include "config.h"
+
+#include <stdint.h>
+
+#include "bench.h"
+#include "collision.h"
+#include "utils.h"
+
+#define LEVEL_TILES 128
+#define TILE_SIZE 32.0f
+#define LEVEL_SIZE (LEVEL_TILES * TILE_SIZE)
+#define NUM_BODIES 1024
+
+typedef struct {
+  CollisionWorld *world;
+  CollisionBox bodies[NUM_BODIES];
+  Vector velocities[NUM_BODIES];
+} Context;
+
+static uint64_t NextRandom(uint64_t *const state) {
+  /* xorshift64, deterministic so every run moves through the same level */
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+/* A level with about one solid tile in eight, and bodies moving at up to
+ * four tiles per tick. The param is the grid cell size, where a cell as
+ * large as the level tests every solid. */
+static void *Setup(const size_t param) {
+  Context *const ctx = xmalloc(sizeof(Context));
+  ctx->world = CollisionWorldCreate(LEVEL_SIZE, LEVEL_SIZE, (float)param);
+
+  uint64_t state = 0x9E3779B97F4A7C15u;
+  uint8_t *const tiles = xmalloc(LEVEL_TILES * LEVEL_TILES);
+  for (size_t i = 0; i < LEVEL_TILES * LEVEL_TILES; i++) {
+    tiles[i] = (NextRandom(&state) % 8) == 0;
+  }
+  const Vector origin = {.x = 0.0f, .y = 0.0f};
+  const Vector tile_size = {.width = TILE_SIZE, .height = TILE_SIZE};
+  CollisionWorldAddTiles(ctx->world, tiles, LEVEL_TILES, LEVEL_TILES, &origin,
+                         &tile_size);
+  free(tiles);
+
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    ctx->bodies[i].position.x = (float)(NextRandom(&state) % (int)LEVEL_SIZE);
+    ctx->bodies[i].position.y = (float)(NextRandom(&state) % (int)LEVEL_SIZE);
+    ctx->bodies[i].size.width = 24.0f;
+    ctx->bodies[i].size.height = 32.0f;
+    ctx->velocities[i].x = (float)(NextRandom(&state) % 257) - 128.0f;
+    ctx->velocities[i].y = (float)(NextRandom(&state) % 257) - 128.0f;
+  }
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  CollisionWorldDestroy(ctx->world);
+  free(ctx);
+}
+
+static size_t RunMove(void *const ptr, ARG_UNUSED const size_t param) {
+  Context *const ctx = ptr;
+  CollisionContacts contacts = 0;
+  for (size_t i = 0; i < NUM_BODIES; i++) {
+    contacts |=
+        CollisionMove(ctx->world, &ctx->bodies[i], &ctx->velocities[i]);
+  }
+  BenchDoNotOptimize(&contacts);
+  return NUM_BODIES;
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"collision/move", 32, 0, Setup, RunMove, Teardown},
+    {"collision/move", 64, 0, Setup, RunMove, Teardown},
+    {"collision/move", 256, 0, Setup, RunMove, Teardown},
+    {"collision/move", (size_t)LEVEL_SIZE, 0, Setup, RunMove, Teardown},
+};
+
+const BenchSuite BENCH_SUITE_COLLISION =
+    BENCH_SUITE("collision", BENCHMARKS);
@@ -0,0 +1,124 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3_image/SDL_image.h>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "buffer.h"
+#include "compress.h"
+#include "utils.h"
+
+/* Paths are relative to the repository root, as for the game itself */
+static const char *const IMAGES[] = {
+    "assets/player/idle.png", "assets/player/walk.png",
+    "assets/player/run.png",  "assets/player/jump.png",
+    "assets/player/fall.png", "assets/player/attack.png",
+    "assets/player/die.png",
+};
+
+static Buffer *PIXELS = NULL;
+
+static void FreePixels(void) { BufferDestroy(PIXELS); }
+
+/* Decoded RGBA32 pixels of all player animations, loaded once */
+static const Buffer *GetPixels(void) {
+  if (PIXELS != NULL) {
+    return PIXELS;
+  }
+
+  PIXELS = BufferCreate();
+  atexit(FreePixels);
+
+  for (size_t i = 0; i < LENGTH(IMAGES); i++) {
+    SDL_Surface *const image = IMG_Load(IMAGES[i]);
+    if (image == NULL) {
+      LOG_CRITICAL("Failed to load '%s' (run from the repository root): %s",
+                   IMAGES[i], SDL_GetError());
+    }
+    SDL_Surface *const surface =
+        SDL_ConvertSurface(image, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(image);
+    if (surface == NULL) {
+      LOG_CRITICAL("Failed to convert '%s': %s", IMAGES[i], SDL_GetError());
+    }
+
+    const size_t row_size = (size_t)surface->w * 4;
+    for (int row = 0; row < surface->h; row++) {
+      const char *const src =
+          (const char *)surface->pixels + ((size_t)row * surface->pitch);
+      BufferAppendSlice(PIXELS, SliceCreate(src, row_size));
+    }
+    SDL_DestroySurface(surface);
+  }
+
+  Buffer *const frame = BufferCreate();
+  CompressFrame(frame, BufferData(PIXELS), BufferLength(PIXELS));
+  /* Report the ratio on stderr to keep CSV and JSON output parsable */
+  fprintf(stderr, "compress: %zu bytes of pixel data to %zu bytes (%.2fx)\n",
+          BufferLength(PIXELS), BufferLength(frame),
+          (double)BufferLength(PIXELS) / (double)BufferLength(frame));
+  BufferDestroy(frame);
+  return PIXELS;
+}
+
+typedef struct {
+  const Buffer *pixels;
+  Buffer *frame;
+  Buffer *out;
+} Context;
+
+static void *Setup(ARG_UNUSED size_t param) {
+  Context *const ctx = xcalloc(1, sizeof(Context));
+  ctx->pixels = GetPixels();
+  ctx->frame = BufferCreate();
+  CompressFrame(ctx->frame, BufferData(ctx->pixels),
+                BufferLength(ctx->pixels));
+  ctx->out = BufferCreate();
+  BufferReserve(ctx->out, BufferLength(ctx->frame) +
+                              BufferLength(ctx->pixels));
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  BufferDestroy(ctx->frame);
+  BufferDestroy(ctx->out);
+  free(ctx);
+}
+
+static size_t RunCompress(void *const ptr, ARG_UNUSED size_t param) {
+  Context *const ctx = ptr;
+  CompressFrame(ctx->out, BufferData(ctx->pixels), BufferLength(ctx->pixels));
+  BenchDoNotOptimize(BufferData(ctx->out));
+  return BufferLength(ctx->pixels);
+}
+
+static size_t RunDecompress(void *const ptr, ARG_UNUSED size_t param) {
+  Context *const ctx = ptr;
+  NDEBUG_UNUSED const bool success = DecompressFrame(
+      ctx->out, BufferData(ctx->frame), BufferLength(ctx->frame));
+  assert(success);
+  assert(BufferLength(ctx->out) == BufferLength(ctx->pixels));
+  BenchDoNotOptimize(BufferData(ctx->out));
+  return BufferLength(ctx->pixels);
+}
+
+/* Baseline: the cost of touching the uncompressed bytes once */
+static size_t RunCopy(void *const ptr, ARG_UNUSED size_t param) {
+  Context *const ctx = ptr;
+  BufferAppendSlice(ctx->out, BufferSlice(ctx->pixels));
+  BenchDoNotOptimize(BufferData(ctx->out));
+  return BufferLength(ctx->pixels);
+}
+
+/* Operations are uncompressed bytes, so ns/op is the time per byte */
+static const Benchmark BENCHMARKS[] = {
+    {"compress/copy", 1, 0, Setup, RunCopy, Teardown},
+    {"compress/frame", 1, 0, Setup, RunCompress, Teardown},
+    {"compress/decompress_frame", 1, 0, Setup, RunDecompress, Teardown},
+};
+
+const BenchSuite BENCH_SUITE_COMPRESS = BENCH_SUITE("compress", BENCHMARKS);
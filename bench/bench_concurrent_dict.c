@@ -0,0 +1,239 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "concurrent_dict.h"
+#include "dict.h"
+#include "utils.h"
+
+/* Keys that are always present, followed by keys that the writer keeps
+ * inserting and removing. The value of each key is its index plus one. */
+#define NUM_KEYS 4096
+#define NUM_CHURN_KEYS 4096
+#define READS_PER_THREAD 100000
+
+typedef struct {
+  Dict *dict;
+  SDL_Mutex *lock;
+  ConcurrentDict *concurrent;
+  atomic_bool done;
+  size_t churn_step; /* Only accessed by the writer until it is joined */
+} Context;
+
+typedef struct {
+  Context *ctx;
+  unsigned seed;
+} Reader;
+
+static Atom KEYS[NUM_KEYS + NUM_CHURN_KEYS];
+
+static void *Setup(ARG_UNUSED size_t param) {
+  Context *const ctx = xmalloc(sizeof(Context));
+  ctx->dict = DictCreate();
+  ctx->lock = SDL_CreateMutex();
+  ctx->concurrent = ConcurrentDictCreate();
+  atomic_init(&ctx->done, false);
+  ctx->churn_step = 0;
+
+  for (size_t i = 0; i < NUM_KEYS + NUM_CHURN_KEYS; i++) {
+    if (KEYS[i] == NULL) {
+      char key[32];
+      snprintf(key, sizeof(key), "texture/%zu", i);
+      KEYS[i] = AtomIntern(key);
+    }
+  }
+
+  for (size_t i = 0; i < NUM_KEYS; i++) {
+    DictSetAtom(ctx->dict, KEYS[i], (void *)(uintptr_t)(i + 1), NULL);
+    ConcurrentDictSet(ctx->concurrent, KEYS[i], (void *)(uintptr_t)(i + 1),
+                      NULL);
+  }
+
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  DictDestroy(ctx->dict);
+  SDL_DestroyMutex(ctx->lock);
+  ConcurrentDictDestroy(ctx->concurrent);
+  free(ctx);
+}
+
+static inline size_t NextIndex(unsigned *const seed) {
+  *seed = (*seed * 1103515245u) + 12345u;
+  return (*seed >> 8) % (NUM_KEYS + NUM_CHURN_KEYS);
+}
+
+/* Fail unless a lookup agrees with the keys the writer never removes and
+ * the values of all keys. Runs in every build, unlike an assert. */
+static void CheckLookup(const size_t index, const bool found,
+                        const void *const value) {
+  if (!found) {
+    if (index < NUM_KEYS) {
+      LOG_CRITICAL("Key %zu went missing", index);
+    }
+    return;
+  }
+  if ((uintptr_t)value != index + 1) {
+    LOG_CRITICAL("Key %zu has value %" PRIuPTR ", expected %zu", index,
+                 (uintptr_t)value, index + 1);
+  }
+}
+
+/**
+ * @brief Take the next step of the writer, which inserts all churn keys and
+ *        then removes them again, over and over.
+ * @param ctx The benchmark context.
+ * @param insert Set to whether to insert or remove the key.
+ * @return The index of the key.
+ * @note Inserting grows the shards and removing leaves tombstones that later
+ *       inserts compact, so readers see both kinds of rehash.
+ */
+static size_t NextChurn(Context *const ctx, bool *const insert) {
+  const size_t step = ctx->churn_step++ % (2 * NUM_CHURN_KEYS);
+  *insert = step < NUM_CHURN_KEYS;
+  return NUM_KEYS + (step % NUM_CHURN_KEYS);
+}
+
+/* Number of churn keys present once the writer has stopped */
+static size_t ChurnLength(const Context *const ctx) {
+  const size_t step = ctx->churn_step % (2 * NUM_CHURN_KEYS);
+  return (step <= NUM_CHURN_KEYS) ? step : (2 * NUM_CHURN_KEYS) - step;
+}
+
+static int MutexReader(void *const data) {
+  Reader *const reader = data;
+  Context *const ctx = reader->ctx;
+  for (size_t i = 0; i < READS_PER_THREAD; i++) {
+    const size_t index = NextIndex(&reader->seed);
+    SDL_LockMutex(ctx->lock);
+    const bool found = DictHasAtom(ctx->dict, KEYS[index]);
+    const void *const value =
+        found ? DictGetAtom(ctx->dict, KEYS[index]) : NULL;
+    SDL_UnlockMutex(ctx->lock);
+    CheckLookup(index, found, value);
+  }
+  return 0;
+}
+
+static int MutexWriter(void *const data) {
+  Context *const ctx = data;
+  while (!atomic_load_explicit(&ctx->done, memory_order_relaxed)) {
+    bool insert;
+    const size_t index = NextChurn(ctx, &insert);
+    SDL_LockMutex(ctx->lock);
+    if (insert) {
+      DictSetAtom(ctx->dict, KEYS[index], (void *)(uintptr_t)(index + 1),
+                  NULL);
+    } else {
+      DictRemoveAtom(ctx->dict, KEYS[index]);
+    }
+    SDL_UnlockMutex(ctx->lock);
+  }
+  return 0;
+}
+
+static size_t MutexLength(const Context *const ctx) {
+  return DictLength(ctx->dict);
+}
+
+static int ConcurrentReader(void *const data) {
+  Reader *const reader = data;
+  Context *const ctx = reader->ctx;
+  for (size_t i = 0; i < READS_PER_THREAD; i++) {
+    const size_t index = NextIndex(&reader->seed);
+    void *value = NULL;
+    const bool found = ConcurrentDictGet(ctx->concurrent, KEYS[index], &value);
+    CheckLookup(index, found, value);
+  }
+  return 0;
+}
+
+static size_t ConcurrentLength(const Context *const ctx) {
+  return ConcurrentDictLength(ctx->concurrent);
+}
+
+static int ConcurrentWriter(void *const data) {
+  Context *const ctx = data;
+  while (!atomic_load_explicit(&ctx->done, memory_order_relaxed)) {
+    bool insert;
+    const size_t index = NextChurn(ctx, &insert);
+    if (insert) {
+      ConcurrentDictSet(ctx->concurrent, KEYS[index],
+                        (void *)(uintptr_t)(index + 1), NULL);
+    } else if (!ConcurrentDictRemove(ctx->concurrent, KEYS[index], NULL)) {
+      LOG_CRITICAL("Key %zu was not found for removal", index);
+    }
+  }
+  return 0;
+}
+
+/* Run readers until they are done while a writer keeps inserting and
+ * removing entries, then check that no entry was lost or duplicated */
+static size_t RunReaders(Context *const ctx, const size_t n_readers,
+                         SDL_ThreadFunction reader_func,
+                         SDL_ThreadFunction writer_func,
+                         size_t (*length_func)(const Context *)) {
+  Reader *const readers = xcalloc(n_readers, sizeof(Reader));
+  SDL_Thread **const threads = xcalloc(n_readers, sizeof(SDL_Thread *));
+
+  SDL_Thread *const writer = SDL_CreateThread(writer_func, "writer", ctx);
+  if (writer == NULL) {
+    LOG_CRITICAL("Failed to create thread: %s", SDL_GetError());
+  }
+
+  for (size_t i = 0; i < n_readers; i++) {
+    readers[i].ctx = ctx;
+    readers[i].seed = (unsigned)i + 1;
+    threads[i] = SDL_CreateThread(reader_func, "reader", &readers[i]);
+    if (threads[i] == NULL) {
+      LOG_CRITICAL("Failed to create thread: %s", SDL_GetError());
+    }
+  }
+
+  for (size_t i = 0; i < n_readers; i++) {
+    SDL_WaitThread(threads[i], NULL);
+  }
+
+  atomic_store_explicit(&ctx->done, true, memory_order_relaxed);
+  SDL_WaitThread(writer, NULL);
+
+  const size_t expected = NUM_KEYS + ChurnLength(ctx);
+  const size_t length = length_func(ctx);
+  if (length != expected) {
+    LOG_CRITICAL("Dictionary holds %zu entries, expected %zu", length,
+                 expected);
+  }
+
+  free(threads);
+  free(readers);
+  return n_readers * READS_PER_THREAD;
+}
+
+static size_t RunMutex(void *const ptr, const size_t param) {
+  return RunReaders(ptr, param, MutexReader, MutexWriter, MutexLength);
+}
+
+static size_t RunConcurrent(void *const ptr, const size_t param) {
+  return RunReaders(ptr, param, ConcurrentReader, ConcurrentWriter,
+                    ConcurrentLength);
+}
+
+/* The parameter is the number of reader threads */
+#define CONCURRENT_BENCHMARKS(name, run)                                       \
+  {name, 1, 0, Setup, run, Teardown}, {name, 4, 0, Setup, run, Teardown},      \
+      {name, 16, 0, Setup, run, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    CONCURRENT_BENCHMARKS("concurrent_dict/mutex_read", RunMutex),
+    CONCURRENT_BENCHMARKS("concurrent_dict/lock_free_read", RunConcurrent),
+};
+
+const BenchSuite BENCH_SUITE_CONCURRENT_DICT =
+    BENCH_SUITE("concurrent_dict", BENCHMARKS);
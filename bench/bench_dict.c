@@ -0,0 +1,172 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "bench.h"
+#include "dict.h"
+#include "utils.h"
+
+#define KEY_POOL_SIZE (2 * 100000)
+#define KEY_SIZE 16
+
+typedef struct {
+  Dict *dict;
+  size_t prefill;
+} DictContext;
+
+static char KEYS[KEY_POOL_SIZE][KEY_SIZE];
+static bool KEYS_INITIALIZED = false;
+
+static const char *GetKey(const size_t index) {
+  assert(index < KEY_POOL_SIZE);
+
+  if (!KEYS_INITIALIZED) {
+    for (size_t i = 0; i < KEY_POOL_SIZE; i++) {
+      NDEBUG_UNUSED const int ret =
+          snprintf(KEYS[i], KEY_SIZE, "key/%zu", i * 7919);
+      assert(ret > 0 && ret < KEY_SIZE);
+    }
+    KEYS_INITIALIZED = true;
+  }
+
+  return KEYS[index];
+}
+
+static void *SetupEmpty(ARG_UNUSED size_t param) {
+  DictContext *const ctx = xmalloc(sizeof(DictContext));
+  ctx->dict = DictCreate();
+  ctx->prefill = 0;
+  GetKey(0);
+  return ctx;
+}
+
+static void *SetupFilled(const size_t param) {
+  assert(2 * param <= KEY_POOL_SIZE);
+
+  DictContext *const ctx = SetupEmpty(param);
+  for (size_t i = 0; i < param; i++) {
+    DictSet(ctx->dict, GetKey(i), (void *)(KEYS + i), NULL);
+  }
+  ctx->prefill = param;
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  DictContext *const ctx = ptr;
+  DictDestroy(ctx->dict);
+  free(ctx);
+}
+
+static size_t RunSet(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  for (size_t i = 0; i < param; i++) {
+    DictSet(ctx->dict, GetKey(i), (void *)(KEYS + i), NULL);
+  }
+  return param;
+}
+
+static size_t RunGet(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BenchDoNotOptimize(DictGet(ctx->dict, GetKey(i)));
+  }
+  return param;
+}
+
+static size_t RunGetMissing(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  size_t found = 0;
+  for (size_t i = 0; i < param; i++) {
+    found += DictHasKey(ctx->dict, GetKey(param + i)) ? 1 : 0;
+  }
+  BenchDoNotOptimize(&found);
+  return param;
+}
+
+static size_t RunRemove(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BenchDoNotOptimize(DictRemove(ctx->dict, GetKey(i)));
+  }
+  return param;
+}
+
+/* Remove the oldest key and insert a new one, keeping the number of live
+ * entries (and thus the load factor) constant while tombstones accumulate. */
+static size_t RunChurn(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BenchDoNotOptimize(DictRemove(ctx->dict, GetKey(i)));
+    DictSet(ctx->dict, GetKey(param + i), (void *)(KEYS + i), NULL);
+  }
+  return param;
+}
+
+static size_t RunSetMany(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  const char *keys[256];
+  void *values[256];
+
+  for (size_t i = 0; i < param; i += LENGTH(keys)) {
+    const size_t n = MIN(LENGTH(keys), param - i);
+    for (size_t j = 0; j < n; j++) {
+      keys[j] = GetKey(i + j);
+      values[j] = (void *)(KEYS + i + j);
+    }
+    DictSetMany(ctx->dict, keys, values, n, NULL);
+  }
+  return param;
+}
+
+static size_t RunClearRefill(void *const ptr, const size_t param) {
+  DictContext *const ctx = ptr;
+  DictClear(ctx->dict);
+  return RunSet(ctx, param);
+}
+
+static size_t RunIterate(void *const ptr, ARG_UNUSED size_t param) {
+  DictContext *const ctx = ptr;
+  DictIterator iter;
+  DictIteratorInit(&iter, ctx->dict);
+
+  size_t count = 0;
+  void *value;
+  while (DictIteratorNext(&iter, NULL, &value)) {
+    BenchDoNotOptimize(value);
+    count += 1;
+  }
+  return count;
+}
+
+static size_t RunGetKeys(void *const ptr, ARG_UNUSED size_t param) {
+  DictContext *const ctx = ptr;
+  List *const keys = DictGetKeys(ctx->dict);
+  const size_t count = ListLength(keys);
+  ListDestroy(keys);
+  return count;
+}
+
+/* Sizes are picked to exercise both low (~0.4) and high (~0.7) load factors
+ * given the default capacity and growth policy. */
+#define DICT_BENCHMARKS(name, setup, run)                                      \
+  {name, 100, 0, setup, run, Teardown},                                        \
+      {name, 180, 0, setup, run, Teardown},                                    \
+      {name, 1500, 0, setup, run, Teardown},                                   \
+      {name, 12000, 0, setup, run, Teardown},                                  \
+      {name, 100000, 0, setup, run, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    DICT_BENCHMARKS("dict/set", SetupEmpty, RunSet),
+    DICT_BENCHMARKS("dict/update", SetupFilled, RunSet),
+    DICT_BENCHMARKS("dict/get", SetupFilled, RunGet),
+    DICT_BENCHMARKS("dict/get_missing", SetupFilled, RunGetMissing),
+    DICT_BENCHMARKS("dict/remove", SetupFilled, RunRemove),
+    DICT_BENCHMARKS("dict/churn", SetupFilled, RunChurn),
+    DICT_BENCHMARKS("dict/set_many", SetupEmpty, RunSetMany),
+    DICT_BENCHMARKS("dict/clear_refill", SetupFilled, RunClearRefill),
+    DICT_BENCHMARKS("dict/iterate", SetupFilled, RunIterate),
+    DICT_BENCHMARKS("dict/get_keys", SetupFilled, RunGetKeys),
+};
+
+const BenchSuite BENCH_SUITE_DICT = BENCH_SUITE("dict", BENCHMARKS);
@@ -0,0 +1,178 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "allocator.h"
+#include "bench.h"
+#include "list.h"
+#include "utils.h"
+
+static void *SetupEmpty(ARG_UNUSED size_t param) { return ListCreate(); }
+
+static void *SetupFilled(const size_t param) {
+  List *const list = ListCreate();
+  for (size_t i = 0; i < param; i++) {
+    ListAppend(list, (void *)(uintptr_t)i, NULL);
+  }
+  return list;
+}
+
+static void Teardown(void *const ptr) { ListDestroy(ptr); }
+
+typedef struct {
+  Arena *arena;
+  List *list;
+} ArenaContext;
+
+static void *SetupArena(ARG_UNUSED size_t param) {
+  ArenaContext *const ctx = xmalloc(sizeof(ArenaContext));
+  ctx->arena = ArenaCreate(0);
+  ctx->list = ListCreateInArena(ctx->arena);
+  return ctx;
+}
+
+static void *SetupArenaFilled(const size_t param) {
+  ArenaContext *const ctx = SetupArena(param);
+  for (size_t i = 0; i < param; i++) {
+    ListAppend(ctx->list, (void *)(uintptr_t)i, NULL);
+  }
+  return ctx;
+}
+
+static void TeardownArena(void *const ptr) {
+  ArenaContext *const ctx = ptr;
+  ArenaDestroy(ctx->arena);
+  free(ctx);
+}
+
+static void *SetupFilledDestroy(const size_t param) {
+  List **const list = xmalloc(sizeof(List *));
+  *list = SetupFilled(param);
+  return list;
+}
+
+static void TeardownDestroy(void *const ptr) { free(ptr); }
+
+static size_t RunAppend(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  for (size_t i = 0; i < param; i++) {
+    ListAppend(list, (void *)(uintptr_t)i, NULL);
+  }
+  return param;
+}
+
+static size_t RunInsertFront(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  for (size_t i = 0; i < param; i++) {
+    ListInsert(list, 0, (void *)(uintptr_t)i, NULL);
+  }
+  return param;
+}
+
+static size_t RunInsertMiddle(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  for (size_t i = 0; i < param; i++) {
+    ListInsert(list, ListLength(list) / 2, (void *)(uintptr_t)i, NULL);
+  }
+  return param;
+}
+
+static size_t RunRemoveFront(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BenchDoNotOptimize(ListRemove(list, 0));
+  }
+  return param;
+}
+
+static size_t RunRemoveBack(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  for (size_t i = 0; i < param; i++) {
+    BenchDoNotOptimize(ListRemove(list, ListLength(list) - 1));
+  }
+  return param;
+}
+
+static size_t RunAppendArena(void *const ptr, const size_t param) {
+  ArenaContext *const ctx = ptr;
+  return RunAppend(ctx->list, param);
+}
+
+static size_t RunDestroy(void *const ptr, const size_t param) {
+  List **const list = ptr;
+  ListDestroy(*list);
+  return param;
+}
+
+static size_t RunArenaReset(void *const ptr, const size_t param) {
+  ArenaContext *const ctx = ptr;
+  ArenaReset(ctx->arena);
+  return param;
+}
+
+static size_t RunIterate(void *const ptr, const size_t param) {
+  List *const list = ptr;
+  uintptr_t sum = 0;
+  for (size_t i = 0; i < param; i++) {
+    sum += (uintptr_t)ListGet(list, i);
+  }
+  BenchDoNotOptimize(&sum);
+  return param;
+}
+
+/* Elements in a temporary list, e.g. the draw list of a frame */
+#define TEMPORARY_LENGTH 64
+
+/* The param is the number of frames, each building and dropping a list */
+static size_t RunTemporary(ARG_UNUSED void *const ptr, const size_t param) {
+  for (size_t frame = 0; frame < param; frame++) {
+    List *const list = ListCreate();
+    RunAppend(list, TEMPORARY_LENGTH);
+    ListDestroy(list);
+  }
+  return param;
+}
+
+static size_t RunTemporaryFrame(ARG_UNUSED void *const ptr,
+                                const size_t param) {
+  for (size_t frame = 0; frame < param; frame++) {
+    FrameArenaBegin();
+    List *const list = ListCreateWithAllocator(FrameAllocator());
+    RunAppend(list, TEMPORARY_LENGTH);
+  }
+  return param;
+}
+
+static void TeardownFrame(ARG_UNUSED void *const ptr) { FrameArenaShutdown(); }
+
+#define LIST_BENCHMARKS(name, setup, run)                                      \
+  {name, 100, 0, setup, run, Teardown},                                        \
+      {name, 1000, 0, setup, run, Teardown},                                   \
+      {name, 10000, 0, setup, run, Teardown},                                  \
+      {name, 100000, 0, setup, run, Teardown}
+
+/* Shifting operations are quadratic, so skip the largest size */
+#define LIST_BENCHMARKS_SHIFTING(name, setup, run)                             \
+  {name, 100, 0, setup, run, Teardown},                                        \
+      {name, 1000, 0, setup, run, Teardown},                                   \
+      {name, 10000, 0, setup, run, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    LIST_BENCHMARKS("list/append", SetupEmpty, RunAppend),
+    LIST_BENCHMARKS_SHIFTING("list/insert_front", SetupEmpty, RunInsertFront),
+    LIST_BENCHMARKS_SHIFTING("list/insert_middle", SetupEmpty,
+                             RunInsertMiddle),
+    LIST_BENCHMARKS_SHIFTING("list/remove_front", SetupFilled, RunRemoveFront),
+    LIST_BENCHMARKS("list/remove_back", SetupFilled, RunRemoveBack),
+    LIST_BENCHMARKS("list/iterate", SetupFilled, RunIterate),
+    {"list/append_arena", 100000, 0, SetupArena, RunAppendArena, TeardownArena},
+    {"list/destroy", 100000, 0, SetupFilledDestroy, RunDestroy,
+     TeardownDestroy},
+    {"list/destroy_arena", 100000, 0, SetupArenaFilled, RunArenaReset,
+     TeardownArena},
+    {"list/temporary", 10000, 0, NULL, RunTemporary, NULL},
+    {"list/temporary_frame", 10000, 0, NULL, RunTemporaryFrame, TeardownFrame},
+};
+
+const BenchSuite BENCH_SUITE_LIST = BENCH_SUITE("list", BENCHMARKS);
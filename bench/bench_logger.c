@@ -0,0 +1,76 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "logger.h"
+#include "utils.h"
+
+/* Fewer than fit in a ring, so that no message is dropped */
+#define NUM_MESSAGES 512
+
+typedef struct {
+  char *path;
+} Context;
+
+/* Records go to a binary log file, so that the console stays parsable */
+static void *Setup(ARG_UNUSED size_t param) {
+  Context *const ctx = xcalloc(1, sizeof(Context));
+  ctx->path = BenchCreateTempFile(0);
+  if (!LogSetBinaryOutput(ctx->path)) {
+    LOG_CRITICAL("Failed to set binary log output");
+  }
+  LogInit();
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  LogShutdown();
+  unlink(ctx->path);
+  free(ctx->path);
+  free(ctx);
+}
+
+static size_t RunBinary(ARG_UNUSED void *const ptr,
+                        ARG_UNUSED const size_t param) {
+  for (int i = 0; i < NUM_MESSAGES; i++) {
+    LOG_INFO("Object %d at (%.2f, %.2f) in state '%s'", i, (double)i * 0.5,
+             (double)i * 0.25, "idle");
+  }
+  return NUM_MESSAGES;
+}
+
+/* Filtered by the runtime level check, unless run with --debug */
+static size_t RunDisabled(ARG_UNUSED void *const ptr,
+                          ARG_UNUSED const size_t param) {
+  for (int i = 0; i < NUM_MESSAGES; i++) {
+    LOG_DEBUG("Object %d at (%.2f, %.2f) in state '%s'", i, (double)i * 0.5,
+              (double)i * 0.25, "idle");
+  }
+  return NUM_MESSAGES;
+}
+
+/* Baseline: formatting the message on the calling thread, as synchronous
+ * logging does before it writes anything */
+static size_t RunSnprintf(ARG_UNUSED void *const ptr,
+                          ARG_UNUSED const size_t param) {
+  char message[256];
+  for (int i = 0; i < NUM_MESSAGES; i++) {
+    snprintf(message, sizeof(message),
+             "Object %d at (%.2f, %.2f) in state '%s'", i, (double)i * 0.5,
+             (double)i * 0.25, "idle");
+    BenchDoNotOptimize(message);
+  }
+  return NUM_MESSAGES;
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"logger/snprintf", 1, 0, Setup, RunSnprintf, Teardown},
+    {"logger/binary", 1, 0, Setup, RunBinary, Teardown},
+    {"logger/disabled", 1, 0, Setup, RunDisabled, Teardown},
+};
+
+const BenchSuite BENCH_SUITE_LOGGER = BENCH_SUITE("logger", BENCHMARKS);
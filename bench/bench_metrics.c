@@ -0,0 +1,82 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "bench.h"
+#include "metrics.h"
+#include "utils.h"
+
+#define NUM_UPDATES (1 << 20)
+#define MAX_THREADS 8
+
+/* Baseline: a single counter shared by all threads */
+static atomic_uint_least64_t SHARED_COUNTER = 0;
+
+typedef struct {
+  size_t n_updates;
+} Worker;
+
+static int SharedWorker(void *const data) {
+  const Worker *const worker = data;
+  for (size_t i = 0; i < worker->n_updates; i++) {
+    atomic_fetch_add_explicit(&SHARED_COUNTER, 1, memory_order_relaxed);
+  }
+  return 0;
+}
+
+static int AddWorker(void *const data) {
+  const Worker *const worker = data;
+  for (size_t i = 0; i < worker->n_updates; i++) {
+    MetricsAdd(METRICS_DRAW_CALLS, 1);
+  }
+  return 0;
+}
+
+static int ObserveWorker(void *const data) {
+  const Worker *const worker = data;
+  for (size_t i = 0; i < worker->n_updates; i++) {
+    MetricsObserve(METRICS_DICT_PROBE_LENGTH, i & 7);
+  }
+  return 0;
+}
+
+/* Split NUM_UPDATES over n threads */
+static size_t Run(const size_t n_threads, SDL_ThreadFunction function) {
+  SDL_Thread *threads[MAX_THREADS];
+  Worker worker = {NUM_UPDATES / n_threads};
+  for (size_t i = 0; i < n_threads; i++) {
+    threads[i] = SDL_CreateThread(function, "metrics", &worker);
+    if (threads[i] == NULL) {
+      LOG_CRITICAL("Failed to create thread: %s", SDL_GetError());
+    }
+  }
+  for (size_t i = 0; i < n_threads; i++) {
+    SDL_WaitThread(threads[i], NULL);
+  }
+  return worker.n_updates * n_threads;
+}
+
+static size_t RunShared(ARG_UNUSED void *const ctx, const size_t param) {
+  return Run(param, SharedWorker);
+}
+
+static size_t RunAdd(ARG_UNUSED void *const ctx, const size_t param) {
+  return Run(param, AddWorker);
+}
+
+static size_t RunObserve(ARG_UNUSED void *const ctx, const size_t param) {
+  return Run(param, ObserveWorker);
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"metrics/shared_atomic", 1, 0, NULL, RunShared, NULL},
+    {"metrics/shared_atomic", 4, 0, NULL, RunShared, NULL},
+    {"metrics/add", 1, 0, NULL, RunAdd, NULL},
+    {"metrics/add", 4, 0, NULL, RunAdd, NULL},
+    {"metrics/observe", 1, 0, NULL, RunObserve, NULL},
+    {"metrics/observe", 4, 0, NULL, RunObserve, NULL},
+};
+
+const BenchSuite BENCH_SUITE_METRICS = BENCH_SUITE("metrics", BENCHMARKS);
@@ -0,0 +1,291 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "queue.h"
+#include "utils.h"
+
+#define NUM_ITEMS (1 << 20)
+#define QUEUE_CAPACITY 1024
+#define BATCH_SIZE 64
+
+/* Baseline: a ring guarded by a mutex, as one would write it without atomics */
+typedef struct {
+  SDL_Mutex *lock;
+  SDL_Condition *not_empty;
+  SDL_Condition *not_full;
+  size_t head, tail;
+  uint64_t slots[QUEUE_CAPACITY];
+} MutexQueue;
+
+typedef struct {
+  SpscQueue *spsc;
+  MpmcQueue *mpmc;
+  MutexQueue *mutex;
+  size_t n_producers;
+  atomic_uchar *seen; /* Times each value was popped */
+} Context;
+
+typedef struct {
+  Context *ctx;
+  size_t begin, end; /* Range of values to push or number to pop */
+  bool batch;
+} Worker;
+
+/* Count a popped value, so that duplicates and gaps can be found */
+static inline void Mark(Context *const ctx, const uint64_t value) {
+  if (value >= NUM_ITEMS) {
+    LOG_CRITICAL("Popped value %" PRIu64 " that was never pushed", value);
+  }
+  atomic_fetch_add_explicit(&ctx->seen[value], 1, memory_order_relaxed);
+}
+
+static void MutexQueuePush(MutexQueue *const queue, const uint64_t value) {
+  SDL_LockMutex(queue->lock);
+  while (queue->tail - queue->head == QUEUE_CAPACITY) {
+    SDL_WaitCondition(queue->not_full, queue->lock);
+  }
+  queue->slots[queue->tail++ % QUEUE_CAPACITY] = value;
+  SDL_SignalCondition(queue->not_empty);
+  SDL_UnlockMutex(queue->lock);
+}
+
+static uint64_t MutexQueuePop(MutexQueue *const queue) {
+  SDL_LockMutex(queue->lock);
+  while (queue->tail == queue->head) {
+    SDL_WaitCondition(queue->not_empty, queue->lock);
+  }
+  const uint64_t value = queue->slots[queue->head++ % QUEUE_CAPACITY];
+  SDL_SignalCondition(queue->not_full);
+  SDL_UnlockMutex(queue->lock);
+  return value;
+}
+
+static void *Setup(const size_t param) {
+  Context *const ctx = xcalloc(1, sizeof(Context));
+  ctx->spsc = SpscQueueCreate(QUEUE_CAPACITY, sizeof(uint64_t));
+  ctx->mpmc = MpmcQueueCreate(QUEUE_CAPACITY, sizeof(uint64_t));
+  ctx->mutex = xcalloc(1, sizeof(MutexQueue));
+  ctx->mutex->lock = SDL_CreateMutex();
+  ctx->mutex->not_empty = SDL_CreateCondition();
+  ctx->mutex->not_full = SDL_CreateCondition();
+  ctx->n_producers = param;
+  ctx->seen = xcalloc(NUM_ITEMS, sizeof(atomic_uchar));
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  SpscQueueDestroy(ctx->spsc);
+  MpmcQueueDestroy(ctx->mpmc);
+  SDL_DestroyCondition(ctx->mutex->not_empty);
+  SDL_DestroyCondition(ctx->mutex->not_full);
+  SDL_DestroyMutex(ctx->mutex->lock);
+  free(ctx->mutex);
+  free((void *)ctx->seen);
+  free(ctx);
+}
+
+static int SpscProducer(void *const data) {
+  Worker *const worker = data;
+  SpscQueue *const queue = worker->ctx->spsc;
+  uint64_t batch[BATCH_SIZE];
+
+  size_t value = worker->begin;
+  while (value < worker->end) {
+    if (!worker->batch) {
+      const uint64_t element = value++;
+      SpscQueuePushWait(queue, &element, -1);
+      continue;
+    }
+
+    const size_t n = MIN((size_t)BATCH_SIZE, worker->end - value);
+    for (size_t i = 0; i < n; i++) {
+      batch[i] = value + i;
+    }
+    size_t pushed = SpscQueuePushMany(queue, batch, n);
+    if (pushed == 0) {
+      SpscQueuePushWait(queue, &batch[0], -1);
+      pushed = 1;
+    }
+    value += pushed;
+  }
+  return 0;
+}
+
+static int SpscConsumer(void *const data) {
+  Worker *const worker = data;
+  SpscQueue *const queue = worker->ctx->spsc;
+  uint64_t batch[BATCH_SIZE];
+
+  size_t remaining = worker->end - worker->begin;
+  while (remaining > 0) {
+    size_t popped = 1;
+    if (worker->batch) {
+      popped = SpscQueuePopMany(queue, batch, MIN(remaining, BATCH_SIZE));
+    }
+    if (!worker->batch || popped == 0) {
+      SpscQueuePopWait(queue, &batch[0], -1);
+      popped = 1;
+    }
+
+    for (size_t i = 0; i < popped; i++) {
+      Mark(worker->ctx, batch[i]);
+    }
+    remaining -= popped;
+  }
+  return 0;
+}
+
+static int MpmcProducer(void *const data) {
+  Worker *const worker = data;
+  MpmcQueue *const queue = worker->ctx->mpmc;
+  uint64_t batch[BATCH_SIZE];
+
+  size_t value = worker->begin;
+  while (value < worker->end) {
+    if (!worker->batch) {
+      const uint64_t element = value++;
+      MpmcQueuePushWait(queue, &element, -1);
+      continue;
+    }
+
+    const size_t n = MIN((size_t)BATCH_SIZE, worker->end - value);
+    for (size_t i = 0; i < n; i++) {
+      batch[i] = value + i;
+    }
+    size_t pushed = MpmcQueuePushMany(queue, batch, n);
+    if (pushed == 0) {
+      MpmcQueuePushWait(queue, &batch[0], -1);
+      pushed = 1;
+    }
+    value += pushed;
+  }
+  return 0;
+}
+
+static int MpmcConsumer(void *const data) {
+  Worker *const worker = data;
+  MpmcQueue *const queue = worker->ctx->mpmc;
+  uint64_t batch[BATCH_SIZE];
+
+  size_t remaining = worker->end - worker->begin;
+  while (remaining > 0) {
+    size_t popped = 1;
+    if (worker->batch) {
+      popped = MpmcQueuePopMany(queue, batch, MIN(remaining, BATCH_SIZE));
+    }
+    if (!worker->batch || popped == 0) {
+      MpmcQueuePopWait(queue, &batch[0], -1);
+      popped = 1;
+    }
+
+    for (size_t i = 0; i < popped; i++) {
+      Mark(worker->ctx, batch[i]);
+    }
+    remaining -= popped;
+  }
+  return 0;
+}
+
+static int MutexProducer(void *const data) {
+  Worker *const worker = data;
+  for (size_t value = worker->begin; value < worker->end; value++) {
+    MutexQueuePush(worker->ctx->mutex, value);
+  }
+  return 0;
+}
+
+static int MutexConsumer(void *const data) {
+  Worker *const worker = data;
+  for (size_t i = worker->begin; i < worker->end; i++) {
+    Mark(worker->ctx, MutexQueuePop(worker->ctx->mutex));
+  }
+  return 0;
+}
+
+/* Split NUM_ITEMS over n producers and as many consumers, then check that
+ * every value came out exactly once. The check runs in every build, since
+ * the benchmarks stand in for stress tests of the queues. */
+static size_t RunWorkers(Context *const ctx, SDL_ThreadFunction producer,
+                         SDL_ThreadFunction consumer, const bool batch) {
+  const size_t n = ctx->n_producers;
+  memset((void *)ctx->seen, 0, NUM_ITEMS * sizeof(atomic_uchar));
+  Worker *const workers = xcalloc(2 * n, sizeof(Worker));
+  SDL_Thread **const threads = xcalloc(2 * n, sizeof(SDL_Thread *));
+
+  for (size_t i = 0; i < n; i++) {
+    Worker *const p = &workers[i];
+    Worker *const c = &workers[n + i];
+    p->ctx = c->ctx = ctx;
+    p->begin = c->begin = (NUM_ITEMS * i) / n;
+    p->end = c->end = (NUM_ITEMS * (i + 1)) / n;
+    p->batch = c->batch = batch;
+  }
+
+  for (size_t i = 0; i < 2 * n; i++) {
+    threads[i] = SDL_CreateThread((i < n) ? producer : consumer, "queue",
+                                  &workers[i]);
+    if (threads[i] == NULL) {
+      LOG_CRITICAL("Failed to create thread: %s", SDL_GetError());
+    }
+  }
+
+  for (size_t i = 0; i < 2 * n; i++) {
+    SDL_WaitThread(threads[i], NULL);
+  }
+
+  for (size_t value = 0; value < NUM_ITEMS; value++) {
+    const unsigned count =
+        atomic_load_explicit(&ctx->seen[value], memory_order_relaxed);
+    if (count != 1) {
+      LOG_CRITICAL("Value %zu was popped %u times, expected once", value,
+                   count);
+    }
+  }
+
+  free(threads);
+  free(workers);
+  return NUM_ITEMS;
+}
+
+static size_t RunSpsc(void *const ptr, ARG_UNUSED size_t param) {
+  return RunWorkers(ptr, SpscProducer, SpscConsumer, false);
+}
+
+static size_t RunSpscBatch(void *const ptr, ARG_UNUSED size_t param) {
+  return RunWorkers(ptr, SpscProducer, SpscConsumer, true);
+}
+
+static size_t RunMpmc(void *const ptr, ARG_UNUSED size_t param) {
+  return RunWorkers(ptr, MpmcProducer, MpmcConsumer, false);
+}
+
+static size_t RunMpmcBatch(void *const ptr, ARG_UNUSED size_t param) {
+  return RunWorkers(ptr, MpmcProducer, MpmcConsumer, true);
+}
+
+static size_t RunMutex(void *const ptr, ARG_UNUSED size_t param) {
+  return RunWorkers(ptr, MutexProducer, MutexConsumer, false);
+}
+
+/* The parameter is the number of producers, each paired with a consumer, so
+ * 1 to 8 means 2 to 16 threads */
+#define QUEUE_BENCHMARKS(name, run)                                            \
+  {name, 1, 0, Setup, run, Teardown}, {name, 2, 0, Setup, run, Teardown},      \
+      {name, 4, 0, Setup, run, Teardown}, {name, 8, 0, Setup, run, Teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    {"queue/spsc", 1, 0, Setup, RunSpsc, Teardown},
+    {"queue/spsc_batch", 1, 0, Setup, RunSpscBatch, Teardown},
+    QUEUE_BENCHMARKS("queue/mpmc", RunMpmc),
+    QUEUE_BENCHMARKS("queue/mpmc_batch", RunMpmcBatch),
+    QUEUE_BENCHMARKS("queue/mutex", RunMutex),
+};
+
+const BenchSuite BENCH_SUITE_QUEUE = BENCH_SUITE("queue", BENCHMARKS);
@@ -0,0 +1,117 @@
+#include "config.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bench.h"
+#include "snapshot.h"
+#include "utils.h"
+
+/* Ticks captured or rewound per run */
+#define TICKS 16
+
+/* Same layout as the saved state of the player */
+typedef struct {
+  float x, y;
+  float vx, vy;
+  uint32_t contacts;
+  uint32_t flip;
+  uint32_t conditions;
+  float elapsed;
+  uint16_t state;
+  uint16_t frame;
+} Entity;
+
+typedef struct {
+  SnapshotRing *ring;
+  Entity *entities;
+  unsigned char *scene;
+} Context;
+
+/* Move the walking entities, about three in four, as a tick would */
+static void Step(Entity *const entities, const size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    Entity *const entity = &entities[i];
+    entity->x += entity->vx * (1.0f / DEFAULT_TICK_RATE);
+    entity->y += entity->vy * (1.0f / DEFAULT_TICK_RATE);
+    entity->elapsed += (entity->vx != 0.0f) ? 1.0f / DEFAULT_TICK_RATE : 0.0f;
+  }
+}
+
+static void Capture(Context *const ctx, const size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    memcpy(ctx->scene + (i * sizeof(Entity)), &ctx->entities[i],
+           sizeof(Entity));
+  }
+  SnapshotRingPush(ctx->ring, ctx->scene, n * sizeof(Entity));
+}
+
+/* The param is the number of entities */
+static void *Setup(const size_t param) {
+  Context *const ctx = xmalloc(sizeof(Context));
+  ctx->ring = SnapshotRingCreate(0, 0);
+  ctx->entities = xcalloc(param, sizeof(Entity));
+  ctx->scene = xmalloc(param * sizeof(Entity));
+  for (size_t i = 0; i < param; i++) {
+    ctx->entities[i].x = (float)(i % 1000) * 16.0f;
+    ctx->entities[i].y = (float)(i / 1000) * 16.0f;
+    ctx->entities[i].vx = (i % 4 != 0) ? 90.0f : 0.0f;
+  }
+
+  /* Warm up, so that the runs do not allocate */
+  Capture(ctx, param);
+  Step(ctx->entities, param);
+  Capture(ctx, param);
+  return ctx;
+}
+
+/* Setup with TICKS snapshots to rewind through */
+static void *SetupHistory(const size_t param) {
+  Context *const ctx = Setup(param);
+  for (size_t i = 0; i < TICKS; i++) {
+    Step(ctx->entities, param);
+    Capture(ctx, param);
+  }
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  Context *const ctx = ptr;
+  SnapshotRingDestroy(ctx->ring);
+  free(ctx->entities);
+  free(ctx->scene);
+  free(ctx);
+}
+
+/* Copy all entities into a scene, and push it */
+static size_t RunCapture(void *const ptr, const size_t param) {
+  Context *const ctx = ptr;
+  for (size_t tick = 0; tick < TICKS; tick++) {
+    Step(ctx->entities, param);
+    Capture(ctx, param);
+  }
+  return TICKS;
+}
+
+/* Step back, and copy the scene into all entities */
+static size_t RunRestore(void *const ptr, ARG_UNUSED const size_t param) {
+  Context *const ctx = ptr;
+  for (size_t tick = 0; tick < TICKS; tick++) {
+    size_t size;
+    const unsigned char *const scene = SnapshotRingRewind(ctx->ring, &size);
+    for (size_t i = 0; i < size / sizeof(Entity); i++) {
+      memcpy(&ctx->entities[i], scene + (i * sizeof(Entity)), sizeof(Entity));
+    }
+  }
+  BenchDoNotOptimize(ctx->entities);
+  return TICKS;
+}
+
+static const Benchmark BENCHMARKS[] = {
+    {"snapshot/capture", 1000, 0, Setup, RunCapture, Teardown},
+    {"snapshot/capture", 10000, 0, Setup, RunCapture, Teardown},
+    {"snapshot/restore", 1000, 0, SetupHistory, RunRestore, Teardown},
+    {"snapshot/restore", 10000, 0, SetupHistory, RunRestore, Teardown},
+};
+
+const BenchSuite BENCH_SUITE_SNAPSHOT = BENCH_SUITE("snapshot", BENCHMARKS);
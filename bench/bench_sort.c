@@ -0,0 +1,139 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+
+#include "bench.h"
+#include "list.h"
+#include "sort.h"
+#include "utils.h"
+
+typedef struct {
+  void *items;
+  void *scratch;
+} SortContext;
+
+static uint64_t NextRandom(uint64_t *const state) {
+  /* xorshift64, deterministic so every run sorts the same input */
+  *state ^= *state << 13;
+  *state ^= *state >> 7;
+  *state ^= *state << 17;
+  return *state;
+}
+
+static void *Setup32(const size_t param) {
+  SortContext *const ctx = xmalloc(sizeof(SortContext));
+  SortKey32 *const items = xmalloc(param * sizeof(SortKey32));
+  uint64_t state = 0x9E3779B97F4A7C15u;
+  for (size_t i = 0; i < param; i++) {
+    items[i].key = (uint32_t)NextRandom(&state);
+    items[i].index = (uint32_t)i;
+  }
+  ctx->items = items;
+  ctx->scratch = xmalloc(param * sizeof(SortKey32));
+  return ctx;
+}
+
+/* Composite draw-order keys: layer in the high byte, then y, then texture */
+static void *Setup64(const size_t param) {
+  SortContext *const ctx = xmalloc(sizeof(SortContext));
+  SortKey64 *const items = xmalloc(param * sizeof(SortKey64));
+  uint64_t state = 0x9E3779B97F4A7C15u;
+  for (size_t i = 0; i < param; i++) {
+    const uint64_t layer = NextRandom(&state) % 4;
+    const float y = (float)(NextRandom(&state) % 100000) / 10.0f;
+    const uint64_t texture = NextRandom(&state) % 64;
+    items[i].key =
+        (layer << 56) | ((uint64_t)SortKeyFromFloat(y) << 24) | texture;
+    items[i].index = (uint32_t)i;
+  }
+  ctx->items = items;
+  ctx->scratch = xmalloc(param * sizeof(SortKey64));
+  return ctx;
+}
+
+static void Teardown(void *const ptr) {
+  SortContext *const ctx = ptr;
+  free(ctx->items);
+  free(ctx->scratch);
+  free(ctx);
+}
+
+static int Compare32(const void *const a, const void *const b) {
+  const uint32_t x = ((const SortKey32 *)a)->key;
+  const uint32_t y = ((const SortKey32 *)b)->key;
+  return (x > y) - (x < y);
+}
+
+static int Compare64(const void *const a, const void *const b) {
+  const uint64_t x = ((const SortKey64 *)a)->key;
+  const uint64_t y = ((const SortKey64 *)b)->key;
+  return (x > y) - (x < y);
+}
+
+static size_t RunQsort32(void *const ptr, const size_t param) {
+  SortContext *const ctx = ptr;
+  qsort(ctx->items, param, sizeof(SortKey32), Compare32);
+  return param;
+}
+
+static size_t RunQsort64(void *const ptr, const size_t param) {
+  SortContext *const ctx = ptr;
+  qsort(ctx->items, param, sizeof(SortKey64), Compare64);
+  return param;
+}
+
+static size_t RunRadix32(void *const ptr, const size_t param) {
+  SortContext *const ctx = ptr;
+  RadixSort32(ctx->items, ctx->scratch, param);
+  return param;
+}
+
+static size_t RunRadix64(void *const ptr, const size_t param) {
+  SortContext *const ctx = ptr;
+  RadixSort64(ctx->items, ctx->scratch, param);
+  return param;
+}
+
+static size_t RunParallelMerge64(void *const ptr, const size_t param) {
+  SortContext *const ctx = ptr;
+  ParallelMergeSort(ctx->items, param, sizeof(SortKey64), Compare64, 0);
+  return param;
+}
+
+static void *SetupList(const size_t param) {
+  List *const list = ListCreate();
+  uint64_t state = 0x9E3779B97F4A7C15u;
+  for (size_t i = 0; i < param; i++) {
+    ListAppend(list, (void *)(uintptr_t)NextRandom(&state), NULL);
+  }
+  return list;
+}
+
+static int CompareValues(const void *const a, const void *const b) {
+  const uintptr_t x = (uintptr_t)a;
+  const uintptr_t y = (uintptr_t)b;
+  return (x > y) - (x < y);
+}
+
+static size_t RunListSort(void *const ptr, const size_t param) {
+  ListSort(ptr, CompareValues);
+  return param;
+}
+
+#define SORT_BENCHMARKS(name, setup, run, teardown)                            \
+  {name, 10000, 0, setup, run, teardown},                                      \
+      {name, 100000, 0, setup, run, teardown},                                 \
+      {name, 1000000, 0, setup, run, teardown}
+
+static const Benchmark BENCHMARKS[] = {
+    SORT_BENCHMARKS("sort/qsort32", Setup32, RunQsort32, Teardown),
+    SORT_BENCHMARKS("sort/radix32", Setup32, RunRadix32, Teardown),
+    SORT_BENCHMARKS("sort/qsort64", Setup64, RunQsort64, Teardown),
+    SORT_BENCHMARKS("sort/radix64", Setup64, RunRadix64, Teardown),
+    SORT_BENCHMARKS("sort/parallel_merge64", Setup64, RunParallelMerge64,
+                    Teardown),
+    SORT_BENCHMARKS("sort/list_sort", SetupList, RunListSort, ListDestroy),
+};
+
+const BenchSuite BENCH_SUITE_SORT = BENCH_SUITE("sort", BENCHMARKS);
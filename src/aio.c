@@ -0,0 +1,800 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_AIO
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif /* HAVE_LINUX_IO_URING_H */
+
+#include "aio.h"
+#include "array.h"
+#include "buffer.h"
+#include "logger.h"
+#include "queue.h"
+#include "utils.h"
+
+typedef enum AioStage {
+  AIO_STAGE_OPEN,
+  AIO_STAGE_READ,
+} AioStage;
+
+typedef struct AioRequest {
+  struct AioRequest *next; /* Next free request */
+  uint64_t id;
+  const char *filename; /* Owned by the caller */
+  void *user_data;
+  Buffer *buffer;
+  bool owns_buffer; /* Created for the request rather than passed in */
+  int fd;
+  int error;
+  AioStage stage;
+  uint64_t offset; /* Position of the first byte to read */
+  size_t length;   /* Number of bytes to read or 0 for the rest of the file */
+  size_t size;     /* Number of bytes to read when opened or 0 if unknown */
+  Uint64 submit_time;
+  Uint64 complete_time;
+} AioRequest;
+
+/* The array macros add const to the element type, which needs a typedef to
+ * apply to the pointer rather than the request */
+typedef AioRequest *AioRequestPtr;
+ARRAY_DEFINE(RequestArray, AioRequestPtr, 16)
+
+#ifdef HAVE_LINUX_IO_URING_H
+typedef struct IoUring {
+  int fd;
+  unsigned to_submit; /* Entries pushed since the last io_uring_enter(2) */
+  /* Submission queue */
+  void *sq_ring;
+  size_t sq_ring_size;
+  atomic_uint *sq_head;
+  atomic_uint *sq_tail;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  /* Completion queue */
+  void *cq_ring;
+  size_t cq_ring_size;
+  atomic_uint *cq_head;
+  atomic_uint *cq_tail;
+  unsigned cq_mask;
+  struct io_uring_cqe *cqes;
+} IoUring;
+#endif /* HAVE_LINUX_IO_URING_H */
+
+struct AioContext {
+  AioBackend backend; /* Either AIO_BACKEND_IO_URING or AIO_BACKEND_THREADS */
+  unsigned queue_depth;
+  size_t in_flight;
+  uint64_t next_id;
+  RequestArray queued;
+  RequestArray completed; /* Completed but not yet polled */
+  AioRequest *free_requests;
+  /* Thread backend */
+  MpmcQueue *requests;
+  MpmcQueue *completions;
+  SDL_Thread *threads[DEFAULT_AIO_THREADS];
+#ifdef HAVE_LINUX_IO_URING_H
+  IoUring ring;
+#endif /* HAVE_LINUX_IO_URING_H */
+};
+
+static void RequestDestroy(AioRequest *const request) {
+  assert(request != NULL);
+  if (request->owns_buffer) {
+    BufferDestroy(request->buffer);
+  }
+  xfree(request);
+}
+
+/* Keep a harvested request for a later read. Its buffer went to the caller. */
+static void RequestRelease(AioContext *const aio, AioRequest *const request) {
+  request->buffer = NULL;
+  request->next = aio->free_requests;
+  aio->free_requests = request;
+}
+
+/**
+ * @brief Size of the next read of a request.
+ * @note Files of unknown size (e.g. in /proc) are read in chunks until EOF.
+ */
+static size_t NextReadSize(const AioRequest *const request) {
+  const size_t length = BufferLength(request->buffer);
+  return (request->size > 0) ? request->size - length
+                             : DEFAULT_BUFFER_CAPACITY;
+}
+
+/**
+ * @brief Check whether a request has read everything it is going to.
+ * @param request The request.
+ * @param n_read Number of bytes returned by the last read.
+ */
+static bool ReadDone(const AioRequest *const request, const size_t n_read) {
+  /* Stop at the size seen when opening, even if the file grew since */
+  return (n_read == 0) || (request->size > 0 &&
+                           BufferLength(request->buffer) >= request->size);
+}
+
+/**
+ * @brief Size the buffer of a request after its file was opened.
+ */
+static void PrepareBuffer(AioRequest *const request) {
+  struct stat sb;
+  if (request->length > 0) {
+    request->size = request->length;
+  } else if (fstat(request->fd, &sb) == 0 && S_ISREG(sb.st_mode) &&
+             (uint64_t)sb.st_size > request->offset) {
+    request->size = (size_t)((uint64_t)sb.st_size - request->offset);
+  }
+
+  if (request->buffer == NULL) {
+    request->buffer = BufferCreate();
+    request->owns_buffer = true;
+  }
+  if (request->size > 0) {
+    BufferReserve(request->buffer, request->size);
+  }
+}
+
+/**
+ * @brief Read a whole file synchronously. Used by the worker threads.
+ */
+static void ReadRequest(AioRequest *const request) {
+  request->fd = open(request->filename, O_RDONLY | O_CLOEXEC);
+  if (request->fd < 0) {
+    request->error = errno;
+    return;
+  }
+  PrepareBuffer(request);
+
+  while (true) {
+    const size_t size = NextReadSize(request);
+    char *const dst = BufferReserve(request->buffer, size);
+    const ssize_t n_read =
+        pread(request->fd, dst, size,
+              (off_t)(request->offset + BufferLength(request->buffer)));
+    if (n_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      request->error = errno;
+      return;
+    }
+
+    BufferCommit(request->buffer, (size_t)n_read);
+    if (ReadDone(request, (size_t)n_read)) {
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Move a finished request to the completed requests.
+ */
+static void Complete(AioContext *const aio, AioRequest *const request) {
+  if (request->fd >= 0) {
+    close(request->fd);
+    request->fd = -1;
+  }
+  if (request->complete_time == 0) {
+    request->complete_time = SDL_GetTicksNS();
+  }
+
+  if (request->error != 0) {
+    LOG_DEBUG("Failed to read file '%s': %s", request->filename,
+              strerror(request->error));
+    if (request->owns_buffer) {
+      BufferDestroy(request->buffer);
+    }
+    request->buffer = NULL;
+  }
+
+  assert(aio->in_flight > 0);
+  aio->in_flight -= 1;
+  RequestArrayAppend(&aio->completed, request);
+}
+
+static int Worker(void *const data) {
+  AioContext *const aio = data;
+  while (true) {
+    AioRequest *request;
+    MpmcQueuePopWait(aio->requests, &request, -1);
+    if (request == NULL) {
+      break; /* Shutting down */
+    }
+
+    ReadRequest(request);
+    request->complete_time = SDL_GetTicksNS();
+    MpmcQueuePushWait(aio->completions, &request, -1);
+  }
+  return 0;
+}
+
+static void ThreadsCreate(AioContext *const aio) {
+  /* Leave room for one shutdown marker per worker */
+  aio->requests = MpmcQueueCreate(aio->queue_depth + DEFAULT_AIO_THREADS,
+                                  sizeof(AioRequest *));
+  aio->completions = MpmcQueueCreate(aio->queue_depth, sizeof(AioRequest *));
+
+  for (size_t i = 0; i < LENGTH(aio->threads); i++) {
+    aio->threads[i] = SDL_CreateThread(Worker, "aio", aio);
+    if (aio->threads[i] == NULL) {
+      LOG_CRITICAL("Failed to create thread: %s", SDL_GetError());
+    }
+  }
+}
+
+static void ThreadsDestroy(AioContext *const aio) {
+  AioRequest *const marker = NULL;
+  for (size_t i = 0; i < LENGTH(aio->threads); i++) {
+    MpmcQueuePushWait(aio->requests, &marker, -1);
+  }
+  for (size_t i = 0; i < LENGTH(aio->threads); i++) {
+    SDL_WaitThread(aio->threads[i], NULL);
+  }
+
+  AioRequest *request;
+  while (MpmcQueuePop(aio->completions, &request)) {
+    RequestDestroy(request);
+  }
+
+  MpmcQueueDestroy(aio->requests);
+  MpmcQueueDestroy(aio->completions);
+}
+
+#ifdef HAVE_LINUX_IO_URING_H
+/* glibc has no wrappers for the io_uring system calls */
+static int IoUringSetupSyscall(const unsigned entries,
+                               struct io_uring_params *const params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnterSyscall(const int fd, const unsigned to_submit,
+                               const unsigned min_complete,
+                               const unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      NULL, 0);
+}
+
+static int IoUringRegisterSyscall(const int fd, const unsigned opcode,
+                                  void *const arg, const unsigned n_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, n_args);
+}
+
+/**
+ * @brief Check that the kernel supports the operations we need.
+ */
+static bool IoUringProbe(const IoUring *const ring) {
+  const size_t n_ops = 256;
+  struct io_uring_probe *const probe =
+      xcalloc(1, sizeof(struct io_uring_probe) +
+                     (n_ops * sizeof(struct io_uring_probe_op)));
+
+  bool supported = false;
+  if (IoUringRegisterSyscall(ring->fd, IORING_REGISTER_PROBE, probe,
+                             (unsigned)n_ops) == 0) {
+    supported = (probe->last_op >= IORING_OP_OPENAT) &&
+                (probe->last_op >= IORING_OP_READ) &&
+                (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) &&
+                (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+  }
+
+  xfree(probe);
+  return supported;
+}
+
+static void IoUringDestroy(IoUring *const ring) {
+  if (ring->sqes != NULL) {
+    munmap(ring->sqes, ring->sqes_size);
+  }
+  if (ring->cq_ring != NULL && ring->cq_ring != ring->sq_ring) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+  if (ring->sq_ring != NULL) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+  if (ring->fd >= 0) {
+    close(ring->fd);
+  }
+  memset(ring, 0, sizeof(IoUring));
+  ring->fd = -1;
+}
+
+static void *IoUringMap(const int fd, const size_t size, const off_t offset) {
+  void *const ptr = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, fd, offset);
+  return (ptr != MAP_FAILED) ? ptr : NULL;
+}
+
+/**
+ * @brief Set up an io_uring instance.
+ * @return False if the kernel does not support io_uring or the operations
+ *         we need, e.g. because it is too old or disabled by a sandbox.
+ */
+static bool IoUringCreate(IoUring *const ring, const unsigned entries) {
+  memset(ring, 0, sizeof(IoUring));
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring->fd = IoUringSetupSyscall(entries, &params);
+  if (ring->fd < 0) {
+    LOG_DEBUG("Failed to set up io_uring: %s", strerror(errno));
+    return false;
+  }
+
+  ring->sq_ring_size =
+      params.sq_off.array + (params.sq_entries * sizeof(unsigned));
+  ring->cq_ring_size =
+      params.cq_off.cqes + (params.cq_entries * sizeof(struct io_uring_cqe));
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->sq_ring_size = ring->cq_ring_size =
+        MAX(ring->sq_ring_size, ring->cq_ring_size);
+  }
+
+  ring->sq_ring = IoUringMap(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cq_ring = ring->sq_ring;
+  } else if (ring->sq_ring != NULL) {
+    ring->cq_ring =
+        IoUringMap(ring->fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+  }
+  ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  if (ring->cq_ring != NULL) {
+    ring->sqes = IoUringMap(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+  }
+  if (ring->sqes == NULL) {
+    LOG_DEBUG("Failed to map io_uring: %s", strerror(errno));
+    IoUringDestroy(ring);
+    return false;
+  }
+
+  unsigned char *const sq = ring->sq_ring;
+  ring->sq_head = (atomic_uint *)(sq + params.sq_off.head);
+  ring->sq_tail = (atomic_uint *)(sq + params.sq_off.tail);
+  ring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sq_entries = params.sq_entries;
+  ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+
+  unsigned char *const cq = ring->cq_ring;
+  ring->cq_head = (atomic_uint *)(cq + params.cq_off.head);
+  ring->cq_tail = (atomic_uint *)(cq + params.cq_off.tail);
+  ring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  if (!IoUringProbe(ring)) {
+    LOG_DEBUG("Kernel lacks io_uring support for opening and reading files");
+    IoUringDestroy(ring);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Push an entry to the submission queue.
+ * @note The caller makes sure there is room, by never having more entries in
+ *       flight than the queue holds.
+ */
+static void IoUringPush(IoUring *const ring,
+                        const struct io_uring_sqe *const entry) {
+  const unsigned tail =
+      atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+  assert(tail - atomic_load_explicit(ring->sq_head, memory_order_acquire) <
+         ring->sq_entries);
+
+  const unsigned index = tail & ring->sq_mask;
+  ring->sqes[index] = *entry;
+  ring->sq_array[index] = index;
+
+  /* Publish the entry to the kernel */
+  atomic_store_explicit(ring->sq_tail, tail + 1, memory_order_release);
+  ring->to_submit += 1;
+}
+
+/**
+ * @brief Submit pushed entries and optionally wait for a completion.
+ * @return False on error.
+ */
+static bool IoUringEnter(IoUring *const ring, const bool wait) {
+  while (ring->to_submit > 0 || wait) {
+    const int ret = IoUringEnterSyscall(ring->fd, ring->to_submit,
+                                        wait ? 1 : 0,
+                                        wait ? IORING_ENTER_GETEVENTS : 0);
+    if (ret < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("Failed to enter io_uring: %s", strerror(errno));
+      return false;
+    }
+
+    ring->to_submit -= (unsigned)ret;
+    if (wait) {
+      break;
+    }
+  }
+  return true;
+}
+
+static void IoUringPushOpen(IoUring *const ring, AioRequest *const request) {
+  struct io_uring_sqe entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.opcode = IORING_OP_OPENAT;
+  entry.fd = AT_FDCWD;
+  entry.addr = (uint64_t)(uintptr_t)request->filename;
+  entry.open_flags = O_RDONLY | O_CLOEXEC;
+  entry.user_data = (uint64_t)(uintptr_t)request;
+
+  request->stage = AIO_STAGE_OPEN;
+  IoUringPush(ring, &entry);
+}
+
+static void IoUringPushRead(IoUring *const ring, AioRequest *const request) {
+  const size_t size = NextReadSize(request);
+  const uint64_t offset = request->offset + BufferLength(request->buffer);
+
+  struct io_uring_sqe entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.opcode = IORING_OP_READ;
+  entry.fd = request->fd;
+  entry.addr = (uint64_t)(uintptr_t)BufferReserve(request->buffer, size);
+  entry.len = (unsigned)MIN(size, (size_t)INT_MAX);
+  entry.off = offset;
+  entry.user_data = (uint64_t)(uintptr_t)request;
+
+  request->stage = AIO_STAGE_READ;
+  IoUringPush(ring, &entry);
+}
+
+/**
+ * @brief Advance the request of a completion queue entry to its next stage.
+ */
+static void IoUringHandle(AioContext *const aio, AioRequest *const request,
+                          const int result) {
+  if (result == -EINTR || result == -EAGAIN) {
+    /* Retry the same stage */
+    if (request->stage == AIO_STAGE_OPEN) {
+      IoUringPushOpen(&aio->ring, request);
+    } else {
+      IoUringPushRead(&aio->ring, request);
+    }
+    return;
+  }
+  if (result < 0) {
+    request->error = -result;
+    Complete(aio, request);
+    return;
+  }
+
+  if (request->stage == AIO_STAGE_OPEN) {
+    request->fd = result;
+    PrepareBuffer(request);
+    IoUringPushRead(&aio->ring, request);
+    return;
+  }
+
+  BufferCommit(request->buffer, (size_t)result);
+  if (ReadDone(request, (size_t)result)) {
+    Complete(aio, request);
+  } else {
+    IoUringPushRead(&aio->ring, request);
+  }
+}
+
+/**
+ * @brief Handle all entries in the completion queue.
+ */
+static void IoUringReap(AioContext *const aio) {
+  IoUring *const ring = &aio->ring;
+  unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+  const unsigned tail =
+      atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+
+  while (head != tail) {
+    const struct io_uring_cqe *const entry = &ring->cqes[head & ring->cq_mask];
+    AioRequest *const request = (AioRequest *)(uintptr_t)entry->user_data;
+    const int result = entry->res;
+    head += 1;
+    IoUringHandle(aio, request, result);
+  }
+
+  /* Hand the entries back to the kernel */
+  atomic_store_explicit(ring->cq_head, head, memory_order_release);
+  IoUringEnter(ring, false);
+}
+#endif /* HAVE_LINUX_IO_URING_H */
+
+AioContext *AioCreate(const unsigned queue_depth, const AioBackend backend) {
+  AioContext *const aio = xcalloc(1, sizeof(AioContext));
+  aio->queue_depth = (queue_depth > 0) ? queue_depth : DEFAULT_AIO_QUEUE_DEPTH;
+  aio->next_id = 1;
+  RequestArrayInit(&aio->queued);
+  RequestArrayInit(&aio->completed);
+
+  aio->backend = AIO_BACKEND_THREADS;
+#ifdef HAVE_LINUX_IO_URING_H
+  aio->ring.fd = -1;
+  if (backend != AIO_BACKEND_THREADS &&
+      IoUringCreate(&aio->ring, aio->queue_depth)) {
+    /* The kernel may round up, but never hand out fewer entries */
+    assert(aio->ring.sq_entries >= aio->queue_depth);
+    aio->backend = AIO_BACKEND_IO_URING;
+  }
+#else
+  (void)backend;
+#endif /* HAVE_LINUX_IO_URING_H */
+
+  if (aio->backend == AIO_BACKEND_THREADS) {
+    ThreadsCreate(aio);
+  }
+
+  LOG_DEBUG("Created asynchronous I/O context using %s with queue depth %u",
+            AioBackendName(aio), aio->queue_depth);
+  return aio;
+}
+
+void AioDestroy(void *const ptr) {
+  AioContext *const aio = ptr;
+  if (aio == NULL) {
+    return;
+  }
+
+  if (aio->backend == AIO_BACKEND_THREADS) {
+    ThreadsDestroy(aio);
+  }
+#ifdef HAVE_LINUX_IO_URING_H
+  else {
+    /* The kernel writes into the buffers until the reads complete */
+    while (aio->in_flight > 0 && IoUringEnter(&aio->ring, true)) {
+      IoUringReap(aio);
+    }
+    IoUringDestroy(&aio->ring);
+  }
+#endif /* HAVE_LINUX_IO_URING_H */
+
+  for (size_t i = 0; i < RequestArrayLength(&aio->queued); i++) {
+    RequestDestroy(*RequestArrayAt(&aio->queued, i));
+  }
+  for (size_t i = 0; i < RequestArrayLength(&aio->completed); i++) {
+    RequestDestroy(*RequestArrayAt(&aio->completed, i));
+  }
+  RequestArrayDestroy(&aio->queued);
+  RequestArrayDestroy(&aio->completed);
+  while (aio->free_requests != NULL) {
+    AioRequest *const request = aio->free_requests;
+    aio->free_requests = request->next;
+    xfree(request);
+  }
+  xfree(aio);
+}
+
+const char *AioBackendName(const AioContext *const aio) {
+  assert(aio != NULL);
+  return (aio->backend == AIO_BACKEND_IO_URING) ? "io_uring" : "threads";
+}
+
+void AioReserve(AioContext *const aio, const size_t n_requests) {
+  assert(aio != NULL);
+
+  size_t n_free = 0;
+  for (const AioRequest *request = aio->free_requests; request != NULL;
+       request = request->next) {
+    n_free += 1;
+  }
+  for (; n_free < n_requests; n_free++) {
+    AioRequest *const request = xcalloc(1, sizeof(AioRequest));
+    request->next = aio->free_requests;
+    aio->free_requests = request;
+  }
+
+  RequestArrayReserve(&aio->queued, n_requests);
+  RequestArrayReserve(&aio->completed, n_requests);
+}
+
+/**
+ * @brief Queue a read of length bytes at offset, or of the rest of the file
+ *        if length is 0, into buffer or a new buffer if it is NULL.
+ */
+static uint64_t Queue(AioContext *const aio, const char *const filename,
+                      const uint64_t offset, const size_t length,
+                      Buffer *const buffer, void *const user_data) {
+  assert(aio != NULL);
+  assert(filename != NULL);
+
+  AioRequest *request = aio->free_requests;
+  if (request != NULL) {
+    aio->free_requests = request->next;
+  } else {
+    request = xmalloc(sizeof(AioRequest));
+  }
+
+  *request = (AioRequest){
+      .id = aio->next_id++,
+      .filename = filename,
+      .user_data = user_data,
+      .buffer = buffer,
+      .fd = -1,
+      .offset = offset,
+      .length = length,
+  };
+  if (buffer != NULL) {
+    BufferTruncate(buffer, 0);
+  }
+
+  RequestArrayAppend(&aio->queued, request);
+  return request->id;
+}
+
+uint64_t AioRead(AioContext *const aio, const char *const filename,
+                 void *const user_data) {
+  return Queue(aio, filename, 0, 0, NULL, user_data);
+}
+
+uint64_t AioReadRange(AioContext *const aio, const char *const filename,
+                      const uint64_t offset, const size_t length,
+                      Buffer *const buffer, void *const user_data) {
+  assert(length > 0);
+  return Queue(aio, filename, offset, length, buffer, user_data);
+}
+
+size_t AioSubmit(AioContext *const aio) {
+  assert(aio != NULL);
+
+  AioRequest **const queued = RequestArrayData(&aio->queued);
+  const size_t n_queued = RequestArrayLength(&aio->queued);
+  const Uint64 now = SDL_GetTicksNS();
+
+  size_t n_submitted = 0;
+  while (n_submitted < n_queued && aio->in_flight < aio->queue_depth) {
+    AioRequest *const request = queued[n_submitted];
+    request->submit_time = now;
+
+    if (aio->backend == AIO_BACKEND_THREADS) {
+      NDEBUG_UNUSED const bool pushed =
+          MpmcQueuePush(aio->requests, &request);
+      assert(pushed); /* Never more requests than the queue depth */
+    }
+#ifdef HAVE_LINUX_IO_URING_H
+    else {
+      IoUringPushOpen(&aio->ring, request);
+    }
+#endif /* HAVE_LINUX_IO_URING_H */
+
+    aio->in_flight += 1;
+    n_submitted += 1;
+  }
+
+#ifdef HAVE_LINUX_IO_URING_H
+  if (aio->backend == AIO_BACKEND_IO_URING) {
+    IoUringEnter(&aio->ring, false);
+  }
+#endif /* HAVE_LINUX_IO_URING_H */
+
+  /* Keep the rest queued in order */
+  memmove(queued, queued + n_submitted,
+          (n_queued - n_submitted) * sizeof(AioRequest *));
+  aio->queued.length = n_queued - n_submitted;
+  return n_submitted;
+}
+
+/**
+ * @brief Collect finished requests from the backend without blocking.
+ */
+static void Reap(AioContext *const aio) {
+  if (aio->backend == AIO_BACKEND_THREADS) {
+    AioRequest *request;
+    while (MpmcQueuePop(aio->completions, &request)) {
+      Complete(aio, request);
+    }
+  }
+#ifdef HAVE_LINUX_IO_URING_H
+  else {
+    IoUringReap(aio);
+  }
+#endif /* HAVE_LINUX_IO_URING_H */
+}
+
+/**
+ * @brief Move completed requests to the caller's array.
+ */
+static size_t Harvest(AioContext *const aio, AioCompletion *const completions,
+                      const size_t max) {
+  AioRequest **const completed = RequestArrayData(&aio->completed);
+  const size_t n_completed = RequestArrayLength(&aio->completed);
+  const size_t n = MIN(n_completed, max);
+
+  for (size_t i = 0; i < n; i++) {
+    AioRequest *const request = completed[i];
+    completions[i] = (AioCompletion){
+        .id = request->id,
+        .user_data = request->user_data,
+        .buffer = request->buffer,
+        .error = request->error,
+        .latency_ns = request->complete_time - request->submit_time,
+    };
+    RequestRelease(aio, request);
+  }
+
+  memmove(completed, completed + n, (n_completed - n) * sizeof(AioRequest *));
+  aio->completed.length = n_completed - n;
+
+  /* Completions made room for queued requests */
+  if (RequestArrayLength(&aio->queued) > 0) {
+    AioSubmit(aio);
+  }
+  return n;
+}
+
+size_t AioPoll(AioContext *const aio, AioCompletion *const completions,
+               const size_t max) {
+  assert(aio != NULL);
+  assert(completions != NULL || max == 0);
+
+  Reap(aio);
+  return Harvest(aio, completions, max);
+}
+
+size_t AioWait(AioContext *const aio, AioCompletion *const completions,
+               const size_t max, const int32_t timeout_ms) {
+  assert(aio != NULL);
+  assert(completions != NULL || max == 0);
+
+  const Uint64 deadline =
+      (timeout_ms > 0) ? SDL_GetTicks() + (Uint64)timeout_ms : 0;
+
+  while (true) {
+    const size_t n = AioPoll(aio, completions, max);
+    if (n > 0 || aio->in_flight == 0) {
+      return n;
+    }
+
+    if (aio->backend == AIO_BACKEND_THREADS) {
+      /* Sleep until a worker finishes something */
+      AioRequest *request;
+      Sint32 remaining = -1;
+      if (timeout_ms >= 0) {
+        const Uint64 now = SDL_GetTicks();
+        remaining = (now < deadline) ? (Sint32)(deadline - now) : 0;
+      }
+      if (!MpmcQueuePopWait(aio->completions, &request, remaining)) {
+        return 0;
+      }
+      Complete(aio, request);
+      continue;
+    }
+
+#ifdef HAVE_LINUX_IO_URING_H
+    if (timeout_ms < 0) {
+      /* A completion may only advance a request to its next stage, so loop
+       * until one actually finishes */
+      if (!IoUringEnter(&aio->ring, true)) {
+        return 0;
+      }
+    } else if (SDL_GetTicks() >= deadline) {
+      return 0;
+    } else {
+      SDL_Delay(1);
+    }
+#endif /* HAVE_LINUX_IO_URING_H */
+  }
+}
+
+size_t AioPending(const AioContext *const aio) {
+  assert(aio != NULL);
+  return RequestArrayLength(&aio->queued) + aio->in_flight +
+         RequestArrayLength(&aio->completed);
+}
@@ -0,0 +1,138 @@
+#ifndef __ETERNO_AIO_H__
+#define __ETERNO_AIO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "buffer.h"
+
+/**
+ * @brief Asynchronous file reader for streaming assets.
+ * @note Reads of whole files or ranges are queued with AioRead() or
+ *       AioReadRange(), handed to the backend in batches with AioSubmit()
+ *       and harvested with AioPoll(), so the calling thread never blocks on
+ *       disk. The context itself is not thread-safe and should be driven
+ *       from a single thread, e.g. the main thread.
+ */
+typedef struct AioContext AioContext;
+
+typedef enum AioBackend {
+  AIO_BACKEND_AUTO,     /* io_uring if the kernel supports it, else threads */
+  AIO_BACKEND_IO_URING, /* Falls back to threads if unsupported */
+  AIO_BACKEND_THREADS,
+} AioBackend;
+
+typedef struct AioCompletion {
+  uint64_t id;         /* As returned by AioRead() */
+  void *user_data;     /* As passed to AioRead() */
+  Buffer *buffer;      /* File contents or NULL on error */
+  int error;           /* 0 on success, otherwise an errno value */
+  uint64_t latency_ns; /* Time from submission to completion */
+} AioCompletion;
+
+/**
+ * @brief Create an asynchronous I/O context.
+ * @param queue_depth Maximum number of reads in flight or 0 for the default.
+ * @param backend Backend to use.
+ * @return The context.
+ * @note Caller takes ownership of returned value.
+ */
+AioContext *AioCreate(unsigned queue_depth, AioBackend backend);
+
+/**
+ * @brief Destroy the context.
+ * @param ptr Pointer to the context.
+ * @note If ptr is NULL, no operation is performed. Otherwise, waits for reads
+ *       in flight and discards all results that were not polled.
+ */
+void AioDestroy(void *ptr);
+
+/**
+ * @brief Get name of the backend in use.
+ * @param aio The context.
+ * @return "io_uring" or "threads".
+ */
+const char *AioBackendName(const AioContext *aio);
+
+/**
+ * @brief Make room for reads without allocating when they are queued.
+ * @param aio The context.
+ * @param n_requests Number of reads that may be queued, in flight or not
+ *                   yet harvested at the same time.
+ * @note Reads into a buffer of the caller that is large enough then
+ *       allocate nothing, e.g. when streaming within a frame loop.
+ */
+void AioReserve(AioContext *aio, size_t n_requests);
+
+/**
+ * @brief Queue a read of a whole file.
+ * @param aio The context.
+ * @param filename Path to file, which must stay valid until the read is
+ *                 harvested or the context is destroyed.
+ * @param user_data Passed back in the completion.
+ * @return Id of the request, never 0.
+ * @note The read starts on the next call to AioSubmit().
+ */
+uint64_t AioRead(AioContext *aio, const char *filename, void *user_data);
+
+/**
+ * @brief Queue a read of part of a file.
+ * @param aio The context.
+ * @param filename Path to file, which must stay valid until the read is
+ *                 harvested or the context is destroyed.
+ * @param offset Position of the first byte to read.
+ * @param length Number of bytes to read, must be greater than 0.
+ * @param buffer Buffer to read into, which is emptied first, or NULL for a
+ *               new buffer. The caller keeps ownership of it, but must not
+ *               touch it until the read is harvested.
+ * @param user_data Passed back in the completion.
+ * @return Id of the request, never 0.
+ * @note The buffer of the completion is shorter than length if the file
+ *       ends before. The read starts on the next call to AioSubmit().
+ */
+uint64_t AioReadRange(AioContext *aio, const char *filename, uint64_t offset,
+                      size_t length, Buffer *buffer, void *user_data);
+
+/**
+ * @brief Hand queued reads to the backend as one batch.
+ * @param aio The context.
+ * @return Number of reads submitted.
+ * @note At most the queue depth is in flight. The rest stays queued and is
+ *       submitted as earlier reads complete.
+ */
+size_t AioSubmit(AioContext *aio);
+
+/**
+ * @brief Harvest completed reads without blocking.
+ * @param aio The context.
+ * @param completions Array for completed reads.
+ * @param max Length of array.
+ * @return Number of completions stored in array.
+ * @note Caller takes ownership of the buffers of the completions. A buffer
+ *       passed to AioReadRange() stays with the caller even if the read
+ *       failed.
+ */
+size_t AioPoll(AioContext *aio, AioCompletion *completions, size_t max);
+
+/**
+ * @brief Harvest completed reads, waiting until at least one completes.
+ * @param aio The context.
+ * @param completions Array for completed reads.
+ * @param max Length of array.
+ * @param timeout_ms Maximum time to wait in milliseconds or -1 to wait
+ *                   indefinitely.
+ * @return Number of completions stored in array. 0 if the timeout expired or
+ *         nothing is in flight.
+ */
+size_t AioWait(AioContext *aio, AioCompletion *completions, size_t max,
+               int32_t timeout_ms);
+
+/**
+ * @brief Get number of reads that have not been harvested yet.
+ * @param aio The context.
+ * @return Number of queued and in flight reads.
+ */
+size_t AioPending(const AioContext *aio);
+
+#endif // __ETERNO_AIO_H__
@@ -0,0 +1,128 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+#include "arena.h"
+#include "logger.h"
+#include "utils.h"
+
+static void *HeapAlloc(ARG_UNUSED void *const ctx, const size_t size) {
+  return xmalloc(size);
+}
+
+static void *HeapRealloc(ARG_UNUSED void *const ctx, void *const ptr,
+                         ARG_UNUSED const size_t old_size,
+                         const size_t new_size) {
+  return xrealloc(ptr, new_size);
+}
+
+static void HeapFree(ARG_UNUSED void *const ctx, void *const ptr,
+                     ARG_UNUSED const size_t size) {
+  xfree(ptr);
+}
+
+const Allocator HEAP_ALLOCATOR = {
+    .alloc = HeapAlloc,
+    .realloc = HeapRealloc,
+    .free = HeapFree,
+    .ctx = NULL,
+};
+
+static void *ArenaAllocatorAlloc(void *const ctx, const size_t size) {
+  return ArenaAlloc(ctx, size);
+}
+
+static void *ArenaAllocatorRealloc(void *const ctx, void *const ptr,
+                                   const size_t old_size,
+                                   const size_t new_size) {
+  return ArenaRealloc(ctx, ptr, old_size, new_size);
+}
+
+static void ArenaAllocatorFree(ARG_UNUSED void *const ctx,
+                               ARG_UNUSED void *const ptr,
+                               ARG_UNUSED const size_t size) {
+  /* Reclaimed when the arena is reset */
+}
+
+Allocator ArenaAllocator(Arena *const arena) {
+  if (arena == NULL) {
+    return HEAP_ALLOCATOR;
+  }
+
+  const Allocator allocator = {
+      .alloc = ArenaAllocatorAlloc,
+      .realloc = ArenaAllocatorRealloc,
+      .free = ArenaAllocatorFree,
+      .ctx = arena,
+  };
+  return allocator;
+}
+
+static struct {
+  Arena *arenas[2];
+  Allocator allocators[2];
+  unsigned current;
+} FRAME = {0};
+
+static void FrameArenaInit(void) {
+  for (size_t i = 0; i < LENGTH(FRAME.arenas); i++) {
+    FRAME.arenas[i] = ArenaCreate(DEFAULT_FRAME_ARENA_SIZE);
+    FRAME.allocators[i] = ArenaAllocator(FRAME.arenas[i]);
+  }
+}
+
+void FrameArenaBegin(void) {
+  if (FRAME.arenas[0] == NULL) {
+    FrameArenaInit();
+  }
+
+  FRAME.current ^= 1;
+  ArenaReset(FRAME.arenas[FRAME.current]);
+}
+
+Arena *FrameArena(void) {
+  if (FRAME.arenas[0] == NULL) {
+    FrameArenaInit();
+  }
+  return FRAME.arenas[FRAME.current];
+}
+
+const Allocator *FrameAllocator(void) {
+  if (FRAME.arenas[0] == NULL) {
+    FrameArenaInit();
+  }
+  return &FRAME.allocators[FRAME.current];
+}
+
+void FrameArenaShutdown(void) {
+  for (size_t i = 0; i < LENGTH(FRAME.arenas); i++) {
+    ArenaDestroy(FRAME.arenas[i]);
+    FRAME.arenas[i] = NULL;
+  }
+  FRAME.current = 0;
+}
+
+static _Thread_local Arena *THREAD_SCRATCH = NULL;
+static SDL_TLSID SCRATCH_TLS;
+
+static void OnThreadExit(void *const value) {
+  ArenaDestroy(value);
+  THREAD_SCRATCH = NULL;
+}
+
+Arena *ScratchArena(void) {
+  if (THREAD_SCRATCH == NULL) {
+    THREAD_SCRATCH = ArenaCreate(0);
+    /* Only used for its destructor */
+    if (!SDL_SetTLS(&SCRATCH_TLS, THREAD_SCRATCH, OnThreadExit)) {
+      LOG_WARNING("Failed to register scratch arena for cleanup: %s",
+                  SDL_GetError());
+    }
+  }
+  return THREAD_SCRATCH;
+}
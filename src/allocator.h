@@ -0,0 +1,108 @@
+#ifndef __ETERNO_ALLOCATOR_H__
+#define __ETERNO_ALLOCATOR_H__
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "logger.h"
+
+/**
+ * @brief Interface to a memory allocator.
+ * @note Containers take an allocator instead of calling xmalloc() directly,
+ *       so that short-lived containers can draw from an arena. Functions
+ *       abort on allocation failure, like xmalloc(). An allocator is a small
+ *       value and is copied into the containers using it.
+ */
+typedef struct Allocator {
+  void *(*alloc)(void *ctx, size_t size);
+  void *(*realloc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+  void (*free)(void *ctx, void *ptr, size_t size); /* May be a no-op */
+  void *ctx;
+} Allocator;
+
+/* Allocator using malloc(3) and free(3) */
+extern const Allocator HEAP_ALLOCATOR;
+
+/**
+ * @brief Get an allocator drawing from an arena.
+ * @param arena The arena or NULL for HEAP_ALLOCATOR.
+ * @return The allocator. Freeing memory is a no-op, it is reclaimed when the
+ *         arena is reset.
+ */
+Allocator ArenaAllocator(Arena *arena);
+
+static inline void *AllocatorAlloc(const Allocator *const allocator,
+                                   const size_t size) {
+  assert(allocator != NULL);
+  return allocator->alloc(allocator->ctx, size);
+}
+
+static inline void *AllocatorCalloc(const Allocator *const allocator,
+                                    const size_t nmemb, const size_t size) {
+  assert(allocator != NULL);
+  if (size != 0 && nmemb > SIZE_MAX / size) {
+    LOG_CRITICAL("Failed to allocate memory: Size overflow (%zu * %zu)", nmemb,
+                 size);
+  }
+  void *const ptr = allocator->alloc(allocator->ctx, nmemb * size);
+  memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+static inline void *AllocatorRealloc(const Allocator *const allocator,
+                                     void *const ptr, const size_t old_size,
+                                     const size_t new_size) {
+  assert(allocator != NULL);
+  return allocator->realloc(allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void AllocatorFree(const Allocator *const allocator,
+                                 void *const ptr, const size_t size) {
+  assert(allocator != NULL);
+  if (ptr != NULL) {
+    allocator->free(allocator->ctx, ptr, size);
+  }
+}
+
+/**
+ * @brief Begin a frame, making the frame arena of two frames ago current and
+ *        resetting it.
+ * @note Call at the top of each iteration of the main loop. Memory from the
+ *       frame arena stays valid until the end of the next frame, so data
+ *       built during one frame can be consumed during the next. Only use the
+ *       frame arena from the main thread.
+ */
+void FrameArenaBegin(void);
+
+/**
+ * @brief Get the arena of the current frame.
+ * @return The arena.
+ */
+Arena *FrameArena(void);
+
+/**
+ * @brief Get an allocator drawing from the arena of the current frame.
+ * @return The allocator, valid until the next call to FrameArenaBegin().
+ */
+const Allocator *FrameAllocator(void);
+
+/**
+ * @brief Destroy both frame arenas.
+ * @note Call once the main loop has ended.
+ */
+void FrameArenaShutdown(void);
+
+/**
+ * @brief Get the scratch arena of the calling thread.
+ * @return The arena, created on first use and destroyed when the thread
+ *         exits.
+ * @note For temporary memory in worker threads. Scope each use with
+ *       ArenaGetMark() and ArenaRewind(), so that nested uses do not release
+ *       each other's memory.
+ */
+Arena *ScratchArena(void);
+
+#endif // __ETERNO_ALLOCATOR_H__
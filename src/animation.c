@@ -0,0 +1,291 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "animation.h"
+#include "array.h"
+#include "utils.h"
+
+/* Transition of a compiled graph. The source state is implied by its
+ * position in the table. */
+typedef struct {
+  uint32_t all;
+  uint32_t none;
+  uint16_t to;
+} CompiledTransition;
+
+struct AnimationGraph {
+  size_t n_states;
+  uint16_t initial;
+  AnimationClip *clips;
+  uint32_t *first; /* Transitions of state s are first[s] to first[s + 1] */
+  CompiledTransition *transitions;
+};
+
+typedef struct {
+  const AnimationGraph *graph;
+  uint32_t conditions;
+  float elapsed; /* Seconds into the current frame */
+  uint16_t state;
+  uint16_t frame;
+  AnimatorId id;
+} Animator;
+
+ARRAY_DEFINE(AnimatorArray, Animator, 1)
+ARRAY_DEFINE(IndexArray, uint32_t, 1)
+
+/* Slot of an unused handle */
+#define NO_ANIMATOR UINT32_MAX
+
+struct AnimationSystem {
+  AnimatorArray animators; /* Contiguous, in no particular order */
+  IndexArray slots;        /* Index of each handle's animator */
+  IndexArray free_ids;     /* Handles available for reuse */
+};
+
+static bool Applies(const AnimationTransition *const transition,
+                    const size_t state) {
+  if (transition->from == ANIMATION_ANY_STATE) {
+    return transition->to != state;
+  }
+  return transition->from == state;
+}
+
+AnimationGraph *AnimationGraphCreate(
+    const AnimationClip *const clips, const size_t n_states,
+    const AnimationTransition *const transitions, const size_t n_transitions,
+    const uint16_t initial) {
+  assert(clips != NULL);
+  assert(n_states > 0 && n_states < ANIMATION_ANY_STATE);
+  assert(transitions != NULL || n_transitions == 0);
+  assert(initial < n_states);
+
+  AnimationGraph *const graph = xcalloc(1, sizeof(AnimationGraph));
+  graph->n_states = n_states;
+  graph->initial = initial;
+
+  graph->clips = xmalloc(n_states * sizeof(AnimationClip));
+  for (size_t i = 0; i < n_states; i++) {
+    assert(clips[i].n_frames > 0 && clips[i].n_frames <= UINT16_MAX);
+    assert(clips[i].frame_duration > 0.0f);
+    graph->clips[i] = clips[i];
+  }
+
+  /* Expand transitions from any state into each state, keeping the order,
+   * so that an animator only scans the table of its own state */
+  size_t total = 0;
+  graph->first = xmalloc((n_states + 1) * sizeof(uint32_t));
+  for (size_t state = 0; state < n_states; state++) {
+    graph->first[state] = (uint32_t)total;
+    for (size_t i = 0; i < n_transitions; i++) {
+      assert(transitions[i].to < n_states);
+      assert(transitions[i].from == ANIMATION_ANY_STATE ||
+             transitions[i].from < n_states);
+      total += Applies(&transitions[i], state);
+    }
+  }
+  graph->first[n_states] = (uint32_t)total;
+
+  graph->transitions = xmalloc(MAX(total, 1) * sizeof(CompiledTransition));
+  size_t index = 0;
+  for (size_t state = 0; state < n_states; state++) {
+    for (size_t i = 0; i < n_transitions; i++) {
+      if (Applies(&transitions[i], state)) {
+        graph->transitions[index++] = (CompiledTransition){
+            .all = transitions[i].all,
+            .none = transitions[i].none,
+            .to = transitions[i].to,
+        };
+      }
+    }
+  }
+  assert(index == total);
+
+  return graph;
+}
+
+void AnimationGraphDestroy(AnimationGraph *const graph) {
+  if (graph == NULL) {
+    return;
+  }
+  xfree(graph->clips);
+  xfree(graph->first);
+  xfree(graph->transitions);
+  xfree(graph);
+}
+
+AnimationSystem *AnimationSystemCreate(void) {
+  AnimationSystem *const system = xmalloc(sizeof(AnimationSystem));
+  AnimatorArrayInit(&system->animators);
+  IndexArrayInit(&system->slots);
+  IndexArrayInit(&system->free_ids);
+  return system;
+}
+
+void AnimationSystemDestroy(AnimationSystem *const system) {
+  if (system == NULL) {
+    return;
+  }
+  AnimatorArrayDestroy(&system->animators);
+  IndexArrayDestroy(&system->slots);
+  IndexArrayDestroy(&system->free_ids);
+  xfree(system);
+}
+
+AnimatorId AnimationSystemAdd(AnimationSystem *const system,
+                              const AnimationGraph *const graph) {
+  assert(system != NULL);
+  assert(graph != NULL);
+
+  AnimatorId id;
+  if (IndexArrayLength(&system->free_ids) > 0) {
+    id = IndexArrayPop(&system->free_ids);
+  } else {
+    id = (AnimatorId)IndexArrayLength(&system->slots);
+    IndexArrayAppend(&system->slots, NO_ANIMATOR);
+  }
+
+  const Animator animator = {
+      .graph = graph,
+      .state = graph->initial,
+      .id = id,
+  };
+  *IndexArrayAt(&system->slots, id) =
+      (uint32_t)AnimatorArrayLength(&system->animators);
+  AnimatorArrayAppend(&system->animators, animator);
+  return id;
+}
+
+static Animator *GetAnimator(AnimationSystem *const system,
+                             const AnimatorId id) {
+  assert(system != NULL);
+  const uint32_t index = *IndexArrayAt(&system->slots, id);
+  assert(index != NO_ANIMATOR);
+  return AnimatorArrayAt(&system->animators, index);
+}
+
+void AnimationSystemRemove(AnimationSystem *const system,
+                           const AnimatorId id) {
+  assert(system != NULL);
+
+  uint32_t *const slot = IndexArrayAt(&system->slots, id);
+  assert(*slot != NO_ANIMATOR);
+
+  /* Move the last animator into the gap */
+  AnimatorArraySwapRemove(&system->animators, *slot);
+  if (*slot < AnimatorArrayLength(&system->animators)) {
+    const Animator *const moved = AnimatorArrayAt(&system->animators, *slot);
+    *IndexArrayAt(&system->slots, moved->id) = *slot;
+  }
+
+  *slot = NO_ANIMATOR;
+  IndexArrayAppend(&system->free_ids, id);
+}
+
+void AnimationSystemSetConditions(AnimationSystem *const system,
+                                  const AnimatorId id,
+                                  const uint32_t conditions) {
+  assert((conditions & ANIMATION_FINISHED) == 0);
+  GetAnimator(system, id)->conditions = conditions;
+}
+
+void AnimationSystemUpdate(AnimationSystem *const system, const float dt) {
+  assert(system != NULL);
+  assert(dt >= 0.0f);
+
+  Animator *const animators = AnimatorArrayData(&system->animators);
+  const size_t length = AnimatorArrayLength(&system->animators);
+  for (size_t i = 0; i < length; i++) {
+    Animator *const animator = &animators[i];
+    const AnimationGraph *const graph = animator->graph;
+
+    /* Take the first transition whose conditions hold */
+    const AnimationClip *clip = &graph->clips[animator->state];
+    uint32_t conditions = animator->conditions;
+    if (!clip->loop && animator->frame + 1u == clip->n_frames &&
+        animator->elapsed >= clip->frame_duration) {
+      conditions |= ANIMATION_FINISHED;
+    }
+
+    const CompiledTransition *const end =
+        graph->transitions + graph->first[animator->state + 1];
+    for (const CompiledTransition *transition =
+             graph->transitions + graph->first[animator->state];
+         transition < end; transition++) {
+      if ((conditions & transition->all) == transition->all &&
+          (conditions & transition->none) == 0) {
+        if (transition->to != animator->state) {
+          animator->state = transition->to;
+          animator->frame = 0;
+          animator->elapsed = 0.0f;
+          clip = &graph->clips[animator->state];
+        }
+        break;
+      }
+    }
+
+    /* Advance the clip */
+    animator->elapsed += dt;
+    while (animator->elapsed >= clip->frame_duration) {
+      if (animator->frame + 1u < clip->n_frames) {
+        animator->frame += 1;
+      } else if (clip->loop) {
+        animator->frame = 0;
+      } else {
+        /* Hold the last frame */
+        animator->elapsed = clip->frame_duration;
+        break;
+      }
+      animator->elapsed -= clip->frame_duration;
+    }
+  }
+}
+
+uint16_t AnimationSystemGetState(AnimationSystem *const system,
+                                 const AnimatorId id) {
+  return GetAnimator(system, id)->state;
+}
+
+void AnimationSystemGetFrame(AnimationSystem *const system,
+                             const AnimatorId id, Atom *const texture,
+                             unsigned *const frame) {
+  assert(texture != NULL);
+  assert(frame != NULL);
+
+  const Animator *const animator = GetAnimator(system, id);
+  *texture = animator->graph->clips[animator->state].texture;
+  *frame = animator->frame;
+}
+
+void AnimationSystemSave(AnimationSystem *const system, const AnimatorId id,
+                         AnimatorState *const state) {
+  assert(state != NULL);
+
+  const Animator *const animator = GetAnimator(system, id);
+  *state = (AnimatorState){
+      .conditions = animator->conditions,
+      .elapsed = animator->elapsed,
+      .state = animator->state,
+      .frame = animator->frame,
+  };
+}
+
+void AnimationSystemLoad(AnimationSystem *const system, const AnimatorId id,
+                         const AnimatorState *const state) {
+  assert(state != NULL);
+
+  Animator *const animator = GetAnimator(system, id);
+  assert(state->state < animator->graph->n_states);
+  assert(state->frame < animator->graph->clips[state->state].n_frames);
+  animator->conditions = state->conditions;
+  animator->elapsed = state->elapsed;
+  animator->state = state->state;
+  animator->frame = state->frame;
+}
+
+size_t AnimationSystemLength(const AnimationSystem *const system) {
+  assert(system != NULL);
+  return AnimatorArrayLength(&system->animators);
+}
@@ -0,0 +1,173 @@
+#ifndef __ETERNO_ANIMATION_H__
+#define __ETERNO_ANIMATION_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atom.h"
+
+/**
+ * @brief Data-driven animation state machines.
+ * @note A character type describes its states, clips and transitions once
+ *       as an AnimationGraph, which is compiled into flat tables. Each
+ *       animated object only sets condition bits, and AnimationSystemUpdate()
+ *       advances all animators in one pass over a contiguous array.
+ */
+typedef struct AnimationGraph AnimationGraph;
+typedef struct AnimationSystem AnimationSystem;
+
+/* Handle of an animator in an AnimationSystem */
+typedef uint32_t AnimatorId;
+
+/* Transition source matching every state except the target itself */
+#define ANIMATION_ANY_STATE UINT16_MAX
+
+/* Condition set by the system while a non-looping clip shows its last frame
+ * for its full duration. Other bits are defined by each graph. */
+#define ANIMATION_FINISHED ((uint32_t)1 << 31)
+
+/* Progress of an animator, saved for rewinding. Has no padding. */
+typedef struct {
+  uint32_t conditions;
+  float elapsed; /* Seconds into the current frame */
+  uint16_t state;
+  uint16_t frame;
+} AnimatorState;
+
+/* Sprite sheet played in a state, with frames laid out in one row */
+typedef struct {
+  Atom texture;
+  unsigned n_frames;
+  float frame_duration; /* Seconds */
+  bool loop;            /* Otherwise holds the last frame */
+} AnimationClip;
+
+/**
+ * @brief Transition taken when all of the bits in 'all' and none of the bits
+ *        in 'none' are set.
+ * @note Transitions are tried in the order given and the first match wins.
+ *       A transition from a state to itself keeps the clip playing, and so
+ *       blocks the transitions after it, e.g. to finish an attack.
+ */
+typedef struct {
+  uint16_t from; /* Source state or ANIMATION_ANY_STATE */
+  uint16_t to;   /* Target state */
+  uint32_t all;
+  uint32_t none;
+} AnimationTransition;
+
+/**
+ * @brief Compile an animation graph.
+ * @param clips The clip of each state, indexed by state.
+ * @param n_states Number of states.
+ * @param transitions The transitions.
+ * @param n_transitions Number of transitions.
+ * @param initial State of new animators.
+ * @return The graph.
+ * @note The arguments are copied. Caller takes ownership of returned value.
+ */
+AnimationGraph *AnimationGraphCreate(const AnimationClip *clips,
+                                     size_t n_states,
+                                     const AnimationTransition *transitions,
+                                     size_t n_transitions, uint16_t initial);
+
+/**
+ * @brief Destroy an animation graph.
+ * @param graph The graph.
+ * @note If graph is NULL, no operation is performed. Animators using the
+ *       graph must be removed first.
+ */
+void AnimationGraphDestroy(AnimationGraph *graph);
+
+/**
+ * @brief Create an animation system without animators.
+ * @return The animation system.
+ * @note Caller takes ownership of returned value.
+ */
+AnimationSystem *AnimationSystemCreate(void);
+
+/**
+ * @brief Destroy an animation system and all its animators.
+ * @param system The animation system.
+ * @note If system is NULL, no operation is performed.
+ */
+void AnimationSystemDestroy(AnimationSystem *system);
+
+/**
+ * @brief Add an animator in the initial state of a graph.
+ * @param system The animation system.
+ * @param graph The graph, which must outlive the animator.
+ * @return Handle of the animator.
+ */
+AnimatorId AnimationSystemAdd(AnimationSystem *system,
+                              const AnimationGraph *graph);
+
+/**
+ * @brief Remove an animator.
+ * @param system The animation system.
+ * @param id Handle of the animator. It may be reused by later animators.
+ */
+void AnimationSystemRemove(AnimationSystem *system, AnimatorId id);
+
+/**
+ * @brief Set the conditions that the transitions of an animator test.
+ * @param system The animation system.
+ * @param id Handle of the animator.
+ * @param conditions Condition bits, except ANIMATION_FINISHED.
+ */
+void AnimationSystemSetConditions(AnimationSystem *system, AnimatorId id,
+                                  uint32_t conditions);
+
+/**
+ * @brief Take transitions and advance the clips of all animators.
+ * @param system The animation system.
+ * @param dt Time step in seconds.
+ */
+void AnimationSystemUpdate(AnimationSystem *system, float dt);
+
+/**
+ * @brief Get the state of an animator.
+ * @param system The animation system.
+ * @param id Handle of the animator.
+ * @return The state.
+ */
+uint16_t AnimationSystemGetState(AnimationSystem *system, AnimatorId id);
+
+/**
+ * @brief Get the frame an animator shows.
+ * @param system The animation system.
+ * @param id Handle of the animator.
+ * @param texture Set to the sprite sheet of the current clip.
+ * @param frame Set to the column of the frame in the sprite sheet.
+ */
+void AnimationSystemGetFrame(AnimationSystem *system, AnimatorId id,
+                             Atom *texture, unsigned *frame);
+
+/**
+ * @brief Save the progress of an animator.
+ * @param system The animation system.
+ * @param id Handle of the animator.
+ * @param state Set to the progress.
+ */
+void AnimationSystemSave(AnimationSystem *system, AnimatorId id,
+                         AnimatorState *state);
+
+/**
+ * @brief Restore the progress of an animator.
+ * @param system The animation system.
+ * @param id Handle of the animator.
+ * @param state Progress saved with AnimationSystemSave() from an animator
+ *              with the same graph.
+ */
+void AnimationSystemLoad(AnimationSystem *system, AnimatorId id,
+                         const AnimatorState *state);
+
+/**
+ * @brief Get the number of animators.
+ * @param system The animation system.
+ * @return The number of animators.
+ */
+size_t AnimationSystemLength(const AnimationSystem *system);
+
+#endif /* __ETERNO_ANIMATION_H__ */
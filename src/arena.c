@@ -0,0 +1,197 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "arena.h"
+#include "logger.h"
+#include "utils.h"
+
+#define ARENA_ALIGNMENT alignof(max_align_t)
+
+typedef struct Block {
+  struct Block *next;
+  size_t capacity;
+  size_t used;
+  alignas(ARENA_ALIGNMENT) unsigned char data[];
+} Block;
+
+struct Arena {
+  size_t block_size;
+  Block *first;
+  Block *current;
+  void *last; /* Most recent allocation, which can be resized in place */
+};
+
+static inline size_t AlignUp(const size_t size) {
+  return (size + (ARENA_ALIGNMENT - 1)) & ~(ARENA_ALIGNMENT - 1);
+}
+
+static Block *BlockCreate(const size_t capacity) {
+  Block *const block = xmalloc(sizeof(Block) + capacity);
+  block->next = NULL;
+  block->capacity = capacity;
+  block->used = 0;
+  return block;
+}
+
+Arena *ArenaCreate(const size_t block_size) {
+  Arena *const arena = xmalloc(sizeof(Arena));
+  arena->block_size =
+      AlignUp((block_size > 0) ? block_size : DEFAULT_ARENA_BLOCK_SIZE);
+  arena->first = arena->current = BlockCreate(arena->block_size);
+  arena->last = NULL;
+  return arena;
+}
+
+void ArenaDestroy(void *const ptr) {
+  Arena *const arena = ptr;
+  if (arena == NULL) {
+    return;
+  }
+
+  Block *block = arena->first;
+  while (block != NULL) {
+    Block *const next = block->next;
+    xfree(block);
+    block = next;
+  }
+
+  xfree(arena);
+}
+
+void *ArenaAlloc(Arena *const arena, const size_t size) {
+  assert(arena != NULL);
+  assert(arena->current != NULL);
+
+  const size_t needed = AlignUp(MAX(size, (size_t)1));
+
+  /* Find a block with enough room, reusing blocks kept from before a reset */
+  Block *block = arena->current;
+  while (block->capacity - block->used < needed) {
+    if (block->next == NULL) {
+      block->next = BlockCreate(MAX(arena->block_size, needed));
+    } else if (block->next->capacity < needed) {
+      /* Insert a dedicated block for the oversized allocation */
+      Block *const large = BlockCreate(needed);
+      large->next = block->next;
+      block->next = large;
+    }
+    block = block->next;
+    assert(block->used == 0);
+  }
+  arena->current = block;
+
+  void *const ptr = block->data + block->used;
+  block->used += needed;
+  arena->last = ptr;
+  return ptr;
+}
+
+void *ArenaCalloc(Arena *const arena, const size_t nmemb, const size_t size) {
+  assert(arena != NULL);
+
+  if (size != 0 && nmemb > SIZE_MAX / size) {
+    LOG_CRITICAL("Failed to allocate memory: Size overflow (%zu * %zu)", nmemb,
+                 size);
+  }
+
+  void *const ptr = ArenaAlloc(arena, nmemb * size);
+  memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+void *ArenaRealloc(Arena *const arena, void *const ptr, const size_t old_size,
+                   const size_t new_size) {
+  assert(arena != NULL);
+
+  if (ptr == NULL) {
+    return ArenaAlloc(arena, new_size);
+  }
+
+  /* Grow or shrink the most recent allocation in place */
+  Block *const block = arena->current;
+  if (ptr == arena->last) {
+    const size_t offset = (size_t)((unsigned char *)ptr - block->data);
+    assert(offset < block->capacity);
+    const size_t needed = AlignUp(MAX(new_size, (size_t)1));
+    if (needed <= block->capacity - offset) {
+      block->used = offset + needed;
+      return ptr;
+    }
+  }
+
+  if (new_size <= old_size) {
+    return ptr;
+  }
+
+  void *const new_ptr = ArenaAlloc(arena, new_size);
+  memcpy(new_ptr, ptr, old_size);
+  return new_ptr;
+}
+
+char *ArenaStrdup(Arena *const arena, const char *const str) {
+  assert(arena != NULL);
+  assert(str != NULL);
+
+  const size_t size = strlen(str) + 1;
+  char *const dup = ArenaAlloc(arena, size);
+  memcpy(dup, str, size);
+  return dup;
+}
+
+void ArenaReset(Arena *const arena) {
+  assert(arena != NULL);
+
+  for (Block *block = arena->first; block != NULL; block = block->next) {
+    block->used = 0;
+  }
+  arena->current = arena->first;
+  arena->last = NULL;
+}
+
+ArenaMark ArenaGetMark(const Arena *const arena) {
+  assert(arena != NULL);
+  const ArenaMark mark = {arena->current, arena->current->used};
+  return mark;
+}
+
+void ArenaRewind(Arena *const arena, const ArenaMark mark) {
+  assert(arena != NULL);
+  assert(mark.block != NULL);
+
+  Block *const block = mark.block;
+  assert(mark.used <= block->used);
+  block->used = mark.used;
+  for (Block *next = block->next; next != NULL && next->used > 0;
+       next = next->next) {
+    next->used = 0;
+  }
+  arena->current = block;
+  arena->last = NULL;
+}
+
+size_t ArenaUsed(const Arena *const arena) {
+  assert(arena != NULL);
+
+  size_t used = 0;
+  for (const Block *block = arena->first; block != NULL; block = block->next) {
+    used += block->used;
+  }
+  return used;
+}
+
+size_t ArenaCapacity(const Arena *const arena) {
+  assert(arena != NULL);
+
+  size_t capacity = 0;
+  for (const Block *block = arena->first; block != NULL; block = block->next) {
+    capacity += block->capacity;
+  }
+  return capacity;
+}
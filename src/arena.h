@@ -0,0 +1,113 @@
+#ifndef __ETERNO_ARENA_H__
+#define __ETERNO_ARENA_H__
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+/**
+ * @brief Region allocator.
+ * @note Allocations are pointer bumps into large blocks, and are all released
+ *       at once with ArenaReset() or ArenaDestroy(). Blocks are kept across
+ *       resets, so a reused arena stops hitting the heap once warmed up.
+ */
+typedef struct Arena Arena;
+
+/**
+ * @brief Create an arena.
+ * @param block_size Minimum size of each block or 0 for the default size.
+ * @return The arena.
+ * @note Caller takes ownership of returned value.
+ */
+Arena *ArenaCreate(size_t block_size);
+
+/**
+ * @brief Destroy the arena and all memory allocated from it.
+ * @param ptr Pointer to the arena.
+ * @note If ptr is NULL, no operation is performed.
+ */
+void ArenaDestroy(void *ptr);
+
+/**
+ * @brief Allocate memory from the arena.
+ * @param arena The arena.
+ * @param size Number of bytes.
+ * @return Pointer to memory suitably aligned for any type.
+ * @note Memory is uninitialized and owned by the arena.
+ */
+void *ArenaAlloc(Arena *arena, size_t size);
+
+/**
+ * @brief Allocate zero-initialized memory from the arena.
+ * @param arena The arena.
+ * @param nmemb Number of members.
+ * @param size Size of each member.
+ * @return Pointer to memory suitably aligned for any type.
+ */
+void *ArenaCalloc(Arena *arena, size_t nmemb, size_t size);
+
+/**
+ * @brief Resize memory allocated from the arena.
+ * @param arena The arena.
+ * @param ptr Previously allocated memory or NULL.
+ * @param old_size Current size of the allocation.
+ * @param new_size Requested size of the allocation.
+ * @return Pointer to resized memory.
+ * @note The most recent allocation is resized in place when possible.
+ *       Otherwise the contents are copied and the old memory is not reclaimed
+ *       until the arena is reset.
+ */
+void *ArenaRealloc(Arena *arena, void *ptr, size_t old_size, size_t new_size);
+
+/**
+ * @brief Duplicate a string into the arena.
+ * @param arena The arena.
+ * @param str The string.
+ * @return The duplicate.
+ */
+char *ArenaStrdup(Arena *arena, const char *str);
+
+/**
+ * @brief Release all allocations at once.
+ * @param arena The arena.
+ * @note All memory previously allocated from the arena becomes invalid. The
+ *       blocks are kept for reuse.
+ */
+void ArenaReset(Arena *arena);
+
+/* Position in an arena, see ArenaGetMark() */
+typedef struct {
+  void *block;
+  size_t used;
+} ArenaMark;
+
+/**
+ * @brief Remember the current position in the arena.
+ * @param arena The arena.
+ * @return The position.
+ */
+ArenaMark ArenaGetMark(const Arena *arena);
+
+/**
+ * @brief Release all allocations made since a position was remembered.
+ * @param arena The arena.
+ * @param mark Position returned by ArenaGetMark() since the last reset.
+ */
+void ArenaRewind(Arena *arena, ArenaMark mark);
+
+/**
+ * @brief Get number of bytes allocated from the arena since last reset.
+ * @param arena The arena.
+ * @return Number of bytes including alignment padding.
+ */
+size_t ArenaUsed(const Arena *arena);
+
+/**
+ * @brief Get number of bytes reserved by the arena.
+ * @param arena The arena.
+ * @return Total size of all blocks.
+ */
+size_t ArenaCapacity(const Arena *arena);
+
+#endif // __ETERNO_ARENA_H__
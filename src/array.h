@@ -0,0 +1,165 @@
+#ifndef __ETERNO_ARRAY_H__
+#define __ETERNO_ARRAY_H__
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+
+/**
+ * @brief Define a typed dynamic array storing elements inline.
+ * @param Name Name of the array type and prefix of its functions.
+ * @param Type Element type.
+ * @param InlineCapacity Number of elements stored without heap allocation.
+ *
+ * Unlike List, elements are stored by value in one contiguous buffer, so
+ * iterating is a linear scan and appending only allocates when the capacity
+ * is exceeded. The first InlineCapacity elements live inside the array
+ * struct itself (small-buffer optimization). The array struct may be copied
+ * with memcpy(3) as long as only one copy is used afterwards.
+ *
+ * Generated functions (for Name = DrawList):
+ *   void DrawListInit(DrawList *array);
+ *   void DrawListDestroy(DrawList *array);
+ *   size_t DrawListLength(const DrawList *array);
+ *   Type *DrawListData(DrawList *array);
+ *   Type *DrawListAt(DrawList *array, size_t index);
+ *   void DrawListReserve(DrawList *array, size_t capacity);
+ *   void DrawListShrink(DrawList *array);
+ *   void DrawListClear(DrawList *array);
+ *   Type *DrawListAppend(DrawList *array, Type value);
+ *   Type DrawListPop(DrawList *array);
+ *   Type DrawListRemove(DrawList *array, size_t index);
+ *   Type DrawListSwapRemove(DrawList *array, size_t index);
+ */
+#define ARRAY_DEFINE(Name, Type, InlineCapacity)                               \
+  typedef struct Name {                                                        \
+    size_t length;                                                             \
+    size_t capacity;                                                           \
+    Type *heap; /* NULL while elements are stored inline */                    \
+    Type inline_data[((InlineCapacity) > 0) ? (InlineCapacity) : 1];           \
+  } Name;                                                                      \
+                                                                               \
+  ARG_UNUSED static inline void Name##Init(Name *const array) {                \
+    assert(array != NULL);                                                     \
+    array->length = 0;                                                         \
+    array->capacity = LENGTH(array->inline_data);                              \
+    array->heap = NULL;                                                        \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline void Name##Destroy(Name *const array) {             \
+    if (array != NULL) {                                                       \
+      xfree(array->heap);                                                      \
+      array->heap = NULL;                                                      \
+      array->length = 0;                                                       \
+      array->capacity = LENGTH(array->inline_data);                            \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline size_t Name##Length(const Name *const array) {      \
+    assert(array != NULL);                                                     \
+    return array->length;                                                      \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline Type *Name##Data(Name *const array) {               \
+    assert(array != NULL);                                                     \
+    return (array->heap != NULL) ? array->heap : array->inline_data;           \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline Type *Name##At(Name *const array,                   \
+                                          const size_t index) {                \
+    assert(array != NULL);                                                     \
+    assert(index < array->length);                                             \
+    return Name##Data(array) + index;                                          \
+  }                                                                            \
+                                                                               \
+  /* Move elements into a buffer of exactly new_capacity elements */           \
+  ARG_UNUSED static inline void Name##Resize(Name *const array,                \
+                                             const size_t new_capacity) {      \
+    assert(array != NULL);                                                     \
+    assert(new_capacity >= array->length);                                     \
+                                                                               \
+    if (new_capacity <= LENGTH(array->inline_data)) {                          \
+      if (array->heap != NULL) {                                               \
+        memcpy(array->inline_data, array->heap,                                \
+               array->length * sizeof(Type));                                  \
+        xfree(array->heap);                                                    \
+        array->heap = NULL;                                                    \
+      }                                                                        \
+      array->capacity = LENGTH(array->inline_data);                            \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+    Type *new_heap;                                                            \
+    if (array->heap == NULL) {                                                 \
+      new_heap = xmalloc(new_capacity * sizeof(Type));                         \
+      memcpy(new_heap, array->inline_data, array->length * sizeof(Type));      \
+    } else {                                                                   \
+      new_heap = xrealloc(array->heap, new_capacity * sizeof(Type));           \
+    }                                                                          \
+    array->heap = new_heap;                                                    \
+    array->capacity = new_capacity;                                            \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline void Name##Reserve(Name *const array,               \
+                                              const size_t capacity) {         \
+    assert(array != NULL);                                                     \
+    if (capacity > array->capacity) {                                          \
+      Name##Resize(array, capacity);                                           \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline void Name##Shrink(Name *const array) {              \
+    assert(array != NULL);                                                     \
+    if (array->heap != NULL && array->length < array->capacity) {              \
+      Name##Resize(array, array->length);                                      \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline void Name##Clear(Name *const array) {               \
+    assert(array != NULL);                                                     \
+    array->length = 0;                                                         \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline Type *Name##Append(Name *const array,               \
+                                              const Type value) {              \
+    assert(array != NULL);                                                     \
+    if (array->length == array->capacity) {                                    \
+      Name##Resize(array, array->capacity * 2);                                \
+    }                                                                          \
+    Type *const element = Name##Data(array) + array->length++;                 \
+    *element = value;                                                          \
+    return element;                                                            \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline Type Name##Pop(Name *const array) {                 \
+    assert(array != NULL);                                                     \
+    assert(array->length > 0);                                                 \
+    return Name##Data(array)[--array->length];                                 \
+  }                                                                            \
+                                                                               \
+  ARG_UNUSED static inline Type Name##Remove(Name *const array,                \
+                                             const size_t index) {             \
+    assert(array != NULL);                                                     \
+    assert(index < array->length);                                             \
+    Type *const data = Name##Data(array);                                      \
+    const Type value = data[index];                                            \
+    array->length -= 1;                                                        \
+    memmove(data + index, data + index + 1,                                    \
+            (array->length - index) * sizeof(Type));                           \
+    return value;                                                              \
+  }                                                                            \
+                                                                               \
+  /* Remove in O(1) by moving the last element into the hole */                \
+  ARG_UNUSED static inline Type Name##SwapRemove(Name *const array,            \
+                                                 const size_t index) {         \
+    assert(array != NULL);                                                     \
+    assert(index < array->length);                                             \
+    Type *const data = Name##Data(array);                                      \
+    const Type value = data[index];                                            \
+    data[index] = data[--array->length];                                       \
+    return value;                                                              \
+  }
+
+#endif // __ETERNO_ARRAY_H__
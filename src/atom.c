@@ -0,0 +1,180 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "atom.h"
+#include "logger.h"
+#include "utils.h"
+
+typedef struct AtomHeader {
+  size_t hash;
+  size_t length;
+  char str[];
+} AtomHeader;
+
+typedef struct {
+  size_t length;
+  size_t capacity;
+  AtomHeader **buffer;
+} AtomTable;
+
+static AtomTable ATOM_TABLE = {0};
+
+/**
+ * @brief Hash a string.
+ * @param str The string.
+ * @param length Length of the string.
+ * @return The hash.
+ */
+static size_t HashString(const char *const str, const size_t length) {
+  assert(str != NULL);
+
+  size_t hash = 5381;
+  for (size_t i = 0; i < length; i++) {
+    hash = ((hash << 5) + hash) + (size_t)str[i];
+  }
+  return hash;
+}
+
+static const AtomHeader *GetHeader(const Atom atom) {
+  assert(atom != NULL);
+  return (const AtomHeader *)(atom - offsetof(AtomHeader, str));
+}
+
+/**
+ * @brief Compute the index of a string in the atom table.
+ * @return Index of the matching atom or the empty slot where it belongs.
+ * @note Capacity is always a power of two.
+ */
+static size_t ComputeIndex(const AtomHeader *const *const buffer,
+                           const size_t capacity, const char *const str,
+                           const size_t length, const size_t hash) {
+  assert(buffer != NULL);
+
+  size_t index = hash & (capacity - 1);
+  while (true) {
+    const AtomHeader *const header = buffer[index];
+    if (header == NULL) {
+      break;
+    }
+    if (header->hash == hash && header->length == length &&
+        memcmp(header->str, str, length) == 0) {
+      break;
+    }
+    index = (index + 1) & (capacity - 1);
+  }
+
+  return index;
+}
+
+static void EnsureCapacity(AtomTable *const table) {
+  assert(table != NULL);
+
+  if (table->buffer == NULL) {
+    table->capacity = DEFAULT_ATOM_CAPACITY;
+    table->buffer = xcalloc(table->capacity, sizeof(AtomHeader *));
+    return;
+  }
+
+  if ((float)table->length <
+      ((float)table->capacity * DEFAULT_DICT_MAX_LOAD_FACTOR)) {
+    return;
+  }
+
+  const size_t new_capacity = table->capacity * 2;
+  AtomHeader **const new_buffer = xcalloc(new_capacity, sizeof(AtomHeader *));
+
+  for (size_t i = 0; i < table->capacity; i++) {
+    AtomHeader *const header = table->buffer[i];
+    if (header == NULL) {
+      continue;
+    }
+
+    const size_t index =
+        ComputeIndex((const AtomHeader *const *)new_buffer, new_capacity,
+                     header->str, header->length, header->hash);
+    assert(new_buffer[index] == NULL);
+    new_buffer[index] = header;
+  }
+
+  xfree(table->buffer);
+  table->buffer = new_buffer;
+  table->capacity = new_capacity;
+}
+
+Atom AtomIntern(const char *const str) {
+  assert(str != NULL);
+  return AtomInternSlice(SliceFromString(str));
+}
+
+Atom AtomInternSlice(const Slice slice) {
+  assert(slice.data != NULL || slice.length == 0);
+
+  AtomTable *const table = &ATOM_TABLE;
+  EnsureCapacity(table);
+
+  const size_t hash = HashString(slice.data, slice.length);
+  const size_t index =
+      ComputeIndex((const AtomHeader *const *)table->buffer, table->capacity,
+                   slice.data, slice.length, hash);
+  if (table->buffer[index] != NULL) {
+    return table->buffer[index]->str;
+  }
+
+  AtomHeader *const header = xmalloc(sizeof(AtomHeader) + slice.length + 1);
+  header->hash = hash;
+  header->length = slice.length;
+  memcpy(header->str, slice.data, slice.length);
+  header->str[slice.length] = '\0';
+
+  table->buffer[index] = header;
+  table->length += 1;
+
+  return header->str;
+}
+
+Atom AtomFind(const char *const str) {
+  assert(str != NULL);
+  return AtomFindSlice(SliceFromString(str));
+}
+
+Atom AtomFindSlice(const Slice slice) {
+  assert(slice.data != NULL || slice.length == 0);
+
+  const AtomTable *const table = &ATOM_TABLE;
+  if (table->buffer == NULL) {
+    return NULL;
+  }
+
+  const size_t hash = HashString(slice.data, slice.length);
+  const size_t index =
+      ComputeIndex((const AtomHeader *const *)table->buffer, table->capacity,
+                   slice.data, slice.length, hash);
+  const AtomHeader *const header = table->buffer[index];
+  return (header != NULL) ? header->str : NULL;
+}
+
+size_t AtomLength(const Atom atom) { return GetHeader(atom)->length; }
+
+size_t AtomHash(const Atom atom) { return GetHeader(atom)->hash; }
+
+size_t AtomCount(void) { return ATOM_TABLE.length; }
+
+void AtomTableDestroy(void) {
+  AtomTable *const table = &ATOM_TABLE;
+  if (table->buffer == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < table->capacity; i++) {
+    xfree(table->buffer[i]);
+  }
+
+  xfree(table->buffer);
+  table->buffer = NULL;
+  table->capacity = table->length = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef __ETERNO_ATOM_H__
+#define __ETERNO_ATOM_H__
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "slice.h"
+
+/**
+ * @brief Interned string.
+ * @note Two atoms are equal if and only if the pointers are equal. Atoms are
+ *       valid NUL-terminated strings and live until AtomTableDestroy() is
+ *       called.
+ */
+typedef const char *Atom;
+
+/**
+ * @brief Intern a string.
+ * @param str The string.
+ * @return The unique atom for the string.
+ * @note The atom table is not thread-safe. Strings should be interned on the
+ *       main thread.
+ */
+Atom AtomIntern(const char *str);
+
+/**
+ * @brief Intern a slice.
+ * @param slice The slice.
+ * @return The unique atom for the contents of the slice.
+ * @note Lets parsers turn keys into atoms without creating intermediate
+ *       strings.
+ */
+Atom AtomInternSlice(Slice slice);
+
+/**
+ * @brief Find the atom of a previously interned string.
+ * @param str The string.
+ * @return The atom or NULL if the string has never been interned.
+ */
+Atom AtomFind(const char *str);
+
+/**
+ * @brief Find the atom of a previously interned slice.
+ * @param slice The slice.
+ * @return The atom or NULL if the contents have never been interned.
+ */
+Atom AtomFindSlice(Slice slice);
+
+/**
+ * @brief Get length of an atom.
+ * @param atom The atom.
+ * @return Length of the atom excluding terminating null-byte.
+ */
+size_t AtomLength(Atom atom);
+
+/**
+ * @brief Get hash of an atom.
+ * @param atom The atom.
+ * @return The hash computed when the atom was interned.
+ */
+size_t AtomHash(Atom atom);
+
+/**
+ * @brief Get number of interned atoms.
+ * @return Number of interned atoms.
+ */
+size_t AtomCount(void);
+
+/**
+ * @brief Destroy all atoms.
+ * @note All previously returned atoms become invalid.
+ */
+void AtomTableDestroy(void);
+
+#endif // __ETERNO_ATOM_H__
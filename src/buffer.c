@@ -1,49 +1,103 @@
 
 #include "config.h"
 
+#define LOG_MODULE LOG_MODULE_CORE
+
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "allocator.h"
 #include "buffer.h"
 #include "logger.h"
+#include "metrics.h"
+#include "slice.h"
 #include "utils.h"
 
 struct Buffer {
   size_t length;
   size_t capacity;
   char *buffer;
+  Allocator allocator;
+  size_t mapped; /* Size of the read-only mapping or 0 if not mapped */
 };
 
+/**
+ * @brief Replace a read-only mapping with a private copy of its contents.
+ * @param buf Buffer.
+ * @param needed Number of bytes to make room for in addition to the contents.
+ */
+static void Unmap(Buffer *const buf, const size_t needed) {
+  assert(buf != NULL);
+  assert(buf->mapped > 0);
+
+  size_t new_capacity = DEFAULT_BUFFER_CAPACITY;
+  while (new_capacity <= buf->length + needed) {
+    new_capacity *= 2;
+  }
+
+  char *const new_buffer = AllocatorAlloc(&buf->allocator, new_capacity);
+  memcpy(new_buffer, buf->buffer, buf->length + 1);
+  if (munmap(buf->buffer, buf->mapped) != 0) {
+    LOG_ERROR("Failed to unmap buffer: %s", strerror(errno));
+  }
+
+  buf->buffer = new_buffer;
+  buf->capacity = new_capacity;
+  buf->mapped = 0;
+}
+
 static void EnsureCapacity(Buffer *const buf, const size_t needed) {
   assert(buf != NULL);
 
-  while ((buf->capacity - buf->length) <= needed) {
-    size_t new_capacity =
-        (buf->capacity > 0) ? buf->capacity * 2 : DEFAULT_BUFFER_CAPACITY;
-    char *new_buffer = realloc(buf->buffer, new_capacity);
-    if (new_buffer == NULL) {
-      LOG_CRITICAL("realloc(3): Failed to allocate memory: %s",
-                   strerror(errno));
-    }
+  if (buf->mapped > 0) {
+    /* Mapped buffers are read-only, writing makes a private copy */
+    Unmap(buf, needed);
+  }
+
+  size_t new_capacity = buf->capacity;
+  while ((new_capacity - buf->length) <= needed) {
+    new_capacity = (new_capacity > 0) ? new_capacity * 2
+                                      : DEFAULT_BUFFER_CAPACITY;
+  }
+
+  /* Grow in one step, so large requests do not copy repeatedly */
+  if (new_capacity != buf->capacity) {
+    buf->buffer = AllocatorRealloc(&buf->allocator, buf->buffer, buf->capacity,
+                                   new_capacity);
     buf->capacity = new_capacity;
-    buf->buffer = new_buffer;
   }
 }
 
 Buffer *BufferCreate(void) {
-  Buffer *buf = xmalloc(sizeof(Buffer));
+  return BufferCreateWithAllocator(&HEAP_ALLOCATOR);
+}
+
+Buffer *BufferCreateInArena(Arena *const arena) {
+  const Allocator allocator = ArenaAllocator(arena);
+  return BufferCreateWithAllocator(&allocator);
+}
+
+Buffer *BufferCreateWithAllocator(const Allocator *const allocator) {
+  assert(allocator != NULL);
+
+  Buffer *buf = AllocatorAlloc(allocator, sizeof(Buffer));
 
   buf->capacity = DEFAULT_BUFFER_CAPACITY;
   buf->length = 0;
-  buf->buffer = xmalloc(buf->capacity);
+  buf->buffer = AllocatorAlloc(allocator, buf->capacity);
   buf->buffer[0] = '\0';
+  buf->allocator = *allocator;
+  buf->mapped = 0;
 
   return buf;
 }
@@ -58,6 +112,11 @@ size_t BufferLength(const Buffer *const buf) {
   return buf->length;
 }
 
+Slice BufferSlice(const Buffer *const buf) {
+  assert(buf != NULL);
+  return SliceCreate(buf->buffer, buf->length);
+}
+
 void BufferAppend(Buffer *const buf, const char ch) {
   assert(buf != NULL);
   EnsureCapacity(buf, 1);
@@ -66,6 +125,32 @@ void BufferAppend(Buffer *const buf, const char ch) {
   assert(buf->length <= buf->capacity);
 }
 
+char *BufferReserve(Buffer *const buf, const size_t size) {
+  assert(buf != NULL);
+  EnsureCapacity(buf, size);
+  return buf->buffer + buf->length;
+}
+
+void BufferCommit(Buffer *const buf, const size_t size) {
+  assert(buf != NULL);
+  assert(buf->mapped == 0);
+  assert(buf->length + size < buf->capacity);
+
+  buf->length += size;
+  buf->buffer[buf->length] = '\0';
+}
+
+void BufferTruncate(Buffer *const buf, const size_t length) {
+  assert(buf != NULL);
+  assert(length <= buf->length);
+
+  if (buf->mapped > 0) {
+    Unmap(buf, 0);
+  }
+  buf->length = length;
+  buf->buffer[buf->length] = '\0';
+}
+
 void BufferPrint(Buffer *const buf, const char *const str) {
   assert(buf != NULL);
   assert(str != NULL);
@@ -78,41 +163,207 @@ void BufferPrint(Buffer *const buf, const char *const str) {
   assert(buf->length <= buf->capacity);
 }
 
+void BufferAppendSlice(Buffer *const buf, const Slice slice) {
+  assert(buf != NULL);
+  assert(slice.data != NULL || slice.length == 0);
+
+  EnsureCapacity(buf, slice.length);
+  if (slice.length > 0) {
+    memcpy(buf->buffer + buf->length, slice.data, slice.length);
+  }
+  buf->length += slice.length;
+  buf->buffer[buf->length] = '\0';
+  assert(buf->length <= buf->capacity);
+}
+
 void BufferPrintFormat(Buffer *const buf, const char *const fmt, ...) {
   assert(buf != NULL);
   assert(fmt != NULL);
 
-  va_list ap;
+  /* Makes mapped buffers writable */
+  EnsureCapacity(buf, 0);
+
+  va_list ap, retry;
 
-  // Figure out how many bytes we need
+  // Optimistically format into the remaining capacity
   va_start(ap, fmt);
-  const int length = vsnprintf(NULL, 0, fmt, ap);
+  va_copy(retry, ap);
+  const size_t available = buf->capacity - buf->length;
+  const int length = vsnprintf(buf->buffer + buf->length, available, fmt, ap);
   va_end(ap);
 
   if (length < 0) {
+    va_end(retry);
     LOG_CRITICAL("vsnprintf(3): Unexpected return value (%d < 0): %s", length,
                  strerror(errno));
   }
-  EnsureCapacity(buf, (size_t)length);
 
-  va_start(ap, fmt);
-  const int ret = vsnprintf(buf->buffer + buf->length,
-                            buf->capacity - buf->length, fmt, ap);
-  va_end(ap);
-
-  if (ret != length) {
-    LOG_CRITICAL("vsnprintf(3): Unexpected return value (%d != %d): %s", ret,
-                 length, strerror(errno));
+  // Only format a second time if the output was truncated
+  if ((size_t)length >= available) {
+    EnsureCapacity(buf, (size_t)length);
+    const int ret = vsnprintf(buf->buffer + buf->length,
+                              buf->capacity - buf->length, fmt, retry);
+    if (ret != length) {
+      LOG_CRITICAL("vsnprintf(3): Unexpected return value (%d != %d): %s",
+                   ret, length, strerror(errno));
+    }
   }
+  va_end(retry);
 
   buf->length += (size_t)length;
-  assert(buf->length <= buf->capacity);
+  assert(buf->length < buf->capacity);
+}
+
+/* Two-digit decimal strings "00" to "99", halving the divisions needed */
+static const char DIGIT_PAIRS[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+/**
+ * @brief Count decimal digits of a value.
+ */
+static size_t CountDigits(uint64_t value) {
+  size_t n_digits = 1;
+  while (value >= 10000) {
+    value /= 10000;
+    n_digits += 4;
+  }
+  if (value >= 1000) {
+    return n_digits + 3;
+  }
+  if (value >= 100) {
+    return n_digits + 2;
+  }
+  return n_digits + ((value >= 10) ? 1 : 0);
+}
+
+/**
+ * @brief Write decimal digits of a value, ending right before end.
+ */
+static void WriteDigits(char *end, uint64_t value) {
+  while (value >= 100) {
+    const size_t pair = (size_t)(value % 100) * 2;
+    value /= 100;
+    *--end = DIGIT_PAIRS[pair + 1];
+    *--end = DIGIT_PAIRS[pair];
+  }
+  if (value >= 10) {
+    const size_t pair = (size_t)value * 2;
+    *--end = DIGIT_PAIRS[pair + 1];
+    *--end = DIGIT_PAIRS[pair];
+  } else {
+    *--end = (char)('0' + value);
+  }
+}
+
+/**
+ * @brief Append digits of a value, zero-padded to at least min_digits.
+ */
+static void AppendDigits(Buffer *const buf, const uint64_t value,
+                         const size_t min_digits) {
+  const size_t n_digits = CountDigits(value);
+  const size_t n_zeros = (min_digits > n_digits) ? min_digits - n_digits : 0;
+  EnsureCapacity(buf, n_zeros + n_digits);
+
+  memset(buf->buffer + buf->length, '0', n_zeros);
+  buf->length += n_zeros + n_digits;
+  WriteDigits(buf->buffer + buf->length, value);
+  buf->buffer[buf->length] = '\0';
+  assert(buf->length < buf->capacity);
+}
+
+void BufferAppendInt(Buffer *const buf, const int64_t value) {
+  assert(buf != NULL);
+
+  if (value < 0) {
+    BufferAppend(buf, '-');
+    /* Negate as unsigned, so that INT64_MIN does not overflow */
+    AppendDigits(buf, -(uint64_t)value, 0);
+  } else {
+    AppendDigits(buf, (uint64_t)value, 0);
+  }
+}
+
+void BufferAppendUnsigned(Buffer *const buf, const uint64_t value) {
+  assert(buf != NULL);
+  AppendDigits(buf, value, 0);
+}
+
+void BufferAppendHex(Buffer *const buf, uint64_t value,
+                     const size_t min_digits) {
+  assert(buf != NULL);
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+
+  size_t n_digits = 1;
+  for (uint64_t rest = value >> 4; rest != 0; rest >>= 4) {
+    n_digits += 1;
+  }
+  n_digits = MAX(n_digits, min_digits);
+  EnsureCapacity(buf, n_digits);
+
+  buf->length += n_digits;
+  char *ptr = buf->buffer + buf->length;
+  for (size_t i = 0; i < n_digits; i++) {
+    *--ptr = HEX_DIGITS[value & 0xf];
+    value >>= 4;
+  }
+  buf->buffer[buf->length] = '\0';
+  assert(buf->length < buf->capacity);
+}
+
+void BufferAppendFloat(Buffer *const buf, const double value,
+                       const unsigned precision) {
+  assert(buf != NULL);
+
+  static const double POWERS_OF_TEN[] = {
+      1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+  };
+  assert(precision < LENGTH(POWERS_OF_TEN));
+
+  /* Scale to an integer, which is exact while it stays below 2^53. Anything
+   * else (including NaN and infinity) goes through the slow path. */
+  const double scaled =
+      (signbit(value) ? -value : value) * POWERS_OF_TEN[precision];
+  if (!(scaled < 9007199254740992.0)) {
+    BufferPrintFormat(buf, "%.*f", (int)precision, value);
+    return;
+  }
+
+  /* Scaling may be off by an ulp, which only matters if the value is close
+   * to halfway between two outputs. Let printf(3) round those exactly. */
+  uint64_t fixed = (uint64_t)scaled;
+  const double remainder = scaled - (double)fixed;
+  const double distance = (remainder > 0.5) ? remainder - 0.5 : 0.5 - remainder;
+  if (distance <= scaled * 0x1p-51) {
+    BufferPrintFormat(buf, "%.*f", (int)precision, value);
+    return;
+  }
+  if (remainder > 0.5) {
+    fixed += 1;
+  }
+  const uint64_t scale = (uint64_t)POWERS_OF_TEN[precision];
+
+  /* Like printf(3), keep the sign of values that round to zero */
+  if (signbit(value)) {
+    BufferAppend(buf, '-');
+  }
+  AppendDigits(buf, fixed / scale, 0);
+
+  if (precision > 0) {
+    BufferAppend(buf, '.');
+    AppendDigits(buf, fixed % scale, precision);
+  }
 }
 
 char *BufferToString(Buffer *const buf) {
   assert(buf != NULL);
+  if (buf->mapped > 0) {
+    Unmap(buf, 0);
+  }
   char *const str = buf->buffer;
-  free(buf);
+  const Allocator allocator = buf->allocator;
+  AllocatorFree(&allocator, buf, sizeof(Buffer));
   return str;
 }
 
@@ -133,19 +384,34 @@ bool BufferReadFile(Buffer *const buf, const char *const filename) {
     return false;
   }
 
-  ssize_t n_read = 0;
-  do {
-    EnsureCapacity(buf, DEFAULT_BUFFER_CAPACITY);
-    n_read = read(fd, buf->buffer + buf->length, DEFAULT_BUFFER_CAPACITY);
+  /* Size the buffer up front, so that regular files are read in one go */
+  struct stat sb;
+  if (fstat(fd, &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0) {
+    EnsureCapacity(buf, (size_t)sb.st_size + 1);
+  }
+
+  while (true) {
+    /* Always leave room for the terminating null-byte. For files whose size
+     * is unknown, the capacity doubles so the reads grow along with it. */
+    EnsureCapacity(buf, 1);
+    const ssize_t n_read = read(fd, buf->buffer + buf->length,
+                                buf->capacity - buf->length - 1);
+    if (n_read == 0) {
+      break;
+    }
     if (n_read < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
       LOG_ERROR("Failed to read file '%s': %s", filename, strerror(errno));
       close(fd);
       return false;
     }
 
     buf->length += (size_t)n_read;
-    assert(buf->length <= buf->capacity);
-  } while (n_read > 0);
+    assert(buf->length < buf->capacity);
+    METRICS_ADD(FILE_BYTES_READ, (uint64_t)n_read);
+  }
 
   close(fd);
   buf->buffer[buf->length] = '\0';
@@ -154,10 +420,87 @@ bool BufferReadFile(Buffer *const buf, const char *const filename) {
   return true;
 }
 
+Buffer *BufferMapFile(const char *const filename) {
+  assert(filename != NULL);
+
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    LOG_ERROR("Failed to open file '%s' for reading: %s", filename,
+              strerror(errno));
+    return NULL;
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) != 0) {
+    LOG_ERROR("Failed to stat file '%s': %s", filename, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  if (!S_ISREG(sb.st_mode)) {
+    LOG_ERROR("Failed to map file '%s': Not a regular file", filename);
+    close(fd);
+    return NULL;
+  }
+
+  /* Reserve zeroed memory for the file plus at least one byte, then map the
+   * file over the start of it. The byte after the contents is then always a
+   * null-byte, even when the size is a multiple of the page size. */
+  const size_t length = (size_t)sb.st_size;
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t mapped = ((length / page_size) + 1) * page_size;
+
+  char *const data = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+  if (data == MAP_FAILED) {
+    LOG_ERROR("Failed to map file '%s': %s", filename, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+
+  if (length > 0) {
+    if (mmap(data, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) ==
+        MAP_FAILED) {
+      LOG_ERROR("Failed to map file '%s': %s", filename, strerror(errno));
+      munmap(data, mapped);
+      close(fd);
+      return NULL;
+    }
+
+    /* Pages are read ahead aggressively and dropped soon after use */
+    if (madvise(data, length, MADV_SEQUENTIAL) != 0) {
+      LOG_DEBUG("Failed to advise kernel on mapping of file '%s': %s",
+                filename, strerror(errno));
+    }
+  }
+
+  /* The mapping stays valid after the descriptor is closed */
+  close(fd);
+
+  Buffer *const buf = xmalloc(sizeof(Buffer));
+  buf->length = length;
+  buf->capacity = mapped;
+  buf->buffer = data;
+  buf->allocator = HEAP_ALLOCATOR;
+  buf->mapped = mapped;
+  LOG_DEBUG("Mapped %zu byte(s) from file '%s'", length, filename);
+
+  return buf;
+}
+
 void BufferDestroy(void *const ptr) {
   Buffer *const buf = (Buffer *)ptr;
-  if (buf != NULL) {
-    free(buf->buffer);
-    free(buf);
+  if (buf == NULL) {
+    return;
+  }
+
+  if (buf->mapped > 0) {
+    if (munmap(buf->buffer, buf->mapped) != 0) {
+      LOG_ERROR("Failed to unmap buffer: %s", strerror(errno));
+    }
+  } else {
+    AllocatorFree(&buf->allocator, buf->buffer, buf->capacity);
   }
+  /* Copy, as the allocator lives in the buffer being freed */
+  const Allocator allocator = buf->allocator;
+  AllocatorFree(&allocator, buf, sizeof(Buffer));
 }
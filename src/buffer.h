@@ -2,8 +2,13 @@
 #define __ETERNO_BUFFER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
+#include "allocator.h"
+#include "arena.h"
+#include "slice.h"
+
 typedef struct Buffer Buffer;
 
 /**
@@ -13,6 +18,23 @@ typedef struct Buffer Buffer;
  */
 Buffer *BufferCreate(void);
 
+/**
+ * @brief Create a buffer whose storage is drawn from an arena.
+ * @param arena The arena or NULL to use the heap.
+ * @return Buffer.
+ * @note The buffer is invalidated when the arena is reset.
+ */
+Buffer *BufferCreateInArena(Arena *arena);
+
+/**
+ * @brief Create a buffer whose storage is drawn from an allocator.
+ * @param allocator The allocator, which is copied into the buffer.
+ * @return Buffer.
+ * @note The buffer must be destroyed before the memory of the allocator is
+ *       released, e.g. within the same frame for FrameAllocator().
+ */
+Buffer *BufferCreateWithAllocator(const Allocator *allocator);
+
 /**
  * @brief Get buffer data.
  * @param buf Buffer.
@@ -27,6 +49,14 @@ const char *BufferData(const Buffer *buf);
  */
 size_t BufferLength(const Buffer *buf);
 
+/**
+ * @brief Get a slice covering the buffer data.
+ * @param buf Buffer.
+ * @return The slice.
+ * @note The slice is invalidated when the buffer is modified or destroyed.
+ */
+Slice BufferSlice(const Buffer *buf);
+
 /**
  * @brief Append a byte to the buffer.
  * @param buf Buffer.
@@ -34,6 +64,31 @@ size_t BufferLength(const Buffer *buf);
  */
 void BufferAppend(Buffer *buf, char ch);
 
+/**
+ * @brief Reserve space for writing directly into the buffer, e.g. with
+ *        read(2).
+ * @param buf Buffer.
+ * @param size Number of bytes to reserve.
+ * @return Pointer to at least size writable bytes after the current contents.
+ * @note Call BufferCommit() with the number of bytes actually written. The
+ *       pointer is invalidated by any other modification of the buffer.
+ */
+char *BufferReserve(Buffer *buf, size_t size);
+
+/**
+ * @brief Append bytes previously written to space from BufferReserve().
+ * @param buf Buffer.
+ * @param size Number of bytes written, at most the reserved size.
+ */
+void BufferCommit(Buffer *buf, size_t size);
+
+/**
+ * @brief Discard the end of the buffer.
+ * @param buf Buffer.
+ * @param length New length, at most the current length.
+ */
+void BufferTruncate(Buffer *buf, size_t length);
+
 /**
  * @brief Print string to buffer.
  * @param buf Buffer.
@@ -41,19 +96,65 @@ void BufferAppend(Buffer *buf, char ch);
  */
 void BufferPrint(Buffer *buf, const char *str);
 
+/**
+ * @brief Append a slice to the buffer.
+ * @param buf Buffer.
+ * @param slice Slice. Must not point into the buffer itself.
+ */
+void BufferAppendSlice(Buffer *buf, Slice slice);
+
 /**
  * @brief Print string to buffer.
  * @param buf Buffer.
  * @param fmt Format string.
  * @param ... Format arguments.
+ * @note The string is formatted straight into the buffer, and only formatted
+ *       again if it did not fit.
  */
 void BufferPrintFormat(Buffer *buf, const char *fmt, ...);
 
+/**
+ * @brief Append a signed integer in decimal.
+ * @param buf Buffer.
+ * @param value The integer.
+ * @note Much faster than BufferPrintFormat() with "%" PRId64.
+ */
+void BufferAppendInt(Buffer *buf, int64_t value);
+
+/**
+ * @brief Append an unsigned integer in decimal.
+ * @param buf Buffer.
+ * @param value The integer.
+ */
+void BufferAppendUnsigned(Buffer *buf, uint64_t value);
+
+/**
+ * @brief Append an unsigned integer in lowercase hexadecimal.
+ * @param buf Buffer.
+ * @param value The integer.
+ * @param min_digits Minimum number of digits, padded with zeros.
+ */
+void BufferAppendHex(Buffer *buf, uint64_t value, size_t min_digits);
+
+/**
+ * @brief Append a floating point number with a fixed number of decimals.
+ * @param buf Buffer.
+ * @param value The number.
+ * @param precision Number of decimals, at most 9.
+ * @note Same output as BufferPrintFormat() with "%.*f". Values close to
+ *       halfway between two outputs, large numbers, NaN and infinity fall back
+ *       to formatting.
+ */
+void BufferAppendFloat(Buffer *buf, double value, unsigned precision);
+
 /**
  * @brief Convert buffer to string.
  * @param buf Buffer.
  * @return Pointer to internal buffer data.
- * @note Buffer is destroyed. Caller takes ownership of returned value.
+ * @note Buffer is destroyed. The string is allocated by the allocator of the
+ *       buffer, so caller takes ownership of returned value unless the buffer
+ *       was created in an arena, in which case the string is owned by the
+ *       arena.
  */
 char *BufferToString(Buffer *buf);
 
@@ -74,6 +175,18 @@ Buffer *BufferFromString(const char *str);
  */
 bool BufferReadFile(Buffer *buf, const char *filename);
 
+/**
+ * @brief Map file contents into a buffer without copying.
+ * @param filename Path to file.
+ * @return Buffer or NULL on error.
+ * @note Error is logged to stderr. Caller takes ownership of returned value.
+ *       The contents are null-terminated and paged in lazily, with the kernel
+ *       advised to expect a sequential scan. Modifying the buffer first copies
+ *       the contents to the heap. Changes made to the file while it is mapped
+ *       may or may not be visible through the buffer.
+ */
+Buffer *BufferMapFile(const char *filename);
+
 /**
  * @brief Destroy buffer.
  * @param ptr Pointer to Buffer.
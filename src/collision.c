@@ -0,0 +1,427 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <float.h>
+#include <stdint.h>
+
+#include "array.h"
+#include "collision.h"
+#include "utils.h"
+
+/* Gap in pixels within which a box counts as touching a solid. Also absorbs
+ * rounding errors, so a box resting on a solid is not blocked by it. */
+#define CONTACT_EPSILON 0.01f
+
+/* Number of times a move may be blocked and slide along a solid */
+#define MAX_SLIDES 3
+
+ARRAY_DEFINE(IndexArray, uint32_t, 4)
+ARRAY_DEFINE(SolidArray, CollisionBox, 1)
+
+struct CollisionWorld {
+  float cell_size;
+  int columns;
+  int rows;
+  IndexArray *cells;      /* Indices of the solids overlapping each cell */
+  SolidArray solids;
+  IndexArray free_solids; /* Slots of removed solids */
+  IndexArray stamps;      /* Query that last visited each solid */
+  uint32_t stamp;
+  IndexArray candidates;  /* Solids found by the last query */
+};
+
+CollisionWorld *CollisionWorldCreate(const float width, const float height,
+                                     float cell_size) {
+  assert(width > 0.0f && height > 0.0f);
+  assert(cell_size >= 0.0f);
+
+  if (cell_size == 0.0f) {
+    cell_size = DEFAULT_COLLISION_CELL_SIZE;
+  }
+
+  CollisionWorld *const world = xcalloc(1, sizeof(CollisionWorld));
+  world->cell_size = cell_size;
+  world->columns = (int)SDL_ceilf(width / cell_size);
+  world->rows = (int)SDL_ceilf(height / cell_size);
+
+  const size_t n_cells = (size_t)world->columns * (size_t)world->rows;
+  world->cells = xcalloc(n_cells, sizeof(IndexArray));
+  for (size_t i = 0; i < n_cells; i++) {
+    IndexArrayInit(&world->cells[i]);
+  }
+  SolidArrayInit(&world->solids);
+  IndexArrayInit(&world->free_solids);
+  IndexArrayInit(&world->stamps);
+  IndexArrayInit(&world->candidates);
+
+  return world;
+}
+
+void CollisionWorldDestroy(CollisionWorld *const world) {
+  if (world == NULL) {
+    return;
+  }
+
+  const size_t n_cells = (size_t)world->columns * (size_t)world->rows;
+  for (size_t i = 0; i < n_cells; i++) {
+    IndexArrayDestroy(&world->cells[i]);
+  }
+  xfree(world->cells);
+  SolidArrayDestroy(&world->solids);
+  IndexArrayDestroy(&world->free_solids);
+  IndexArrayDestroy(&world->stamps);
+  IndexArrayDestroy(&world->candidates);
+  xfree(world);
+}
+
+void CollisionWorldReserve(CollisionWorld *const world, const size_t n_solids,
+                           const size_t n_per_cell) {
+  assert(world != NULL);
+
+  const size_t n_cells = (size_t)world->columns * (size_t)world->rows;
+  for (size_t i = 0; i < n_cells; i++) {
+    IndexArrayReserve(&world->cells[i], n_per_cell);
+  }
+  SolidArrayReserve(&world->solids, n_solids);
+  IndexArrayReserve(&world->free_solids, n_solids);
+  IndexArrayReserve(&world->stamps, n_solids);
+  IndexArrayReserve(&world->candidates, n_solids);
+}
+
+/* Cell containing a coordinate, clamped to the grid so that anything
+ * outside it lands in the nearest edge cell */
+static int CellIndex(const float coordinate, const float cell_size,
+                     const int count) {
+  const float index = SDL_floorf(coordinate / cell_size);
+  if (index < 0.0f) {
+    return 0;
+  }
+  if (index >= (float)count) {
+    return count - 1;
+  }
+  return (int)index;
+}
+
+typedef struct {
+  int column_begin, column_end; /* Inclusive */
+  int row_begin, row_end;       /* Inclusive */
+} CellRange;
+
+static CellRange GetCellRange(const CollisionWorld *const world,
+                              const float x0, const float y0, const float x1,
+                              const float y1) {
+  const CellRange range = {
+      .column_begin = CellIndex(x0, world->cell_size, world->columns),
+      .column_end = CellIndex(x1, world->cell_size, world->columns),
+      .row_begin = CellIndex(y0, world->cell_size, world->rows),
+      .row_end = CellIndex(y1, world->cell_size, world->rows),
+  };
+  return range;
+}
+
+void CollisionWorldAddSolid(CollisionWorld *const world,
+                            const CollisionBox *const solid) {
+  assert(world != NULL);
+  assert(solid != NULL);
+  assert(solid->size.width > 0.0f && solid->size.height > 0.0f);
+
+  size_t index;
+  if (IndexArrayLength(&world->free_solids) > 0) {
+    index = IndexArrayPop(&world->free_solids);
+    *SolidArrayAt(&world->solids, index) = *solid;
+  } else {
+    index = SolidArrayLength(&world->solids);
+    assert(index < UINT32_MAX);
+    SolidArrayAppend(&world->solids, *solid);
+    IndexArrayAppend(&world->stamps, world->stamp);
+  }
+
+  const CellRange range = GetCellRange(
+      world, solid->position.x, solid->position.y,
+      solid->position.x + solid->size.width,
+      solid->position.y + solid->size.height);
+  for (int row = range.row_begin; row <= range.row_end; row++) {
+    for (int column = range.column_begin; column <= range.column_end;
+         column++) {
+      IndexArrayAppend(&world->cells[row * world->columns + column],
+                       (uint32_t)index);
+    }
+  }
+}
+
+void CollisionWorldAddTiles(CollisionWorld *const world,
+                            const uint8_t *const tiles, const size_t columns,
+                            const size_t rows, const Vector *const origin,
+                            const Vector *const tile_size) {
+  assert(world != NULL);
+  assert(tiles != NULL || columns * rows == 0);
+  assert(origin != NULL);
+  assert(tile_size != NULL);
+
+  for (size_t row = 0; row < rows; row++) {
+    const uint8_t *const line = tiles + (row * columns);
+    size_t column = 0;
+    while (column < columns) {
+      if (line[column] == 0) {
+        column += 1;
+        continue;
+      }
+
+      const size_t begin = column;
+      while (column < columns && line[column] != 0) {
+        column += 1;
+      }
+
+      const CollisionBox solid = {
+          .position = {.x = origin->x + ((float)begin * tile_size->width),
+                       .y = origin->y + ((float)row * tile_size->height)},
+          .size = {.width = (float)(column - begin) * tile_size->width,
+                   .height = tile_size->height},
+      };
+      CollisionWorldAddSolid(world, &solid);
+    }
+  }
+}
+
+/* Start a new visit of the solids, so each is handled once */
+static uint32_t *NextStamp(CollisionWorld *const world) {
+  uint32_t *const stamps = IndexArrayData(&world->stamps);
+  world->stamp += 1;
+  if (world->stamp == 0) {
+    /* Wrapped around, so old stamps could match again */
+    memset(stamps, 0, IndexArrayLength(&world->stamps) * sizeof(uint32_t));
+    world->stamp = 1;
+  }
+  return stamps;
+}
+
+size_t CollisionWorldRemoveSolids(CollisionWorld *const world,
+                                  const CollisionBox *const area) {
+  assert(world != NULL);
+  assert(area != NULL);
+
+  const float left = area->position.x;
+  const float right = area->position.x + area->size.width;
+  const float top = area->position.y;
+  const float bottom = area->position.y + area->size.height;
+
+  /* A solid inside the area only overlaps cells that the area overlaps */
+  uint32_t *const stamps = NextStamp(world);
+  size_t n_removed = 0;
+  const CellRange range = GetCellRange(world, left, top, right, bottom);
+  for (int row = range.row_begin; row <= range.row_end; row++) {
+    for (int column = range.column_begin; column <= range.column_end;
+         column++) {
+      IndexArray *const cell = &world->cells[row * world->columns + column];
+      size_t i = 0;
+      while (i < IndexArrayLength(cell)) {
+        const uint32_t index = *IndexArrayAt(cell, i);
+        const CollisionBox *const solid = SolidArrayAt(&world->solids, index);
+        if (solid->position.x < left || solid->position.y < top ||
+            solid->position.x + solid->size.width > right ||
+            solid->position.y + solid->size.height > bottom) {
+          i += 1;
+          continue;
+        }
+
+        IndexArraySwapRemove(cell, i);
+        if (stamps[index] != world->stamp) {
+          stamps[index] = world->stamp;
+          IndexArrayAppend(&world->free_solids, index);
+          n_removed += 1;
+        }
+      }
+    }
+  }
+  return n_removed;
+}
+
+size_t CollisionWorldSolidCount(const CollisionWorld *const world) {
+  assert(world != NULL);
+  return SolidArrayLength(&world->solids) -
+         IndexArrayLength(&world->free_solids);
+}
+
+/* Collect the solids in the cells overlapping a rectangle, each once */
+static void Query(CollisionWorld *const world, const float x0, const float y0,
+                  const float x1, const float y1) {
+  IndexArrayClear(&world->candidates);
+
+  uint32_t *const stamps = NextStamp(world);
+
+  const CellRange range = GetCellRange(world, x0, y0, x1, y1);
+  for (int row = range.row_begin; row <= range.row_end; row++) {
+    for (int column = range.column_begin; column <= range.column_end;
+         column++) {
+      IndexArray *const cell = &world->cells[row * world->columns + column];
+      const uint32_t *const indices = IndexArrayData(cell);
+      const size_t length = IndexArrayLength(cell);
+      for (size_t i = 0; i < length; i++) {
+        if (stamps[indices[i]] != world->stamp) {
+          stamps[indices[i]] = world->stamp;
+          IndexArrayAppend(&world->candidates, indices[i]);
+        }
+      }
+    }
+  }
+}
+
+/* Times at which a moving interval [min, max) enters and leaves a static
+ * interval [begin, end). Returns false if they never overlap. */
+static bool SweepAxis(const float min, const float max, const float delta,
+                      const float begin, const float end, float *const entry,
+                      float *const exit) {
+  if (delta > 0.0f) {
+    *entry = (begin - max) / delta;
+    *exit = (end - min) / delta;
+  } else if (delta < 0.0f) {
+    *entry = (end - min) / delta;
+    *exit = (begin - max) / delta;
+  } else if (min < end && max > begin) {
+    *entry = -FLT_MAX;
+    *exit = FLT_MAX;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+typedef struct {
+  float time;
+  bool vertical; /* Whether the box hit a top or bottom side */
+} Hit;
+
+/* Swept AABB test of a moving box against a solid */
+static bool Sweep(const CollisionBox *const box, const Vector *const motion,
+                  const CollisionBox *const solid, Hit *const hit) {
+  float x_entry, x_exit, y_entry, y_exit;
+  if (!SweepAxis(box->position.x, box->position.x + box->size.width,
+                 motion->x, solid->position.x,
+                 solid->position.x + solid->size.width, &x_entry, &x_exit) ||
+      !SweepAxis(box->position.y, box->position.y + box->size.height,
+                 motion->y, solid->position.y,
+                 solid->position.y + solid->size.height, &y_entry, &y_exit)) {
+    return false;
+  }
+
+  const bool vertical = y_entry >= x_entry;
+  const float entry = vertical ? y_entry : x_entry;
+  const float exit = MIN(x_exit, y_exit);
+  if (entry >= exit || entry > 1.0f) {
+    /* Misses the solid, or grazes its corner */
+    return false;
+  }
+
+  if (entry < 0.0f) {
+    /* Started inside the solid, unless only by a rounding error */
+    const float depth = -entry * SDL_fabsf(vertical ? motion->y : motion->x);
+    if (depth > CONTACT_EPSILON) {
+      return false;
+    }
+  }
+
+  hit->time = MAX(entry, 0.0f);
+  hit->vertical = vertical;
+  return true;
+}
+
+/* Sides of a box within CONTACT_EPSILON of a solid */
+static CollisionContacts Touching(CollisionWorld *const world,
+                                  const CollisionBox *const box) {
+  const float left = box->position.x;
+  const float right = box->position.x + box->size.width;
+  const float top = box->position.y;
+  const float bottom = box->position.y + box->size.height;
+
+  Query(world, left - CONTACT_EPSILON, top - CONTACT_EPSILON,
+        right + CONTACT_EPSILON, bottom + CONTACT_EPSILON);
+
+  CollisionContacts contacts = 0;
+  const uint32_t *const indices = IndexArrayData(&world->candidates);
+  const size_t length = IndexArrayLength(&world->candidates);
+  for (size_t i = 0; i < length; i++) {
+    const CollisionBox *const solid = SolidArrayAt(&world->solids, indices[i]);
+    const float solid_left = solid->position.x;
+    const float solid_right = solid->position.x + solid->size.width;
+    const float solid_top = solid->position.y;
+    const float solid_bottom = solid->position.y + solid->size.height;
+
+    if (left < solid_right && right > solid_left) {
+      if (SDL_fabsf(bottom - solid_top) <= CONTACT_EPSILON) {
+        contacts |= COLLISION_GROUND;
+      }
+      if (SDL_fabsf(top - solid_bottom) <= CONTACT_EPSILON) {
+        contacts |= COLLISION_CEILING;
+      }
+    }
+    if (top < solid_bottom && bottom > solid_top) {
+      if (SDL_fabsf(right - solid_left) <= CONTACT_EPSILON) {
+        contacts |= COLLISION_WALL_RIGHT;
+      }
+      if (SDL_fabsf(left - solid_right) <= CONTACT_EPSILON) {
+        contacts |= COLLISION_WALL_LEFT;
+      }
+    }
+  }
+  return contacts;
+}
+
+CollisionContacts CollisionMove(CollisionWorld *const world,
+                                CollisionBox *const box,
+                                const Vector *const motion) {
+  assert(world != NULL);
+  assert(box != NULL);
+  assert(motion != NULL);
+
+  Vector remaining = *motion;
+  for (int slide = 0; slide < MAX_SLIDES && !VectorIsZero(&remaining);
+       slide++) {
+    /* Only solids overlapping the bounds of the swept box can be hit */
+    const float x = box->position.x;
+    const float y = box->position.y;
+    Query(world, MIN(x, x + remaining.x), MIN(y, y + remaining.y),
+          MAX(x, x + remaining.x) + box->size.width,
+          MAX(y, y + remaining.y) + box->size.height);
+
+    Hit first = {.time = FLT_MAX};
+    const CollisionBox *blocker = NULL;
+    const uint32_t *const indices = IndexArrayData(&world->candidates);
+    const size_t length = IndexArrayLength(&world->candidates);
+    for (size_t i = 0; i < length; i++) {
+      const CollisionBox *const solid =
+          SolidArrayAt(&world->solids, indices[i]);
+      Hit hit;
+      if (Sweep(box, &remaining, solid, &hit) && hit.time < first.time) {
+        first = hit;
+        blocker = solid;
+      }
+    }
+
+    if (blocker == NULL) {
+      VectorAdd(&box->position, &remaining);
+      break;
+    }
+
+    /* Move up to the solid, then snap flush against it so that rounding
+     * errors do not leave a gap or overlap */
+    const bool forward =
+        first.vertical ? (remaining.y > 0.0f) : (remaining.x > 0.0f);
+    Vector step = remaining;
+    VectorMul(&step, first.time);
+    VectorAdd(&box->position, &step);
+    VectorMul(&remaining, 1.0f - first.time);
+
+    if (first.vertical) {
+      box->position.y = forward ? blocker->position.y - box->size.height
+                            : blocker->position.y + blocker->size.height;
+      remaining.y = 0.0f; /* Slide horizontally */
+    } else {
+      box->position.x = forward ? blocker->position.x - box->size.width
+                            : blocker->position.x + blocker->size.width;
+      remaining.x = 0.0f; /* Slide vertically */
+    }
+  }
+
+  return Touching(world, box);
+}
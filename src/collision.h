@@ -0,0 +1,116 @@
+#ifndef __ETERNO_COLLISION_H__
+#define __ETERNO_COLLISION_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vector.h"
+
+/**
+ * @brief Static level geometry that moving boxes collide with.
+ * @note Solids are axis-aligned rectangles bucketed into a uniform grid, so
+ *       that moving a box only tests the solids near its path. Moves are
+ *       swept, so fast boxes cannot tunnel through thin solids.
+ */
+typedef struct CollisionWorld CollisionWorld;
+
+/* Axis-aligned box with its top-left corner at position */
+typedef struct {
+  Vector position;
+  Vector size;
+} CollisionBox;
+
+/* Sides of a box touching a solid, see CollisionMove() */
+enum {
+  COLLISION_GROUND = 1 << 0,
+  COLLISION_CEILING = 1 << 1,
+  COLLISION_WALL_LEFT = 1 << 2,
+  COLLISION_WALL_RIGHT = 1 << 3,
+};
+typedef unsigned CollisionContacts;
+
+/**
+ * @brief Create an empty collision world.
+ * @param width Width of the area covered by the grid.
+ * @param height Height of the area covered by the grid.
+ * @param cell_size Size of grid cells or 0 for the default size.
+ * @return The collision world.
+ * @note Solids may extend outside the area, but those outside it are tested
+ *       against every box near the edge. Caller takes ownership of returned
+ *       value.
+ */
+CollisionWorld *CollisionWorldCreate(float width, float height,
+                                     float cell_size);
+
+/**
+ * @brief Destroy a collision world.
+ * @param world The collision world.
+ * @note If world is NULL, no operation is performed.
+ */
+void CollisionWorldDestroy(CollisionWorld *world);
+
+/**
+ * @brief Make room for solids, so that adding them allocates nothing.
+ * @param world The collision world.
+ * @param n_solids Number of solids present at the same time.
+ * @param n_per_cell Number of solids overlapping any one grid cell.
+ * @note Useful when solids are added and removed within a frame loop, e.g.
+ *       as chunks of a level stream in and out.
+ */
+void CollisionWorldReserve(CollisionWorld *world, size_t n_solids,
+                           size_t n_per_cell);
+
+/**
+ * @brief Add a solid rectangle.
+ * @param world The collision world.
+ * @param solid The rectangle.
+ */
+void CollisionWorldAddSolid(CollisionWorld *world, const CollisionBox *solid);
+
+/**
+ * @brief Add solid tiles from a tile map.
+ * @param world The collision world.
+ * @param tiles Row-major tile map, where nonzero tiles are solid.
+ * @param columns Number of columns.
+ * @param rows Number of rows.
+ * @param origin Position of the top-left corner of the tile map.
+ * @param tile_size Size of each tile.
+ * @note Horizontal runs of solid tiles are merged into single rectangles.
+ */
+void CollisionWorldAddTiles(CollisionWorld *world, const uint8_t *tiles,
+                            size_t columns, size_t rows, const Vector *origin,
+                            const Vector *tile_size);
+
+/**
+ * @brief Remove the solids lying entirely inside an area.
+ * @param world The collision world.
+ * @param area The area, e.g. a chunk of a level that is unloaded.
+ * @return Number of solids removed.
+ * @note Solids partly outside the area are kept. Their slots are reused by
+ *       later solids.
+ */
+size_t CollisionWorldRemoveSolids(CollisionWorld *world,
+                                  const CollisionBox *area);
+
+/**
+ * @brief Get the number of solid rectangles.
+ * @param world The collision world.
+ * @return The number of solids.
+ */
+size_t CollisionWorldSolidCount(const CollisionWorld *world);
+
+/**
+ * @brief Move a box, stopping at the first solid on its path and sliding
+ *        along it.
+ * @param world The collision world.
+ * @param box The box to move. Updated to its new position.
+ * @param motion Displacement to apply.
+ * @return The sides of the box touching a solid after the move, whether it
+ *         was blocked or was already resting against it.
+ * @note Solids the box already overlaps do not block it, so that it can move
+ *       out of them. The caller should stop any velocity into a touched side.
+ */
+CollisionContacts CollisionMove(CollisionWorld *world, CollisionBox *box,
+                                const Vector *motion);
+
+#endif /* __ETERNO_COLLISION_H__ */
@@ -0,0 +1,580 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_COMPRESS
+
+#include <assert.h>
+#include <string.h>
+
+#include "compress.h"
+#include "utils.h"
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5 /* The last bytes of a block are always literals */
+#define MF_LIMIT 12     /* The last match starts at least this far from end */
+#define MAX_DISTANCE 65535
+#define HASH_LOG 12
+#define SKIP_TRIGGER 6 /* Search faster through incompressible data */
+#define RUN_MASK 15
+#define WILD_COPY 16 /* Copy in chunks of this size while there is room */
+
+#define FRAME_MAGIC 0x184D2204u
+#define FRAME_VERSION 0x40
+#define FRAME_BLOCK_INDEPENDENT 0x20
+#define FRAME_BLOCK_CHECKSUM 0x10
+#define FRAME_CONTENT_SIZE 0x08
+#define FRAME_CONTENT_CHECKSUM 0x04
+#define FRAME_DICT_ID 0x01
+#define FRAME_UNCOMPRESSED 0x80000000u
+#define FRAME_BLOCK_SIZE_ID 4 /* 64 KiB blocks fit in the L2 cache */
+
+#define XXH_PRIME1 0x9E3779B1u
+#define XXH_PRIME2 0x85EBCA77u
+#define XXH_PRIME3 0xC2B2AE3Du
+#define XXH_PRIME4 0x27D4EB2Fu
+#define XXH_PRIME5 0x165667B1u
+
+static inline uint32_t Read32(const void *const ptr) {
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+static inline uint64_t Read64(const void *const ptr) {
+  uint64_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+/* The formats are little-endian regardless of the host */
+static inline uint32_t ReadLE32(const void *const ptr) {
+  const unsigned char *const p = ptr;
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static inline void WriteLE32(void *const ptr, const uint32_t value) {
+  unsigned char *const p = ptr;
+  p[0] = (unsigned char)value;
+  p[1] = (unsigned char)(value >> 8);
+  p[2] = (unsigned char)(value >> 16);
+  p[3] = (unsigned char)(value >> 24);
+}
+
+static inline uint64_t ReadLE64(const void *const ptr) {
+  const unsigned char *const p = ptr;
+  return (uint64_t)ReadLE32(p) | ((uint64_t)ReadLE32(p + 4) << 32);
+}
+
+static inline void WriteLE64(void *const ptr, const uint64_t value) {
+  unsigned char *const p = ptr;
+  WriteLE32(p, (uint32_t)value);
+  WriteLE32(p + 4, (uint32_t)(value >> 32));
+}
+
+static inline uint32_t Rotl32(const uint32_t value, const int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+static inline uint32_t XxhRound(uint32_t acc, const uint32_t input) {
+  acc += input * XXH_PRIME2;
+  acc = Rotl32(acc, 13);
+  return acc * XXH_PRIME1;
+}
+
+uint32_t CompressChecksum(const void *const data, const size_t size,
+                          const uint32_t seed) {
+  assert(data != NULL || size == 0);
+
+  const unsigned char *p = data;
+  const unsigned char *const end = p + size;
+  uint32_t hash;
+
+  if (size >= 16) {
+    uint32_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+    uint32_t v2 = seed + XXH_PRIME2;
+    uint32_t v3 = seed;
+    uint32_t v4 = seed - XXH_PRIME1;
+    do {
+      v1 = XxhRound(v1, ReadLE32(p));
+      v2 = XxhRound(v2, ReadLE32(p + 4));
+      v3 = XxhRound(v3, ReadLE32(p + 8));
+      v4 = XxhRound(v4, ReadLE32(p + 12));
+      p += 16;
+    } while (end - p >= 16);
+    hash = Rotl32(v1, 1) + Rotl32(v2, 7) + Rotl32(v3, 12) + Rotl32(v4, 18);
+  } else {
+    hash = seed + XXH_PRIME5;
+  }
+
+  hash += (uint32_t)size;
+  for (; end - p >= 4; p += 4) {
+    hash += ReadLE32(p) * XXH_PRIME3;
+    hash = Rotl32(hash, 17) * XXH_PRIME4;
+  }
+  for (; p < end; p++) {
+    hash += (*p) * XXH_PRIME5;
+    hash = Rotl32(hash, 11) * XXH_PRIME1;
+  }
+
+  hash ^= hash >> 15;
+  hash *= XXH_PRIME2;
+  hash ^= hash >> 13;
+  hash *= XXH_PRIME3;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+static inline uint32_t Hash(const char *const ptr) {
+  return (Read32(ptr) * 2654435761u) >> (32 - HASH_LOG);
+}
+
+/**
+ * @brief Count the number of equal bytes, comparing a word at a time.
+ */
+static size_t CountMatch(const char *a, const char *b, const char *const end) {
+  const char *const start = a;
+  while (end - a >= 8) {
+    const uint64_t diff = Read64(a) ^ Read64(b);
+    if (diff != 0) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      return (size_t)(a - start) + ((size_t)__builtin_ctzll(diff) >> 3);
+#else
+      return (size_t)(a - start) + ((size_t)__builtin_clzll(diff) >> 3);
+#endif
+    }
+    a += 8;
+    b += 8;
+  }
+  while (a < end && *a == *b) {
+    a += 1;
+    b += 1;
+  }
+  return (size_t)(a - start);
+}
+
+/**
+ * @brief Write the extra length bytes of a literal or match length.
+ */
+static char *WriteLength(char *op, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *op++ = (char)255;
+  }
+  *op++ = (char)length;
+  return op;
+}
+
+/**
+ * @brief Write one sequence of literals followed by a match.
+ * @return End of the sequence or NULL if it does not fit.
+ */
+static char *WriteSequence(char *op, const char *const op_end,
+                           const char *const literals,
+                           const size_t literal_length, const size_t offset,
+                           const size_t match_length) {
+  /* Token, literals with their length, then offset and match length */
+  size_t needed = 1 + (literal_length / 255) + 1 + literal_length;
+  if (match_length > 0) {
+    needed += 2 + ((match_length - MIN_MATCH) / 255) + 1;
+  }
+  if ((size_t)(op_end - op) < needed) {
+    return NULL;
+  }
+
+  char *const token = op++;
+  unsigned char bits = 0;
+
+  if (literal_length >= RUN_MASK) {
+    bits = RUN_MASK << 4;
+    op = WriteLength(op, literal_length - RUN_MASK);
+  } else {
+    bits = (unsigned char)(literal_length << 4);
+  }
+  memcpy(op, literals, literal_length);
+  op += literal_length;
+
+  if (match_length == 0) {
+    *token = (char)bits; /* The last sequence has no match */
+    return op;
+  }
+
+  op[0] = (char)(offset & 0xFF);
+  op[1] = (char)(offset >> 8);
+  op += 2;
+
+  const size_t extra = match_length - MIN_MATCH;
+  if (extra >= RUN_MASK) {
+    bits |= RUN_MASK;
+    op = WriteLength(op, extra - RUN_MASK);
+  } else {
+    bits |= (unsigned char)extra;
+  }
+  *token = (char)bits;
+  return op;
+}
+
+size_t CompressBlockBound(const size_t size) {
+  return size + (size / 255) + 16;
+}
+
+size_t CompressBlock(const char *const src, const size_t size, char *const dst,
+                     const size_t capacity) {
+  assert(src != NULL || size == 0);
+  assert(dst != NULL);
+
+  /* Positions relative to src of the last occurrence of each hash */
+  uint32_t table[1 << HASH_LOG];
+  memset(table, 0, sizeof(table));
+
+  const char *const src_end = src + size;
+  const char *const dst_end = dst + capacity;
+  const char *anchor = src;
+  char *op = dst;
+
+  if (size >= MF_LIMIT + 1) {
+    const char *const match_limit = src_end - MF_LIMIT;
+    const char *const match_end = src_end - LAST_LITERALS;
+    const char *ip = src + 1;
+    table[Hash(src)] = 0;
+
+    while (true) {
+      /* Find a match, taking bigger steps the longer we look */
+      const char *ref;
+      unsigned attempts = 1 << SKIP_TRIGGER;
+      while (true) {
+        if (ip > match_limit) {
+          goto last_literals;
+        }
+
+        const uint32_t hash = Hash(ip);
+        ref = src + table[hash];
+        table[hash] = (uint32_t)(ip - src);
+        if (ip - ref <= MAX_DISTANCE && ref < ip && Read32(ref) == Read32(ip)) {
+          break;
+        }
+        ip += attempts++ >> SKIP_TRIGGER;
+      }
+
+      /* Extend the match backwards into the pending literals */
+      while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+        ip -= 1;
+        ref -= 1;
+      }
+
+      const size_t match_length =
+          MIN_MATCH + CountMatch(ip + MIN_MATCH, ref + MIN_MATCH, match_end);
+      op = WriteSequence(op, dst_end, anchor, (size_t)(ip - anchor),
+                         (size_t)(ip - ref), match_length);
+      if (op == NULL) {
+        return 0;
+      }
+
+      ip += match_length;
+      anchor = ip;
+      if (ip > match_limit) {
+        break;
+      }
+      table[Hash(ip - 2)] = (uint32_t)(ip - 2 - src);
+    }
+  }
+
+last_literals:
+  op = WriteSequence(op, dst_end, anchor, (size_t)(src_end - anchor), 0, 0);
+  return (op != NULL) ? (size_t)(op - dst) : 0;
+}
+
+/**
+ * @brief Read the extra length bytes of a literal or match length.
+ * @return False if the input ends first or the length overflows.
+ */
+static bool ReadLength(const unsigned char **const ip,
+                       const unsigned char *const ip_end,
+                       size_t *const length) {
+  unsigned char byte;
+  do {
+    if (*ip >= ip_end) {
+      return false;
+    }
+    byte = *(*ip)++;
+    if (*length > SIZE_MAX - byte) {
+      return false;
+    }
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+/**
+ * @brief Copy a match, which may overlap its own output.
+ * @note A match at a small offset repeats a pattern, e.g. a run of equal
+ *       pixels. Copying from the start of the match with chunks as long as
+ *       the distance to the output doubles the chunk size every step.
+ */
+static void CopyMatch(char *op, const char *const ref, size_t length) {
+  while (length > 0) {
+    const size_t n = MIN((size_t)(op - ref), length);
+    memcpy(op, ref, n);
+    op += n;
+    length -= n;
+  }
+}
+
+/**
+ * @brief Decode a block.
+ * @param base Lowest address matches may refer to. Earlier blocks of the
+ *             same output may be referred to by frames with linked blocks.
+ * @return End of the output or NULL on corrupt input.
+ */
+static char *DecodeBlock(const char *const src, const size_t size,
+                         const char *const base, char *op,
+                         const char *const op_end) {
+  const unsigned char *ip = (const unsigned char *)src;
+  const unsigned char *const ip_end = ip + size;
+
+  while (true) {
+    if (ip >= ip_end) {
+      return NULL;
+    }
+    const unsigned token = *ip++;
+
+    size_t literal_length = token >> 4;
+    if (literal_length == RUN_MASK &&
+        !ReadLength(&ip, ip_end, &literal_length)) {
+      return NULL;
+    }
+    if (literal_length > (size_t)(ip_end - ip) ||
+        literal_length > (size_t)(op_end - op)) {
+      return NULL;
+    }
+
+    if (literal_length <= WILD_COPY && ip_end - ip >= WILD_COPY &&
+        op_end - op >= WILD_COPY) {
+      memcpy(op, ip, WILD_COPY); /* Short literals are the common case */
+    } else {
+      memcpy(op, ip, literal_length);
+    }
+    ip += literal_length;
+    op += literal_length;
+
+    if (ip == ip_end) {
+      return op; /* The last sequence has no match */
+    }
+
+    if (ip_end - ip < 2) {
+      return NULL;
+    }
+    const size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - base)) {
+      return NULL;
+    }
+
+    size_t match_length = token & RUN_MASK;
+    if (match_length == RUN_MASK && !ReadLength(&ip, ip_end, &match_length)) {
+      return NULL;
+    }
+    match_length += MIN_MATCH;
+    if (match_length > (size_t)(op_end - op)) {
+      return NULL;
+    }
+
+    const char *const ref = op - offset;
+    if (offset >= WILD_COPY &&
+        (size_t)(op_end - op) >= match_length + WILD_COPY) {
+      /* Chunks never overlap, and overshooting is overwritten later */
+      for (size_t i = 0; i < match_length; i += WILD_COPY) {
+        memcpy(op + i, ref + i, WILD_COPY);
+      }
+    } else {
+      CopyMatch(op, ref, match_length);
+    }
+    op += match_length;
+  }
+}
+
+bool DecompressBlock(const char *const src, const size_t size, char *const dst,
+                     const size_t capacity, size_t *const length) {
+  assert(src != NULL || size == 0);
+  assert(dst != NULL);
+  assert(length != NULL);
+
+  const char *const end = DecodeBlock(src, size, dst, dst, dst + capacity);
+  if (end == NULL) {
+    return false;
+  }
+  *length = (size_t)(end - dst);
+  return true;
+}
+
+bool CompressIsFrame(const char *const data, const size_t size) {
+  assert(data != NULL || size == 0);
+  return size >= 4 && ReadLE32(data) == FRAME_MAGIC;
+}
+
+static size_t BlockSizeFromId(const unsigned id) {
+  return (size_t)1 << (8 + (2 * id));
+}
+
+void CompressFrame(Buffer *const out, const char *const src,
+                   const size_t size) {
+  assert(out != NULL);
+  assert(src != NULL || size == 0);
+
+  const size_t block_size = BlockSizeFromId(FRAME_BLOCK_SIZE_ID);
+
+  /* Magic, descriptor and header checksum */
+  unsigned char header[15];
+  WriteLE32(header, FRAME_MAGIC);
+  header[4] = FRAME_VERSION | FRAME_BLOCK_INDEPENDENT | FRAME_BLOCK_CHECKSUM |
+              FRAME_CONTENT_SIZE | FRAME_CONTENT_CHECKSUM;
+  header[5] = FRAME_BLOCK_SIZE_ID << 4;
+  WriteLE64(header + 6, size);
+  header[14] = (unsigned char)(CompressChecksum(header + 4, 10, 0) >> 8);
+  memcpy(BufferReserve(out, sizeof(header)), header, sizeof(header));
+  BufferCommit(out, sizeof(header));
+
+  for (size_t offset = 0; offset < size; offset += block_size) {
+    const size_t n = MIN(block_size, size - offset);
+
+    /* Block size, then the block itself, then its checksum */
+    char *const block = BufferReserve(out, 4 + n + 4);
+    size_t compressed = CompressBlock(src + offset, n, block + 4, n - 1);
+    if (compressed > 0) {
+      WriteLE32(block, (uint32_t)compressed);
+    } else {
+      /* Store incompressible blocks as is */
+      memcpy(block + 4, src + offset, n);
+      compressed = n;
+      WriteLE32(block, (uint32_t)n | FRAME_UNCOMPRESSED);
+    }
+    WriteLE32(block + 4 + compressed,
+              CompressChecksum(block + 4, compressed, 0));
+    BufferCommit(out, 4 + compressed + 4);
+  }
+
+  /* End mark and content checksum */
+  char *const trailer = BufferReserve(out, 8);
+  WriteLE32(trailer, 0);
+  WriteLE32(trailer + 4, CompressChecksum(src, size, 0));
+  BufferCommit(out, 8);
+}
+
+/**
+ * @brief Decode the blocks and trailer of a frame.
+ * @return False on corrupt input.
+ */
+static bool DecodeFrame(Buffer *const out, const char *const src,
+                        const size_t size, const unsigned flags,
+                        const size_t block_size, const size_t start) {
+  const char *ip = src;
+  const char *const ip_end = src + size;
+
+  while (true) {
+    if (ip_end - ip < 4) {
+      return false;
+    }
+    const uint32_t header = ReadLE32(ip);
+    ip += 4;
+    if (header == 0) {
+      break; /* End mark */
+    }
+
+    const size_t n = header & ~FRAME_UNCOMPRESSED;
+    const size_t checksum_size = (flags & FRAME_BLOCK_CHECKSUM) ? 4 : 0;
+    if (n > block_size || (size_t)(ip_end - ip) < n + checksum_size) {
+      return false;
+    }
+    if (checksum_size > 0 &&
+        CompressChecksum(ip, n, 0) != ReadLE32(ip + n)) {
+      LOG_DEBUG("Block checksum mismatch");
+      return false;
+    }
+
+    char *const dst = BufferReserve(out, block_size);
+    size_t length = n;
+    if (header & FRAME_UNCOMPRESSED) {
+      memcpy(dst, ip, n);
+    } else {
+      /* Linked blocks may refer back to earlier blocks of the frame */
+      const char *const base = (flags & FRAME_BLOCK_INDEPENDENT)
+                                   ? dst
+                                   : BufferData(out) + start;
+      const char *const end = DecodeBlock(ip, n, base, dst, dst + block_size);
+      if (end == NULL) {
+        return false;
+      }
+      length = (size_t)(end - dst);
+    }
+    BufferCommit(out, length);
+    ip += n + checksum_size;
+  }
+
+  if (flags & FRAME_CONTENT_CHECKSUM) {
+    if (ip_end - ip < 4) {
+      return false;
+    }
+    const char *const content = BufferData(out) + start;
+    if (CompressChecksum(content, BufferLength(out) - start, 0) !=
+        ReadLE32(ip)) {
+      LOG_DEBUG("Content checksum mismatch");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DecompressFrame(Buffer *const out, const char *const src,
+                     const size_t size) {
+  assert(out != NULL);
+  assert(src != NULL || size == 0);
+
+  if (!CompressIsFrame(src, size) || size < 7) {
+    LOG_DEBUG("Bad frame: Missing magic number or header");
+    return false;
+  }
+
+  const unsigned char *const descriptor = (const unsigned char *)src + 4;
+  const unsigned flags = descriptor[0];
+  const unsigned block_size_id = (descriptor[1] >> 4) & 0x7;
+  if ((flags & 0xC0) != FRAME_VERSION || (flags & FRAME_DICT_ID) ||
+      block_size_id < 4) {
+    LOG_DEBUG("Bad frame: Unsupported version, dictionary or block size");
+    return false;
+  }
+
+  const size_t descriptor_size = (flags & FRAME_CONTENT_SIZE) ? 10 : 2;
+  if (size < 4 + descriptor_size + 1) {
+    LOG_DEBUG("Bad frame: Truncated header");
+    return false;
+  }
+  const unsigned char checksum =
+      (unsigned char)(CompressChecksum(descriptor, descriptor_size, 0) >> 8);
+  if (checksum != descriptor[descriptor_size]) {
+    LOG_DEBUG("Bad frame: Header checksum mismatch");
+    return false;
+  }
+
+  const size_t start = BufferLength(out);
+  if (flags & FRAME_CONTENT_SIZE) {
+    /* Presize for the whole content, unless the header is lying */
+    const uint64_t content_size = ReadLE64(descriptor + 2);
+    if (content_size <= (uint64_t)size * 255) {
+      BufferReserve(out, (size_t)content_size);
+    }
+  }
+
+  const size_t header_size = 4 + descriptor_size + 1;
+  if (!DecodeFrame(out, src + header_size, size - header_size, flags,
+                   BlockSizeFromId(block_size_id), start)) {
+    LOG_DEBUG("Bad frame: Corrupt block or checksum mismatch");
+    BufferTruncate(out, start);
+    return false;
+  }
+
+  if ((flags & FRAME_CONTENT_SIZE) &&
+      ReadLE64(descriptor + 2) != BufferLength(out) - start) {
+    LOG_DEBUG("Bad frame: Content size mismatch");
+    BufferTruncate(out, start);
+    return false;
+  }
+  return true;
+}
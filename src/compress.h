@@ -0,0 +1,83 @@
+#ifndef __ETERNO_COMPRESS_H__
+#define __ETERNO_COMPRESS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "buffer.h"
+
+/**
+ * @brief Fast LZ77 block compression in the LZ4 block and frame formats.
+ * @note Favours decompression speed over ratio. Frames are compatible with
+ *       the reference lz4(1) tool, so packed assets can be inspected and
+ *       produced with it.
+ */
+
+/**
+ * @brief Get worst case size of a compressed block.
+ * @param size Size of uncompressed data.
+ * @return Capacity that is always enough for CompressBlock().
+ */
+size_t CompressBlockBound(size_t size);
+
+/**
+ * @brief Compress a single block.
+ * @param src Uncompressed data.
+ * @param size Size of uncompressed data.
+ * @param dst Destination for compressed data.
+ * @param capacity Capacity of destination.
+ * @return Size of compressed data or 0 if it does not fit.
+ */
+size_t CompressBlock(const char *src, size_t size, char *dst,
+                     size_t capacity);
+
+/**
+ * @brief Decompress a single block.
+ * @param src Compressed data.
+ * @param size Size of compressed data.
+ * @param dst Destination for uncompressed data.
+ * @param capacity Capacity of destination.
+ * @param length Set to size of uncompressed data on success.
+ * @return False if the block is corrupt or does not fit.
+ * @note Never reads or writes out of bounds, even on corrupt input.
+ */
+bool DecompressBlock(const char *src, size_t size, char *dst, size_t capacity,
+                     size_t *length);
+
+/**
+ * @brief Compress data into a frame with block and content checksums.
+ * @param out Buffer to append frame to.
+ * @param src Uncompressed data.
+ * @param size Size of uncompressed data.
+ */
+void CompressFrame(Buffer *out, const char *src, size_t size);
+
+/**
+ * @brief Decompress a frame and verify its checksums.
+ * @param out Buffer to append uncompressed data to.
+ * @param src Frame.
+ * @param size Size of frame.
+ * @return False if the frame is corrupt or unsupported, in which case the
+ *         buffer is left as it was.
+ */
+bool DecompressFrame(Buffer *out, const char *src, size_t size);
+
+/**
+ * @brief Check whether data starts like a compressed frame.
+ * @param data The data.
+ * @param size Size of data.
+ * @return True if the data starts with the frame magic number.
+ */
+bool CompressIsFrame(const char *data, size_t size);
+
+/**
+ * @brief Compute the xxHash32 checksum used by frames.
+ * @param data The data.
+ * @param size Size of data.
+ * @param seed Seed, 0 for frames.
+ * @return The checksum.
+ */
+uint32_t CompressChecksum(const void *data, size_t size, uint32_t seed);
+
+#endif // __ETERNO_COMPRESS_H__
@@ -0,0 +1,356 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "concurrent_dict.h"
+#include "logger.h"
+#include "utils.h"
+
+#define CACHE_LINE_SIZE 64
+
+/* Marks a removed entry, so that probing continues past it */
+static const char TOMBSTONE[] = "";
+
+typedef struct Slot {
+  _Atomic(Atom) key;
+  _Atomic(void *) value;
+  void (*destroy)(void *);
+} Slot;
+
+typedef struct Table {
+  size_t capacity; /* Always a power of two */
+  struct Table *retired;
+  Slot slots[];
+} Table;
+
+typedef struct Shard {
+  alignas(CACHE_LINE_SIZE) atomic_uint sequence;
+  _Atomic(Table *) table;
+  size_t in_use;
+  atomic_size_t length;
+  SDL_Mutex *lock;
+} Shard;
+
+struct ConcurrentDict {
+  Shard shards[DEFAULT_CONCURRENT_DICT_SHARDS];
+};
+
+static inline size_t MixHash(const Atom key) {
+  uint64_t hash = (uint64_t)AtomHash(key);
+  hash ^= hash >> 33;
+  hash *= UINT64_C(0xff51afd7ed558ccd);
+  hash ^= hash >> 33;
+  return (size_t)hash;
+}
+
+static inline Shard *GetShard(const ConcurrentDict *const dict,
+                              const size_t hash) {
+  /* Use the high bits for the shard and the low bits for the slot */
+  const size_t index = (hash >> (sizeof(size_t) * CHAR_BIT - 8)) %
+                       DEFAULT_CONCURRENT_DICT_SHARDS;
+  return (Shard *)&dict->shards[index];
+}
+
+static Table *TableCreate(const size_t capacity) {
+  assert((capacity & (capacity - 1)) == 0);
+
+  Table *const table = xcalloc(1, sizeof(Table) + (capacity * sizeof(Slot)));
+  table->capacity = capacity;
+  return table;
+}
+
+/**
+ * @brief Mark the beginning of a modification of a shard.
+ * @note Readers that overlap the modification see an odd or changed sequence
+ *       number and retry.
+ */
+static inline void WriteBegin(Shard *const shard) {
+  const unsigned sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  assert((sequence & 1) == 0);
+  atomic_store_explicit(&shard->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static inline void WriteEnd(Shard *const shard) {
+  const unsigned sequence =
+      atomic_load_explicit(&shard->sequence, memory_order_relaxed);
+  assert((sequence & 1) == 1);
+  atomic_store_explicit(&shard->sequence, sequence + 1, memory_order_release);
+}
+
+/**
+ * @brief Find the slot of a key or the empty slot where it belongs.
+ * @note Must be called with the shard lock held.
+ */
+static Slot *FindSlot(Table *const table, const Atom key, const size_t hash) {
+  size_t index = hash & (table->capacity - 1);
+  while (true) {
+    Slot *const slot = &table->slots[index];
+    const Atom slot_key =
+        atomic_load_explicit(&slot->key, memory_order_relaxed);
+    if (slot_key == key || slot_key == NULL) {
+      return slot;
+    }
+    index = (index + 1) & (table->capacity - 1);
+  }
+}
+
+/**
+ * @brief Move live entries of a table into another table.
+ * @note Must be called with the shard lock held.
+ */
+static void CopyLiveSlots(Table *const dst, const Slot *const src,
+                          const size_t capacity) {
+  for (size_t i = 0; i < capacity; i++) {
+    const Atom key = atomic_load_explicit(&src[i].key, memory_order_relaxed);
+    if (key == NULL || key == TOMBSTONE) {
+      continue;
+    }
+
+    Slot *const slot = FindSlot(dst, key, MixHash(key));
+    atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+    atomic_store_explicit(
+        &slot->value,
+        atomic_load_explicit(&src[i].value, memory_order_relaxed),
+        memory_order_relaxed);
+    slot->destroy = src[i].destroy;
+  }
+}
+
+/**
+ * @brief Make room for one more entry in a shard.
+ * @note Must be called with the shard lock held.
+ */
+static void EnsureCapacity(Shard *const shard) {
+  Table *const table =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  if ((float)shard->in_use <
+      ((float)table->capacity * DEFAULT_DICT_MAX_LOAD_FACTOR)) {
+    return;
+  }
+
+  const size_t length =
+      atomic_load_explicit(&shard->length, memory_order_relaxed);
+  const bool expand = ((float)length >=
+                       ((float)table->capacity * DEFAULT_DICT_MIN_LOAD_FACTOR));
+
+  if (expand) {
+    /* Build the new table off to the side and publish it. The old table is
+     * retired rather than freed, since lock-free readers may still be probing
+     * it. Retired tables are bounded by the geometric growth. */
+    Table *const new_table = TableCreate(table->capacity * 2);
+    CopyLiveSlots(new_table, table->slots, table->capacity);
+    new_table->retired = table;
+
+    WriteBegin(shard);
+    atomic_store_explicit(&shard->table, new_table, memory_order_relaxed);
+    WriteEnd(shard);
+  } else {
+    /* Compact tombstones in place. Readers observe the odd sequence number
+     * and retry until we are done. */
+    const size_t size = table->capacity * sizeof(Slot);
+    Slot *const scratch = xmalloc(size);
+    memcpy(scratch, table->slots, size);
+
+    WriteBegin(shard);
+    memset(table->slots, 0, size);
+    CopyLiveSlots(table, scratch, table->capacity);
+    WriteEnd(shard);
+
+    xfree(scratch);
+  }
+
+  shard->in_use = length;
+}
+
+ConcurrentDict *ConcurrentDictCreate(void) {
+  ConcurrentDict *const dict =
+      aligned_alloc(CACHE_LINE_SIZE, sizeof(ConcurrentDict));
+  if (dict == NULL) {
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+  memset(dict, 0, sizeof(ConcurrentDict));
+
+  for (size_t i = 0; i < DEFAULT_CONCURRENT_DICT_SHARDS; i++) {
+    Shard *const shard = &dict->shards[i];
+    atomic_init(&shard->sequence, 0);
+    atomic_init(&shard->table, TableCreate(DEFAULT_CONCURRENT_DICT_CAPACITY));
+    atomic_init(&shard->length, 0);
+    shard->in_use = 0;
+    shard->lock = SDL_CreateMutex();
+    if (shard->lock == NULL) {
+      LOG_CRITICAL("Failed to create mutex: %s", SDL_GetError());
+    }
+  }
+
+  return dict;
+}
+
+void ConcurrentDictDestroy(void *const ptr) {
+  ConcurrentDict *const dict = ptr;
+  if (dict == NULL) {
+    return;
+  }
+
+  for (size_t i = 0; i < DEFAULT_CONCURRENT_DICT_SHARDS; i++) {
+    Shard *const shard = &dict->shards[i];
+    Table *table = atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    for (size_t j = 0; j < table->capacity; j++) {
+      Slot *const slot = &table->slots[j];
+      const Atom key = atomic_load_explicit(&slot->key, memory_order_relaxed);
+      if (key != NULL && key != TOMBSTONE && slot->destroy != NULL) {
+        slot->destroy(atomic_load_explicit(&slot->value, memory_order_relaxed));
+      }
+    }
+
+    while (table != NULL) {
+      Table *const retired = table->retired;
+      xfree(table);
+      table = retired;
+    }
+
+    SDL_DestroyMutex(shard->lock);
+  }
+
+  free(dict);
+}
+
+size_t ConcurrentDictLength(const ConcurrentDict *const dict) {
+  assert(dict != NULL);
+
+  size_t length = 0;
+  for (size_t i = 0; i < DEFAULT_CONCURRENT_DICT_SHARDS; i++) {
+    length +=
+        atomic_load_explicit(&dict->shards[i].length, memory_order_relaxed);
+  }
+  return length;
+}
+
+void ConcurrentDictSet(ConcurrentDict *const dict, const Atom key,
+                       void *const value, void (*destroy)(void *)) {
+  assert(dict != NULL);
+  assert(key != NULL);
+
+  const size_t hash = MixHash(key);
+  Shard *const shard = GetShard(dict, hash);
+
+  SDL_LockMutex(shard->lock);
+  EnsureCapacity(shard);
+
+  Table *const table =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  Slot *const slot = FindSlot(table, key, hash);
+  const bool exists =
+      atomic_load_explicit(&slot->key, memory_order_relaxed) != NULL;
+  void *const old_value =
+      atomic_load_explicit(&slot->value, memory_order_relaxed);
+  void (*const old_destroy)(void *) = slot->destroy;
+
+  WriteBegin(shard);
+  atomic_store_explicit(&slot->value, value, memory_order_relaxed);
+  atomic_store_explicit(&slot->key, key, memory_order_relaxed);
+  WriteEnd(shard);
+  slot->destroy = destroy;
+
+  if (!exists) {
+    shard->in_use += 1;
+    atomic_fetch_add_explicit(&shard->length, 1, memory_order_relaxed);
+  }
+  SDL_UnlockMutex(shard->lock);
+
+  if (exists && old_destroy != NULL) {
+    old_destroy(old_value);
+  }
+}
+
+bool ConcurrentDictGet(const ConcurrentDict *const dict, const Atom key,
+                       void **const value) {
+  assert(dict != NULL);
+  assert(key != NULL);
+
+  const size_t hash = MixHash(key);
+  const Shard *const shard = GetShard(dict, hash);
+
+  while (true) {
+    const unsigned begin =
+        atomic_load_explicit(&shard->sequence, memory_order_acquire);
+    if ((begin & 1) != 0) {
+      /* A writer is modifying the shard */
+      continue;
+    }
+
+    const Table *const table =
+        atomic_load_explicit(&shard->table, memory_order_relaxed);
+
+    /* The table may be modified under our feet, so never probe more than its
+     * capacity. The sequence check below discards inconsistent results. */
+    bool found = false;
+    void *result = NULL;
+    size_t index = hash & (table->capacity - 1);
+    for (size_t i = 0; i < table->capacity; i++) {
+      const Slot *const slot = &table->slots[index];
+      const Atom slot_key =
+          atomic_load_explicit(&slot->key, memory_order_relaxed);
+      if (slot_key == key) {
+        result = atomic_load_explicit(&slot->value, memory_order_relaxed);
+        found = true;
+        break;
+      }
+      if (slot_key == NULL) {
+        break;
+      }
+      index = (index + 1) & (table->capacity - 1);
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&shard->sequence, memory_order_relaxed) == begin) {
+      if (found && value != NULL) {
+        *value = result;
+      }
+      return found;
+    }
+  }
+}
+
+bool ConcurrentDictRemove(ConcurrentDict *const dict, const Atom key,
+                          void **const value) {
+  assert(dict != NULL);
+  assert(key != NULL);
+
+  const size_t hash = MixHash(key);
+  Shard *const shard = GetShard(dict, hash);
+
+  SDL_LockMutex(shard->lock);
+
+  Table *const table =
+      atomic_load_explicit(&shard->table, memory_order_relaxed);
+  Slot *const slot = FindSlot(table, key, hash);
+  if (atomic_load_explicit(&slot->key, memory_order_relaxed) == NULL) {
+    SDL_UnlockMutex(shard->lock);
+    return false;
+  }
+
+  if (value != NULL) {
+    *value = atomic_load_explicit(&slot->value, memory_order_relaxed);
+  }
+
+  WriteBegin(shard);
+  atomic_store_explicit(&slot->key, TOMBSTONE, memory_order_relaxed);
+  atomic_store_explicit(&slot->value, NULL, memory_order_relaxed);
+  WriteEnd(shard);
+  slot->destroy = NULL;
+
+  atomic_fetch_sub_explicit(&shard->length, 1, memory_order_relaxed);
+  SDL_UnlockMutex(shard->lock);
+
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef __ETERNO_CONCURRENT_DICT_H__
+#define __ETERNO_CONCURRENT_DICT_H__
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "atom.h"
+
+/**
+ * @brief Dictionary for read-mostly data shared between threads.
+ * @note Lookups never take a lock. Entries are spread over shards, each with
+ *       its own writer lock and sequence counter. Readers retry if a writer
+ *       modified the shard while they were probing it.
+ */
+typedef struct ConcurrentDict ConcurrentDict;
+
+/**
+ * @brief Create a concurrent dictionary.
+ * @return The dictionary.
+ * @note Caller takes ownership of returned value.
+ */
+ConcurrentDict *ConcurrentDictCreate(void);
+
+/**
+ * @brief Destroy the concurrent dictionary.
+ * @param ptr Pointer to dictionary.
+ * @note If ptr is NULL, no operation is performed. Otherwise, values are
+ *       destroyed using passed destroy function unless it's NULL. No other
+ *       thread may access the dictionary during or after this call.
+ */
+void ConcurrentDictDestroy(void *ptr);
+
+/**
+ * @brief Get number of entries in dictionary.
+ * @param dict The dictionary.
+ * @return Number of entries in dictionary.
+ * @note The result is approximate while other threads are writing.
+ */
+size_t ConcurrentDictLength(const ConcurrentDict *dict);
+
+/**
+ * @brief Create/update entry in dictionary.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @param value Value of entry.
+ * @param destroy Function to destroy the value of the entry or NULL.
+ * @note A replaced value is destroyed immediately, so callers must make sure
+ *       no reader still uses it (e.g. by reference counting).
+ */
+void ConcurrentDictSet(ConcurrentDict *dict, Atom key, void *value,
+                       void (*destroy)(void *));
+
+/**
+ * @brief Look up entry in dictionary without taking a lock.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @param value Set to value of entry unless NULL.
+ * @return True if entry with key exists.
+ */
+bool ConcurrentDictGet(const ConcurrentDict *dict, Atom key, void **value);
+
+/**
+ * @brief Remove entry from dictionary.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @param value Set to value of entry unless NULL.
+ * @return True if entry with key existed.
+ * @note Caller takes ownership of the value.
+ */
+bool ConcurrentDictRemove(ConcurrentDict *dict, Atom key, void **value);
+
+#endif // __ETERNO_CONCURRENT_DICT_H__
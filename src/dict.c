@@ -1,16 +1,24 @@
 #include "config.h"
 
+#define LOG_MODULE LOG_MODULE_CORE
+
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
 
+#include "allocator.h"
+#include "atom.h"
 #include "dict.h"
 #include "list.h"
 #include "logger.h"
+#include "metrics.h"
 #include "utils.h"
 
+/* An entry is empty if it has no key and is not invalidated. Entries are
+ * stored inline in the buffer, so iterating and clearing never touches the
+ * allocator. */
 typedef struct Entry {
-  char *key;
+  Atom key;
   void *value;
   void (*destroy)(void *);
   bool invalidated;
@@ -20,51 +28,73 @@ struct Dict {
   size_t length;
   size_t capacity;
   size_t in_use;
-  Entry **buffer;
+  Entry *buffer;
+  Allocator allocator;
 };
 
-/**
- * @brief Hash a key.
- * @param key The key.
- * @return The hash.
- */
-static size_t HashKey(const char *const key) {
-  assert(key != NULL);
-
-  size_t hash = 5381;
-  const size_t length = strlen(key);
-  for (size_t i = 0; i < length; i++) {
-    hash = ((hash << 5) + hash) + (size_t)key[i];
-  }
-  return hash;
-}
-
 /**
  * @brief Compute the available index of a new entry in a dictionary.
  * @param dict The dictionary.
  * @param key The key.
  * @return The index.
+ * @note Keys are atoms, so the hash is precomputed and equality is a pointer
+ *       comparison.
  */
-static size_t ComputeIndex(const Dict *const dict, const char *const key) {
+static size_t ComputeIndex(const Dict *const dict, const Atom key) {
   assert(dict != NULL);
   assert(dict->buffer != NULL);
   assert(key != NULL);
 
-  size_t index = HashKey(key) % dict->capacity;
+  size_t index = AtomHash(key) % dict->capacity;
+  size_t probes = 0;
   while (true) {
-    Entry *entry = dict->buffer[index];
-    if (entry == NULL) {
+    const Entry *const entry = &dict->buffer[index];
+    if (entry->key == key) {
       break;
     }
-    if (!entry->invalidated && StringEqual(entry->key, key)) {
+    if (entry->key == NULL && !entry->invalidated) {
       break;
     }
     index = (index + 1) % dict->capacity;
+    probes += 1;
   }
 
+  METRICS_OBSERVE(DICT_PROBE_LENGTH, probes);
   return index;
 }
 
+/**
+ * @brief Move all valid entries into a new buffer, dropping invalidated ones.
+ * @param dict The dictionary.
+ * @param new_capacity Capacity of the new buffer.
+ */
+static void Rehash(Dict *const dict, const size_t new_capacity) {
+  assert(dict != NULL);
+  assert(new_capacity > dict->length);
+
+  Entry *const old_buffer = dict->buffer;
+  const size_t old_capacity = dict->capacity;
+  METRICS_ADD(DICT_REHASHES, 1);
+
+  dict->buffer =
+      AllocatorCalloc(&dict->allocator, new_capacity, sizeof(Entry));
+  dict->capacity = new_capacity;
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    const Entry *const entry = &old_buffer[i];
+    if (entry->key == NULL) {
+      continue;
+    }
+
+    const size_t index = ComputeIndex(dict, entry->key);
+    assert(dict->buffer[index].key == NULL);
+    dict->buffer[index] = *entry;
+  }
+
+  dict->in_use = dict->length;
+  AllocatorFree(&dict->allocator, old_buffer, old_capacity * sizeof(Entry));
+}
+
 static void EnsureCapacity(Dict *const dict) {
   assert(dict != NULL);
   assert(DEFAULT_DICT_MAX_LOAD_FACTOR > DEFAULT_DICT_MIN_LOAD_FACTOR);
@@ -77,81 +107,94 @@ static void EnsureCapacity(Dict *const dict) {
   /* If we can free enough of the capacity by removing invalidated items, there
    * is no need to expand the buffer. */
   assert(dict->in_use >= dict->length);
-  const bool expand =
-      (((float)dict->capacity / 100.f) * (float)(dict->in_use - dict->length)) <
-      DEFAULT_DICT_MIN_LOAD_FACTOR;
+  const bool expand = ((float)dict->length >=
+                       ((float)dict->capacity * DEFAULT_DICT_MIN_LOAD_FACTOR));
 
-  const size_t new_capacity = (expand) ? dict->capacity * 2 : dict->capacity;
-  Entry **const new_buffer = xcalloc(new_capacity, sizeof(Entry *));
-
-  Entry **const old_buffer = dict->buffer;
-  dict->buffer = new_buffer;
-  const size_t old_capacity = dict->capacity;
-  dict->capacity = new_capacity;
-
-  for (size_t i = 0; expand && (i < old_capacity); i++) {
-    Entry *const entry = old_buffer[i];
-    if (entry == NULL) {
-      continue;
-    }
-
-    if (entry->invalidated) {
-      free(entry);
-      continue;
-    }
+  Rehash(dict, (expand) ? dict->capacity * 2 : dict->capacity);
+}
 
-    const size_t index = ComputeIndex(dict, entry->key);
-    assert(new_buffer[index] == NULL);
-    new_buffer[index] = entry;
-  }
+Dict *DictCreate(void) { return DictCreateWithAllocator(&HEAP_ALLOCATOR); }
 
-  dict->in_use = dict->length;
-  free(old_buffer);
+Dict *DictCreateInArena(Arena *const arena) {
+  const Allocator allocator = ArenaAllocator(arena);
+  return DictCreateWithAllocator(&allocator);
 }
 
-Dict *DictCreate(void) {
-  Dict *dict = xmalloc(sizeof(Dict));
+Dict *DictCreateWithAllocator(const Allocator *const allocator) {
+  assert(allocator != NULL);
+
+  Dict *dict = AllocatorAlloc(allocator, sizeof(Dict));
   dict->length = dict->in_use = 0;
   dict->capacity = DEFAULT_DICT_CAPACITY;
-  dict->buffer = xcalloc(dict->capacity, sizeof(Entry *));
+  dict->buffer = AllocatorCalloc(allocator, dict->capacity, sizeof(Entry));
+  dict->allocator = *allocator;
   return dict;
 }
 
+/**
+ * @brief Destroy the values of all valid entries.
+ * @param dict The dictionary.
+ */
+static void DestroyValues(Dict *const dict) {
+  assert(dict != NULL);
+  assert(dict->buffer != NULL);
+
+  for (size_t i = 0; i < dict->capacity; i++) {
+    const Entry *const entry = &dict->buffer[i];
+    if (entry->key != NULL && entry->destroy != NULL) {
+      entry->destroy(entry->value);
+    }
+  }
+}
+
 void DictDestroy(void *const ptr) {
   Dict *const dict = (Dict *)ptr;
   if (dict == NULL) {
     return;
   }
 
-  assert(dict->buffer != NULL);
+  DestroyValues(dict);
+  /* Copy, as the allocator lives in the dictionary being freed */
+  const Allocator allocator = dict->allocator;
+  AllocatorFree(&allocator, dict->buffer, dict->capacity * sizeof(Entry));
+  AllocatorFree(&allocator, dict, sizeof(Dict));
+}
 
-  for (size_t i = 0; i < dict->capacity; i++) {
-    Entry *entry = dict->buffer[i];
-    if (entry == NULL) {
-      continue;
-    }
+size_t DictLength(const Dict *const dict) {
+  assert(dict != NULL);
+  return dict->length;
+}
 
-    if (!entry->invalidated) {
-      free(entry->key);
-      if (entry->destroy != NULL) {
-        entry->destroy(entry->value);
-      }
-    }
+void DictReserve(Dict *const dict, const size_t n_entries) {
+  assert(dict != NULL);
 
-    free(entry);
+  size_t new_capacity = dict->capacity;
+  while ((float)n_entries >=
+         ((float)new_capacity * DEFAULT_DICT_MAX_LOAD_FACTOR)) {
+    new_capacity *= 2;
   }
 
-  free(dict->buffer);
-  free(dict);
+  if (new_capacity != dict->capacity) {
+    Rehash(dict, new_capacity);
+  }
 }
 
-size_t DictLength(const Dict *const dict) {
+void DictClear(Dict *const dict) {
   assert(dict != NULL);
-  return dict->length;
+
+  DestroyValues(dict);
+  memset(dict->buffer, 0, dict->capacity * sizeof(Entry));
+  dict->length = dict->in_use = 0;
 }
 
 void DictSet(Dict *const dict, const char *const key, void *const value,
              void (*destroy)(void *)) {
+  assert(key != NULL);
+  DictSetAtom(dict, AtomIntern(key), value, destroy);
+}
+
+void DictSetAtom(Dict *const dict, const Atom key, void *const value,
+                 void (*destroy)(void *)) {
   assert(dict != NULL);
   assert(dict->buffer != NULL);
   assert(key != NULL);
@@ -159,36 +202,57 @@ void DictSet(Dict *const dict, const char *const key, void *const value,
   EnsureCapacity(dict);
 
   const size_t index = ComputeIndex(dict, key);
-  if (dict->buffer[index] != NULL) {
-    Entry *const item = dict->buffer[index];
-    assert(item->key != NULL);
-    assert(StringEqual(key, item->key));
+  Entry *const entry = &dict->buffer[index];
+  if (entry->key != NULL) {
+    assert(entry->key == key);
 
-    if (item->destroy != NULL) {
-      item->destroy(item->value);
+    if (entry->destroy != NULL) {
+      entry->destroy(entry->value);
     }
-    item->value = value;
-    item->destroy = destroy;
+    entry->value = value;
+    entry->destroy = destroy;
+    return;
   }
 
-  Entry *entry = xmalloc(sizeof(Entry));
-  entry->key = xstrdup(key);
+  entry->key = key;
   entry->value = value;
   entry->destroy = destroy;
   entry->invalidated = false;
 
-  dict->buffer[index] = entry;
   dict->in_use += 1;
   dict->length += 1;
 }
 
+void DictSetMany(Dict *const dict, const char *const *const keys,
+                 void *const *const values, const size_t n_entries,
+                 void (*destroy)(void *)) {
+  assert(dict != NULL);
+  assert(keys != NULL || n_entries == 0);
+  assert(values != NULL || n_entries == 0);
+
+  /* Grow once up front instead of rehashing repeatedly while inserting */
+  DictReserve(dict, dict->length + n_entries);
+
+  for (size_t i = 0; i < n_entries; i++) {
+    DictSet(dict, keys[i], values[i], destroy);
+  }
+}
+
 bool DictHasKey(const Dict *const dict, const char *const key) {
+  assert(key != NULL);
+
+  /* A string that was never interned cannot be a key */
+  const Atom atom = AtomFind(key);
+  return (atom != NULL) && DictHasAtom(dict, atom);
+}
+
+bool DictHasAtom(const Dict *const dict, const Atom key) {
   assert(dict != NULL);
   assert(dict->buffer != NULL);
   assert(key != NULL);
 
   const size_t index = ComputeIndex(dict, key);
-  return dict->buffer[index] != NULL;
+  return dict->buffer[index].key != NULL;
 }
 
 List *DictGetKeys(const Dict *const dict) {
@@ -197,12 +261,11 @@ List *DictGetKeys(const Dict *const dict) {
 
   List *const keys = ListCreate();
   for (size_t i = 0; i < dict->capacity; i++) {
-    Entry *const entry = dict->buffer[i];
-    if (entry == NULL || entry->invalidated) {
+    const Entry *const entry = &dict->buffer[i];
+    if (entry->key == NULL) {
       continue;
     }
 
-    assert(entry->key != NULL);
     char *const key = xstrdup(entry->key);
     ListAppend(keys, key, free);
   }
@@ -210,30 +273,75 @@ List *DictGetKeys(const Dict *const dict) {
   return keys;
 }
 
+void DictIteratorInit(DictIterator *const iter, const Dict *const dict) {
+  assert(iter != NULL);
+  assert(dict != NULL);
+
+  iter->dict = dict;
+  iter->index = 0;
+}
+
+bool DictIteratorNext(DictIterator *const iter, Atom *const key,
+                      void **const value) {
+  assert(iter != NULL);
+  assert(iter->dict != NULL);
+
+  const Dict *const dict = iter->dict;
+  while (iter->index < dict->capacity) {
+    const Entry *const entry = &dict->buffer[iter->index++];
+    if (entry->key == NULL) {
+      continue;
+    }
+
+    if (key != NULL) {
+      *key = entry->key;
+    }
+    if (value != NULL) {
+      *value = entry->value;
+    }
+    return true;
+  }
+
+  return false;
+}
+
 const void *DictGet(const Dict *const dict, const char *const key) {
+  assert(key != NULL);
+
+  const Atom atom = AtomFind(key);
+  assert(atom != NULL);
+  return DictGetAtom(dict, atom);
+}
+
+const void *DictGetAtom(const Dict *const dict, const Atom key) {
   assert(dict != NULL);
   assert(dict->buffer != NULL);
   assert(key != NULL);
 
   const size_t index = ComputeIndex(dict, key);
-  Entry *entry = dict->buffer[index];
-  assert(entry != NULL);
+  const Entry *const entry = &dict->buffer[index];
+  assert(entry->key != NULL);
   return entry->value;
 }
 
 void *DictRemove(Dict *const dict, const char *const key) {
+  assert(key != NULL);
+
+  const Atom atom = AtomFind(key);
+  assert(atom != NULL);
+  return DictRemoveAtom(dict, atom);
+}
+
+void *DictRemoveAtom(Dict *const dict, const Atom key) {
   assert(dict != NULL);
   assert(dict->buffer != NULL);
   assert(key != NULL);
 
   const size_t index = ComputeIndex(dict, key);
-  Entry *const entry = dict->buffer[index];
-  assert(entry != NULL);
-  assert(entry->key != NULL);
-  assert(StringEqual(entry->key, key));
+  Entry *const entry = &dict->buffer[index];
+  assert(entry->key == key);
   assert(!entry->invalidated);
 
-  free(entry->key);
   entry->key = NULL;
 
   void *value = entry->value;
@@ -5,10 +5,18 @@
 #include <stdbool.h>
 #include <stdlib.h>
 
+#include "allocator.h"
+#include "arena.h"
+#include "atom.h"
 #include "list.h"
 
 typedef struct Dict Dict;
 
+typedef struct DictIterator {
+  const Dict *dict;
+  size_t index;
+} DictIterator;
+
 /**
  * @brief Create a dictionary.
  * @return The dictionary.
@@ -16,6 +24,24 @@ typedef struct Dict Dict;
  */
 Dict *DictCreate(void);
 
+/**
+ * @brief Create a dictionary whose storage is drawn from an arena.
+ * @param arena The arena or NULL to use the heap.
+ * @return The dictionary.
+ * @note The dictionary is invalidated when the arena is reset. Destroying it
+ *       is only needed to run the destroy functions of the values.
+ */
+Dict *DictCreateInArena(Arena *arena);
+
+/**
+ * @brief Create a dictionary whose storage is drawn from an allocator.
+ * @param allocator The allocator, which is copied into the dictionary.
+ * @return The dictionary.
+ * @note The dictionary must be destroyed before the memory of the allocator
+ *       is released, e.g. within the same frame for FrameAllocator().
+ */
+Dict *DictCreateWithAllocator(const Allocator *allocator);
+
 /**
  * @brief Destroy the dictionary.
  * @param dict Pointer to dictionary.
@@ -31,15 +57,52 @@ void DictDestroy(void *dict);
  */
 size_t DictLength(const Dict *dict);
 
+/**
+ * @brief Make room for a number of entries without further rehashing.
+ * @param dict The dictionary.
+ * @param n_entries Total number of entries to make room for.
+ */
+void DictReserve(Dict *dict, size_t n_entries);
+
+/**
+ * @brief Remove all entries from dictionary.
+ * @param dict The dictionary.
+ * @note Values are destroyed using their destroy function unless it's NULL.
+ *       The capacity is kept, so refilling the dictionary does not allocate.
+ */
+void DictClear(Dict *dict);
+
 /**
  * @brief Create/update entry in dictionary.
  * @param dict The dictionary.
  * @param key Key of entry.
  * @param value Value of entry.
  * @param destroy Function to destroy the value of the entry or NULL.
+ * @note The key is interned using AtomIntern().
  */
 void DictSet(Dict *dict, const char *key, void *value, void (*destroy)(void *));
 
+/**
+ * @brief Create/update entry in dictionary using an interned key.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @param value Value of entry.
+ * @param destroy Function to destroy the value of the entry or NULL.
+ */
+void DictSetAtom(Dict *dict, Atom key, void *value, void (*destroy)(void *));
+
+/**
+ * @brief Create/update multiple entries in dictionary.
+ * @param dict The dictionary.
+ * @param keys Keys of entries.
+ * @param values Values of entries.
+ * @param n_entries Number of entries.
+ * @param destroy Function to destroy the values of the entries or NULL.
+ * @note Capacity is reserved once for all entries up front.
+ */
+void DictSetMany(Dict *dict, const char *const *keys, void *const *values,
+                 size_t n_entries, void (*destroy)(void *));
+
 /**
  * @brief Check for existance of entry in dictionary.
  * @param dict The dictionary.
@@ -48,6 +111,14 @@ void DictSet(Dict *dict, const char *key, void *value, void (*destroy)(void *));
  */
 bool DictHasKey(const Dict *dict, const char *key);
 
+/**
+ * @brief Check for existance of entry with interned key in dictionary.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @return True if entry with key exists.
+ */
+bool DictHasAtom(const Dict *dict, Atom key);
+
 /**
  * @brief Get list of keys in dictionary.
  * @param dict The dictionary.
@@ -56,6 +127,25 @@ bool DictHasKey(const Dict *dict, const char *key);
  */
 List *DictGetKeys(const Dict *dict);
 
+/**
+ * @brief Initialize iterator over entries in dictionary.
+ * @param iter The iterator.
+ * @param dict The dictionary.
+ * @note Iteration does not allocate. Entries may be removed while iterating,
+ *       but adding entries invalidates the iterator.
+ */
+void DictIteratorInit(DictIterator *iter, const Dict *dict);
+
+/**
+ * @brief Advance iterator to next entry in dictionary.
+ * @param iter The iterator.
+ * @param key Set to key of entry unless NULL.
+ * @param value Set to value of entry unless NULL.
+ * @return False if there are no more entries.
+ * @note Key and value are borrowed from the dictionary.
+ */
+bool DictIteratorNext(DictIterator *iter, Atom *key, void **value);
+
 /**
  * @brief Get value of entry with key in dictionary.
  * @param dict The dictionary.
@@ -64,6 +154,14 @@ List *DictGetKeys(const Dict *dict);
  */
 const void *DictGet(const Dict *dict, const char *key);
 
+/**
+ * @brief Get value of entry with interned key in dictionary.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @return Value of entry.
+ */
+const void *DictGetAtom(const Dict *dict, Atom key);
+
 /**
  * @brief Remove entry from dictionary.
  * @param dict The dictionary.
@@ -73,4 +171,13 @@ const void *DictGet(const Dict *dict, const char *key);
  */
 void *DictRemove(Dict *dict, const char *key);
 
+/**
+ * @brief Remove entry with interned key from dictionary.
+ * @param dict The dictionary.
+ * @param key Atom key of entry.
+ * @return Value of entry.
+ * @note Caller takes ownership of returned value.
+ */
+void *DictRemoveAtom(Dict *dict, Atom key);
+
 #endif // __ETERNO_DICT_H__
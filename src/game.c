@@ -1,12 +1,27 @@
-#include "game.h"
 #include "config.h"
+
+#define LOG_MODULE LOG_MODULE_GAME
+
+#include "game.h"
+#include "allocator.h"
+#include "animation.h"
+#include "atom.h"
+#include "buffer.h"
+#include "collision.h"
+#include "input.h"
+#include "level.h"
 #include "logger.h"
+#include "memtrack.h"
+#include "metrics.h"
 #include "player.h"
+#include "snapshot.h"
 #include "texture.h"
 #include "utils.h"
 
 #include <SDL3/SDL.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h>
 
 struct Game {
@@ -15,10 +30,105 @@ struct Game {
   SDL_Renderer *renderer;
   SDL_Texture *render_target;
   TextureMap *texture_map;
+  Input *input;
+  Level *level;          /* NULL if the world is a single screen */
+  CollisionWorld *world; /* Owned by the level, if any */
+  AnimationSystem *animations;
   GameObject *player;
+  Vector camera; /* Top-left corner of the view */
+  SnapshotRing *snapshots;
+  Buffer *scene; /* State of all objects, reused */
+  uint64_t lag_ns; /* Elapsed time not yet simulated */
 };
 
-Game *GameInit(const char *title, int width, int height, bool fullscreen) {
+#define TICK_NS (SDL_NS_PER_SECOND / DEFAULT_TICK_RATE)
+#define TICK_DT (1.0f / DEFAULT_TICK_RATE)
+
+/* Thickness of the walls around the render target */
+#define WALL_SIZE 64.0f
+
+/* Keep objects inside the render target, but let them jump above it */
+static CollisionWorld *CreateWorld(void) {
+  CollisionWorld *const world =
+      CollisionWorldCreate(RENDER_TARGET_WIDTH, RENDER_TARGET_HEIGHT, 0.0f);
+
+  const CollisionBox walls[] = {
+      /* Floor */
+      {.position = {.x = -WALL_SIZE, .y = RENDER_TARGET_HEIGHT},
+       .size = {.width = RENDER_TARGET_WIDTH + (2.0f * WALL_SIZE),
+                .height = WALL_SIZE}},
+      /* Left wall */
+      {.position = {.x = -WALL_SIZE, .y = -RENDER_TARGET_HEIGHT},
+       .size = {.width = WALL_SIZE, .height = 2.0f * RENDER_TARGET_HEIGHT}},
+      /* Right wall */
+      {.position = {.x = RENDER_TARGET_WIDTH, .y = -RENDER_TARGET_HEIGHT},
+       .size = {.width = WALL_SIZE, .height = 2.0f * RENDER_TARGET_HEIGHT}},
+  };
+  for (size_t i = 0; i < LENGTH(walls); i++) {
+    CollisionWorldAddSolid(world, &walls[i]);
+  }
+
+  return world;
+}
+
+/* Save the state of all objects as the newest snapshot */
+static void SaveScene(Game *game) {
+  BufferTruncate(game->scene, 0);
+  const size_t size = game->player->state_size;
+  GameObjectSave(game->player, BufferReserve(game->scene, size));
+  BufferCommit(game->scene, size);
+  SnapshotRingPush(game->snapshots, BufferData(game->scene),
+                   BufferLength(game->scene));
+}
+
+/* Restore the objects to the snapshot before the newest, if any */
+static void Rewind(Game *game) {
+  size_t size;
+  const void *const state = SnapshotRingRewind(game->snapshots, &size);
+  if (state == NULL) {
+    return;
+  }
+  assert(size == game->player->state_size);
+  GameObjectLoad(game->player, state);
+}
+
+/* Centre the view on the player, without showing outside the level */
+static void UpdateCamera(Game *game) {
+  if (game->level == NULL) {
+    return;
+  }
+
+  Vector size;
+  LevelGetSize(game->level, &size);
+  const GameObject *const player = game->player;
+  const float x = player->position.x + (player->size.width / 2.0f) -
+                  (RENDER_TARGET_WIDTH / 2.0f);
+  const float y = player->position.y + (player->size.height / 2.0f) -
+                  (RENDER_TARGET_HEIGHT / 2.0f);
+  game->camera.x = MAX(MIN(x, size.width - RENDER_TARGET_WIDTH), 0.0f);
+  game->camera.y = MAX(MIN(y, size.height - RENDER_TARGET_HEIGHT), 0.0f);
+}
+
+/* Stream the level around the view, and make sure the player stands on
+ * resident chunks, since the camera stops at the edges of the level */
+static bool UpdateLevel(Game *game) {
+  if (game->level == NULL) {
+    return true;
+  }
+
+  const Vector center = {
+      .x = game->camera.x + (RENDER_TARGET_WIDTH / 2.0f),
+      .y = game->camera.y + (RENDER_TARGET_HEIGHT / 2.0f),
+  };
+  const CollisionBox player = {
+      .position = game->player->position,
+      .size = game->player->size,
+  };
+  return LevelUpdate(game->level, &center, &player);
+}
+
+Game *GameInit(const char *title, int width, int height, bool fullscreen,
+               const char *level_file) {
   assert(title != NULL);
 
   Game *game = xmalloc(sizeof(Game));
@@ -63,14 +173,51 @@ Game *GameInit(const char *title, int width, int height, bool fullscreen) {
   game->texture_map = TextureMapCreate();
   assert(game->texture_map != NULL);
 
+  LOG_DEBUG("Creating input state");
+  game->input = InputCreate();
+
+  if (level_file != NULL) {
+    LOG_DEBUG("Opening level");
+    game->level = LevelOpen(level_file);
+    if (game->level == NULL) {
+      LOG_ERROR("Failed to open level '%s'", level_file);
+      GameDestroy(game);
+      return NULL;
+    }
+    game->world = LevelGetWorld(game->level);
+  } else {
+    LOG_DEBUG("Creating collision world");
+    game->world = CreateWorld();
+  }
+
+  LOG_DEBUG("Creating animation system");
+  game->animations = AnimationSystemCreate();
+
   LOG_DEBUG("Creating player");
-  game->player = PlayerCreate(game->texture_map, game->renderer);
+  game->player = PlayerCreate(game->texture_map, game->renderer, game->world,
+                              game->animations);
   if (game->player == NULL) {
     LOG_ERROR("Failed to create player");
     GameDestroy(game);
     return NULL;
   }
 
+  if (game->level != NULL) {
+    /* Wait for the chunks around the start */
+    LevelGetSpawn(game->level, &game->player->position);
+    UpdateCamera(game);
+    if (!UpdateLevel(game)) {
+      LOG_ERROR("Failed to load level around start");
+      GameDestroy(game);
+      return NULL;
+    }
+  }
+
+  LOG_DEBUG("Creating snapshot ring");
+  game->snapshots = SnapshotRingCreate(0, 0);
+  game->scene = BufferCreate();
+  SaveScene(game);
+
   LOG_DEBUG("Game is running");
   game->running = true;
 
@@ -82,6 +229,21 @@ bool GameIsRunning(Game *game) {
   return game->running;
 }
 
+bool GameSetInputBindings(Game *game, const char *spec) {
+  assert(game != NULL);
+  return InputSetBindings(game->input, spec);
+}
+
+bool GameReplay(Game *game, const char *filename) {
+  assert(game != NULL);
+  return InputReplay(game->input, filename);
+}
+
+bool GameRecord(Game *game, const char *filename) {
+  assert(game != NULL);
+  return InputRecord(game->input, filename);
+}
+
 bool GameHandleEvents(Game *game) {
   assert(game != NULL);
 
@@ -97,28 +259,165 @@ bool GameHandleEvents(Game *game) {
       break;
     }
 
-    if (!GameObjectEvent(game->player, &event)) {
-      LOG_ERROR("Failed to handle events for player");
+    InputHandleEvent(game->input, &event);
+  }
+
+  return true;
+}
+
+/* Advance the simulation by one fixed time step */
+static bool Tick(Game *game) {
+  if (InputReplayFinished(game->input)) {
+    LOG_DEBUG("Replay finished");
+    game->running = false;
+    return true;
+  }
+
+  const Uint64 start = SDL_GetTicksNS();
+
+  /* All objects see the same input during a tick */
+  InputSnapshot input;
+  InputCapture(game->input, &input);
+
+  /* Step back one tick at a time while rewinding */
+  if (InputIsDown(&input, INPUT_REWIND)) {
+    Rewind(game);
+    METRICS_OBSERVE(UPDATE_TIME_US, (SDL_GetTicksNS() - start) / 1000);
+    return true;
+  }
+
+  if (!GameObjectUpdate(game->player, &input, TICK_DT)) {
+    LOG_ERROR("Failed to update player");
+    return false;
+  }
+
+  /* Objects have set their animation conditions */
+  AnimationSystemUpdate(game->animations, TICK_DT);
+  SaveScene(game);
+
+  METRICS_OBSERVE(UPDATE_TIME_US, (SDL_GetTicksNS() - start) / 1000);
+  return true;
+}
+
+bool GameUpdate(Game *game, uint64_t elapsed_ns) {
+  assert(game != NULL);
+
+  /* Run as many fixed ticks as fit in the elapsed time, so that the
+   * simulation does not depend on the frame rate */
+  game->lag_ns += elapsed_ns;
+  unsigned ticks = 0;
+  while (game->lag_ns >= TICK_NS) {
+    if (ticks == DEFAULT_MAX_TICKS_PER_FRAME) {
+      /* Too far behind to catch up, so slow down rather than stall */
+      LOG_DEBUG("Skipping %" PRIu64 " ms of simulation",
+                game->lag_ns / SDL_NS_PER_MS);
+      game->lag_ns = 0;
+      break;
+    }
+
+    if (!Tick(game)) {
       return false;
     }
+    game->lag_ns -= TICK_NS;
+    ticks += 1;
+  }
+
+  UpdateCamera(game);
+  if (!UpdateLevel(game)) {
+    LOG_ERROR("Failed to stream level");
+    return false;
   }
 
   return true;
 }
 
-bool GameUpdate(Game *game) {
-  assert(game != NULL);
+/* Draw solid tiles of the level as filled rectangles in one batch, as there
+ * is no tile set yet */
+static bool DrawLevel(Game *game) {
+  if (game->level == NULL) {
+    return true;
+  }
 
-  if (!GameObjectUpdate(game->player)) {
-    LOG_ERROR("Failed to update player");
+  unsigned tile_size, chunk_tiles;
+  LevelGetLayout(game->level, &tile_size, &chunk_tiles, NULL);
+  const float chunk_size = (float)tile_size * chunk_tiles;
+
+  /* Runs of solid tiles are merged, so there is at most one rectangle per
+   * visible tile */
+  const size_t max_rects =
+      ((size_t)(RENDER_TARGET_WIDTH / tile_size) + 2) *
+      ((size_t)(RENDER_TARGET_HEIGHT / tile_size) + 2);
+  SDL_FRect *const rects =
+      ArenaAlloc(FrameArena(), max_rects * sizeof(SDL_FRect));
+  size_t n_rects = 0;
+
+  const float view_right = game->camera.x + RENDER_TARGET_WIDTH;
+  const float view_bottom = game->camera.y + RENDER_TARGET_HEIGHT;
+  const size_t n_chunks = LevelChunkCount(game->level);
+  for (size_t i = 0; i < n_chunks; i++) {
+    const LevelChunk *const chunk = LevelGetChunk(game->level, i);
+    const float left = (float)chunk->column * chunk_size;
+    const float top = (float)chunk->row * chunk_size;
+    if (left >= view_right || left + chunk_size <= game->camera.x ||
+        top >= view_bottom || top + chunk_size <= game->camera.y) {
+      continue;
+    }
+
+    /* Visible tiles of the chunk */
+    const unsigned column_begin =
+        (unsigned)MAX((game->camera.x - left) / tile_size, 0.0f);
+    const unsigned column_end =
+        (unsigned)MIN(SDL_ceilf((view_right - left) / tile_size),
+                      (float)chunk_tiles);
+    const unsigned row_begin =
+        (unsigned)MAX((game->camera.y - top) / tile_size, 0.0f);
+    const unsigned row_end = (unsigned)MIN(
+        SDL_ceilf((view_bottom - top) / tile_size), (float)chunk_tiles);
+
+    for (unsigned row = row_begin; row < row_end; row++) {
+      const uint8_t *const line = chunk->collision + (row * chunk_tiles);
+      unsigned column = column_begin;
+      while (column < column_end) {
+        if (line[column] == 0) {
+          column += 1;
+          continue;
+        }
+        const unsigned begin = column;
+        while (column < column_end && line[column] != 0) {
+          column += 1;
+        }
+        assert(n_rects < max_rects);
+        rects[n_rects++] = (SDL_FRect){
+            .x = left + ((float)begin * tile_size) - game->camera.x,
+            .y = top + ((float)row * tile_size) - game->camera.y,
+            .w = (float)(column - begin) * tile_size,
+            .h = (float)tile_size,
+        };
+      }
+    }
+  }
+
+  if (n_rects == 0) {
+    return true;
+  }
+
+  if (!SDL_SetRenderDrawColor(game->renderer, 90, 90, 90, 255)) {
+    LOG_ERROR("Failed to set draw color: %s", SDL_GetError());
+    return false;
+  }
+
+  if (!SDL_RenderFillRects(game->renderer, rects, (int)n_rects)) {
+    LOG_ERROR("Failed to draw level: %s", SDL_GetError());
     return false;
   }
+  METRICS_ADD(DRAW_CALLS, 1);
 
   return true;
 }
 
 bool GameRender(Game *game) {
   assert(game != NULL);
+  const Uint64 start = SDL_GetTicksNS();
 
   /* Set render target to texture */
   if (!SDL_SetRenderTarget(game->renderer, game->render_target)) {
@@ -140,7 +439,12 @@ bool GameRender(Game *game) {
   }
 
   /* Draw to render target */
-  if (!GameObjectDraw(game->player, game->texture_map, game->renderer)) {
+  if (!DrawLevel(game)) {
+    return false;
+  }
+
+  if (!GameObjectDraw(game->player, game->texture_map, game->renderer,
+                      &game->camera)) {
     LOG_ERROR("Failed to draw player");
     return false;
   }
@@ -195,6 +499,7 @@ bool GameRender(Game *game) {
     LOG_ERROR("Failed to render texture to screen: %s", SDL_GetError());
     return false;
   }
+  METRICS_ADD(DRAW_CALLS, 1);
 
   /* Present final image */
   if (!SDL_RenderPresent(game->renderer)) {
@@ -202,6 +507,7 @@ bool GameRender(Game *game) {
     return false;
   }
 
+  METRICS_OBSERVE(RENDER_TIME_US, (SDL_GetTicksNS() - start) / 1000);
   return true;
 }
 
@@ -210,12 +516,35 @@ void GameDestroy(Game *game) {
     return;
   }
 
-  LOG_DEBUG("Destroying player");
-  GameObjectDestroy(game->player, game->texture_map);
+  LOG_DEBUG("Destroying snapshot ring");
+  SnapshotRingDestroy(game->snapshots);
+  BufferDestroy(game->scene);
+
+  if (game->player != NULL) {
+    LOG_DEBUG("Destroying player");
+    GameObjectDestroy(game->player, game->texture_map);
+  }
+
+  LOG_DEBUG("Destroying animation system");
+  AnimationSystemDestroy(game->animations);
+
+  if (game->level != NULL) {
+    LOG_DEBUG("Closing level");
+    LevelClose(game->level);
+  } else {
+    LOG_DEBUG("Destroying collision world");
+    CollisionWorldDestroy(game->world);
+  }
+
+  LOG_DEBUG("Destroying input state");
+  InputDestroy(game->input);
 
   LOG_DEBUG("Destroying texture map");
   TextureMapDestroy(game->texture_map);
 
+  LOG_DEBUG("Destroying atom table");
+  AtomTableDestroy();
+
   LOG_DEBUG("Destroying render target");
   SDL_DestroyTexture(game->render_target);
 
@@ -227,4 +556,7 @@ void GameDestroy(Game *game) {
 
   LOG_DEBUG("Shutting down subsystems");
   SDL_Quit();
+
+  xfree(game);
+  MemTrackReport();
 }
@@ -2,16 +2,30 @@
 #define __ETERNO_GAME_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct Game Game;
 
-Game *GameInit(const char *title, int width, int height, bool fullscreen);
+/* Streams the level from level_file, or keeps the player on a single screen
+ * if it is NULL */
+Game *GameInit(const char *title, int width, int height, bool fullscreen,
+               const char *level_file);
 
 bool GameIsRunning(Game *game);
 
+bool GameSetInputBindings(Game *game, const char *spec);
+
+/* Takes the input of each tick from a file recorded with GameRecord(), and
+ * stops the game once it runs out */
+bool GameReplay(Game *game, const char *filename);
+
+bool GameRecord(Game *game, const char *filename);
+
 bool GameHandleEvents(Game *game);
 
-bool GameUpdate(Game *game);
+/* Runs as many ticks of 1 / DEFAULT_TICK_RATE seconds as fit in elapsed_ns,
+ * and carries the remainder over to the next update */
+bool GameUpdate(Game *game, uint64_t elapsed_ns);
 
 bool GameRender(Game *game);
 
@@ -5,63 +5,84 @@
 
 #include "SDL3/SDL.h"
 
+#include "input.h"
 #include "texture.h"
 #include "vector.h"
 
 typedef struct GameObject GameObject;
 
-typedef bool (*GameObjectCallbackEvent)(GameObject *game_object,
-                                        const SDL_Event *event);
-typedef bool (*GameObjectCallbackUpdate)(GameObject *game_object);
+typedef bool (*GameObjectCallbackUpdate)(GameObject *game_object,
+                                         const InputSnapshot *input,
+                                         float dt);
+/* Objects are drawn at their position minus the camera */
 typedef bool (*GameObjectCallbackDraw)(GameObject *game_object,
                                        TextureMap *texture_map,
-                                       SDL_Renderer *renderer);
+                                       SDL_Renderer *renderer,
+                                       const Vector *camera);
 typedef void (*GameObjectCallbackClean)(GameObject *game_object,
                                         TextureMap *texture_map);
+/* Write or read state_size bytes of plain state for rewinding. The state may
+ * be unaligned and its padding must be zero. */
+typedef void (*GameObjectCallbackSave)(const GameObject *game_object,
+                                       void *state);
+typedef void (*GameObjectCallbackLoad)(GameObject *game_object,
+                                       const void *state);
 
 struct GameObject {
   Vector size;
   Vector position;
-  Vector velocity;
+  Vector velocity;   /* px/s */
+  size_t state_size; /* Bytes of saved state */
   struct {
-    GameObjectCallbackEvent event;
     GameObjectCallbackUpdate update;
     GameObjectCallbackDraw draw;
     GameObjectCallbackClean clean;
+    GameObjectCallbackSave save;
+    GameObjectCallbackLoad load;
   } callback;
 };
 
-static inline bool GameObjectEvent(GameObject *game_object,
-                                   const SDL_Event *event) {
+static inline bool GameObjectUpdate(GameObject *game_object,
+                                    const InputSnapshot *input, float dt) {
   assert(game_object != NULL);
+  assert(input != NULL);
 
-  if (!game_object->callback.event(game_object, event)) {
+  if (!game_object->callback.update(game_object, input, dt)) {
     return false;
   }
 
   return true;
 }
 
-static inline bool GameObjectUpdate(GameObject *game_object) {
+static inline bool GameObjectDraw(GameObject *game_object,
+                                  TextureMap *texture_map,
+                                  SDL_Renderer *renderer,
+                                  const Vector *camera) {
   assert(game_object != NULL);
+  assert(camera != NULL);
 
-  if (!game_object->callback.update(game_object)) {
+  if (!game_object->callback.draw(game_object, texture_map, renderer,
+                                  camera)) {
     return false;
   }
 
   return true;
 }
 
-static inline bool GameObjectDraw(GameObject *game_object,
-                                  TextureMap *texture_map,
-                                  SDL_Renderer *renderer) {
+static inline void GameObjectSave(const GameObject *game_object,
+                                  void *state) {
   assert(game_object != NULL);
+  assert(state != NULL);
 
-  if (!game_object->callback.draw(game_object, texture_map, renderer)) {
-    return false;
-  }
+  game_object->callback.save(game_object, state);
+}
 
-  return true;
+static inline void GameObjectLoad(GameObject *game_object,
+                                  const void *state) {
+  assert(game_object != NULL);
+  assert(state != NULL);
+
+  game_object->callback.load(game_object, state);
 }
 
 static inline void GameObjectDestroy(GameObject *game_object,
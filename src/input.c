@@ -0,0 +1,456 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_INPUT
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "array.h"
+#include "buffer.h"
+#include "input.h"
+#include "logger.h"
+#include "slice.h"
+#include "utils.h"
+
+#define INPUT_NAME(name, str) str,
+static const char *const ACTION_NAMES[] = {INPUT_ACTIONS(INPUT_NAME)};
+#undef INPUT_NAME
+
+static const struct {
+  SDL_Scancode scancode;
+  InputAction action;
+} DEFAULT_BINDINGS[] = {
+    {SDL_SCANCODE_A, INPUT_MOVE_LEFT},
+    {SDL_SCANCODE_D, INPUT_MOVE_RIGHT},
+    {SDL_SCANCODE_SPACE, INPUT_JUMP},
+    {SDL_SCANCODE_LSHIFT, INPUT_RUN},
+    {SDL_SCANCODE_R, INPUT_REWIND},
+};
+
+/* Ticks in a row with the same actions. Changes of the held actions at the
+ * first tick imply presses and releases, so pressed and released only hold
+ * the others, e.g. an action pressed and released within one tick, and are
+ * reported in each tick of the span. */
+typedef struct {
+  uint32_t ticks;
+  InputActions down;
+  InputActions pressed;
+  InputActions released;
+} Span;
+
+ARRAY_DEFINE(SpanArray, Span, 1)
+
+struct Input {
+  InputActions bindings[SDL_SCANCODE_COUNT]; /* Actions of each key */
+  bool keys[SDL_SCANCODE_COUNT];             /* Keys held */
+  unsigned char held[INPUT_ACTION_COUNT];    /* Keys held per action */
+  InputActions down;
+  InputActions pressed;
+  InputActions released;
+  bool replaying;
+  SpanArray replay;      /* Replayed instead of the keyboard */
+  size_t replay_span;    /* Span being replayed */
+  uint32_t replay_tick;  /* Ticks replayed of that span */
+  InputActions replayed; /* Held in the previous replayed tick */
+  FILE *record;          /* Replay file being recorded, or NULL */
+  char *record_filename;
+  Span recorded; /* Span being recorded */
+};
+
+Input *InputCreate(void) {
+  Input *const input = xcalloc(1, sizeof(Input));
+  for (size_t i = 0; i < LENGTH(DEFAULT_BINDINGS); i++) {
+    InputBind(input, DEFAULT_BINDINGS[i].scancode, DEFAULT_BINDINGS[i].action);
+  }
+  SpanArrayInit(&input->replay);
+  return input;
+}
+
+/* Write the names of a set of actions, each with a prefix */
+static int WriteActions(Input *const input, const InputActions actions,
+                        const char *const prefix,
+                        const char **const separator) {
+  int ret = 0;
+  for (InputActions rest = actions; rest != 0 && ret >= 0; rest &= rest - 1) {
+    ret = fprintf(input->record, "%s%s%s", *separator, prefix,
+                  ACTION_NAMES[__builtin_ctz(rest)]);
+    *separator = ",";
+  }
+  return ret;
+}
+
+/* Write a span as a line of a replay file */
+static void WriteSpan(Input *const input, const Span *const span) {
+  if (span->ticks == 0) {
+    return;
+  }
+
+  int ret = fprintf(input->record, "%" PRIu32, span->ticks);
+  const char *separator = " ";
+  if (ret >= 0) {
+    ret = WriteActions(input, span->down, "", &separator);
+  }
+  if (ret >= 0) {
+    ret = WriteActions(input, span->pressed, "+", &separator);
+  }
+  if (ret >= 0) {
+    ret = WriteActions(input, span->released, "-", &separator);
+  }
+  if (ret < 0 || fputc('\n', input->record) == EOF) {
+    LOG_ERROR("Failed to write '%s': %s", input->record_filename,
+              strerror(errno));
+  }
+}
+
+static void StopRecording(Input *const input) {
+  if (input->record == NULL) {
+    return;
+  }
+
+  WriteSpan(input, &input->recorded);
+  if (fclose(input->record) != 0) {
+    LOG_ERROR("Failed to close '%s': %s", input->record_filename,
+              strerror(errno));
+  }
+  input->record = NULL;
+  xfree(input->record_filename);
+  input->record_filename = NULL;
+}
+
+void InputDestroy(Input *const input) {
+  if (input == NULL) {
+    return;
+  }
+  StopRecording(input);
+  SpanArrayDestroy(&input->replay);
+  xfree(input);
+}
+
+/* Recount held keys after the bindings change, so that an action bound to a
+ * held key is down, and one whose keys were all unbound is released */
+static void Recount(Input *const input) {
+  memset(input->held, 0, sizeof(input->held));
+  InputActions down = 0;
+  for (size_t i = 0; i < SDL_SCANCODE_COUNT; i++) {
+    if (!input->keys[i]) {
+      continue;
+    }
+    for (InputActions actions = input->bindings[i]; actions != 0;
+         actions &= actions - 1) {
+      input->held[__builtin_ctz(actions)] += 1;
+    }
+    down |= input->bindings[i];
+  }
+  input->pressed |= down & ~input->down;
+  input->released |= input->down & ~down;
+  input->down = down;
+}
+
+void InputBind(Input *const input, const SDL_Scancode scancode,
+               const InputAction action) {
+  assert(input != NULL);
+  assert(scancode > SDL_SCANCODE_UNKNOWN && scancode < SDL_SCANCODE_COUNT);
+  assert(action < INPUT_ACTION_COUNT);
+
+  input->bindings[scancode] |= INPUT_BIT(action);
+  Recount(input);
+}
+
+void InputUnbind(Input *const input, const InputAction action) {
+  assert(input != NULL);
+  assert(action < INPUT_ACTION_COUNT);
+
+  for (size_t i = 0; i < SDL_SCANCODE_COUNT; i++) {
+    input->bindings[i] &= ~INPUT_BIT(action);
+  }
+  Recount(input);
+}
+
+static bool ParseAction(const Slice name, InputAction *const action) {
+  for (unsigned i = 0; i < INPUT_ACTION_COUNT; i++) {
+    if (SliceEqualString(name, ACTION_NAMES[i])) {
+      *action = (InputAction)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseKey(const Slice name, SDL_Scancode *const scancode) {
+  char str[64];
+  if (name.length >= sizeof(str)) {
+    return false;
+  }
+  memcpy(str, name.data, name.length);
+  str[name.length] = '\0';
+
+  *scancode = SDL_GetScancodeFromName(str);
+  return *scancode != SDL_SCANCODE_UNKNOWN;
+}
+
+bool InputSetBindings(Input *const input, const char *const spec) {
+  assert(input != NULL);
+  assert(spec != NULL);
+
+  /* Apply nothing unless the whole specification is valid */
+  InputActions bindings[SDL_SCANCODE_COUNT];
+  memcpy(bindings, input->bindings, sizeof(bindings));
+  InputActions replaced = 0;
+
+  Slice rest = SliceFromString(spec);
+  Slice item;
+  while (SliceSplit(&rest, ',', &item)) {
+    item = SliceTrim(item);
+    size_t equals;
+    if (!SliceFind(item, '=', &equals)) {
+      LOG_ERROR("Bad binding '" SLICE_FMT "': Expected ACTION=KEY",
+                SLICE_ARG(item));
+      return false;
+    }
+
+    const Slice action_name = SliceTrim(SliceSub(item, 0, equals));
+    InputAction action;
+    if (!ParseAction(action_name, &action)) {
+      LOG_ERROR("Bad input action '" SLICE_FMT "'", SLICE_ARG(action_name));
+      return false;
+    }
+
+    const Slice key_name = SliceTrim(SliceSub(item, equals + 1, item.length));
+    SDL_Scancode scancode;
+    if (!ParseKey(key_name, &scancode)) {
+      LOG_ERROR("Bad key name '" SLICE_FMT "'", SLICE_ARG(key_name));
+      return false;
+    }
+
+    /* The first binding of an action replaces its defaults */
+    if ((replaced & INPUT_BIT(action)) == 0) {
+      for (size_t i = 0; i < SDL_SCANCODE_COUNT; i++) {
+        bindings[i] &= ~INPUT_BIT(action);
+      }
+      replaced |= INPUT_BIT(action);
+    }
+    bindings[scancode] |= INPUT_BIT(action);
+  }
+
+  memcpy(input->bindings, bindings, sizeof(bindings));
+  Recount(input);
+  return true;
+}
+
+static void SetKey(Input *const input, const SDL_Scancode scancode,
+                   const bool down) {
+  if (scancode <= SDL_SCANCODE_UNKNOWN || scancode >= SDL_SCANCODE_COUNT ||
+      input->keys[scancode] == down) {
+    return;
+  }
+  input->keys[scancode] = down;
+
+  for (InputActions actions = input->bindings[scancode]; actions != 0;
+       actions &= actions - 1) {
+    const unsigned action = (unsigned)__builtin_ctz(actions);
+    const InputActions bit = INPUT_BIT(action);
+    if (down) {
+      if (input->held[action]++ == 0) {
+        input->down |= bit;
+        input->pressed |= bit;
+      }
+    } else {
+      assert(input->held[action] > 0);
+      if (--input->held[action] == 0) {
+        input->down &= ~bit;
+        input->released |= bit;
+      }
+    }
+  }
+}
+
+void InputHandleEvent(Input *const input, const SDL_Event *const event) {
+  assert(input != NULL);
+  assert(event != NULL);
+
+  switch (event->type) {
+  case SDL_EVENT_KEY_DOWN:
+  case SDL_EVENT_KEY_UP:
+    /* Key repeats do not change the state of the key */
+    if (!event->key.repeat) {
+      SetKey(input, event->key.scancode, event->type == SDL_EVENT_KEY_DOWN);
+    }
+    break;
+
+  case SDL_EVENT_WINDOW_FOCUS_LOST:
+    /* Keys released in another window would otherwise stay held */
+    memset(input->keys, 0, sizeof(input->keys));
+    memset(input->held, 0, sizeof(input->held));
+    input->released |= input->down;
+    input->down = 0;
+    break;
+
+  default:
+    break;
+  }
+}
+
+bool InputReplay(Input *const input, const char *const filename) {
+  assert(input != NULL);
+  assert(filename != NULL);
+
+  Buffer *const buffer = BufferCreate();
+  if (!BufferReadFile(buffer, filename)) {
+    BufferDestroy(buffer);
+    return false;
+  }
+
+  SpanArray spans;
+  SpanArrayInit(&spans);
+  Slice rest = BufferSlice(buffer);
+  Slice line;
+  size_t number = 0;
+  bool success = true;
+  while (success && SliceNextLine(&rest, &line)) {
+    number += 1;
+    line = SliceTrim(line);
+    if (line.length == 0 || line.data[0] == '#') {
+      continue;
+    }
+
+    /* TICKS [[+|-]ACTION[,[+|-]ACTION]...] */
+    Slice ticks = line, actions = {0};
+    size_t space;
+    if (SliceFind(line, ' ', &space)) {
+      ticks = SliceSub(line, 0, space);
+      actions = SliceTrim(SliceSub(line, space + 1, line.length));
+    }
+
+    long value;
+    if (!SliceParseLong(ticks, &value) || value <= 0 || value > UINT32_MAX) {
+      LOG_ERROR("Bad replay '%s' on line %zu: Expected number of ticks",
+                filename, number);
+      success = false;
+      break;
+    }
+    Span span = {.ticks = (uint32_t)value};
+
+    Slice item;
+    while (SliceSplit(&actions, ',', &item)) {
+      item = SliceTrim(item);
+      InputActions *set = &span.down;
+      if (item.length > 0 && (item.data[0] == '+' || item.data[0] == '-')) {
+        set = (item.data[0] == '+') ? &span.pressed : &span.released;
+        item = SliceSub(item, 1, item.length);
+      }
+      InputAction action;
+      if (!ParseAction(item, &action)) {
+        LOG_ERROR("Bad replay '%s' on line %zu: Bad input action '" SLICE_FMT
+                  "'",
+                  filename, number, SLICE_ARG(item));
+        success = false;
+        break;
+      }
+      *set |= INPUT_BIT(action);
+    }
+    SpanArrayAppend(&spans, span);
+  }
+  BufferDestroy(buffer);
+
+  if (!success) {
+    SpanArrayDestroy(&spans);
+    return false;
+  }
+
+  SpanArrayDestroy(&input->replay);
+  input->replay = spans;
+  input->replay_span = 0;
+  input->replay_tick = 0;
+  input->replayed = 0;
+  input->replaying = true;
+  return true;
+}
+
+bool InputReplayFinished(const Input *const input) {
+  assert(input != NULL);
+  return input->replaying &&
+         input->replay_span == SpanArrayLength(&input->replay);
+}
+
+bool InputRecord(Input *const input, const char *const filename) {
+  assert(input != NULL);
+  assert(filename != NULL);
+
+  FILE *const file = fopen(filename, "w");
+  if (file == NULL) {
+    LOG_ERROR("Failed to open '%s': %s", filename, strerror(errno));
+    return false;
+  }
+
+  StopRecording(input);
+  input->record = file;
+  input->record_filename = xstrdup(filename);
+  input->recorded = (Span){0};
+  return true;
+}
+
+/* Take the actions of the next tick of the replay, or none once finished */
+static void ReplayTick(Input *const input, InputSnapshot *const snapshot) {
+  *snapshot = (InputSnapshot){0};
+  if (input->replay_span < SpanArrayLength(&input->replay)) {
+    const Span *const span = SpanArrayAt(&input->replay, input->replay_span);
+    snapshot->down = span->down;
+    snapshot->pressed = span->pressed;
+    snapshot->released = span->released;
+    if (++input->replay_tick == span->ticks) {
+      input->replay_span += 1;
+      input->replay_tick = 0;
+    }
+  }
+
+  snapshot->pressed |= snapshot->down & ~input->replayed;
+  snapshot->released |= input->replayed & ~snapshot->down;
+  input->replayed = snapshot->down;
+}
+
+/* Add a tick to the span being recorded, or write that span and start
+ * another if the actions of the tick differ */
+static void RecordTick(Input *const input,
+                       const InputSnapshot *const snapshot) {
+  Span *const span = &input->recorded;
+  if (span->ticks > 0 && snapshot->down == span->down &&
+      snapshot->pressed == span->pressed &&
+      snapshot->released == span->released) {
+    span->ticks += 1;
+    return;
+  }
+
+  /* Leave out the presses and releases that replaying implies */
+  const InputActions before = span->down;
+  WriteSpan(input, span);
+  *span = (Span){
+      .ticks = 1,
+      .down = snapshot->down,
+      .pressed = snapshot->pressed & ~(snapshot->down & ~before),
+      .released = snapshot->released & ~(before & ~snapshot->down),
+  };
+}
+
+void InputCapture(Input *const input, InputSnapshot *const snapshot) {
+  assert(input != NULL);
+  assert(snapshot != NULL);
+
+  if (input->replaying) {
+    ReplayTick(input, snapshot);
+  } else {
+    snapshot->down = input->down;
+    snapshot->pressed = input->pressed;
+    snapshot->released = input->released;
+  }
+
+  input->pressed = 0;
+  input->released = 0;
+
+  if (input->record != NULL) {
+    RecordTick(input, snapshot);
+  }
+}
@@ -0,0 +1,171 @@
+#ifndef __ETERNO_INPUT_H__
+#define __ETERNO_INPUT_H__
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Maps keyboard events to game actions.
+ * @note Events update the input state as they arrive, and InputCapture()
+ *       turns it into a small snapshot once per tick. Game objects only read
+ *       the snapshot, so handling input costs O(events + objects) rather
+ *       than dispatching each event to each object.
+ */
+typedef struct Input Input;
+
+/* To add an action, add a line below and a default binding in input.c */
+#define INPUT_ACTIONS(X)                                                       \
+  X(MOVE_LEFT, "left")                                                         \
+  X(MOVE_RIGHT, "right")                                                       \
+  X(JUMP, "jump")                                                              \
+  X(RUN, "run")                                                                \
+  X(REWIND, "rewind")
+
+#define INPUT_ENUM(name, str) INPUT_##name,
+typedef enum InputAction {
+  INPUT_ACTIONS(INPUT_ENUM) INPUT_ACTION_COUNT
+} InputAction;
+#undef INPUT_ENUM
+
+/* Set of actions, one bit per action */
+typedef uint32_t InputActions;
+#define INPUT_BIT(action) ((InputActions)1 << (action))
+
+/**
+ * @brief Actions during one tick.
+ * @note Plain value without pointers, so that it can be copied and recorded.
+ */
+typedef struct {
+  InputActions down;     /* Held at the end of the tick */
+  InputActions pressed;  /* Went down during the tick */
+  InputActions released; /* Went up during the tick */
+} InputSnapshot;
+
+/**
+ * @brief Create input state with the default bindings.
+ * @return The input state.
+ * @note Caller takes ownership of returned value.
+ */
+Input *InputCreate(void);
+
+/**
+ * @brief Destroy input state.
+ * @param input The input state.
+ * @note If input is NULL, no operation is performed.
+ */
+void InputDestroy(Input *input);
+
+/**
+ * @brief Bind a key to an action, in addition to its existing keys.
+ * @param input The input state.
+ * @param scancode The key.
+ * @param action The action.
+ */
+void InputBind(Input *input, SDL_Scancode scancode, InputAction action);
+
+/**
+ * @brief Remove all key bindings of an action.
+ * @param input The input state.
+ * @param action The action.
+ */
+void InputUnbind(Input *input, InputAction action);
+
+/**
+ * @brief Replace key bindings from a specification.
+ * @param input The input state.
+ * @param spec Comma-separated ACTION=KEY pairs, e.g. "jump=w,left=left".
+ *             Key names are those of SDL_GetScancodeFromName(). Actions
+ *             named in the spec lose their previous bindings.
+ * @return False if the specification is invalid, in which case the bindings
+ *         are unchanged.
+ */
+bool InputSetBindings(Input *input, const char *spec);
+
+/**
+ * @brief Update the input state from an event.
+ * @param input The input state.
+ * @param event The event. Events other than keyboard and focus events are
+ *              ignored.
+ */
+void InputHandleEvent(Input *input, const SDL_Event *event);
+
+/**
+ * @brief Take the actions of the current tick and start the next tick.
+ * @param input The input state.
+ * @param snapshot Filled with the actions.
+ * @note Call once per tick after handling the events of the tick. Presses and
+ *       releases are reported once, even if several ticks run per frame.
+ */
+void InputCapture(Input *input, InputSnapshot *snapshot);
+
+/**
+ * @brief Replay actions from a file instead of the keyboard.
+ * @param input The input state.
+ * @param filename The replay. Each line holds a number of ticks, a space
+ *                 and the actions held during those ticks, comma-separated,
+ *                 e.g. "120 right,run". Actions prefixed with '+' or '-'
+ *                 are pressed or released in each of those ticks, besides
+ *                 those implied by the held actions changing, e.g.
+ *                 "1 right,+jump,-jump" taps jump. Lines starting with '#'
+ *                 are comments.
+ * @return False if the file cannot be read or is malformed, in which case
+ *         the input state is unchanged.
+ * @note Each call to InputCapture() takes one tick of the replay, and no
+ *       actions once the replay is finished.
+ */
+bool InputReplay(Input *input, const char *filename);
+
+/**
+ * @brief Check whether all ticks of a replay were taken.
+ * @param input The input state.
+ * @return True if replaying and finished.
+ */
+bool InputReplayFinished(const Input *input);
+
+/**
+ * @brief Record the actions of each tick to a file for InputReplay().
+ * @param input The input state.
+ * @param filename The replay to write.
+ * @return False if the file cannot be opened.
+ * @note Ticks with the same actions are written as one line once the
+ *       actions change, and the last line when the input state is destroyed.
+ *       Replays start with no actions held, so start recording before the
+ *       first tick.
+ */
+bool InputRecord(Input *input, const char *filename);
+
+/**
+ * @brief Check whether an action is held.
+ * @param snapshot The actions of a tick.
+ * @param action The action.
+ * @return True if held.
+ */
+static inline bool InputIsDown(const InputSnapshot *const snapshot,
+                               const InputAction action) {
+  return (snapshot->down & INPUT_BIT(action)) != 0;
+}
+
+/**
+ * @brief Check whether an action was pressed during the tick.
+ * @param snapshot The actions of a tick.
+ * @param action The action.
+ * @return True if pressed, even if released again in the same tick.
+ */
+static inline bool InputWasPressed(const InputSnapshot *const snapshot,
+                                   const InputAction action) {
+  return (snapshot->pressed & INPUT_BIT(action)) != 0;
+}
+
+/**
+ * @brief Check whether an action was released during the tick.
+ * @param snapshot The actions of a tick.
+ * @param action The action.
+ * @return True if released.
+ */
+static inline bool InputWasReleased(const InputSnapshot *const snapshot,
+                                    const InputAction action) {
+  return (snapshot->released & INPUT_BIT(action)) != 0;
+}
+
+#endif // __ETERNO_INPUT_H__
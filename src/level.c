@@ -0,0 +1,916 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_LEVEL
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "aio.h"
+#include "array.h"
+#include "buffer.h"
+#include "collision.h"
+#include "compress.h"
+#include "level.h"
+#include "logger.h"
+#include "metrics.h"
+#include "utils.h"
+
+/* Level files start with a header, followed by an index entry per chunk in
+ * row-major order and the chunks themselves. Integers are little-endian.
+ *
+ * Header:
+ *   0  magic "ETLV"
+ *   4  u16 version
+ *   6  u16 tile size in px
+ *   8  u16 chunk size in tiles
+ *  10  u16 number of tile layers
+ *  12  u32 chunks per row
+ *  16  u32 chunks per column
+ *  20  u32 level width in tiles
+ *  24  u32 level height in tiles
+ *  28  i32 player start x in px
+ *  32  i32 player start y in px
+ *  36  reserved, zero
+ *
+ * Index entry:
+ *   0  u64 offset of the chunk in the file
+ *   8  u32 size of the chunk in the file or 0 if it is empty
+ *  12  u32 size of the chunk when decompressed
+ *
+ * Chunks are compressed frames, see compress.h, of the collision tiles as u8,
+ * the tiles of each layer as u16, a u16 number of spawns and the spawns as
+ * u16 type, u16 reserved, i32 x and i32 y. Tiles outside the level are 0. */
+#define LEVEL_MAGIC "ETLV"
+#define LEVEL_VERSION 1
+#define LEVEL_HEADER_SIZE 48
+#define LEVEL_INDEX_ENTRY_SIZE 16
+#define LEVEL_SPAWN_SIZE 12
+
+/* Chunks the point or area is in or next to are waited for */
+#define REQUIRED_RADIUS 1
+
+/* Upper bound on cells of the collision grid, which covers the whole level */
+#define MAX_COLLISION_CELLS (1 << 18)
+
+/* Maximum number of completions harvested at a time */
+#define MAX_COMPLETIONS 16
+
+typedef enum {
+  CHUNK_EMPTY, /* Not in the file */
+  CHUNK_UNLOADED,
+  CHUNK_LOADING,
+  CHUNK_RESIDENT,
+  CHUNK_FAILED, /* Corrupt, not retried */
+} ChunkState;
+
+/* Memory for reading and decoding one chunk. Blocks are sized for the
+ * largest chunk of the level and taken from a pool when a chunk is
+ * requested, so that streaming allocates nothing. */
+typedef struct ChunkBlock {
+  struct ChunkBlock *next; /* Next free block */
+  Buffer *read;            /* Compressed chunk */
+  LevelChunk *chunk;       /* Decoded chunk, block_bytes long */
+  size_t slot;             /* Slot of the chunk while taken */
+} ChunkBlock;
+
+typedef struct {
+  uint64_t offset;
+  uint32_t size;
+  uint32_t raw_size;
+  uint64_t request; /* Read in flight or 0 if the chunk is not wanted */
+  ChunkState state;
+  ChunkBlock *block; /* While loading or resident */
+  size_t bytes;
+} ChunkSlot;
+
+typedef LevelChunk *LevelChunkPtr;
+ARRAY_DEFINE(ChunkArray, LevelChunkPtr, 16)
+ARRAY_DEFINE(SlotArray, uint32_t, 16)
+typedef ChunkBlock *ChunkBlockPtr;
+ARRAY_DEFINE(BlockArray, ChunkBlockPtr, 1)
+
+struct Level {
+  char *filename; /* Read by the aio context */
+  AioContext *aio;
+  CollisionWorld *world;
+  Buffer *raw; /* Chunk being decoded, reused */
+  ChunkSlot *slots;
+  ChunkArray resident;
+  SlotArray loading;       /* Slots with a read in flight */
+  BlockArray blocks;       /* All blocks, for freeing them */
+  ChunkBlock *free_blocks; /* Blocks not taken by a chunk or read */
+  size_t block_bytes;      /* Size of the largest decoded chunk */
+  size_t read_bytes;       /* Size of the largest compressed chunk */
+  uint32_t chunks_x, chunks_y;
+  uint32_t columns, rows;
+  uint16_t tile_size;
+  uint16_t chunk_tiles;
+  uint16_t n_layers;
+  Vector spawn;
+  size_t memory_used;
+};
+
+static void PutU16(Buffer *const out, const uint16_t value) {
+  BufferAppend(out, (char)(value & 0xff));
+  BufferAppend(out, (char)(value >> 8));
+}
+
+static void PutU32(Buffer *const out, const uint32_t value) {
+  PutU16(out, (uint16_t)(value & 0xffff));
+  PutU16(out, (uint16_t)(value >> 16));
+}
+
+static void PutU64(Buffer *const out, const uint64_t value) {
+  PutU32(out, (uint32_t)(value & 0xffffffff));
+  PutU32(out, (uint32_t)(value >> 32));
+}
+
+static uint16_t GetU16(const unsigned char *const src) {
+  return (uint16_t)(src[0] | (src[1] << 8));
+}
+
+static uint32_t GetU32(const unsigned char *const src) {
+  return (uint32_t)GetU16(src) | ((uint32_t)GetU16(src + 2) << 16);
+}
+
+static uint64_t GetU64(const unsigned char *const src) {
+  return (uint64_t)GetU32(src) | ((uint64_t)GetU32(src + 4) << 32);
+}
+
+static size_t ChunkArea(const uint16_t chunk_tiles) {
+  return (size_t)chunk_tiles * chunk_tiles;
+}
+
+/* Size of a decoded chunk, which is one block of memory */
+static size_t ChunkBytes(const Level *const level, const size_t n_spawns) {
+  const size_t area = ChunkArea(level->chunk_tiles);
+  return sizeof(LevelChunk) + (n_spawns * sizeof(LevelSpawn)) +
+         (area * level->n_layers * sizeof(uint16_t)) + area;
+}
+
+/* Tile of a chunk at a position relative to the chunk, or 0 if the position
+ * is outside the level */
+static size_t LevelTile(const LevelDesc *const desc, const size_t chunk_column,
+                        const size_t chunk_row, const size_t column,
+                        const size_t row, bool *const inside) {
+  const size_t x = (chunk_column * desc->chunk_tiles) + column;
+  const size_t y = (chunk_row * desc->chunk_tiles) + row;
+  *inside = (x < desc->columns && y < desc->rows);
+  return *inside ? (y * desc->columns) + x : 0;
+}
+
+/* Append the uncompressed chunk, and return whether it has any content */
+static bool PackChunk(Buffer *const raw, const LevelDesc *const desc,
+                      const size_t chunk_column, const size_t chunk_row) {
+  const size_t n_tiles = desc->columns * desc->rows;
+  bool inside;
+  bool used = false;
+
+  for (size_t row = 0; row < desc->chunk_tiles; row++) {
+    for (size_t column = 0; column < desc->chunk_tiles; column++) {
+      const size_t tile =
+          LevelTile(desc, chunk_column, chunk_row, column, row, &inside);
+      const uint8_t value = inside ? desc->collision[tile] : 0;
+      BufferAppend(raw, (char)value);
+      used |= (value != 0);
+    }
+  }
+
+  for (size_t layer = 0; layer < desc->n_layers; layer++) {
+    for (size_t row = 0; row < desc->chunk_tiles; row++) {
+      for (size_t column = 0; column < desc->chunk_tiles; column++) {
+        const size_t tile =
+            LevelTile(desc, chunk_column, chunk_row, column, row, &inside);
+        const uint16_t value =
+            inside ? desc->layers[(layer * n_tiles) + tile] : 0;
+        PutU16(raw, value);
+        used |= (value != 0);
+      }
+    }
+  }
+
+  /* Spawns belong to the chunk containing them */
+  const int64_t chunk_size = (int64_t)desc->tile_size * desc->chunk_tiles;
+  const int64_t left = (int64_t)chunk_column * chunk_size;
+  const int64_t top = (int64_t)chunk_row * chunk_size;
+  size_t n_spawns = 0;
+  for (size_t i = 0; i < desc->n_spawns; i++) {
+    const LevelSpawn *const spawn = &desc->spawns[i];
+    n_spawns += (spawn->x >= left && spawn->x < left + chunk_size &&
+                 spawn->y >= top && spawn->y < top + chunk_size);
+  }
+  assert(n_spawns <= UINT16_MAX);
+  PutU16(raw, (uint16_t)n_spawns);
+  for (size_t i = 0; i < desc->n_spawns; i++) {
+    const LevelSpawn *const spawn = &desc->spawns[i];
+    if (spawn->x >= left && spawn->x < left + chunk_size && spawn->y >= top &&
+        spawn->y < top + chunk_size) {
+      PutU16(raw, spawn->type);
+      PutU16(raw, 0);
+      PutU32(raw, (uint32_t)spawn->x);
+      PutU32(raw, (uint32_t)spawn->y);
+    }
+  }
+
+  return used || n_spawns > 0;
+}
+
+void LevelPack(Buffer *const out, const LevelDesc *const desc) {
+  assert(out != NULL);
+  assert(desc != NULL);
+  assert(desc->tile_size > 0);
+  assert(desc->chunk_tiles > 0);
+  assert(desc->columns > 0 && desc->rows > 0);
+  assert(desc->collision != NULL);
+  assert(desc->layers != NULL || desc->n_layers == 0);
+  assert(desc->spawns != NULL || desc->n_spawns == 0);
+
+  const uint32_t chunks_x =
+      (desc->columns + desc->chunk_tiles - 1) / desc->chunk_tiles;
+  const uint32_t chunks_y =
+      (desc->rows + desc->chunk_tiles - 1) / desc->chunk_tiles;
+  const size_t n_chunks = (size_t)chunks_x * chunks_y;
+
+  /* Compress the chunks first, so that their offsets are known */
+  Buffer *const raw = BufferCreate();
+  Buffer *const chunks = BufferCreate();
+  Buffer *const index = BufferCreate();
+  uint64_t offset = LEVEL_HEADER_SIZE + (n_chunks * LEVEL_INDEX_ENTRY_SIZE);
+  for (uint32_t chunk_row = 0; chunk_row < chunks_y; chunk_row++) {
+    for (uint32_t chunk_column = 0; chunk_column < chunks_x; chunk_column++) {
+      BufferTruncate(raw, 0);
+      if (!PackChunk(raw, desc, chunk_column, chunk_row)) {
+        PutU64(index, 0);
+        PutU32(index, 0);
+        PutU32(index, 0);
+        continue;
+      }
+
+      const size_t before = BufferLength(chunks);
+      CompressFrame(chunks, BufferData(raw), BufferLength(raw));
+      const size_t size = BufferLength(chunks) - before;
+      assert(size <= UINT32_MAX && BufferLength(raw) <= UINT32_MAX);
+
+      PutU64(index, offset);
+      PutU32(index, (uint32_t)size);
+      PutU32(index, (uint32_t)BufferLength(raw));
+      offset += size;
+    }
+  }
+
+  BufferPrint(out, LEVEL_MAGIC);
+  PutU16(out, LEVEL_VERSION);
+  PutU16(out, desc->tile_size);
+  PutU16(out, desc->chunk_tiles);
+  PutU16(out, desc->n_layers);
+  PutU32(out, chunks_x);
+  PutU32(out, chunks_y);
+  PutU32(out, desc->columns);
+  PutU32(out, desc->rows);
+  PutU32(out, (uint32_t)desc->spawn_x);
+  PutU32(out, (uint32_t)desc->spawn_y);
+  for (size_t i = 36; i < LEVEL_HEADER_SIZE; i++) {
+    BufferAppend(out, '\0');
+  }
+  BufferAppendSlice(out, BufferSlice(index));
+  BufferAppendSlice(out, BufferSlice(chunks));
+
+  BufferDestroy(raw);
+  BufferDestroy(chunks);
+  BufferDestroy(index);
+}
+
+/* Read exactly size bytes, or fail */
+static bool ReadExact(FILE *const file, const char *const filename,
+                      void *const dst, const size_t size) {
+  if (fread(dst, 1, size, file) != size) {
+    LOG_ERROR("Failed to read level '%s': %s", filename,
+              ferror(file) ? strerror(errno) : "Unexpected end of file");
+    return false;
+  }
+  return true;
+}
+
+/* Read the header and index. The level is destroyed by the caller on error. */
+static bool ReadIndex(Level *const level, FILE *const file) {
+  unsigned char header[LEVEL_HEADER_SIZE];
+  if (!ReadExact(file, level->filename, header, sizeof(header))) {
+    return false;
+  }
+
+  if (memcmp(header, LEVEL_MAGIC, 4) != 0) {
+    LOG_ERROR("Bad level '%s': Not a level file", level->filename);
+    return false;
+  }
+  const uint16_t version = GetU16(header + 4);
+  if (version != LEVEL_VERSION) {
+    LOG_ERROR("Bad level '%s': Unsupported version %u", level->filename,
+              (unsigned)version);
+    return false;
+  }
+
+  level->tile_size = GetU16(header + 6);
+  level->chunk_tiles = GetU16(header + 8);
+  level->n_layers = GetU16(header + 10);
+  level->chunks_x = GetU32(header + 12);
+  level->chunks_y = GetU32(header + 16);
+  level->columns = GetU32(header + 20);
+  level->rows = GetU32(header + 24);
+  level->spawn.x = (float)(int32_t)GetU32(header + 28);
+  level->spawn.y = (float)(int32_t)GetU32(header + 32);
+
+  if (level->tile_size == 0 || level->chunk_tiles == 0 ||
+      level->columns == 0 || level->rows == 0 ||
+      level->chunks_x !=
+          (level->columns + level->chunk_tiles - 1) / level->chunk_tiles ||
+      level->chunks_y !=
+          (level->rows + level->chunk_tiles - 1) / level->chunk_tiles) {
+    LOG_ERROR("Bad level '%s': Inconsistent size", level->filename);
+    return false;
+  }
+
+  const size_t n_chunks = (size_t)level->chunks_x * level->chunks_y;
+  unsigned char *const index = xmalloc(n_chunks * LEVEL_INDEX_ENTRY_SIZE);
+  if (!ReadExact(file, level->filename, index,
+                 n_chunks * LEVEL_INDEX_ENTRY_SIZE)) {
+    xfree(index);
+    return false;
+  }
+
+  level->slots = xcalloc(n_chunks, sizeof(ChunkSlot));
+  for (size_t i = 0; i < n_chunks; i++) {
+    const unsigned char *const entry = index + (i * LEVEL_INDEX_ENTRY_SIZE);
+    ChunkSlot *const slot = &level->slots[i];
+    slot->offset = GetU64(entry);
+    slot->size = GetU32(entry + 8);
+    slot->raw_size = GetU32(entry + 12);
+    slot->state = (slot->size == 0) ? CHUNK_EMPTY : CHUNK_UNLOADED;
+  }
+  xfree(index);
+  return true;
+}
+
+static ChunkBlock *BlockCreate(Level *const level) {
+  ChunkBlock *const block = xmalloc(sizeof(ChunkBlock));
+  block->next = NULL;
+  block->read = BufferCreate();
+  BufferReserve(block->read, level->read_bytes);
+  block->chunk = xmalloc(level->block_bytes);
+  BlockArrayAppend(&level->blocks, block);
+  return block;
+}
+
+static void BlockRelease(Level *const level, ChunkBlock *const block) {
+  block->next = level->free_blocks;
+  level->free_blocks = block;
+}
+
+/* Make room for everything that grows with the chunks in memory, so that
+ * streaming allocates nothing. Pool blocks for the memory budget, but at
+ * least for the load radius and the chunks around the point and area. */
+static void ReservePool(Level *const level, const float cell_size) {
+  const size_t n_chunks = (size_t)level->chunks_x * level->chunks_y;
+  size_t n_stored = 0;
+  size_t raw_bytes = 0;
+  for (size_t i = 0; i < n_chunks; i++) {
+    const ChunkSlot *const slot = &level->slots[i];
+    if (slot->state != CHUNK_EMPTY) {
+      n_stored += 1;
+      level->read_bytes = MAX(level->read_bytes, (size_t)slot->size);
+      raw_bytes = MAX(raw_bytes, (size_t)slot->raw_size);
+    }
+  }
+
+  /* Decoding checks that the spawns fill the rest of the chunk */
+  const size_t area = ChunkArea(level->chunk_tiles);
+  const size_t tiles_size = area * (1 + (2 * (size_t)level->n_layers));
+  const size_t max_spawns = (raw_bytes > tiles_size + 2)
+                                ? (raw_bytes - tiles_size - 2) /
+                                      LEVEL_SPAWN_SIZE
+                                : 0;
+  level->block_bytes = ChunkBytes(level, max_spawns);
+
+  const size_t load_side = (2 * DEFAULT_LEVEL_LOAD_RADIUS) + 1;
+  const size_t required_side = (2 * REQUIRED_RADIUS) + 2;
+  const size_t min_blocks =
+      (load_side * load_side) + (2 * required_side * required_side);
+  const size_t block_cost = level->block_bytes + level->read_bytes;
+  const size_t n_blocks = MIN(
+      n_stored, MAX(DEFAULT_LEVEL_MEMORY_BUDGET / block_cost, min_blocks));
+  for (size_t i = 0; i < n_blocks; i++) {
+    BlockRelease(level, BlockCreate(level));
+  }
+
+  ChunkArrayReserve(&level->resident, n_blocks);
+  SlotArrayReserve(&level->loading, n_blocks);
+  AioReserve(level->aio, n_blocks);
+  BufferReserve(level->raw, raw_bytes);
+
+  /* Runs of solid tiles are separate solids at most every other tile, and
+   * at every tile where chunks are small. Cells also hold the solids that
+   * merely touch them. */
+  const size_t cell_tiles = (size_t)(cell_size / level->tile_size) + 2;
+  const size_t runs = MIN(cell_tiles, (cell_tiles / 2) + 1 +
+                                          (cell_tiles / level->chunk_tiles) +
+                                          1);
+  CollisionWorldReserve(level->world,
+                        n_blocks * level->chunk_tiles *
+                            ((level->chunk_tiles + 1) / 2),
+                        cell_tiles * runs);
+}
+
+Level *LevelOpen(const char *const filename) {
+  assert(filename != NULL);
+
+  LOG_DEBUG("Opening level '%s'", filename);
+  FILE *const file = fopen(filename, "rb");
+  if (file == NULL) {
+    LOG_ERROR("Failed to open level '%s': %s", filename, strerror(errno));
+    return NULL;
+  }
+
+  Level *const level = xcalloc(1, sizeof(Level));
+  level->filename = xstrdup(filename);
+  ChunkArrayInit(&level->resident);
+  SlotArrayInit(&level->loading);
+  BlockArrayInit(&level->blocks);
+  const bool success = ReadIndex(level, file);
+  fclose(file);
+  if (!success) {
+    LevelClose(level);
+    return NULL;
+  }
+
+  /* Grow the cells of huge levels, rather than the grid */
+  const float width = (float)level->columns * level->tile_size;
+  const float height = (float)level->rows * level->tile_size;
+  float cell_size = DEFAULT_COLLISION_CELL_SIZE;
+  while (SDL_ceilf(width / cell_size) * SDL_ceilf(height / cell_size) >
+         (float)MAX_COLLISION_CELLS) {
+    cell_size *= 2.0f;
+  }
+  level->world = CollisionWorldCreate(width, height, cell_size);
+
+  level->aio = AioCreate(0, AIO_BACKEND_AUTO);
+  level->raw = BufferCreate();
+  ReservePool(level, cell_size);
+
+  LOG_DEBUG("Opened level '%s': %" PRIu32 "x%" PRIu32 " tiles in %" PRIu32
+            "x%" PRIu32 " chunks",
+            filename, level->columns, level->rows, level->chunks_x,
+            level->chunks_y);
+  return level;
+}
+
+static size_t SlotIndex(const Level *const level, const int64_t column,
+                        const int64_t row) {
+  assert(column >= 0 && column < level->chunks_x);
+  assert(row >= 0 && row < level->chunks_y);
+  return ((size_t)row * level->chunks_x) + (size_t)column;
+}
+
+static void UnloadChunk(Level *const level, LevelChunk *const chunk) {
+  ChunkSlot *const slot =
+      &level->slots[SlotIndex(level, chunk->column, chunk->row)];
+  assert(slot->state == CHUNK_RESIDENT && slot->block->chunk == chunk);
+
+  const float chunk_size = (float)level->tile_size * level->chunk_tiles;
+  const CollisionBox area = {
+      .position = {.x = (float)chunk->column * chunk_size,
+                   .y = (float)chunk->row * chunk_size},
+      .size = {.width = chunk_size, .height = chunk_size},
+  };
+  CollisionWorldRemoveSolids(level->world, &area);
+
+  for (size_t i = 0; i < ChunkArrayLength(&level->resident); i++) {
+    if (*ChunkArrayAt(&level->resident, i) == chunk) {
+      ChunkArraySwapRemove(&level->resident, i);
+      break;
+    }
+  }
+
+  level->memory_used -= slot->bytes;
+  BlockRelease(level, slot->block);
+  slot->block = NULL;
+  slot->bytes = 0;
+  slot->state = CHUNK_UNLOADED;
+}
+
+void LevelClose(Level *const level) {
+  if (level == NULL) {
+    return;
+  }
+
+  /* Waits for reads in flight */
+  AioDestroy(level->aio);
+
+  for (size_t i = 0; i < BlockArrayLength(&level->blocks); i++) {
+    ChunkBlock *const block = *BlockArrayAt(&level->blocks, i);
+    BufferDestroy(block->read);
+    xfree(block->chunk);
+    xfree(block);
+  }
+  xfree(level->slots);
+  ChunkArrayDestroy(&level->resident);
+  SlotArrayDestroy(&level->loading);
+  BlockArrayDestroy(&level->blocks);
+  CollisionWorldDestroy(level->world);
+  BufferDestroy(level->raw);
+  xfree(level->filename);
+  xfree(level);
+}
+
+/* Turn a finished read into a resident chunk */
+static bool DecodeChunk(Level *const level, const size_t slot_index) {
+  ChunkSlot *const slot = &level->slots[slot_index];
+  const Buffer *const data = slot->block->read;
+  const uint32_t column = (uint32_t)(slot_index % level->chunks_x);
+  const uint32_t row = (uint32_t)(slot_index / level->chunks_x);
+
+  BufferTruncate(level->raw, 0);
+  if (BufferLength(data) != slot->size ||
+      !DecompressFrame(level->raw, BufferData(data), BufferLength(data)) ||
+      BufferLength(level->raw) != slot->raw_size) {
+    LOG_ERROR("Bad level '%s': Corrupt chunk %" PRIu32 ",%" PRIu32,
+              level->filename, column, row);
+    return false;
+  }
+
+  const size_t area = ChunkArea(level->chunk_tiles);
+  const size_t tiles_size = area * (1 + (2 * (size_t)level->n_layers));
+  const unsigned char *const src =
+      (const unsigned char *)BufferData(level->raw);
+  if (slot->raw_size < tiles_size + 2) {
+    LOG_ERROR("Bad level '%s': Truncated chunk %" PRIu32 ",%" PRIu32,
+              level->filename, column, row);
+    return false;
+  }
+  const size_t n_spawns = GetU16(src + tiles_size);
+  if (slot->raw_size != tiles_size + 2 + (n_spawns * LEVEL_SPAWN_SIZE)) {
+    LOG_ERROR("Bad level '%s': Truncated chunk %" PRIu32 ",%" PRIu32,
+              level->filename, column, row);
+    return false;
+  }
+
+  /* One block for the chunk, ordered by alignment */
+  const size_t bytes = ChunkBytes(level, n_spawns);
+  assert(bytes <= level->block_bytes);
+  LevelChunk *const chunk = slot->block->chunk;
+  LevelSpawn *const spawns = (LevelSpawn *)(chunk + 1);
+  uint16_t *const layers = (uint16_t *)(spawns + n_spawns);
+  uint8_t *const collision = (uint8_t *)(layers + (area * level->n_layers));
+
+  memcpy(collision, src, area);
+  const unsigned char *const layer_src = src + area;
+  for (size_t i = 0; i < area * level->n_layers; i++) {
+    layers[i] = GetU16(layer_src + (2 * i));
+  }
+  const unsigned char *const spawn_src = src + tiles_size + 2;
+  for (size_t i = 0; i < n_spawns; i++) {
+    const unsigned char *const entry = spawn_src + (i * LEVEL_SPAWN_SIZE);
+    spawns[i].type = GetU16(entry);
+    spawns[i].x = (int32_t)GetU32(entry + 4);
+    spawns[i].y = (int32_t)GetU32(entry + 8);
+  }
+
+  *chunk = (LevelChunk){
+      .column = column,
+      .row = row,
+      .collision = collision,
+      .layers = layers,
+      .spawns = spawns,
+      .n_spawns = n_spawns,
+  };
+
+  const float chunk_size = (float)level->tile_size * level->chunk_tiles;
+  const Vector origin = {.x = (float)column * chunk_size,
+                         .y = (float)row * chunk_size};
+  const Vector tile_size = {.width = level->tile_size,
+                            .height = level->tile_size};
+  CollisionWorldAddTiles(level->world, collision, level->chunk_tiles,
+                         level->chunk_tiles, &origin, &tile_size);
+
+  slot->bytes = bytes;
+  slot->state = CHUNK_RESIDENT;
+  ChunkArrayAppend(&level->resident, chunk);
+  level->memory_used += bytes;
+  METRICS_ADD(CHUNK_LOADS, 1);
+  return true;
+}
+
+static void HandleCompletions(Level *const level,
+                              const AioCompletion *const completions,
+                              const size_t n_completions) {
+  for (size_t i = 0; i < n_completions; i++) {
+    const AioCompletion *const completion = &completions[i];
+    ChunkBlock *const block = completion->user_data;
+    const size_t slot_index = block->slot;
+    ChunkSlot *const slot = &level->slots[slot_index];
+
+    if (slot->state != CHUNK_LOADING || slot->request != completion->id) {
+      /* Left the unload radius while the read was in flight */
+      BlockRelease(level, block);
+      continue;
+    }
+    slot->request = 0;
+    for (size_t j = 0; j < SlotArrayLength(&level->loading); j++) {
+      if (*SlotArrayAt(&level->loading, j) == slot_index) {
+        SlotArraySwapRemove(&level->loading, j);
+        break;
+      }
+    }
+
+    if (completion->buffer == NULL) {
+      LOG_ERROR("Failed to read chunk of level '%s': %s", level->filename,
+                strerror(completion->error));
+      slot->state = CHUNK_FAILED;
+    } else if (!DecodeChunk(level, slot_index)) {
+      slot->state = CHUNK_FAILED;
+    }
+    if (slot->state == CHUNK_FAILED) {
+      BlockRelease(level, block);
+      slot->block = NULL;
+    }
+  }
+}
+
+/* Chebyshev distance in chunks */
+static int64_t Distance(const int64_t column, const int64_t row,
+                        const int64_t center_column,
+                        const int64_t center_row) {
+  const int64_t dx = (column > center_column) ? column - center_column
+                                               : center_column - column;
+  const int64_t dy = (row > center_row) ? row - center_row : center_row - row;
+  return MAX(dx, dy);
+}
+
+/* Chunks from min to max inclusive, clamped to the level */
+typedef struct {
+  int64_t min_column, min_row;
+  int64_t max_column, max_row;
+} ChunkRange;
+
+static int64_t ChunkAt(const float coordinate, const float chunk_size) {
+  return (int64_t)SDL_floorf(coordinate / chunk_size);
+}
+
+static ChunkRange RequiredRange(const Level *const level,
+                                const int64_t min_column,
+                                const int64_t min_row,
+                                const int64_t max_column,
+                                const int64_t max_row) {
+  return (ChunkRange){
+      .min_column = MAX(min_column - REQUIRED_RADIUS, 0),
+      .min_row = MAX(min_row - REQUIRED_RADIUS, 0),
+      .max_column =
+          MIN(max_column + REQUIRED_RADIUS, (int64_t)level->chunks_x - 1),
+      .max_row = MIN(max_row + REQUIRED_RADIUS, (int64_t)level->chunks_y - 1),
+  };
+}
+
+static bool InRange(const ChunkRange *const range, const int64_t column,
+                    const int64_t row) {
+  return column >= range->min_column && column <= range->max_column &&
+         row >= range->min_row && row <= range->max_row;
+}
+
+/* Where chunks are wanted during an update */
+typedef struct {
+  int64_t column, row;    /* Chunk the point is in */
+  ChunkRange required[2]; /* Around the point and around the area */
+} Focus;
+
+/* Whether a chunk is around the point or the area */
+static bool IsRequired(const Focus *const focus, const int64_t column,
+                       const int64_t row) {
+  return InRange(&focus->required[0], column, row) ||
+         InRange(&focus->required[1], column, row);
+}
+
+/* Unload the farthest chunk outside the load radius that is not required.
+ * Returns false if there is none. */
+static bool EvictFarthest(Level *const level, const Focus *const focus) {
+  LevelChunk *farthest = NULL;
+  int64_t farthest_distance = DEFAULT_LEVEL_LOAD_RADIUS;
+  for (size_t i = 0; i < ChunkArrayLength(&level->resident); i++) {
+    LevelChunk *const chunk = *ChunkArrayAt(&level->resident, i);
+    const int64_t distance =
+        Distance(chunk->column, chunk->row, focus->column, focus->row);
+    if (distance > farthest_distance &&
+        !IsRequired(focus, chunk->column, chunk->row)) {
+      farthest = chunk;
+      farthest_distance = distance;
+    }
+  }
+  if (farthest == NULL) {
+    return false;
+  }
+  UnloadChunk(level, farthest);
+  return true;
+}
+
+/* Request a chunk if a block is free or can be freed. Required chunks get
+ * a new block otherwise, which only happens if the area spans more chunks
+ * than the pool was sized for. */
+static void RequestChunk(Level *const level, const Focus *const focus,
+                         const size_t slot_index, const bool required) {
+  ChunkSlot *const slot = &level->slots[slot_index];
+  assert(slot->state == CHUNK_UNLOADED);
+
+  if (level->free_blocks == NULL && !EvictFarthest(level, focus)) {
+    if (!required) {
+      return;
+    }
+    LOG_DEBUG("Growing chunk pool of level '%s' to %zu blocks",
+              level->filename, BlockArrayLength(&level->blocks) + 1);
+    BlockRelease(level, BlockCreate(level));
+  }
+
+  ChunkBlock *const block = level->free_blocks;
+  level->free_blocks = block->next;
+  block->slot = slot_index;
+  slot->block = block;
+  slot->request = AioReadRange(level->aio, level->filename, slot->offset,
+                               slot->size, block->read, block);
+  slot->state = CHUNK_LOADING;
+  SlotArrayAppend(&level->loading, (uint32_t)slot_index);
+}
+
+bool LevelUpdate(Level *const level, const Vector *const center,
+                 const CollisionBox *const area) {
+  assert(level != NULL);
+  assert(center != NULL);
+  assert(area != NULL);
+
+  AioCompletion completions[MAX_COMPLETIONS];
+  size_t n_completions;
+  while ((n_completions = AioPoll(level->aio, completions,
+                                  LENGTH(completions))) > 0) {
+    HandleCompletions(level, completions, n_completions);
+  }
+
+  const float chunk_size = (float)level->tile_size * level->chunk_tiles;
+  const int64_t center_column = ChunkAt(center->x, chunk_size);
+  const int64_t center_row = ChunkAt(center->y, chunk_size);
+
+  /* The area may be far from the point, e.g. where the camera stops at the
+   * edges of the level, and span several chunks if they are small */
+  const Focus focus = {
+      .column = center_column,
+      .row = center_row,
+      .required =
+          {
+              RequiredRange(level, center_column, center_row, center_column,
+                            center_row),
+              RequiredRange(
+                  level, ChunkAt(area->position.x, chunk_size),
+                  ChunkAt(area->position.y, chunk_size),
+                  ChunkAt(area->position.x + area->size.width, chunk_size),
+                  ChunkAt(area->position.y + area->size.height, chunk_size)),
+          },
+  };
+
+  /* Unload chunks that left the unload radius, and forget reads of them */
+  for (size_t i = 0; i < ChunkArrayLength(&level->resident);) {
+    LevelChunk *const chunk = *ChunkArrayAt(&level->resident, i);
+    if (Distance(chunk->column, chunk->row, center_column, center_row) >
+            DEFAULT_LEVEL_UNLOAD_RADIUS &&
+        !IsRequired(&focus, chunk->column, chunk->row)) {
+      UnloadChunk(level, chunk); /* Moves the last chunk to i */
+    } else {
+      i += 1;
+    }
+  }
+  for (size_t i = 0; i < SlotArrayLength(&level->loading);) {
+    const uint32_t slot_index = *SlotArrayAt(&level->loading, i);
+    const int64_t column = slot_index % level->chunks_x;
+    const int64_t row = slot_index / level->chunks_x;
+    if (Distance(column, row, center_column, center_row) >
+            DEFAULT_LEVEL_UNLOAD_RADIUS &&
+        !IsRequired(&focus, column, row)) {
+      /* The completion is discarded and frees the block */
+      level->slots[slot_index].request = 0;
+      level->slots[slot_index].state = CHUNK_UNLOADED;
+      level->slots[slot_index].block = NULL;
+      SlotArraySwapRemove(&level->loading, i);
+    } else {
+      i += 1;
+    }
+  }
+
+  /* Request the required chunks regardless of the budget, then nearer
+   * chunks first while within it */
+  for (size_t i = 0; i < LENGTH(focus.required); i++) {
+    const ChunkRange *const range = &focus.required[i];
+    for (int64_t row = range->min_row; row <= range->max_row; row++) {
+      for (int64_t column = range->min_column; column <= range->max_column;
+           column++) {
+        const size_t slot_index = SlotIndex(level, column, row);
+        if (level->slots[slot_index].state == CHUNK_UNLOADED) {
+          RequestChunk(level, &focus, slot_index, true);
+        }
+      }
+    }
+  }
+  for (int64_t ring = 1; ring <= DEFAULT_LEVEL_LOAD_RADIUS; ring++) {
+    for (int64_t row = center_row - ring; row <= center_row + ring; row++) {
+      for (int64_t column = center_column - ring;
+           column <= center_column + ring; column++) {
+        if (row < 0 || row >= level->chunks_y || column < 0 ||
+            column >= level->chunks_x ||
+            Distance(column, row, center_column, center_row) != ring) {
+          continue;
+        }
+        const size_t slot_index = SlotIndex(level, column, row);
+        if (level->slots[slot_index].state == CHUNK_UNLOADED &&
+            level->memory_used < DEFAULT_LEVEL_MEMORY_BUDGET) {
+          RequestChunk(level, &focus, slot_index, false);
+        }
+      }
+    }
+  }
+
+  AioSubmit(level->aio);
+
+  /* Evict the farthest chunks outside the load radius while over budget */
+  while (level->memory_used > DEFAULT_LEVEL_MEMORY_BUDGET) {
+    if (!EvictFarthest(level, &focus)) {
+      break;
+    }
+  }
+
+  /* Wait for the chunks around the point and the area */
+  bool success = true;
+  for (size_t i = 0; i < LENGTH(focus.required); i++) {
+    const ChunkRange *const range = &focus.required[i];
+    for (int64_t row = range->min_row; row <= range->max_row; row++) {
+      for (int64_t column = range->min_column; column <= range->max_column;
+           column++) {
+        const ChunkSlot *const slot =
+            &level->slots[SlotIndex(level, column, row)];
+        while (slot->state == CHUNK_LOADING) {
+          LOG_DEBUG("Waiting for chunk %" PRId64 ",%" PRId64, column, row);
+          n_completions = AioWait(level->aio, completions,
+                                  LENGTH(completions), -1);
+          HandleCompletions(level, completions, n_completions);
+        }
+        success &= (slot->state != CHUNK_FAILED);
+      }
+    }
+  }
+
+  METRICS_SET(LEVEL_CHUNKS, (int64_t)ChunkArrayLength(&level->resident));
+  METRICS_SET(LEVEL_BYTES, (int64_t)level->memory_used);
+  return success;
+}
+
+CollisionWorld *LevelGetWorld(Level *const level) {
+  assert(level != NULL);
+  return level->world;
+}
+
+void LevelGetSize(const Level *const level, Vector *const size) {
+  assert(level != NULL);
+  assert(size != NULL);
+  size->width = (float)level->columns * level->tile_size;
+  size->height = (float)level->rows * level->tile_size;
+}
+
+void LevelGetSpawn(const Level *const level, Vector *const position) {
+  assert(level != NULL);
+  assert(position != NULL);
+  *position = level->spawn;
+}
+
+void LevelGetLayout(const Level *const level, unsigned *const tile_size,
+                    unsigned *const chunk_tiles, unsigned *const n_layers) {
+  assert(level != NULL);
+  if (tile_size != NULL) {
+    *tile_size = level->tile_size;
+  }
+  if (chunk_tiles != NULL) {
+    *chunk_tiles = level->chunk_tiles;
+  }
+  if (n_layers != NULL) {
+    *n_layers = level->n_layers;
+  }
+}
+
+size_t LevelChunkCount(const Level *const level) {
+  assert(level != NULL);
+  return ChunkArrayLength(&level->resident);
+}
+
+const LevelChunk *LevelGetChunk(const Level *const level, const size_t index) {
+  assert(level != NULL);
+  return *ChunkArrayAt((ChunkArray *)&level->resident, index);
+}
+
+size_t LevelMemoryUsed(const Level *const level) {
+  assert(level != NULL);
+  return level->memory_used;
+}
@@ -0,0 +1,152 @@
+#ifndef __ETERNO_LEVEL_H__
+#define __ETERNO_LEVEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "collision.h"
+#include "vector.h"
+
+/**
+ * @brief Level streamed from disk in chunks around a point of interest.
+ * @note A level file holds a header, an index with the position of each
+ *       chunk in the file, and the chunks as compressed frames. A chunk is a
+ *       square of tiles with a collision map, any number of tile layers and
+ *       the entity spawns inside it. Chunks within DEFAULT_LEVEL_LOAD_RADIUS
+ *       chunks of the point are read asynchronously, and their solid tiles
+ *       are added to the collision world of the level. Chunks beyond
+ *       DEFAULT_LEVEL_UNLOAD_RADIUS are unloaded. The gap between the two
+ *       keeps chunks on a boundary from being reloaded over and over.
+ *       Memory for reading and decoding chunks is pooled when the level is
+ *       opened, within DEFAULT_LEVEL_MEMORY_BUDGET, so that streaming does
+ *       not allocate. Reads are asynchronous, but decoding happens in
+ *       LevelUpdate() on the calling thread.
+ */
+typedef struct Level Level;
+
+/* Entity to create when its chunk is loaded */
+typedef struct {
+  uint16_t type;
+  int32_t x, y; /* px */
+} LevelSpawn;
+
+/* Resident chunk. Tiles are row-major. */
+typedef struct {
+  uint32_t column, row;     /* Position in chunks */
+  const uint8_t *collision; /* Nonzero tiles are solid */
+  const uint16_t *layers;   /* Tiles of each layer, one after another */
+  const LevelSpawn *spawns;
+  size_t n_spawns;
+} LevelChunk;
+
+/* Whole level in memory, as packed by LevelPack() */
+typedef struct {
+  uint16_t tile_size;   /* px */
+  uint16_t chunk_tiles; /* Width and height of chunks in tiles */
+  uint16_t n_layers;
+  uint32_t columns, rows;     /* Size in tiles */
+  const uint8_t *collision;   /* columns * rows tiles */
+  const uint16_t *layers;     /* n_layers * columns * rows tiles */
+  const LevelSpawn *spawns;   /* Anywhere in the level */
+  size_t n_spawns;
+  int32_t spawn_x, spawn_y; /* Player start in px */
+} LevelDesc;
+
+/**
+ * @brief Pack a level into the chunked level format.
+ * @param out Buffer to append the level file to.
+ * @param desc The level.
+ * @note Chunks without solid tiles, nonzero tiles or spawns are left out of
+ *       the file.
+ */
+void LevelPack(Buffer *out, const LevelDesc *desc);
+
+/**
+ * @brief Open a level file and read its index.
+ * @param filename Path to level file.
+ * @return The level or NULL on error. No chunks are loaded yet.
+ * @note Caller takes ownership of returned value.
+ */
+Level *LevelOpen(const char *filename);
+
+/**
+ * @brief Close a level, waiting for reads in flight.
+ * @param level The level.
+ * @note If level is NULL, no operation is performed. The collision world of
+ *       the level is destroyed with it.
+ */
+void LevelClose(Level *level);
+
+/**
+ * @brief Stream chunks in and out around a point.
+ * @param level The level.
+ * @param center The point, e.g. the centre of the camera.
+ * @param area Area that must be resident, e.g. the box of the player.
+ * @return False if a chunk the point or area is in or next to failed to
+ *         load.
+ * @note Call once per frame. Finished reads are decoded and nearer chunks are
+ *       requested first. Blocks only if a chunk the point or area is in or
+ *       next to is not resident yet, so that nothing can fall out of the
+ *       world. Those chunks are kept regardless of distance and budget.
+ *       Other chunks outside the load radius are evicted, farthest first,
+ *       while the chunks use more than DEFAULT_LEVEL_MEMORY_BUDGET bytes.
+ */
+bool LevelUpdate(Level *level, const Vector *center, const CollisionBox *area);
+
+/**
+ * @brief Get the collision world holding the solids of resident chunks.
+ * @param level The level.
+ * @return The collision world, owned by the level.
+ */
+CollisionWorld *LevelGetWorld(Level *level);
+
+/**
+ * @brief Get the size of the level.
+ * @param level The level.
+ * @param size Set to the width and height in px.
+ */
+void LevelGetSize(const Level *level, Vector *size);
+
+/**
+ * @brief Get the player start.
+ * @param level The level.
+ * @param position Set to the start in px.
+ */
+void LevelGetSpawn(const Level *level, Vector *position);
+
+/**
+ * @brief Get the size of tiles and chunks.
+ * @param level The level.
+ * @param tile_size Set to the size of tiles in px.
+ * @param chunk_tiles Set to the width and height of chunks in tiles.
+ * @param n_layers Set to the number of tile layers.
+ */
+void LevelGetLayout(const Level *level, unsigned *tile_size,
+                    unsigned *chunk_tiles, unsigned *n_layers);
+
+/**
+ * @brief Get the number of resident chunks.
+ * @param level The level.
+ * @return The number of chunks.
+ */
+size_t LevelChunkCount(const Level *level);
+
+/**
+ * @brief Get a resident chunk.
+ * @param level The level.
+ * @param index Index of the chunk, less than LevelChunkCount().
+ * @return The chunk, valid until the next call to LevelUpdate().
+ * @note Chunks are in no particular order.
+ */
+const LevelChunk *LevelGetChunk(const Level *level, size_t index);
+
+/**
+ * @brief Get the memory used by resident chunks.
+ * @param level The level.
+ * @return Size in bytes.
+ */
+size_t LevelMemoryUsed(const Level *level);
+
+#endif // __ETERNO_LEVEL_H__
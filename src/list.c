@@ -1,11 +1,15 @@
 #include "config.h"
 
+#define LOG_MODULE LOG_MODULE_CORE
+
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
 
+#include "allocator.h"
 #include "list.h"
 #include "logger.h"
+#include "metrics.h"
 #include "utils.h"
 
 typedef struct Element {
@@ -17,6 +21,7 @@ struct List {
   size_t length;
   size_t capacity;
   Element **buffer;
+  Allocator allocator;
 };
 
 static void EnsureCapacity(List *const list, const size_t n_elements) {
@@ -32,20 +37,30 @@ static void EnsureCapacity(List *const list, const size_t n_elements) {
   }
 
   Element **new_buffer =
-      realloc(list->buffer, sizeof(Element *) * new_capacity);
-  if (new_buffer == NULL) {
-    LOG_CRITICAL("realloc(3): Failed to allocate memory: %s", strerror(errno));
-  }
+      AllocatorRealloc(&list->allocator, list->buffer,
+                       sizeof(Element *) * list->capacity,
+                       sizeof(Element *) * new_capacity);
 
   list->capacity = new_capacity;
   list->buffer = new_buffer;
+  METRICS_ADD(LIST_GROWTHS, 1);
+}
+
+List *ListCreate(void) { return ListCreateWithAllocator(&HEAP_ALLOCATOR); }
+
+List *ListCreateInArena(Arena *const arena) {
+  const Allocator allocator = ArenaAllocator(arena);
+  return ListCreateWithAllocator(&allocator);
 }
 
-List *ListCreate(void) {
-  List *list = xmalloc(sizeof(List));
+List *ListCreateWithAllocator(const Allocator *const allocator) {
+  assert(allocator != NULL);
+
+  List *list = AllocatorAlloc(allocator, sizeof(List));
   list->length = 0;
   list->capacity = DEFAULT_LIST_CAPACITY;
-  list->buffer = xcalloc(list->capacity, sizeof(Element *));
+  list->buffer = AllocatorCalloc(allocator, list->capacity, sizeof(Element *));
+  list->allocator = *allocator;
   return list;
 }
 
@@ -62,11 +77,13 @@ void ListDestroy(void *const ptr) {
     if (element->destroy != NULL) {
       element->destroy(element->value);
     }
-    free(element);
+    AllocatorFree(&list->allocator, element, sizeof(Element));
   }
 
-  free(list->buffer);
-  free(list);
+  /* Copy, as the allocator lives in the list being freed */
+  const Allocator allocator = list->allocator;
+  AllocatorFree(&allocator, list->buffer, list->capacity * sizeof(Element *));
+  AllocatorFree(&allocator, list, sizeof(List));
 }
 
 size_t ListLength(const List *const list) {
@@ -81,7 +98,7 @@ void ListAppend(List *const list, void *const value, void (*destroy)(void *)) {
   EnsureCapacity(list, 1);
 
   // Create element
-  Element *element = xmalloc(sizeof(Element));
+  Element *element = AllocatorAlloc(&list->allocator, sizeof(Element));
   element->value = value;
   element->destroy = destroy;
 
@@ -121,7 +138,7 @@ void *ListRemove(List *const list, const size_t index) {
 
   // Remove element
   void *const value = list->buffer[index]->value;
-  free(list->buffer[index]);
+  AllocatorFree(&list->allocator, list->buffer[index], sizeof(Element));
 
   // Shift elements to the left
   list->length -= 1;
@@ -138,7 +155,7 @@ void ListInsert(List *const list, const size_t index, void *const value,
 
   EnsureCapacity(list, 1);
 
-  Element *const element = xmalloc(sizeof(Element));
+  Element *const element = AllocatorAlloc(&list->allocator, sizeof(Element));
   element->value = value;
   element->destroy = destroy;
 
@@ -147,3 +164,53 @@ void ListInsert(List *const list, const size_t index, void *const value,
   list->buffer[index] = element;
   list->length += 1;
 }
+
+void ListSort(List *const list, int (*compare)(const void *a, const void *b)) {
+  assert(list != NULL);
+  assert(list->buffer != NULL);
+  assert(compare != NULL);
+
+  const size_t n = list->length;
+  if (n < 2) {
+    return;
+  }
+
+  /* Bottom-up merge sort on the element pointers, ping-ponging between the
+   * buffer and a scratch buffer. Only pointers are moved, elements stay put. */
+  Element **const scratch =
+      AllocatorAlloc(&list->allocator, n * sizeof(Element *));
+  Element **src = list->buffer;
+  Element **dst = scratch;
+
+  for (size_t width = 1; width < n; width *= 2) {
+    for (size_t begin = 0; begin < n; begin += 2 * width) {
+      const size_t middle = MIN(begin + width, n);
+      const size_t end = MIN(begin + (2 * width), n);
+
+      size_t left = begin, right = middle, out = begin;
+      while (left < middle && right < end) {
+        /* Take from the left on ties to keep the sort stable */
+        if (compare(src[right]->value, src[left]->value) < 0) {
+          dst[out++] = src[right++];
+        } else {
+          dst[out++] = src[left++];
+        }
+      }
+      while (left < middle) {
+        dst[out++] = src[left++];
+      }
+      while (right < end) {
+        dst[out++] = src[right++];
+      }
+    }
+
+    Element **const tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != list->buffer) {
+    memcpy(list->buffer, src, n * sizeof(Element *));
+  }
+  AllocatorFree(&list->allocator, scratch, n * sizeof(Element *));
+}
@@ -4,6 +4,9 @@
 
 #include <stdlib.h>
 
+#include "allocator.h"
+#include "arena.h"
+
 typedef struct List List;
 
 /**
@@ -13,6 +16,24 @@ typedef struct List List;
  */
 List *ListCreate(void);
 
+/**
+ * @brief Create a list whose storage is drawn from an arena.
+ * @param arena The arena or NULL to use the heap.
+ * @return The list.
+ * @note The list is invalidated when the arena is reset. Destroying it is only
+ *       needed to run the destroy functions of the elements.
+ */
+List *ListCreateInArena(Arena *arena);
+
+/**
+ * @brief Create a list whose storage is drawn from an allocator.
+ * @param allocator The allocator, which is copied into the list.
+ * @return The list.
+ * @note The list must be destroyed before the memory of the allocator is
+ *       released, e.g. within the same frame for FrameAllocator().
+ */
+List *ListCreateWithAllocator(const Allocator *allocator);
+
 /**
  * @brief Destroy the list.
  * @param ptr Pointer to the list.
@@ -74,4 +95,14 @@ void *ListRemove(List *list, size_t index);
  */
 void ListInsert(List *list, size_t index, void *value, void (*destroy)(void *));
 
+/**
+ * @brief Sort the elements of the list.
+ * @param list The list.
+ * @param compare Function comparing two element values, returning less than,
+ *                equal to or greater than zero as for qsort(3).
+ * @note The sort is stable. Unlike qsort(3), compare is passed the values
+ *       themselves rather than pointers to them.
+ */
+void ListSort(List *list, int (*compare)(const void *a, const void *b));
+
 #endif // __ETERNO_LIST_H__
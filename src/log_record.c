@@ -0,0 +1,647 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <wchar.h>
+
+#include "buffer.h"
+#include "log_record.h"
+#include "logger.h"
+#include "slice.h"
+#include "utils.h"
+
+#define STRING_CUT 0x8000 /* Set in a string length if the string was cut */
+
+/* Values of LogSite.state */
+#define SITE_UNPARSED 0
+#define SITE_PARSING 1
+#define SITE_PARSED 2
+
+typedef enum LogLength {
+  LENGTH_NONE,
+  LENGTH_HH,
+  LENGTH_H,
+  LENGTH_L,
+  LENGTH_LL,
+  LENGTH_J,
+  LENGTH_Z,
+  LENGTH_T,
+  LENGTH_BIG_L,
+} LogLength;
+
+/* A parsed printf(3) conversion specification */
+typedef struct LogSpec {
+  bool width_star;
+  bool precision_star;
+  LogLength length;
+  char conversion;
+} LogSpec;
+
+/* Argument types as passed through printf(3) varargs */
+typedef enum LogArg {
+  ARG_UNSUPPORTED, /* Arguments from here on are not captured */
+  ARG_WIDTH,
+  ARG_PRECISION,
+  ARG_INT,
+  ARG_LONG,
+  ARG_LLONG,
+  ARG_INTMAX,
+  ARG_SSIZE,
+  ARG_PTRDIFF,
+  ARG_UINT,
+  ARG_ULONG,
+  ARG_ULLONG,
+  ARG_UINTMAX,
+  ARG_SIZE,
+  ARG_WINT,
+  ARG_DOUBLE,
+  ARG_LONG_DOUBLE,
+  ARG_STRING,
+  ARG_POINTER,
+} LogArg;
+
+#define LOG_MODULE_NAME(name, str) str,
+static const char *const MODULE_NAMES[] = {LOG_MODULES(LOG_MODULE_NAME)};
+#undef LOG_MODULE_NAME
+
+const char *LogModuleName(const unsigned module) {
+  return (module < LENGTH(MODULE_NAMES)) ? MODULE_NAMES[module] : NULL;
+}
+
+/**
+ * @brief Parse a conversion specification.
+ * @param p Pointer to the character after '%'.
+ * @return Pointer to the character after the conversion.
+ */
+static const char *ParseSpec(const char *p, LogSpec *const spec) {
+  memset(spec, 0, sizeof(LogSpec));
+
+  while (*p != '\0' && strchr("-+ #0'", *p) != NULL) {
+    p += 1;
+  }
+  if (*p == '*') {
+    spec->width_star = true;
+    p += 1;
+  }
+  while (*p >= '0' && *p <= '9') {
+    p += 1;
+  }
+  if (*p == '.') {
+    p += 1;
+    if (*p == '*') {
+      spec->precision_star = true;
+      p += 1;
+    }
+    while (*p >= '0' && *p <= '9') {
+      p += 1;
+    }
+  }
+
+  switch (*p) {
+  case 'h':
+    spec->length = (p[1] == 'h') ? LENGTH_HH : LENGTH_H;
+    p += (p[1] == 'h') ? 2 : 1;
+    break;
+  case 'l':
+    spec->length = (p[1] == 'l') ? LENGTH_LL : LENGTH_L;
+    p += (p[1] == 'l') ? 2 : 1;
+    break;
+  case 'j':
+    spec->length = LENGTH_J;
+    p += 1;
+    break;
+  case 'z':
+    spec->length = LENGTH_Z;
+    p += 1;
+    break;
+  case 't':
+    spec->length = LENGTH_T;
+    p += 1;
+    break;
+  case 'L':
+    spec->length = LENGTH_BIG_L;
+    p += 1;
+    break;
+  }
+
+  spec->conversion = *p;
+  return (*p != '\0') ? p + 1 : p;
+}
+
+/**
+ * @brief Get the type printf(3) reads for a conversion.
+ */
+static LogArg SpecArg(const LogSpec *const spec) {
+  switch (spec->conversion) {
+  case 'd':
+  case 'i':
+    switch (spec->length) {
+    case LENGTH_L:
+      return ARG_LONG;
+    case LENGTH_LL:
+      return ARG_LLONG;
+    case LENGTH_J:
+      return ARG_INTMAX;
+    case LENGTH_Z:
+      return ARG_SSIZE;
+    case LENGTH_T:
+      return ARG_PTRDIFF;
+    default:
+      return ARG_INT;
+    }
+
+  case 'u':
+  case 'o':
+  case 'x':
+  case 'X':
+    switch (spec->length) {
+    case LENGTH_L:
+      return ARG_ULONG;
+    case LENGTH_LL:
+      return ARG_ULLONG;
+    case LENGTH_J:
+      return ARG_UINTMAX;
+    case LENGTH_Z:
+      return ARG_SIZE;
+    case LENGTH_T:
+      return ARG_PTRDIFF;
+    default:
+      return ARG_UINT;
+    }
+
+  case 'c':
+    return (spec->length == LENGTH_L) ? ARG_WINT : ARG_INT;
+
+  case 'f':
+  case 'F':
+  case 'e':
+  case 'E':
+  case 'g':
+  case 'G':
+  case 'a':
+  case 'A':
+    return (spec->length == LENGTH_BIG_L) ? ARG_LONG_DOUBLE : ARG_DOUBLE;
+
+  case 's':
+    return ARG_STRING;
+
+  case 'p':
+    return ARG_POINTER;
+
+  default:
+    /* Unknown conversion, so the type of the remaining arguments is too */
+    return ARG_UNSUPPORTED;
+  }
+}
+
+static size_t AddArg(unsigned char *const args, const size_t n_args,
+                     const LogArg arg) {
+  if (n_args == LOG_MAX_ARGS) {
+    args[LOG_MAX_ARGS - 1] = ARG_UNSUPPORTED;
+    return n_args;
+  }
+  args[n_args] = (unsigned char)arg;
+  return n_args + 1;
+}
+
+static size_t ParseArgs(const char *p, unsigned char *const args) {
+  size_t n_args = 0;
+  while ((p = strchr(p, '%')) != NULL) {
+    if (p[1] == '%') {
+      p += 2;
+      continue;
+    }
+
+    LogSpec spec;
+    p = ParseSpec(p + 1, &spec);
+    if (spec.width_star) {
+      n_args = AddArg(args, n_args, ARG_WIDTH);
+    }
+    if (spec.precision_star) {
+      n_args = AddArg(args, n_args, ARG_PRECISION);
+    }
+
+    const LogArg arg = SpecArg(&spec);
+    n_args = AddArg(args, n_args, arg);
+    if (arg == ARG_UNSUPPORTED || args[n_args - 1] == ARG_UNSUPPORTED) {
+      break;
+    }
+  }
+  return n_args;
+}
+
+size_t LogSiteParse(LogSite *const site, const unsigned char **const args) {
+  assert(site != NULL);
+  assert(args != NULL);
+
+  if (atomic_load_explicit(&site->state, memory_order_acquire) ==
+      SITE_PARSED) {
+    *args = site->args;
+    return site->n_args;
+  }
+
+  unsigned char expected = SITE_UNPARSED;
+  if (atomic_compare_exchange_strong(&site->state, &expected, SITE_PARSING)) {
+    site->n_args = (unsigned char)ParseArgs(site->format, site->args);
+    atomic_store_explicit(&site->state, SITE_PARSED, memory_order_release);
+    *args = site->args;
+    return site->n_args;
+  }
+
+  /* Another thread is parsing it right now */
+  static _Thread_local unsigned char scratch[LOG_MAX_ARGS];
+  *args = scratch;
+  return ParseArgs(site->format, scratch);
+}
+
+static bool Put(LogRecord *const record, const void *const value,
+                const size_t size) {
+  if ((size_t)(LOG_PAYLOAD_SIZE - record->size) < size) {
+    return false;
+  }
+  memcpy(record->payload + record->size, value, size);
+  record->size += (unsigned short)size;
+  return true;
+}
+
+static bool PutString(LogRecord *const record, const char *str,
+                      const int precision) {
+  if (str == NULL) {
+    str = "(null)";
+  }
+
+  const size_t room = (size_t)(LOG_PAYLOAD_SIZE - record->size);
+  if (room <= sizeof(unsigned short)) {
+    return false;
+  }
+
+  /* Respect the precision, as slices are not null-terminated */
+  size_t max = room - sizeof(unsigned short);
+  if (precision >= 0) {
+    max = MIN(max, (size_t)precision);
+  }
+  const unsigned short length = (unsigned short)strnlen(str, max);
+  const bool limited = (precision >= 0 && max == (size_t)precision);
+  const bool cut = (length == max) && !limited && str[length] != '\0';
+
+  const unsigned short header = length | (cut ? STRING_CUT : 0);
+  Put(record, &header, sizeof(header));
+  Put(record, str, length);
+  return !cut;
+}
+
+/* Mirrors the argument promotions of printf(3), so that LogRecordFormat()
+ * can pass the same types back to it */
+void LogRecordCapture(LogRecord *const record, const unsigned char *const args,
+                      const size_t n_args, va_list ap) {
+  assert(record != NULL);
+  assert(args != NULL || n_args == 0);
+
+  int precision = -1;
+  for (size_t i = 0; i < n_args; i++) {
+    bool fits;
+    switch ((LogArg)args[i]) {
+    case ARG_WIDTH: {
+      const int width = va_arg(ap, int);
+      fits = Put(record, &width, sizeof(width));
+      break;
+    }
+    case ARG_PRECISION:
+      precision = va_arg(ap, int);
+      fits = Put(record, &precision, sizeof(precision));
+      break;
+
+    case ARG_INT:
+    case ARG_LONG:
+    case ARG_LLONG:
+    case ARG_INTMAX:
+    case ARG_SSIZE:
+    case ARG_PTRDIFF:
+    case ARG_WINT: {
+      int64_t value;
+      switch ((LogArg)args[i]) {
+      case ARG_LONG:
+        value = va_arg(ap, long);
+        break;
+      case ARG_LLONG:
+        value = va_arg(ap, long long);
+        break;
+      case ARG_INTMAX:
+        value = va_arg(ap, intmax_t);
+        break;
+      case ARG_SSIZE:
+        value = va_arg(ap, ssize_t);
+        break;
+      case ARG_PTRDIFF:
+        value = va_arg(ap, ptrdiff_t);
+        break;
+      case ARG_WINT:
+        value = (int64_t)va_arg(ap, wint_t);
+        break;
+      default:
+        value = va_arg(ap, int);
+        break;
+      }
+      fits = Put(record, &value, sizeof(value));
+      break;
+    }
+
+    case ARG_UINT:
+    case ARG_ULONG:
+    case ARG_ULLONG:
+    case ARG_UINTMAX:
+    case ARG_SIZE: {
+      uint64_t value;
+      switch ((LogArg)args[i]) {
+      case ARG_ULONG:
+        value = va_arg(ap, unsigned long);
+        break;
+      case ARG_ULLONG:
+        value = va_arg(ap, unsigned long long);
+        break;
+      case ARG_UINTMAX:
+        value = va_arg(ap, uintmax_t);
+        break;
+      case ARG_SIZE:
+        value = va_arg(ap, size_t);
+        break;
+      default:
+        value = va_arg(ap, unsigned);
+        break;
+      }
+      fits = Put(record, &value, sizeof(value));
+      break;
+    }
+
+    case ARG_DOUBLE: {
+      const double value = va_arg(ap, double);
+      fits = Put(record, &value, sizeof(value));
+      break;
+    }
+    case ARG_LONG_DOUBLE: {
+      const long double value = va_arg(ap, long double);
+      fits = Put(record, &value, sizeof(value));
+      break;
+    }
+
+    case ARG_STRING:
+      fits = PutString(record, va_arg(ap, const char *), precision);
+      precision = -1;
+      break;
+
+    case ARG_POINTER: {
+      const uint64_t value = (uintptr_t)va_arg(ap, void *);
+      fits = Put(record, &value, sizeof(value));
+      break;
+    }
+
+    default:
+      fits = false;
+      break;
+    }
+
+    if (!fits) {
+      record->truncated = true;
+      return;
+    }
+  }
+}
+
+static bool Get(const LogRecord *const record, size_t *const offset,
+                void *const value, const size_t size) {
+  if ((size_t)record->size - *offset < size) {
+    return false;
+  }
+  memcpy(value, record->payload + *offset, size);
+  *offset += size;
+  return true;
+}
+
+/**
+ * @brief Copy a conversion specification, replacing '*' with the captured
+ *        width and precision.
+ * @return False if the arguments were not captured or the result is too
+ *         long.
+ */
+static bool ResolveSpec(char *const dst, const size_t size, const char *begin,
+                        const char *const end, const LogRecord *const record,
+                        size_t *const offset) {
+  size_t length = 0;
+  for (; begin < end; begin++) {
+    if (*begin != '*') {
+      if (length + 1 >= size) {
+        return false;
+      }
+      dst[length++] = *begin;
+      continue;
+    }
+
+    int value;
+    if (!Get(record, offset, &value, sizeof(value))) {
+      return false;
+    }
+
+    if (begin[-1] == '.' && value < 0) {
+      length -= 1; /* A negative precision means no precision */
+      continue;
+    }
+    const int ret = snprintf(dst + length, size - length, "%d", value);
+    if (ret < 0 || (size_t)ret >= size - length) {
+      return false;
+    }
+    length += (size_t)ret;
+  }
+
+  dst[length] = '\0';
+  return true;
+}
+
+/**
+ * @brief Format the message of a record from its captured arguments.
+ */
+static void FormatMessage(Buffer *const buf, const LogRecord *const record) {
+  const char *p = record->site->format;
+  size_t offset = 0;
+
+  while (true) {
+    const char *const percent = strchr(p, '%');
+    if (percent == NULL) {
+      BufferPrint(buf, p);
+      return;
+    }
+    BufferAppendSlice(buf, SliceCreate(p, (size_t)(percent - p)));
+
+    if (percent[1] == '%') {
+      BufferAppend(buf, '%');
+      p = percent + 2;
+      continue;
+    }
+
+    LogSpec spec;
+    p = ParseSpec(percent + 1, &spec);
+
+    char text[64];
+    if (!ResolveSpec(text, sizeof(text), percent, p, record, &offset)) {
+      BufferPrint(buf, "...");
+      return;
+    }
+
+    bool found = true;
+    switch (spec.conversion) {
+    case 'd':
+    case 'i':
+    case 'c': {
+      int64_t value;
+      found = Get(record, &offset, &value, sizeof(value));
+      if (!found) {
+        break;
+      }
+      switch (spec.length) {
+      case LENGTH_L:
+        BufferPrintFormat(buf, text, (long)value);
+        break;
+      case LENGTH_LL:
+        BufferPrintFormat(buf, text, (long long)value);
+        break;
+      case LENGTH_J:
+        BufferPrintFormat(buf, text, (intmax_t)value);
+        break;
+      case LENGTH_Z:
+        BufferPrintFormat(buf, text, (ssize_t)value);
+        break;
+      case LENGTH_T:
+        BufferPrintFormat(buf, text, (ptrdiff_t)value);
+        break;
+      default:
+        BufferPrintFormat(buf, text, (int)value);
+        break;
+      }
+      break;
+    }
+
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X': {
+      uint64_t value;
+      found = Get(record, &offset, &value, sizeof(value));
+      if (!found) {
+        break;
+      }
+      switch (spec.length) {
+      case LENGTH_L:
+        BufferPrintFormat(buf, text, (unsigned long)value);
+        break;
+      case LENGTH_LL:
+        BufferPrintFormat(buf, text, (unsigned long long)value);
+        break;
+      case LENGTH_J:
+        BufferPrintFormat(buf, text, (uintmax_t)value);
+        break;
+      case LENGTH_Z:
+      case LENGTH_T:
+        BufferPrintFormat(buf, text, (size_t)value);
+        break;
+      default:
+        BufferPrintFormat(buf, text, (unsigned)value);
+        break;
+      }
+      break;
+    }
+
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      if (spec.length == LENGTH_BIG_L) {
+        long double value;
+        found = Get(record, &offset, &value, sizeof(value));
+        if (found) {
+          BufferPrintFormat(buf, text, value);
+        }
+      } else {
+        double value;
+        found = Get(record, &offset, &value, sizeof(value));
+        if (found) {
+          BufferPrintFormat(buf, text, value);
+        }
+      }
+      break;
+
+    case 's': {
+      unsigned short header;
+      found = Get(record, &offset, &header, sizeof(header));
+      if (!found) {
+        break;
+      }
+      char str[LOG_PAYLOAD_SIZE + 1];
+      const size_t length = header & ~STRING_CUT;
+      found = Get(record, &offset, str, length);
+      if (!found) {
+        break;
+      }
+      str[length] = '\0';
+      BufferPrintFormat(buf, text, str);
+      if (header & STRING_CUT) {
+        BufferPrint(buf, "...");
+        return;
+      }
+      break;
+    }
+
+    case 'p': {
+      uint64_t value;
+      found = Get(record, &offset, &value, sizeof(value));
+      if (found) {
+        BufferPrintFormat(buf, text, (void *)(uintptr_t)value);
+      }
+      break;
+    }
+
+    default:
+      found = false;
+      break;
+    }
+
+    if (!found) {
+      BufferPrint(buf, "...");
+      return;
+    }
+  }
+}
+
+void LogRecordFormat(Buffer *const buf, const LogRecord *const record) {
+  assert(buf != NULL);
+  assert(record != NULL);
+
+  const LogSite *const site = record->site;
+  switch ((enum LogLevel)site->level) {
+  case LOG_LEVEL_DEBUG:
+    BufferPrintFormat(buf, "<dbg>  %s:%d  ", site->file, site->line);
+    break;
+  case LOG_LEVEL_INFO:
+    BufferPrint(buf, "<inf>  ");
+    break;
+  case LOG_LEVEL_WARNING:
+    BufferPrint(buf, "<wrn>  ");
+    break;
+  case LOG_LEVEL_ERROR:
+    BufferPrintFormat(buf, "<err>  %s:%d  ", site->file, site->line);
+    break;
+  case LOG_LEVEL_CRITICAL:
+    BufferPrintFormat(buf, "<crt>  %s:%d  ", site->file, site->line);
+    break;
+  }
+  FormatMessage(buf, record);
+  BufferAppend(buf, '\n');
+}
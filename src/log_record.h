@@ -0,0 +1,95 @@
+#ifndef __ETERNO_LOG_RECORD_H__
+#define __ETERNO_LOG_RECORD_H__
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "buffer.h"
+#include "logger.h"
+
+/**
+ * @brief Captured log messages, shared by the logger and eterno-logdecode.
+ * @note A record holds the arguments of a message in the order of the
+ *       format string: integers as 64-bit values, floating point values as
+ *       double or long double, widths and precisions as int, and strings as a
+ *       16-bit length followed by the characters. All values are in host
+ *       byte order.
+ */
+
+/* Room for the arguments of a message. Records are fixed size, so that the
+ * rings can copy them without allocating. */
+#define LOG_PAYLOAD_SIZE 232
+
+typedef struct LogRecord {
+  LogSite *site;
+  uint64_t timestamp;
+  uint64_t sequence; /* Orders records of a thread with equal timestamps */
+  bool truncated;    /* Arguments did not fit */
+  unsigned short size;
+  unsigned char payload[LOG_PAYLOAD_SIZE];
+} LogRecord;
+
+/* Binary log file: the header, followed by entries that each start with
+ * one of the tags below. Fields are in host byte order, and the header
+ * records the byte order and sizes so that a mismatch is detected. */
+#define LOG_BINARY_MAGIC "ETERNLOG"
+#define LOG_BINARY_VERSION 1
+#define LOG_BINARY_BYTE_ORDER 0x01020304u
+
+typedef struct LogBinaryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t long_double_size;
+  uint32_t reserved;
+} LogBinaryHeader;
+
+enum LogBinaryTag {
+  /* u32 id, u8 level, u8 module, u32 line, u16 length + file,
+   * u16 length + format */
+  LOG_BINARY_SITE = 'S',
+  /* u32 id, u64 timestamp, u8 truncated, u16 size + payload */
+  LOG_BINARY_RECORD = 'R',
+  /* u64 number of messages dropped since the previous entry */
+  LOG_BINARY_DROPPED = 'D',
+};
+
+/**
+ * @brief Get the name of a module.
+ * @param module The module.
+ * @return The name, or NULL if the module does not exist.
+ */
+const char *LogModuleName(unsigned module);
+
+/**
+ * @brief Parse the argument types of a statement from its format string.
+ * @param site The statement. Its fields are only written once, so it may be
+ *             called concurrently.
+ * @param args Set to the argument types.
+ * @return Number of argument types.
+ * @note If an argument is not supported, the types stop before it and
+ *       records of the statement are truncated there.
+ */
+size_t LogSiteParse(LogSite *site, const unsigned char **args);
+
+/**
+ * @brief Copy the arguments of a message into a record.
+ * @param record Record with an empty payload.
+ * @param args Argument types from LogSiteParse().
+ * @param n_args Number of argument types.
+ * @param ap The arguments.
+ */
+void LogRecordCapture(LogRecord *record, const unsigned char *args,
+                      size_t n_args, va_list ap);
+
+/**
+ * @brief Format a record as a line of log output.
+ * @param buf Buffer to append line to.
+ * @param record The record.
+ * @note Truncated arguments are replaced with "...".
+ */
+void LogRecordFormat(Buffer *buf, const LogRecord *record);
+
+#endif // __ETERNO_LOG_RECORD_H__
@@ -1,49 +1,468 @@
-#include "logger.h"
 #include "config.h"
-#include "utils.h"
 
+#include <SDL3/SDL.h>
 #include <assert.h>
-#include <libgen.h>
+#include <errno.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static bool LOGGER_LOG_DEBUG = false;
+#include "array.h"
+#include "buffer.h"
+#include "log_record.h"
+#include "logger.h"
+#include "queue.h"
+#include "utils.h"
+
+ARRAY_DEFINE(LogRecordArray, LogRecord, 1)
 
-void SetDebugLogging(const bool enable) { LOGGER_LOG_DEBUG = enable; }
+typedef struct LogRing {
+  SpscQueue *queue;
+  bool closed; /* The owning thread exited */
+  struct LogRing *next;
+} LogRing;
 
-void LogMessage(enum LogLevel level, const char *file, const int line,
-                const char *format, ...) {
-  assert(file != NULL);
-  assert(format != NULL);
+#define LOG_MODULE_LEVEL(name, str) LOG_LEVEL_INFO,
+atomic_uchar LOG_MODULE_LEVELS[LOG_MODULE_COUNT] = {
+    LOG_MODULES(LOG_MODULE_LEVEL)};
+#undef LOG_MODULE_LEVEL
+
+static const char *const LEVEL_NAMES[] = {"debug", "info", "warning",
+                                          "error"};
+
+static struct {
+  atomic_bool running;
+  atomic_uint generation; /* Incremented when rings are freed */
+  atomic_size_t dropped;
+  SDL_Thread *thread;
+  SDL_Mutex *lock; /* Guards the fields below */
+  SDL_Condition *wake;
+  SDL_Condition *flushed;
+  LogRing *rings;
+  uint64_t flush_requested;
+  uint64_t flush_completed;
+  bool stop;
+  FILE *binary; /* Only touched by the writer while the logger runs */
+  unsigned binary_epoch; /* Incremented for each binary output */
+} LOGGER;
+
+/* The ring of the calling thread, valid while the generation matches */
+static _Thread_local LogRing *THREAD_RING = NULL;
+static _Thread_local unsigned THREAD_RING_GENERATION = 0;
+static _Thread_local uint64_t THREAD_SEQUENCE = 0;
+static SDL_TLSID RING_TLS;
+
+void SetDebugLogging(const bool enable) {
+  for (size_t i = 0; i < LOG_MODULE_COUNT; i++) {
+    LogSetLevel((LogModule)i, enable ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO);
+  }
+}
+
+void LogSetLevel(const LogModule module, const enum LogLevel level) {
+  assert(module < LOG_MODULE_COUNT);
+  assert(level <= LOG_LEVEL_CRITICAL);
+  atomic_store_explicit(&LOG_MODULE_LEVELS[module], (unsigned char)level,
+                        memory_order_relaxed);
+}
+
+static bool ParseLevel(const Slice name, enum LogLevel *const level) {
+  for (size_t i = 0; i < LENGTH(LEVEL_NAMES); i++) {
+    if (SliceEqualString(name, LEVEL_NAMES[i])) {
+      *level = (enum LogLevel)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool ParseModule(const Slice name, LogModule *const module) {
+  for (unsigned i = 0; i < LOG_MODULE_COUNT; i++) {
+    if (SliceEqualString(name, LogModuleName(i))) {
+      *module = (LogModule)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LogSetLevels(const char *const spec) {
+  assert(spec != NULL);
+
+  /* Apply nothing unless the whole specification is valid */
+  unsigned char levels[LOG_MODULE_COUNT];
+  for (size_t i = 0; i < LOG_MODULE_COUNT; i++) {
+    levels[i] = atomic_load(&LOG_MODULE_LEVELS[i]);
+  }
+
+  Slice rest = SliceFromString(spec);
+  Slice item;
+  while (SliceSplit(&rest, ',', &item)) {
+    item = SliceTrim(item);
+    size_t equals;
+    const bool all = !SliceFind(item, '=', &equals);
+    const Slice name =
+        all ? item : SliceTrim(SliceSub(item, equals + 1, item.length));
+
+    enum LogLevel level;
+    if (!ParseLevel(name, &level)) {
+      LOG_ERROR("Bad log level '" SLICE_FMT "'", SLICE_ARG(name));
+      return false;
+    }
+
+    if (all) {
+      memset(levels, level, sizeof(levels));
+      continue;
+    }
+
+    const Slice module_name = SliceTrim(SliceSub(item, 0, equals));
+    LogModule module;
+    if (!ParseModule(module_name, &module)) {
+      LOG_ERROR("Bad log module '" SLICE_FMT "'", SLICE_ARG(module_name));
+      return false;
+    }
+    levels[module] = (unsigned char)level;
+  }
+
+  for (size_t i = 0; i < LOG_MODULE_COUNT; i++) {
+    LogSetLevel((LogModule)i, (enum LogLevel)levels[i]);
+  }
+  return true;
+}
+
+static void OnThreadExit(ARG_UNUSED void *const value) {
+  /* Thread-local variables are still valid in TLS destructors */
+  SDL_LockMutex(LOGGER.lock);
+  if (THREAD_RING != NULL &&
+      THREAD_RING_GENERATION == atomic_load(&LOGGER.generation)) {
+    THREAD_RING->closed = true; /* Freed by the writer once drained */
+  }
+  SDL_UnlockMutex(LOGGER.lock);
+  THREAD_RING = NULL;
+}
+
+static LogRing *GetThreadRing(void) {
+  const unsigned generation =
+      atomic_load_explicit(&LOGGER.generation, memory_order_relaxed);
+  if (THREAD_RING != NULL && THREAD_RING_GENERATION == generation) {
+    return THREAD_RING;
+  }
+
+  LogRing *const ring = xcalloc(1, sizeof(LogRing));
+  ring->queue = SpscQueueCreate(DEFAULT_LOG_RING_CAPACITY, sizeof(LogRecord));
+
+  SDL_LockMutex(LOGGER.lock);
+  ring->next = LOGGER.rings;
+  LOGGER.rings = ring;
+  SDL_UnlockMutex(LOGGER.lock);
+
+  THREAD_RING = ring;
+  THREAD_RING_GENERATION = generation;
+  SDL_SetTLS(&RING_TLS, ring, OnThreadExit);
+  return ring;
+}
+
+static int CompareRecords(const void *const a, const void *const b) {
+  const LogRecord *const lhs = a;
+  const LogRecord *const rhs = b;
+  if (lhs->timestamp != rhs->timestamp) {
+    return (lhs->timestamp > rhs->timestamp) ? 1 : -1;
+  }
+  return (lhs->sequence > rhs->sequence) - (lhs->sequence < rhs->sequence);
+}
+
+static void WriteBuffer(Buffer *const buf, FILE *const stream) {
+  if (BufferLength(buf) > 0) {
+    fwrite(BufferData(buf), 1, BufferLength(buf), stream);
+    fflush(stream);
+    BufferTruncate(buf, 0);
+  }
+}
+
+static void PutBinary(Buffer *const buf, const void *const value,
+                      const size_t size) {
+  BufferAppendSlice(buf, SliceCreate(value, size));
+}
+
+static void PutBinaryString(Buffer *const buf, const char *const str) {
+  const uint16_t length = (uint16_t)strnlen(str, UINT16_MAX);
+  PutBinary(buf, &length, sizeof(length));
+  PutBinary(buf, str, length);
+}
+
+/**
+ * @brief Append a record to the binary output, preceded by its statement if
+ *        this is the first record of it.
+ */
+static void PutBinaryRecord(Buffer *const bin, const LogRecord *const record,
+                            unsigned *const n_sites) {
+  LogSite *const site = record->site;
+  if (site->epoch != LOGGER.binary_epoch) {
+    site->epoch = LOGGER.binary_epoch;
+    site->id = (*n_sites)++;
+
+    const uint8_t tag = LOG_BINARY_SITE;
+    const uint32_t id = site->id;
+    const uint32_t line = (uint32_t)site->line;
+    PutBinary(bin, &tag, sizeof(tag));
+    PutBinary(bin, &id, sizeof(id));
+    PutBinary(bin, &site->level, sizeof(site->level));
+    PutBinary(bin, &site->module, sizeof(site->module));
+    PutBinary(bin, &line, sizeof(line));
+    PutBinaryString(bin, site->file);
+    PutBinaryString(bin, site->format);
+  }
+
+  const uint8_t tag = LOG_BINARY_RECORD;
+  const uint32_t id = site->id;
+  const uint8_t truncated = record->truncated;
+  const uint16_t size = record->size;
+  PutBinary(bin, &tag, sizeof(tag));
+  PutBinary(bin, &id, sizeof(id));
+  PutBinary(bin, &record->timestamp, sizeof(record->timestamp));
+  PutBinary(bin, &truncated, sizeof(truncated));
+  PutBinary(bin, &size, sizeof(size));
+  PutBinary(bin, record->payload, size);
+}
+
+/**
+ * @brief Write everything in the rings, oldest first.
+ */
+static void Drain(LogRecordArray *const records, Buffer *const out,
+                  Buffer *const err, Buffer *const bin,
+                  size_t *const dropped_reported, unsigned *const n_sites) {
+  /* New rings are only ever added at the head, and only the writer removes
+   * them, so the list can be walked without holding the lock */
+  SDL_LockMutex(LOGGER.lock);
+  LogRing *const head = LOGGER.rings;
+  SDL_UnlockMutex(LOGGER.lock);
+
+  LogRecordArrayClear(records);
+  for (LogRing *ring = head; ring != NULL; ring = ring->next) {
+    const size_t n = SpscQueueLength(ring->queue);
+    LogRecordArrayReserve(records, LogRecordArrayLength(records) + n);
+    LogRecord *const dst = LogRecordArrayData(records) + records->length;
+    records->length += SpscQueuePopMany(ring->queue, dst, n);
+  }
+
+  /* Rings are in order, but the threads interleave */
+  qsort(LogRecordArrayData(records), LogRecordArrayLength(records),
+        sizeof(LogRecord), CompareRecords);
+
+  for (size_t i = 0; i < LogRecordArrayLength(records); i++) {
+    const LogRecord *const record = LogRecordArrayAt(records, i);
+    const unsigned char level = record->site->level;
+    if (LOGGER.binary != NULL) {
+      PutBinaryRecord(bin, record, n_sites);
+      if (level < LOG_LEVEL_WARNING) {
+        continue;
+      }
+    }
+    LogRecordFormat((level >= LOG_LEVEL_ERROR) ? err : out, record);
+  }
+
+  const size_t dropped =
+      atomic_load_explicit(&LOGGER.dropped, memory_order_relaxed);
+  if (dropped > *dropped_reported) {
+    BufferPrintFormat(out, "<wrn>  Dropped %zu log messages: Ring full\n",
+                      dropped - *dropped_reported);
+    if (LOGGER.binary != NULL) {
+      const uint8_t tag = LOG_BINARY_DROPPED;
+      const uint64_t count = dropped - *dropped_reported;
+      PutBinary(bin, &tag, sizeof(tag));
+      PutBinary(bin, &count, sizeof(count));
+    }
+    *dropped_reported = dropped;
+  }
 
-  if (level == LOG_LEVEL_DEBUG && !LOGGER_LOG_DEBUG) {
+  WriteBuffer(out, stdout);
+  WriteBuffer(err, stderr);
+  if (LOGGER.binary != NULL) {
+    WriteBuffer(bin, LOGGER.binary);
+  }
+
+  /* Free rings of threads that exited */
+  SDL_LockMutex(LOGGER.lock);
+  for (LogRing **link = &LOGGER.rings; *link != NULL;) {
+    LogRing *const ring = *link;
+    if (ring->closed && SpscQueueLength(ring->queue) == 0) {
+      *link = ring->next;
+      SpscQueueDestroy(ring->queue);
+      xfree(ring);
+    } else {
+      link = &ring->next;
+    }
+  }
+  SDL_UnlockMutex(LOGGER.lock);
+}
+
+static int Writer(ARG_UNUSED void *const data) {
+  LogRecordArray records;
+  LogRecordArrayInit(&records);
+  Buffer *const out = BufferCreate();
+  Buffer *const err = BufferCreate();
+  Buffer *const bin = BufferCreate();
+  size_t dropped_reported = 0;
+  unsigned n_sites = 0;
+
+  SDL_LockMutex(LOGGER.lock);
+  while (true) {
+    const uint64_t requested = LOGGER.flush_requested;
+    const bool stop = LOGGER.stop;
+    SDL_UnlockMutex(LOGGER.lock);
+
+    Drain(&records, out, err, bin, &dropped_reported, &n_sites);
+
+    SDL_LockMutex(LOGGER.lock);
+    LOGGER.flush_completed = requested;
+    SDL_BroadcastCondition(LOGGER.flushed);
+    if (stop) {
+      break;
+    }
+    if (LOGGER.flush_requested == requested && !LOGGER.stop) {
+      SDL_WaitConditionTimeout(LOGGER.wake, LOGGER.lock,
+                               DEFAULT_LOG_FLUSH_INTERVAL_MS);
+    }
+  }
+  SDL_UnlockMutex(LOGGER.lock);
+
+  BufferDestroy(out);
+  BufferDestroy(err);
+  BufferDestroy(bin);
+  LogRecordArrayDestroy(&records);
+  return 0;
+}
+
+bool LogSetBinaryOutput(const char *const filename) {
+  assert(!atomic_load(&LOGGER.running));
+
+  if (LOGGER.binary != NULL) {
+    fclose(LOGGER.binary);
+    LOGGER.binary = NULL;
+  }
+  if (filename == NULL) {
+    return true;
+  }
+
+  FILE *const file = fopen(filename, "wb");
+  if (file == NULL) {
+    LOG_ERROR("Failed to open binary log '%s': %s", filename,
+              strerror(errno));
+    return false;
+  }
+
+  LogBinaryHeader header = {
+      .version = LOG_BINARY_VERSION,
+      .byte_order = LOG_BINARY_BYTE_ORDER,
+      .long_double_size = sizeof(long double),
+  };
+  memcpy(header.magic, LOG_BINARY_MAGIC, sizeof(header.magic));
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    LOG_ERROR("Failed to write binary log '%s': %s", filename,
+              strerror(errno));
+    fclose(file);
+    return false;
+  }
+
+  /* Statements are written again for each file */
+  LOGGER.binary_epoch += 1;
+  LOGGER.binary = file;
+  return true;
+}
+
+void LogInit(void) {
+  if (atomic_load(&LOGGER.running)) {
     return;
   }
 
-  va_list ap;
-  va_start(ap, format);
+  /* The lock outlives the logger, see LogShutdown() */
+  if (LOGGER.lock == NULL) {
+    LOGGER.lock = SDL_CreateMutex();
+  }
+  LOGGER.wake = SDL_CreateCondition();
+  LOGGER.flushed = SDL_CreateCondition();
+  if (LOGGER.lock == NULL || LOGGER.wake == NULL || LOGGER.flushed == NULL) {
+    LOG_CRITICAL("Failed to create logger synchronization: %s",
+                 SDL_GetError());
+  }
+  LOGGER.stop = false;
+  LOGGER.flush_requested = LOGGER.flush_completed = 0;
+
+  LOGGER.thread = SDL_CreateThread(Writer, "logger", NULL);
+  if (LOGGER.thread == NULL) {
+    LOG_CRITICAL("Failed to create logger thread: %s", SDL_GetError());
+  }
+  atomic_store(&LOGGER.running, true);
+}
+
+void LogFlush(void) {
+  if (!atomic_load(&LOGGER.running) ||
+      SDL_GetCurrentThreadID() == SDL_GetThreadID(LOGGER.thread)) {
+    return;
+  }
 
+  SDL_LockMutex(LOGGER.lock);
+  const uint64_t target = ++LOGGER.flush_requested;
+  SDL_SignalCondition(LOGGER.wake);
+  while (LOGGER.flush_completed < target) {
+    SDL_WaitCondition(LOGGER.flushed, LOGGER.lock);
+  }
+  SDL_UnlockMutex(LOGGER.lock);
+}
+
+void LogShutdown(void) {
+  if (!atomic_load(&LOGGER.running)) {
+    return;
+  }
+
+  /* Messages logged from here on are written synchronously */
+  atomic_store(&LOGGER.running, false);
+
+  SDL_LockMutex(LOGGER.lock);
+  LOGGER.stop = true;
+  SDL_SignalCondition(LOGGER.wake);
+  SDL_UnlockMutex(LOGGER.lock);
+  SDL_WaitThread(LOGGER.thread, NULL);
+  LOGGER.thread = NULL;
+
+  if (LOGGER.binary != NULL) {
+    fclose(LOGGER.binary);
+    LOGGER.binary = NULL;
+  }
+
+  SDL_LockMutex(LOGGER.lock);
+  while (LOGGER.rings != NULL) {
+    LogRing *const ring = LOGGER.rings;
+    LOGGER.rings = ring->next;
+    SpscQueueDestroy(ring->queue);
+    xfree(ring);
+  }
+  atomic_fetch_add(&LOGGER.generation, 1);
+  SDL_UnlockMutex(LOGGER.lock);
+
+  SDL_DestroyCondition(LOGGER.wake);
+  SDL_DestroyCondition(LOGGER.flushed);
+  /* Threads that exit later still take the lock in OnThreadExit() */
+}
+
+size_t LogDropped(void) { return atomic_load(&LOGGER.dropped); }
+
+static void LogMessageSync(const LogSite *const site, va_list ap) {
   char message[1024];
-  int size = vsnprintf(message, sizeof(message), format, ap);
+  int size = vsnprintf(message, sizeof(message), site->format, ap);
   if (size < 0 || (size_t)size >= sizeof(message)) {
-    LOG_WARNING("Truncation error: Log message too long (%d >= %d)", size,
+    LOG_WARNING("Truncation error: Log message too long (%d >= %zu)", size,
                 sizeof(message));
     message[sizeof(message) - 2] = '.';
     message[sizeof(message) - 3] = '.';
     message[sizeof(message) - 4] = '.';
   }
-  va_end(ap);
 
-  /* Get basename of file path. */
-  char buf[PATH_MAX];
-  strncpy(buf, file, sizeof(buf));
-  char *bname = basename(buf);
-
-  switch (level) {
+  switch ((enum LogLevel)site->level) {
   case LOG_LEVEL_DEBUG:
-    fprintf(stdout, "<dbg>  %s:%d  %s\n", bname, line, message);
+    fprintf(stdout, "<dbg>  %s:%d  %s\n", site->file, site->line, message);
     break;
   case LOG_LEVEL_INFO:
     fprintf(stdout, "<inf>  %s\n", message);
@@ -52,10 +471,45 @@ void LogMessage(enum LogLevel level, const char *file, const int line,
     fprintf(stdout, "<wrn>  %s\n", message);
     break;
   case LOG_LEVEL_ERROR:
-    fprintf(stderr, "<err>  %s:%d  %s\n", bname, line, message);
+    fprintf(stderr, "<err>  %s:%d  %s\n", site->file, site->line, message);
     break;
   case LOG_LEVEL_CRITICAL:
-    fprintf(stderr, "<crt>  %s:%d  %s\n", bname, line, message);
+    fprintf(stderr, "<crt>  %s:%d  %s\n", site->file, site->line, message);
     abort(); /* It's not safe to proceed */
   }
 }
+
+void LogMessage(LogSite *const site, const char *const format, ...) {
+  assert(site != NULL);
+  assert(site->file != NULL);
+  assert(format != NULL);
+
+  va_list ap;
+  va_start(ap, format);
+
+  if (site->level != LOG_LEVEL_CRITICAL &&
+      atomic_load_explicit(&LOGGER.running, memory_order_acquire)) {
+    const unsigned char *args;
+    const size_t n_args = LogSiteParse(site, &args);
+
+    LogRecord record;
+    record.site = site;
+    record.timestamp = SDL_GetTicksNS();
+    record.sequence = THREAD_SEQUENCE++;
+    record.truncated = false;
+    record.size = 0;
+    LogRecordCapture(&record, args, n_args, ap);
+    va_end(ap);
+
+    if (!SpscQueuePush(GetThreadRing()->queue, &record)) {
+      atomic_fetch_add_explicit(&LOGGER.dropped, 1, memory_order_relaxed);
+    }
+    return;
+  }
+
+  if (site->level == LOG_LEVEL_CRITICAL) {
+    LogFlush(); /* Keep messages in order up to the crash */
+  }
+  LogMessageSync(site, ap);
+  va_end(ap);
+}
@@ -1,7 +1,9 @@
 #ifndef __ETERNO_LOGGER_H__
 #define __ETERNO_LOGGER_H__
 
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 enum LogLevel {
   LOG_LEVEL_DEBUG,
@@ -11,24 +13,198 @@ enum LogLevel {
   LOG_LEVEL_CRITICAL,
 };
 
-#define LOG_DEBUG(...)                                                         \
-  LogMessage(LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+/* LOG_MIN_LEVEL from config.h is the lowest level compiled in, see
+ * CMakeLists.txt. Messages below it are type checked, but generate no code.
+ * Hence config.h must be included first. */
 
-#define LOG_INFO(...)                                                          \
-  LogMessage(LOG_LEVEL_INFO, __FILE__, __LINE__, __VA_ARGS__)
+/* Modules whose level can be set at runtime, see LogSetLevels() */
+#define LOG_MODULES(X)                                                         \
+  X(MAIN, "main")                                                              \
+  X(CORE, "core")                                                              \
+  X(GAME, "game")                                                              \
+  X(PLAYER, "player")                                                          \
+  X(TEXTURE, "texture")                                                        \
+  X(AIO, "aio")                                                                \
+  X(COMPRESS, "compress")                                                      \
+  X(METRICS, "metrics")                                                        \
+  X(INPUT, "input")                                                            \
+  X(MEMORY, "memory")                                                          \
+  X(LEVEL, "level")
 
-#define LOG_WARNING(...)                                                       \
-  LogMessage(LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
+#define LOG_MODULE_ENUM(name, str) LOG_MODULE_##name,
+typedef enum LogModule {
+  LOG_MODULES(LOG_MODULE_ENUM) LOG_MODULE_COUNT
+} LogModule;
+#undef LOG_MODULE_ENUM
 
-#define LOG_ERROR(...)                                                         \
-  LogMessage(LOG_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+/* A source file selects its module by defining LOG_MODULE before including
+ * any header */
+#ifndef LOG_MODULE
+#define LOG_MODULE LOG_MODULE_MAIN
+#endif
 
-#define LOG_CRITICAL(...)                                                      \
-  LogMessage(LOG_LEVEL_CRITICAL, __FILE__, __LINE__, __VA_ARGS__)
+/* Maximum number of arguments captured per message */
+#define LOG_MAX_ARGS 16
 
+/**
+ * @brief A log statement, statically allocated by the LOG_* macros.
+ * @note The fields below the fixed ones are private to the logger.
+ */
+typedef struct LogSite {
+  const char *file;
+  const char *format;
+  int line;
+  unsigned char level;
+  unsigned char module;
+
+  atomic_uchar state; /* Whether the argument types below are parsed */
+  unsigned char n_args;
+  unsigned char args[LOG_MAX_ARGS];
+  unsigned epoch; /* Binary output the id below belongs to */
+  unsigned id;
+} LogSite;
+
+/* Basename of the source file, computed at compile time */
+#ifdef __FILE_NAME__
+#define LOG_FILE __FILE_NAME__
+#else
+#define LOG_FILE (__builtin_strrchr("/" __FILE__, '/') + 1)
+#endif
+
+/* Current level of each module, indexed by LogModule */
+extern atomic_uchar LOG_MODULE_LEVELS[LOG_MODULE_COUNT];
+
+/**
+ * @brief Check whether messages of a level are currently written for a
+ *        module.
+ */
+static inline bool LogEnabled(const enum LogLevel level,
+                              const LogModule module) {
+  return level >= atomic_load_explicit(&LOG_MODULE_LEVELS[module],
+                                       memory_order_relaxed);
+}
+
+/* The level is checked before the arguments are evaluated */
+#define LOG_AT(lvl, fmt, ...)                                                  \
+  do {                                                                         \
+    static LogSite log_site_ = {.file = LOG_FILE,                              \
+                                .format = fmt,                                 \
+                                .line = __LINE__,                              \
+                                .level = lvl,                                  \
+                                .module = LOG_MODULE};                         \
+    if (LogEnabled(lvl, LOG_MODULE)) {                                         \
+      LogMessage(&log_site_, fmt, ##__VA_ARGS__);                              \
+    }                                                                          \
+  } while (0)
+
+/* Compiled out, but still type checked so that arguments stay used */
+#define LOG_DISCARD(fmt, ...)                                                  \
+  do {                                                                         \
+    if (0) {                                                                   \
+      LogMessage(NULL, fmt, ##__VA_ARGS__);                                    \
+    }                                                                          \
+  } while (0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+/* Critical messages abort, so they are never filtered */
+#define LOG_CRITICAL(...) LOG_AT(LOG_LEVEL_CRITICAL, __VA_ARGS__)
+
+/**
+ * @brief Enable or disable debug messages of all modules.
+ * @param enable If true, set all modules to debug level, otherwise to info
+ *               level.
+ */
 void SetDebugLogging(bool enable);
 
-void LogMessage(enum LogLevel level, const char *file, const int line,
-                const char *format, ...);
+/**
+ * @brief Set the level of a module.
+ * @param module The module.
+ * @param level Lowest level written. Critical messages are always written.
+ */
+void LogSetLevel(LogModule module, enum LogLevel level);
+
+/**
+ * @brief Set module levels from a specification.
+ * @param spec Comma separated list of either LEVEL, which applies to all
+ *             modules, or MODULE=LEVEL, e.g. "warning,texture=debug". Levels
+ *             are debug, info, warning and error.
+ * @return False if the specification is malformed, in which case an error is
+ *         logged and no level is changed.
+ */
+bool LogSetLevels(const char *spec);
+
+/**
+ * @brief Write log records to a file in binary form.
+ * @param filename File to write to, or NULL to stop writing it.
+ * @return False if the file could not be opened.
+ * @note Must be called before LogInit(), and LogShutdown() closes the file.
+ *       While the logger runs, every record is written as the id of its
+ *       statement followed by its raw arguments, and each statement is
+ *       written once on first use. No formatting takes place. Warnings and
+ *       errors are still written to the console as well. Use
+ *       eterno-logdecode to turn the file into text.
+ */
+bool LogSetBinaryOutput(const char *filename);
+
+/**
+ * @brief Start writing log messages on a background thread.
+ * @note Until then, and after LogShutdown(), messages are written
+ *       synchronously by the calling thread. Each thread logs to its own
+ *       lock-free ring, so logging never blocks. Arguments are copied to the
+ *       ring and only formatted by the background thread. If a ring is full,
+ *       the message is dropped and counted instead.
+ */
+void LogInit(void);
+
+/**
+ * @brief Write all pending messages and stop the background thread.
+ * @note If the logger is not started, no operation is performed.
+ */
+void LogShutdown(void);
+
+/**
+ * @brief Wait until all messages logged so far are written.
+ * @note If the logger is not started, no operation is performed.
+ */
+void LogFlush(void);
+
+/**
+ * @brief Get number of messages dropped because a ring was full.
+ * @return Number of dropped messages.
+ */
+size_t LogDropped(void);
+
+/**
+ * @brief Log a message. Use the LOG_* macros instead.
+ * @param site The statement, which must outlive the logger.
+ * @param format Format string, same as in the statement.
+ * @note Critical messages are written synchronously, then the process
+ *       aborts.
+ */
+void LogMessage(LogSite *site, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
 
-#endif // __ETERNO_LOGGER_H__
\ No newline at end of file
+#endif // __ETERNO_LOGGER_H__
@@ -2,28 +2,52 @@
 
 #include <SDL3/SDL.h>
 #include <assert.h>
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "allocator.h"
 #include "game.h"
 #include "logger.h"
+#include "memtrack.h"
+#include "metrics.h"
 #include "utils.h"
 
 #define GAME_TITLE "Eterno"
 #define WINDOW_WIDTH 1080
 #define WINDOW_HEIGHT 720
 #define FPS 60
-#define DELAY_TIME (1000.0f / FPS)
+#define MAX_FPS 1000
 
 static const struct option LONG_OPTIONS[] = {
     {"debug", no_argument, NULL, 'd'},
+    {"log-level", required_argument, NULL, 'l'},
+    {"log-binary", required_argument, NULL, 'b'},
+    {"stats", required_argument, NULL, 's'},
+    {"bind", required_argument, NULL, 'k'},
+    {"fps", required_argument, NULL, 'f'},
+    {"alloc-check", required_argument, NULL, 'a'},
+    {"level", required_argument, NULL, 'L'},
+    {"replay", required_argument, NULL, 'r'},
+    {"record", required_argument, NULL, 'R'},
+    {"headless", no_argument, NULL, 'H'},
     {"help", no_argument, NULL, 'h'},
     {NULL, 0, NULL, 0},
 };
 
 static const char *const DESCRIPTIONS[] = {
     "enable debug logging",
+    "set log levels, e.g. 'warning,texture=debug'",
+    "write log records in binary form to file",
+    "log metrics periodically and write them to file (.csv or .json) on exit",
+    "bind keys to actions, e.g. 'jump=w,left=left,right=right'",
+    "limit the frame rate in frames per second",
+    "check for heap allocations in the frame loop: off, warn or abort",
+    "play a level packed with eterno-levelpack",
+    "replay input recorded with --record one tick per frame, then quit",
+    "record input to file",
+    "render offscreen in software, e.g. for --replay workloads",
     "print help message",
 };
 
@@ -55,13 +79,83 @@ static void PrintHelp(const char *prog) {
 }
 
 int main(int argc, char *argv[]) {
+  const char *stats = NULL;
+  const char *bindings = NULL;
+  const char *level = NULL;
+  const char *replay = NULL;
+  const char *record = NULL;
+  bool headless = false;
+  unsigned long fps = FPS;
+
   int c;
-  while ((c = getopt_long(argc, argv, "dh", LONG_OPTIONS, NULL)) != -1) {
+  while ((c = getopt_long(argc, argv, "dl:b:s:k:f:a:L:r:R:Hh", LONG_OPTIONS,
+                          NULL)) != -1) {
     switch (c) {
     case 'd':
       SetDebugLogging(true);
       break;
 
+    case 'l':
+      if (!LogSetLevels(optarg)) {
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'b':
+      if (!LogSetBinaryOutput(optarg)) {
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 's':
+#ifndef ENABLE_METRICS
+      LOG_WARNING("Metrics are not recorded: Built without ENABLE_METRICS");
+#endif
+      stats = optarg;
+      MetricsEnableSummary(true);
+      break;
+
+    case 'k':
+      bindings = optarg;
+      break;
+
+    case 'f': {
+      char *end;
+      errno = 0;
+      fps = strtoul(optarg, &end, 10);
+      if (errno != 0 || end == optarg || *end != '\0' || fps == 0 ||
+          fps > MAX_FPS) {
+        LOG_ERROR("Bad frame rate '%s': Expected 1 to %d", optarg, MAX_FPS);
+        return EXIT_FAILURE;
+      }
+      break;
+    }
+
+    case 'a':
+#ifndef ENABLE_MEMTRACK
+      LOG_WARNING("Allocations are not checked: Built without ENABLE_MEMTRACK");
+#endif
+      if (!MemTrackSetMode(optarg)) {
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'L':
+      level = optarg;
+      break;
+
+    case 'r':
+      replay = optarg;
+      break;
+
+    case 'R':
+      record = optarg;
+      break;
+
+    case 'H':
+      headless = true;
+      break;
+
     case 'h':
       PrintHelp(argv[0]);
       return EXIT_SUCCESS;
@@ -75,37 +169,95 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  Game *game = GameInit(GAME_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT, false);
+  if (headless) {
+    /* Same pixels on every machine, without a display or GPU */
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+  }
+
+  /* Write log messages on a background thread from here on */
+  LogInit();
+
+  Game *game =
+      GameInit(GAME_TITLE, WINDOW_WIDTH, WINDOW_HEIGHT, false, level);
   if (game == NULL) {
     LOG_ERROR("Failed to initialize game");
+    LogShutdown();
     return EXIT_FAILURE;
   }
 
-  Uint64 frame_start;
+  if ((bindings != NULL && !GameSetInputBindings(game, bindings)) ||
+      (replay != NULL && !GameReplay(game, replay)) ||
+      (record != NULL && !GameRecord(game, record))) {
+    GameDestroy(game);
+    LogShutdown();
+    return EXIT_FAILURE;
+  }
+
+  /* Replays run one tick per frame without waiting, so that every run does
+   * the same work regardless of how fast the machine is */
+  const Uint64 frame_duration_ns = SDL_NS_PER_SECOND / fps;
+  const Uint64 tick_ns = SDL_NS_PER_SECOND / DEFAULT_TICK_RATE;
+  const Uint64 loop_start = SDL_GetTicksNS();
+  Uint64 previous_start = loop_start;
+  Uint64 update_ns = 0, render_ns = 0;
+  size_t frames = 0;
   while (GameIsRunning(game)) {
-    frame_start = SDL_GetTicks();
+    const Uint64 frame_start = SDL_GetTicksNS();
+    FrameArenaBegin();
+    MemTrackFrame();
 
     if (!GameHandleEvents(game)) {
       LOG_ERROR("Failed to handle events");
       break;
     }
 
-    if (!GameUpdate(game)) {
+    const Uint64 update_start = SDL_GetTicksNS();
+    const Uint64 elapsed_ns =
+        (replay != NULL) ? tick_ns : frame_start - previous_start;
+    if (!GameUpdate(game, elapsed_ns)) {
       LOG_ERROR("Failed to update game");
       break;
     }
 
+    const Uint64 render_start = SDL_GetTicksNS();
+    update_ns += render_start - update_start;
     if (!GameRender(game)) {
       LOG_ERROR("Failed to render game");
       break;
     }
 
-    uint64_t frame_time = SDL_GetTicks() - frame_start;
-    if (frame_time < DELAY_TIME) {
-      SDL_Delay((Uint32)(DELAY_TIME - frame_time));
+    const Uint64 frame_end = SDL_GetTicksNS();
+    render_ns += frame_end - render_start;
+    const Uint64 frame_time_ns = frame_end - frame_start;
+    METRICS_OBSERVE(FRAME_TIME_US, frame_time_ns / 1000);
+    MetricsFrame();
+
+    if (replay == NULL && frame_time_ns < frame_duration_ns) {
+      SDL_DelayNS(frame_duration_ns - frame_time_ns);
     }
+    previous_start = frame_start;
+    frames += 1;
   }
 
+  const Uint64 loop_ns = SDL_GetTicksNS() - loop_start;
+  FrameArenaShutdown();
   GameDestroy(game);
-  return EXIT_SUCCESS;
+
+  /* Only log once the game is destroyed, since the first message of a
+   * thread allocates and the frame loop is checked until then */
+  if (replay != NULL) {
+    LOG_INFO("Replayed %zu frames in %.3f s: %.3f s updating, %.3f s "
+             "rendering",
+             frames, (double)loop_ns / SDL_NS_PER_SECOND,
+             (double)update_ns / SDL_NS_PER_SECOND,
+             (double)render_ns / SDL_NS_PER_SECOND);
+  }
+
+  int status = EXIT_SUCCESS;
+  if (stats != NULL && !MetricsWrite(stats)) {
+    status = EXIT_FAILURE;
+  }
+  LogShutdown();
+  return status;
 }
\ No newline at end of file
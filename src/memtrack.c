@@ -0,0 +1,396 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_MEMORY
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "memtrack.h"
+#include "utils.h"
+
+/* Capacity of the call site table, a power of two. Once half full, new call
+ * sites are counted together in site 0. */
+#define MAX_SITES 4096
+
+/* Number of call sites listed by peak in MemTrackReport() */
+#define REPORT_SITES 10
+
+typedef struct {
+  const char *file; /* NULL if unused */
+  unsigned line;
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t bytes; /* Total allocated */
+  size_t live_count;
+  size_t live_bytes;
+  size_t peak_bytes;
+  uint64_t frame_allocs; /* Allocations in the frame loop after warm-up */
+} Site;
+
+typedef struct {
+  void *ptr; /* NULL if unused */
+  size_t size;
+  uint32_t site;
+} Allocation;
+
+static struct {
+  SDL_SpinLock lock; /* Guards the fields below */
+  Site sites[MAX_SITES];
+  size_t n_sites;
+  Allocation *allocations; /* Open addressing with linear probing */
+  size_t capacity;         /* A power of two */
+  size_t length;
+  uint64_t allocs;
+  uint64_t frees;
+  size_t live_bytes;
+  size_t peak_bytes;
+  uint64_t frames;
+  MemTrackMode mode;
+} TRACK = {
+    .sites = {[0] = {.file = "(other)"}},
+    .n_sites = 1,
+};
+
+/* Whether allocations of this thread are checked, see MemTrackFrame() */
+static _Thread_local bool CHECKING = false;
+
+/* Set while reporting an allocation, so that the logger may allocate */
+static _Thread_local bool REPORTING = false;
+
+static uint32_t FindSite(const char *const file, const unsigned line) {
+  /* FNV-1a */
+  uint64_t hash = 14695981039346656037u ^ line;
+  for (const char *c = file; *c != '\0'; c++) {
+    hash = (hash ^ (unsigned char)*c) * 1099511628211u;
+  }
+
+  for (size_t i = hash & (MAX_SITES - 1);; i = (i + 1) & (MAX_SITES - 1)) {
+    Site *const site = &TRACK.sites[i];
+    if (site->file == NULL) {
+      if (TRACK.n_sites >= MAX_SITES / 2) {
+        return 0;
+      }
+      site->file = file;
+      site->line = line;
+      TRACK.n_sites += 1;
+      return (uint32_t)i;
+    }
+    /* Each translation unit has its own copy of the file name */
+    if (site->line == line &&
+        (site->file == file || StringEqual(site->file, file))) {
+      return (uint32_t)i;
+    }
+  }
+}
+
+static size_t HomeSlot(const void *const ptr) {
+  /* Finalizer of MurmurHash3, as allocations are aligned */
+  uint64_t x = (uintptr_t)ptr;
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDu;
+  x ^= x >> 33;
+  return x & (TRACK.capacity - 1);
+}
+
+static void Grow(void) {
+  const size_t old_capacity = TRACK.capacity;
+  Allocation *const old_allocations = TRACK.allocations;
+
+  const size_t new_capacity = (old_capacity > 0) ? old_capacity * 2 : 1024;
+  Allocation *const new_allocations = calloc(new_capacity, sizeof(Allocation));
+  if (new_allocations == NULL) {
+    SDL_UnlockSpinlock(&TRACK.lock);
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+  TRACK.allocations = new_allocations;
+  TRACK.capacity = new_capacity;
+
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_allocations[i].ptr == NULL) {
+      continue;
+    }
+    size_t slot = HomeSlot(old_allocations[i].ptr);
+    while (TRACK.allocations[slot].ptr != NULL) {
+      slot = (slot + 1) & (TRACK.capacity - 1);
+    }
+    TRACK.allocations[slot] = old_allocations[i];
+  }
+  free(old_allocations);
+}
+
+static void Release(const Allocation *const allocation) {
+  Site *const site = &TRACK.sites[allocation->site];
+  site->frees += 1;
+  site->live_count -= 1;
+  site->live_bytes -= allocation->size;
+  TRACK.frees += 1;
+  TRACK.live_bytes -= allocation->size;
+}
+
+/**
+ * @brief Stop tracking an allocation.
+ * @param ptr The allocation.
+ * @param allocation Set to the allocation if found.
+ * @return False if the allocation is not tracked.
+ * @note Lock must be held.
+ */
+static bool Remove(const void *const ptr, Allocation *const allocation) {
+  if (TRACK.capacity == 0) {
+    return false;
+  }
+
+  const size_t mask = TRACK.capacity - 1;
+  size_t gap = HomeSlot(ptr);
+  while (TRACK.allocations[gap].ptr != ptr) {
+    if (TRACK.allocations[gap].ptr == NULL) {
+      return false;
+    }
+    gap = (gap + 1) & mask;
+  }
+  *allocation = TRACK.allocations[gap];
+
+  /* Shift later entries of the cluster back, unless that would move them
+   * before their home slot, so lookups need no tombstones */
+  for (size_t i = (gap + 1) & mask; TRACK.allocations[i].ptr != NULL;
+       i = (i + 1) & mask) {
+    const size_t home = HomeSlot(TRACK.allocations[i].ptr);
+    if (((i - home) & mask) >= ((i - gap) & mask)) {
+      TRACK.allocations[gap] = TRACK.allocations[i];
+      gap = i;
+    }
+  }
+  TRACK.allocations[gap].ptr = NULL;
+  TRACK.length -= 1;
+  return true;
+}
+
+/**
+ * @brief Start tracking an allocation.
+ * @note Lock must be held.
+ */
+static void Insert(void *const ptr, const size_t size, const uint32_t site) {
+  if ((TRACK.length + 1) * 2 > TRACK.capacity) {
+    Grow();
+  }
+
+  size_t slot = HomeSlot(ptr);
+  while (TRACK.allocations[slot].ptr != NULL &&
+         TRACK.allocations[slot].ptr != ptr) {
+    slot = (slot + 1) & (TRACK.capacity - 1);
+  }
+
+  if (TRACK.allocations[slot].ptr == ptr) {
+    /* Released with free(3) and handed out again */
+    Release(&TRACK.allocations[slot]);
+  } else {
+    TRACK.length += 1;
+  }
+  TRACK.allocations[slot] = (Allocation){ptr, size, site};
+}
+
+static void ReportFrameAllocation(const size_t size, const char *const file,
+                                  const unsigned line, const uint64_t frame,
+                                  const uint64_t count) {
+  REPORTING = true;
+  if (TRACK.mode == MEMTRACK_ABORT) {
+    LOG_CRITICAL("Allocated %zu byte(s) at %s:%u in frame %" PRIu64, size,
+                 file, line, frame);
+  }
+  if (count == 1) {
+    LOG_WARNING("Allocated %zu byte(s) at %s:%u in frame %" PRIu64
+                ", further allocations there are only counted",
+                size, file, line, frame);
+  }
+  REPORTING = false;
+}
+
+static void Record(void *const ptr, const size_t size, const char *const file,
+                   const unsigned line) {
+  const bool check = CHECKING && !REPORTING;
+
+  SDL_LockSpinlock(&TRACK.lock);
+  const uint32_t index = FindSite(file, line);
+  Site *const site = &TRACK.sites[index];
+  site->allocs += 1;
+  site->bytes += size;
+  site->live_count += 1;
+  site->live_bytes += size;
+  site->peak_bytes = MAX(site->peak_bytes, site->live_bytes);
+  TRACK.allocs += 1;
+  TRACK.live_bytes += size;
+  TRACK.peak_bytes = MAX(TRACK.peak_bytes, TRACK.live_bytes);
+  Insert(ptr, size, index);
+
+  const uint64_t frame = TRACK.frames;
+  const uint64_t count = (check) ? ++site->frame_allocs : 0;
+  SDL_UnlockSpinlock(&TRACK.lock);
+
+  if (check) {
+    ReportFrameAllocation(size, file, line, frame, count);
+  }
+}
+
+void *MemTrackMalloc(const size_t size, const char *const file,
+                     const unsigned line) {
+  void *const ptr = malloc(size);
+  if (ptr == NULL) {
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+  Record(ptr, size, file, line);
+  return ptr;
+}
+
+void *MemTrackCalloc(const size_t nmemb, const size_t size,
+                     const char *const file, const unsigned line) {
+  void *const ptr = calloc(nmemb, size);
+  if (ptr == NULL) {
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+  Record(ptr, nmemb * size, file, line);
+  return ptr;
+}
+
+void *MemTrackRealloc(void *const ptr, const size_t size,
+                      const char *const file, const unsigned line) {
+  /* Forget the old allocation first, as another thread may be handed its
+   * address as soon as it is released */
+  if (ptr != NULL) {
+    SDL_LockSpinlock(&TRACK.lock);
+    Allocation allocation;
+    if (Remove(ptr, &allocation)) {
+      Release(&allocation);
+    }
+    SDL_UnlockSpinlock(&TRACK.lock);
+  }
+
+  void *const new_ptr = realloc(ptr, size);
+  if (new_ptr == NULL) {
+    LOG_CRITICAL("realloc(3): Failed to allocate memory: %s", strerror(errno));
+  }
+  Record(new_ptr, size, file, line);
+  return new_ptr;
+}
+
+char *MemTrackStrdup(const char *const str, const char *const file,
+                     const unsigned line) {
+  assert(str != NULL);
+  char *const dup = strdup(str);
+  if (dup == NULL) {
+    LOG_CRITICAL("Failed to allocate memory: %s", strerror(errno));
+  }
+  Record(dup, strlen(dup) + 1, file, line);
+  return dup;
+}
+
+void MemTrackFree(void *const ptr) {
+  if (ptr == NULL) {
+    return;
+  }
+
+  SDL_LockSpinlock(&TRACK.lock);
+  Allocation allocation;
+  if (Remove(ptr, &allocation)) {
+    Release(&allocation);
+  }
+  SDL_UnlockSpinlock(&TRACK.lock);
+
+  free(ptr);
+}
+
+bool MemTrackSetMode(const char *const mode) {
+  assert(mode != NULL);
+
+  if (StringEqual(mode, "off")) {
+    TRACK.mode = MEMTRACK_OFF;
+  } else if (StringEqual(mode, "warn")) {
+    TRACK.mode = MEMTRACK_WARN;
+  } else if (StringEqual(mode, "abort")) {
+    TRACK.mode = MEMTRACK_ABORT;
+  } else {
+    LOG_ERROR("Bad allocation check '%s': Expected off, warn or abort", mode);
+    return false;
+  }
+  return true;
+}
+
+void MemTrackFrame(void) {
+  SDL_LockSpinlock(&TRACK.lock);
+  const uint64_t frames = ++TRACK.frames;
+  SDL_UnlockSpinlock(&TRACK.lock);
+
+  CHECKING = TRACK.mode != MEMTRACK_OFF &&
+             frames > DEFAULT_MEMTRACK_WARMUP_FRAMES;
+}
+
+static int CompareSitePeaks(const void *const a, const void *const b) {
+  const Site *const lhs = a;
+  const Site *const rhs = b;
+  return (lhs->peak_bytes < rhs->peak_bytes) -
+         (lhs->peak_bytes > rhs->peak_bytes);
+}
+
+void MemTrackReport(void) {
+  CHECKING = false;
+
+  SDL_LockSpinlock(&TRACK.lock);
+  const bool recorded = TRACK.allocs > 0;
+  SDL_UnlockSpinlock(&TRACK.lock);
+  if (!recorded) {
+    /* Built without ENABLE_MEMTRACK */
+    return;
+  }
+
+  /* Work on a copy, as logging may allocate */
+  Site *const sites = malloc(sizeof(TRACK.sites));
+  if (sites == NULL) {
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+
+  SDL_LockSpinlock(&TRACK.lock);
+  memcpy(sites, TRACK.sites, sizeof(TRACK.sites));
+  const uint64_t allocs = TRACK.allocs;
+  const uint64_t frees = TRACK.frees;
+  const size_t live_bytes = TRACK.live_bytes;
+  const size_t peak_bytes = TRACK.peak_bytes;
+  const uint64_t frames = TRACK.frames;
+  SDL_UnlockSpinlock(&TRACK.lock);
+
+  qsort(sites, MAX_SITES, sizeof(Site), CompareSitePeaks);
+
+  LOG_INFO("%" PRIu64 " allocation(s) and %" PRIu64 " free(s) over %" PRIu64
+           " frame(s), peak of %zu byte(s) with %zu byte(s) live",
+           allocs, frees, frames, peak_bytes, live_bytes);
+
+  /* Sorted by peak, so the first sites are the largest */
+  uint64_t frame_allocs = 0;
+  for (size_t i = 0; i < MAX_SITES; i++) {
+    const Site *const site = &sites[i];
+    if (site->allocs == 0) {
+      continue;
+    }
+    if (i < REPORT_SITES) {
+      LOG_INFO("Peak of %zu byte(s) from %s:%u, %" PRIu64
+               " allocation(s) of %" PRIu64 " byte(s) in total",
+               site->peak_bytes, site->file, site->line, site->allocs,
+               site->bytes);
+    }
+    if (site->live_count > 0) {
+      LOG_WARNING("%zu byte(s) in %zu allocation(s) from %s:%u still live",
+                  site->live_bytes, site->live_count, site->file,
+                  site->line);
+    }
+    frame_allocs += site->frame_allocs;
+  }
+
+  if (frame_allocs > 0) {
+    LOG_WARNING("%" PRIu64 " allocation(s) in the frame loop after warm-up",
+                frame_allocs);
+  }
+  free(sites);
+}
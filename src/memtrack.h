@@ -0,0 +1,56 @@
+#ifndef __ETERNO_MEMTRACK_H__
+#define __ETERNO_MEMTRACK_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Heap allocation tracking.
+ * @note If ENABLE_MEMTRACK is set, see CMakeLists.txt, xmalloc() and friends
+ *       in utils.h record the file and line of each call. Per call site, the
+ *       tracker counts allocations and bytes, and follows live and peak
+ *       bytes. Memory released with free(3) instead of xfree() is not seen,
+ *       and stays live in the reports. Otherwise the functions below are
+ *       still available, but nothing is recorded.
+ */
+
+/* What to do about heap allocations in the frame loop after the warm-up */
+typedef enum MemTrackMode {
+  MEMTRACK_OFF,
+  MEMTRACK_WARN,  /* Log the first allocation from each call site */
+  MEMTRACK_ABORT, /* Log and abort on the first allocation */
+} MemTrackMode;
+
+void *MemTrackMalloc(size_t size, const char *file, unsigned line);
+void *MemTrackCalloc(size_t nmemb, size_t size, const char *file,
+                     unsigned line);
+void *MemTrackRealloc(void *ptr, size_t size, const char *file,
+                      unsigned line);
+char *MemTrackStrdup(const char *str, const char *file, unsigned line);
+void MemTrackFree(void *ptr);
+
+/**
+ * @brief Parse and set what to do about allocations in the frame loop.
+ * @param mode Either "off", "warn" or "abort".
+ * @return False if the mode is not recognized.
+ */
+bool MemTrackSetMode(const char *mode);
+
+/**
+ * @brief Begin a frame.
+ * @note Call at the top of each iteration of the main loop. After
+ *       DEFAULT_MEMTRACK_WARMUP_FRAMES frames, heap allocations made by the
+ *       calling thread are reported according to the mode. Other threads are
+ *       not checked.
+ */
+void MemTrackFrame(void);
+
+/**
+ * @brief Stop checking for allocations in the frame loop, and log the call
+ *        sites with the highest peak and any that still hold memory.
+ * @note Memory of subsystems that outlive the caller, e.g. the logger, is
+ *       listed as well.
+ */
+void MemTrackReport(void);
+
+#endif // __ETERNO_MEMTRACK_H__
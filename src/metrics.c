@@ -0,0 +1,347 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_METRICS
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "logger.h"
+#include "metrics.h"
+#include "utils.h"
+
+/* Plain copy of the values of one or more shards */
+typedef struct MetricsTotals {
+  uint64_t counters[METRICS_COUNTER_COUNT];
+  uint64_t buckets[METRICS_HISTOGRAM_COUNT][METRICS_BUCKETS];
+  uint64_t sums[METRICS_HISTOGRAM_COUNT];
+  uint64_t maxima[METRICS_HISTOGRAM_COUNT];
+} MetricsTotals;
+
+#define METRICS_NAME(name, str) str,
+static const char *const COUNTER_NAMES[] = {METRICS_COUNTERS(METRICS_NAME)};
+static const char *const GAUGE_NAMES[] = {METRICS_GAUGES(METRICS_NAME)};
+static const char *const HISTOGRAM_NAMES[] = {
+    METRICS_HISTOGRAMS(METRICS_NAME)};
+#undef METRICS_NAME
+
+_Thread_local MetricsShard *METRICS_THREAD_SHARD = NULL;
+
+static atomic_int_least64_t GAUGES[METRICS_GAUGE_COUNT];
+
+static struct {
+  SDL_SpinLock lock; /* Guards the fields below */
+  MetricsShard *shards;
+  MetricsTotals retired; /* Folded in from threads that exited */
+  MetricsTotals totals;  /* As of the last frame */
+  uint64_t frame_maxima[METRICS_COUNTER_COUNT];
+  uint64_t frames;
+  MetricsTotals summary_totals; /* As of the last summary */
+  uint64_t summary_frames;
+  Uint64 summary_time;
+  bool summary;
+} METRICS;
+
+static SDL_TLSID SHARD_TLS;
+
+static void OnThreadExit(void *const value) {
+  MetricsShard *const shard = value;
+
+  SDL_LockSpinlock(&METRICS.lock);
+  for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    METRICS.retired.counters[i] += atomic_load(&shard->counters[i]);
+  }
+  for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+    for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+      METRICS.retired.buckets[i][j] += atomic_load(&shard->buckets[i][j]);
+    }
+    METRICS.retired.sums[i] += atomic_load(&shard->sums[i]);
+    METRICS.retired.maxima[i] =
+        MAX(METRICS.retired.maxima[i], atomic_load(&shard->maxima[i]));
+  }
+
+  for (MetricsShard **link = &METRICS.shards; *link != NULL;
+       link = &(*link)->next) {
+    if (*link == shard) {
+      *link = shard->next;
+      break;
+    }
+  }
+  SDL_UnlockSpinlock(&METRICS.lock);
+
+  xfree(shard);
+  METRICS_THREAD_SHARD = NULL;
+}
+
+MetricsShard *MetricsAttachThread(void) {
+  assert(METRICS_THREAD_SHARD == NULL);
+
+  MetricsShard *const shard = xcalloc(1, sizeof(MetricsShard));
+  SDL_LockSpinlock(&METRICS.lock);
+  shard->next = METRICS.shards;
+  METRICS.shards = shard;
+  SDL_UnlockSpinlock(&METRICS.lock);
+
+  METRICS_THREAD_SHARD = shard;
+  SDL_SetTLS(&SHARD_TLS, shard, OnThreadExit);
+  return shard;
+}
+
+void MetricsSet(const MetricsGauge gauge, const int64_t value) {
+  assert(gauge < METRICS_GAUGE_COUNT);
+  atomic_store_explicit(&GAUGES[gauge], value, memory_order_relaxed);
+}
+
+/**
+ * @brief Sum up the shards of all threads.
+ * @note The lock must be held.
+ */
+static void Collect(MetricsTotals *const totals) {
+  *totals = METRICS.retired;
+  for (const MetricsShard *shard = METRICS.shards; shard != NULL;
+       shard = shard->next) {
+    for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+      totals->counters[i] +=
+          atomic_load_explicit(&shard->counters[i], memory_order_relaxed);
+    }
+    for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+      for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+        totals->buckets[i][j] +=
+            atomic_load_explicit(&shard->buckets[i][j], memory_order_relaxed);
+      }
+      totals->sums[i] +=
+          atomic_load_explicit(&shard->sums[i], memory_order_relaxed);
+      const uint64_t maximum =
+          atomic_load_explicit(&shard->maxima[i], memory_order_relaxed);
+      totals->maxima[i] = MAX(totals->maxima[i], maximum);
+    }
+  }
+}
+
+static uint64_t HistogramCount(const MetricsTotals *const totals,
+                               const size_t histogram) {
+  uint64_t count = 0;
+  for (size_t i = 0; i < METRICS_BUCKETS; i++) {
+    count += totals->buckets[histogram][i];
+  }
+  return count;
+}
+
+/**
+ * @brief Estimate a quantile of a histogram as the upper bound of the bucket
+ *        it falls into.
+ */
+static uint64_t HistogramQuantile(const MetricsTotals *const totals,
+                                  const size_t histogram,
+                                  const double quantile) {
+  const uint64_t count = HistogramCount(totals, histogram);
+  if (count == 0) {
+    return 0;
+  }
+
+  const uint64_t rank = (uint64_t)(quantile * (double)(count - 1)) + 1;
+  uint64_t seen = 0;
+  size_t bucket = 0;
+  for (; bucket < METRICS_BUCKETS - 1; bucket++) {
+    seen += totals->buckets[histogram][bucket];
+    if (seen >= rank) {
+      break;
+    }
+  }
+
+  const uint64_t bound = (bucket == 0) ? 0 : (UINT64_C(1) << bucket) - 1;
+  return MIN(bound, totals->maxima[histogram]);
+}
+
+static double Mean(const uint64_t sum, const uint64_t count) {
+  return (count > 0) ? (double)sum / (double)count : 0.0;
+}
+
+static void LogSummary(const MetricsTotals *const now,
+                       const MetricsTotals *const then, const uint64_t frames,
+                       const Uint64 elapsed_ns) {
+  LOG_INFO("Metrics of the last %.1f s (%llu frames):",
+           (double)elapsed_ns / 1e9, (unsigned long long)frames);
+
+  for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    const uint64_t delta = now->counters[i] - then->counters[i];
+    LOG_INFO("  %-20s %12llu  %10.2f/frame", COUNTER_NAMES[i],
+             (unsigned long long)delta, Mean(delta, frames));
+  }
+  for (size_t i = 0; i < METRICS_GAUGE_COUNT; i++) {
+    LOG_INFO("  %-20s %12lld", GAUGE_NAMES[i],
+             (long long)atomic_load_explicit(&GAUGES[i],
+                                             memory_order_relaxed));
+  }
+  for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+    MetricsTotals delta;
+    uint64_t count = 0;
+    for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+      delta.buckets[i][j] = now->buckets[i][j] - then->buckets[i][j];
+      count += delta.buckets[i][j];
+    }
+    /* The maximum is not windowed, so it only bounds the quantiles */
+    delta.maxima[i] = now->maxima[i];
+    LOG_INFO("  %-20s %12llu  mean %.2f, p50 <= %llu, p99 <= %llu",
+             HISTOGRAM_NAMES[i], (unsigned long long)count,
+             Mean(now->sums[i] - then->sums[i], count),
+             (unsigned long long)HistogramQuantile(&delta, i, 0.5),
+             (unsigned long long)HistogramQuantile(&delta, i, 0.99));
+  }
+}
+
+void MetricsFrame(void) {
+  MetricsTotals now;
+
+  SDL_LockSpinlock(&METRICS.lock);
+  Collect(&now);
+  for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    const uint64_t delta = now.counters[i] - METRICS.totals.counters[i];
+    METRICS.frame_maxima[i] = MAX(METRICS.frame_maxima[i], delta);
+  }
+  METRICS.totals = now;
+  METRICS.frames += 1;
+
+  const Uint64 time = SDL_GetTicksNS();
+  if (METRICS.summary_time == 0) {
+    METRICS.summary_time = time;
+  }
+  const Uint64 elapsed = time - METRICS.summary_time;
+  const bool summary =
+      METRICS.summary &&
+      elapsed >= (Uint64)DEFAULT_METRICS_SUMMARY_INTERVAL_MS * 1000000;
+  MetricsTotals then;
+  uint64_t frames = 0;
+  if (summary) {
+    then = METRICS.summary_totals;
+    frames = METRICS.frames - METRICS.summary_frames;
+    METRICS.summary_totals = now;
+    METRICS.summary_frames = METRICS.frames;
+    METRICS.summary_time = time;
+  }
+  SDL_UnlockSpinlock(&METRICS.lock);
+
+  /* Log outside the lock, as logging may record metrics itself */
+  if (summary) {
+    LogSummary(&now, &then, frames, elapsed);
+  }
+}
+
+void MetricsEnableSummary(const bool enable) {
+  SDL_LockSpinlock(&METRICS.lock);
+  METRICS.summary = enable;
+  SDL_UnlockSpinlock(&METRICS.lock);
+}
+
+static void FormatCsv(Buffer *const buf, const MetricsTotals *const totals,
+                      const uint64_t *const frame_maxima,
+                      const uint64_t frames) {
+  BufferPrint(buf, "type,name,value,mean,max,p50,p99\n");
+  for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    /* The mean and maximum of counters are per frame */
+    BufferPrintFormat(buf, "counter,%s,%llu,%.3f,%llu,,\n", COUNTER_NAMES[i],
+                      (unsigned long long)totals->counters[i],
+                      Mean(totals->counters[i], frames),
+                      (unsigned long long)frame_maxima[i]);
+  }
+  for (size_t i = 0; i < METRICS_GAUGE_COUNT; i++) {
+    BufferPrintFormat(buf, "gauge,%s,%lld,,,,\n", GAUGE_NAMES[i],
+                      (long long)atomic_load(&GAUGES[i]));
+  }
+  for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+    const uint64_t count = HistogramCount(totals, i);
+    BufferPrintFormat(
+        buf, "histogram,%s,%llu,%.3f,%llu,%llu,%llu\n", HISTOGRAM_NAMES[i],
+        (unsigned long long)count, Mean(totals->sums[i], count),
+        (unsigned long long)totals->maxima[i],
+        (unsigned long long)HistogramQuantile(totals, i, 0.5),
+        (unsigned long long)HistogramQuantile(totals, i, 0.99));
+  }
+}
+
+static void FormatJson(Buffer *const buf, const MetricsTotals *const totals,
+                       const uint64_t *const frame_maxima,
+                       const uint64_t frames) {
+  BufferPrintFormat(buf, "{\n  \"frames\": %llu,\n  \"counters\": {",
+                    (unsigned long long)frames);
+  for (size_t i = 0; i < METRICS_COUNTER_COUNT; i++) {
+    BufferPrintFormat(buf,
+                      "%s\n    \"%s\": {\"total\": %llu, "
+                      "\"per_frame_mean\": %.3f, \"per_frame_max\": %llu}",
+                      (i == 0) ? "" : ",", COUNTER_NAMES[i],
+                      (unsigned long long)totals->counters[i],
+                      Mean(totals->counters[i], frames),
+                      (unsigned long long)frame_maxima[i]);
+  }
+
+  BufferPrint(buf, "\n  },\n  \"gauges\": {");
+  for (size_t i = 0; i < METRICS_GAUGE_COUNT; i++) {
+    BufferPrintFormat(buf, "%s\n    \"%s\": %lld", (i == 0) ? "" : ",",
+                      GAUGE_NAMES[i], (long long)atomic_load(&GAUGES[i]));
+  }
+
+  BufferPrint(buf, "\n  },\n  \"histograms\": {");
+  for (size_t i = 0; i < METRICS_HISTOGRAM_COUNT; i++) {
+    const uint64_t count = HistogramCount(totals, i);
+    BufferPrintFormat(
+        buf,
+        "%s\n    \"%s\": {\"count\": %llu, \"mean\": %.3f, \"max\": %llu, "
+        "\"p50\": %llu, \"p99\": %llu, \"buckets\": [",
+        (i == 0) ? "" : ",", HISTOGRAM_NAMES[i], (unsigned long long)count,
+        Mean(totals->sums[i], count), (unsigned long long)totals->maxima[i],
+        (unsigned long long)HistogramQuantile(totals, i, 0.5),
+        (unsigned long long)HistogramQuantile(totals, i, 0.99));
+    for (size_t j = 0; j < METRICS_BUCKETS; j++) {
+      BufferPrintFormat(buf, "%s%llu", (j == 0) ? "" : ", ",
+                        (unsigned long long)totals->buckets[i][j]);
+    }
+    BufferPrint(buf, "]}");
+  }
+  BufferPrint(buf, "\n  }\n}\n");
+}
+
+bool MetricsWrite(const char *const filename) {
+  assert(filename != NULL);
+
+  MetricsTotals totals;
+  uint64_t frame_maxima[METRICS_COUNTER_COUNT];
+  SDL_LockSpinlock(&METRICS.lock);
+  Collect(&totals);
+  memcpy(frame_maxima, METRICS.frame_maxima, sizeof(frame_maxima));
+  const uint64_t frames = METRICS.frames;
+  SDL_UnlockSpinlock(&METRICS.lock);
+
+  Buffer *const buf = BufferCreate();
+  if (SliceEndsWith(SliceFromString(filename), SliceFromString(".json"))) {
+    FormatJson(buf, &totals, frame_maxima, frames);
+  } else {
+    FormatCsv(buf, &totals, frame_maxima, frames);
+  }
+
+  FILE *const file = fopen(filename, "w");
+  if (file == NULL) {
+    LOG_ERROR("Failed to open file '%s' for writing: %s", filename,
+              strerror(errno));
+    BufferDestroy(buf);
+    return false;
+  }
+
+  bool success = true;
+  if (fwrite(BufferData(buf), 1, BufferLength(buf), file) !=
+      BufferLength(buf)) {
+    LOG_ERROR("Failed to write file '%s': %s", filename, strerror(errno));
+    success = false;
+  }
+  if (fclose(file) != 0 && success) {
+    LOG_ERROR("Failed to close file '%s': %s", filename, strerror(errno));
+    success = false;
+  }
+
+  BufferDestroy(buf);
+  return success;
+}
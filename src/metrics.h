@@ -0,0 +1,164 @@
+#ifndef __ETERNO_METRICS_H__
+#define __ETERNO_METRICS_H__
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Registry of named counters, gauges and histograms.
+ * @note Counters and histograms accumulate in per-thread shards, so that
+ *       recording is a plain add without atomic read-modify-write or shared
+ *       cache lines. MetricsFrame() merges the shards once per frame. Gauges
+ *       hold the last value set by any thread. Recording compiles to nothing
+ *       unless ENABLE_METRICS is set, see CMakeLists.txt.
+ */
+
+/* To add a metric, add a line to one of the lists below */
+#define METRICS_COUNTERS(X)                                                    \
+  X(DRAW_CALLS, "draw_calls")                                                  \
+  X(TEXTURE_SWITCHES, "texture_switches")                                      \
+  X(TEXTURE_LOADS, "texture_loads")                                            \
+  X(DICT_REHASHES, "dict_rehashes")                                            \
+  X(LIST_GROWTHS, "list_growths")                                              \
+  X(FILE_BYTES_READ, "file_bytes_read")                                        \
+  X(CHUNK_LOADS, "chunk_loads")
+
+#define METRICS_GAUGES(X)                                                      \
+  X(TEXTURES, "textures")                                                      \
+  X(LEVEL_CHUNKS, "level_chunks")                                              \
+  X(LEVEL_BYTES, "level_bytes")
+
+#define METRICS_HISTOGRAMS(X)                                                  \
+  X(DICT_PROBE_LENGTH, "dict_probe_length")                                    \
+  X(UPDATE_TIME_US, "update_time_us")                                          \
+  X(RENDER_TIME_US, "render_time_us")                                          \
+  X(FRAME_TIME_US, "frame_time_us")
+
+#define METRICS_ENUM(name, str) METRICS_##name,
+typedef enum MetricsCounter {
+  METRICS_COUNTERS(METRICS_ENUM) METRICS_COUNTER_COUNT
+} MetricsCounter;
+typedef enum MetricsGauge {
+  METRICS_GAUGES(METRICS_ENUM) METRICS_GAUGE_COUNT
+} MetricsGauge;
+typedef enum MetricsHistogram {
+  METRICS_HISTOGRAMS(METRICS_ENUM) METRICS_HISTOGRAM_COUNT
+} MetricsHistogram;
+#undef METRICS_ENUM
+
+/* Histogram bucket 0 holds zeros and bucket i > 0 holds values in
+ * [2^(i-1), 2^i). The last bucket also holds everything larger. */
+#define METRICS_BUCKETS 32
+
+/**
+ * @brief Metrics recorded by one thread.
+ * @note Only the owning thread writes to a shard, so the values are atomic
+ *       only to let MetricsFrame() read them. They are updated with a relaxed
+ *       load and store, not a locked add.
+ */
+typedef struct MetricsShard {
+  atomic_uint_least64_t counters[METRICS_COUNTER_COUNT];
+  atomic_uint_least64_t buckets[METRICS_HISTOGRAM_COUNT][METRICS_BUCKETS];
+  atomic_uint_least64_t sums[METRICS_HISTOGRAM_COUNT];
+  atomic_uint_least64_t maxima[METRICS_HISTOGRAM_COUNT];
+  struct MetricsShard *next;
+} MetricsShard;
+
+/* The shard of the calling thread, or NULL until it records something */
+extern _Thread_local MetricsShard *METRICS_THREAD_SHARD;
+
+/**
+ * @brief Create and register the shard of the calling thread.
+ * @return The shard.
+ * @note Its values are folded into the totals when the thread exits.
+ */
+MetricsShard *MetricsAttachThread(void);
+
+static inline MetricsShard *MetricsGetShard(void) {
+  MetricsShard *const shard = METRICS_THREAD_SHARD;
+  return (shard != NULL) ? shard : MetricsAttachThread();
+}
+
+static inline void MetricsBump(atomic_uint_least64_t *const value,
+                               const uint64_t n) {
+  atomic_store_explicit(
+      value, atomic_load_explicit(value, memory_order_relaxed) + n,
+      memory_order_relaxed);
+}
+
+/**
+ * @brief Add to a counter.
+ * @param counter The counter.
+ * @param n Amount to add.
+ */
+static inline void MetricsAdd(const MetricsCounter counter, const uint64_t n) {
+  MetricsBump(&MetricsGetShard()->counters[counter], n);
+}
+
+/**
+ * @brief Record a value in a histogram.
+ * @param histogram The histogram.
+ * @param value The value.
+ */
+static inline void MetricsObserve(const MetricsHistogram histogram,
+                                  const uint64_t value) {
+  MetricsShard *const shard = MetricsGetShard();
+  const unsigned bucket =
+      (value == 0) ? 0 : (unsigned)(64 - __builtin_clzll(value));
+  MetricsBump(&shard->buckets[histogram][(bucket < METRICS_BUCKETS)
+                                             ? bucket
+                                             : METRICS_BUCKETS - 1],
+              1);
+  MetricsBump(&shard->sums[histogram], value);
+  if (value > atomic_load_explicit(&shard->maxima[histogram],
+                                   memory_order_relaxed)) {
+    atomic_store_explicit(&shard->maxima[histogram], value,
+                          memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Set a gauge.
+ * @param gauge The gauge.
+ * @param value The value.
+ */
+void MetricsSet(MetricsGauge gauge, int64_t value);
+
+#ifdef ENABLE_METRICS
+#define METRICS_ADD(name, n) MetricsAdd(METRICS_##name, n)
+#define METRICS_OBSERVE(name, value) MetricsObserve(METRICS_##name, value)
+#define METRICS_SET(name, value) MetricsSet(METRICS_##name, value)
+#else
+/* Not evaluated, but still counted as used */
+#define METRICS_ADD(name, n) ((void)sizeof(n))
+#define METRICS_OBSERVE(name, value) ((void)sizeof(value))
+#define METRICS_SET(name, value) ((void)sizeof(value))
+#endif
+
+/**
+ * @brief Merge the shards of all threads and end the frame.
+ * @note Call once per frame. Tracks the largest per-frame increase of each
+ *       counter, and logs a summary every DEFAULT_METRICS_SUMMARY_INTERVAL_MS
+ *       if enabled with MetricsEnableSummary().
+ */
+void MetricsFrame(void);
+
+/**
+ * @brief Log a summary of the metrics periodically from MetricsFrame().
+ * @param enable Whether to log the summary.
+ */
+void MetricsEnableSummary(bool enable);
+
+/**
+ * @brief Write all metrics to a file.
+ * @param filename Path to file. Written as JSON if it ends with ".json",
+ *                 otherwise as CSV.
+ * @return False if the file could not be written.
+ * @note Merges the shards first, like MetricsFrame() but without ending the
+ *       frame.
+ */
+bool MetricsWrite(const char *filename);
+
+#endif // __ETERNO_METRICS_H__
@@ -0,0 +1,66 @@
+#include "config.h"
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+
+#include "collision.h"
+#include "physics.h"
+#include "utils.h"
+#include "vector.h"
+
+/* Number of substeps needed to move at most max_substep pixels each */
+static int CountSubsteps(const PhysicsParams *const params,
+                         const Vector *const velocity, const float dt) {
+  if (params->max_substep <= 0.0f) {
+    return 1;
+  }
+
+  const float distance = VectorMag(velocity) * dt;
+  const float substeps = SDL_ceilf(distance / params->max_substep);
+  if (substeps <= 1.0f) {
+    return 1;
+  }
+  if (substeps >= PHYSICS_MAX_SUBSTEPS) {
+    return PHYSICS_MAX_SUBSTEPS;
+  }
+  return (int)substeps;
+}
+
+CollisionContacts PhysicsStep(CollisionWorld *const world,
+                              const PhysicsParams *const params,
+                              CollisionBox *const box, Vector *const velocity,
+                              const float dt) {
+  assert(world != NULL);
+  assert(params != NULL);
+  assert(box != NULL);
+  assert(velocity != NULL);
+  assert(dt >= 0.0f);
+
+  const int substeps = CountSubsteps(params, velocity, dt);
+  const float h = dt / (float)substeps;
+
+  CollisionContacts contacts = 0;
+  for (int i = 0; i < substeps; i++) {
+    velocity->y += params->gravity * h;
+    if (params->max_fall_speed > 0.0f && velocity->y > params->max_fall_speed) {
+      velocity->y = params->max_fall_speed;
+    }
+
+    Vector motion = *velocity;
+    VectorMul(&motion, h);
+    contacts = CollisionMove(world, box, &motion);
+
+    /* Stop moving into solids, so that velocity does not build up while
+     * resting against them */
+    if (((contacts & COLLISION_GROUND) && velocity->y > 0.0f) ||
+        ((contacts & COLLISION_CEILING) && velocity->y < 0.0f)) {
+      velocity->y = 0.0f;
+    }
+    if (((contacts & COLLISION_WALL_RIGHT) && velocity->x > 0.0f) ||
+        ((contacts & COLLISION_WALL_LEFT) && velocity->x < 0.0f)) {
+      velocity->x = 0.0f;
+    }
+  }
+
+  return contacts;
+}
@@ -0,0 +1,39 @@
+#ifndef __ETERNO_PHYSICS_H__
+#define __ETERNO_PHYSICS_H__
+
+#include "collision.h"
+#include "vector.h"
+
+/* Upper bound on substeps per step, however fast a body moves */
+#define PHYSICS_MAX_SUBSTEPS 8
+
+/**
+ * @brief Tunable constants of a body.
+ * @note Distances are in pixels and times in seconds, so that bodies behave
+ *       the same at any tick rate.
+ */
+typedef struct {
+  float gravity;        /* Downward acceleration in px/s^2 */
+  float max_fall_speed; /* Terminal velocity in px/s, or 0 for none */
+  float max_substep;    /* Longest move per substep in px, or 0 for one */
+} PhysicsParams;
+
+/**
+ * @brief Advance a body by one time step.
+ * @param world The collision world.
+ * @param params Constants of the body.
+ * @param box The body's box. Updated to its new position.
+ * @param velocity The body's velocity in px/s. Updated by gravity, and
+ *                 stopped in directions blocked by solids.
+ * @param dt Length of the step in seconds.
+ * @return The sides of the box touching a solid after the step.
+ * @note Integrates with semi-implicit Euler: velocity first, then position
+ *       from the new velocity. A body moving further than max_substep in one
+ *       step is advanced in several equal substeps, up to
+ *       PHYSICS_MAX_SUBSTEPS, so that it follows its arc more closely.
+ */
+CollisionContacts PhysicsStep(CollisionWorld *world,
+                              const PhysicsParams *params, CollisionBox *box,
+                              Vector *velocity, float dt);
+
+#endif /* __ETERNO_PHYSICS_H__ */
@@ -1,17 +1,24 @@
 #include "config.h"
 
+#define LOG_MODULE LOG_MODULE_PLAYER
+
 #include <SDL3_image/SDL_image.h>
 #include <assert.h>
 
+#include "animation.h"
+#include "atom.h"
+#include "collision.h"
+#include "input.h"
 #include "logger.h"
+#include "physics.h"
 #include "player.h"
 #include "texture.h"
 #include "utils.h"
 #include "vector.h"
 
-#define FRAME_DURATION 100 /* ms */
+#define FRAME_DURATION 0.1f /* s */
 
-static const char *const texture_ids[] = {
+static const char *const texture_names[] = {
     "player/idle", "player/walk",   "player/run", "player/jump",
     "player/fall", "player/attack", "player/die",
 };
@@ -26,111 +33,99 @@ typedef enum {
   PLAYER_DIE,
 } PlayerState;
 
+/* Animation conditions */
+enum {
+  PLAYER_RISING = 1 << 0,
+  PLAYER_FALLING = 1 << 1,
+  PLAYER_MOVING = 1 << 2,
+  PLAYER_RUNNING = 1 << 3,
+};
+
+/* Tried in order, so airborne states take precedence */
+static const AnimationTransition TRANSITIONS[] = {
+    {ANIMATION_ANY_STATE, PLAYER_JUMP, PLAYER_RISING, 0},
+    {ANIMATION_ANY_STATE, PLAYER_FALL, PLAYER_FALLING, 0},
+    {ANIMATION_ANY_STATE, PLAYER_RUN, PLAYER_MOVING | PLAYER_RUNNING,
+     PLAYER_RISING | PLAYER_FALLING},
+    {ANIMATION_ANY_STATE, PLAYER_WALK, PLAYER_MOVING,
+     PLAYER_RUNNING | PLAYER_RISING | PLAYER_FALLING},
+    {ANIMATION_ANY_STATE, PLAYER_IDLE, 0,
+     PLAYER_MOVING | PLAYER_RISING | PLAYER_FALLING},
+};
+
 typedef struct {
   struct GameObject super;
-  PlayerState state;
-  Uint32 jump_start;
-  Uint32 frame_start;
-  unsigned frame_index;
+  CollisionWorld *world;
+  CollisionContacts contacts; /* Sides touching a solid after the last move */
+  AnimationSystem *animations;
+  AnimationGraph *graph;
+  AnimatorId animator;
   SDL_FlipMode flip;
+  Atom texture_ids[LENGTH(texture_names)];
 } Player;
 
-#define WALK_VELOCITY 1.5f
-#define RUN_VELOCITY 3.0f
-#define JUMP_VELOCITY 3.0f
-#define GRAVITY 0.00028f
-
-static bool OnEvent(GameObject *game_object, const SDL_Event *event) {
-  assert(game_object != NULL);
-  assert(event != NULL);
-
-  Player *player = (Player *)game_object;
-  (void)player;
-  return true;
-}
+/* State saved for rewinding, without padding */
+typedef struct {
+  Vector position;
+  Vector velocity;
+  uint32_t contacts;
+  uint32_t flip;
+  AnimatorState animator;
+} SavedPlayer;
+
+/* Speeds in px/s and accelerations in px/s^2. The jump peaks about 72 px up
+ * after 0.6 s. */
+#define WALK_VELOCITY 90.0f
+#define RUN_VELOCITY 180.0f
+#define JUMP_VELOCITY 240.0f
+
+static const PhysicsParams PHYSICS = {
+    .gravity = 400.0f,
+    .max_fall_speed = 600.0f,
+    .max_substep = 8.0f,
+};
 
-static bool OnUpdate(GameObject *game_object) {
+static bool OnUpdate(GameObject *game_object, const InputSnapshot *input,
+                     float dt) {
   assert(game_object != NULL);
+  assert(input != NULL);
   Player *player = (Player *)game_object;
 
-  const Uint32 frame_time = SDL_GetTicks();
-  const bool *keyboard_state = SDL_GetKeyboardState(NULL);
-
-  /* Move player up and down */
-  if (player->super.position.y >=
-      (RENDER_TARGET_HEIGHT - player->super.size.height)) {
-    /* Player is colliding with floor */
-    player->super.position.y =
-        (RENDER_TARGET_HEIGHT - player->super.size.height);
-    player->super.velocity.y = 0.0f;
-
-    if (keyboard_state[SDL_SCANCODE_SPACE]) {
-      /* Player wants to jump */
-      player->super.velocity.y -= JUMP_VELOCITY;
-      player->jump_start = frame_time;
-    }
-  } else {
-    /* Player is in the air */
-    player->super.velocity.y += GRAVITY * (frame_time - player->jump_start);
+  /* Jump from the ground */
+  if ((player->contacts & COLLISION_GROUND) &&
+      InputIsDown(input, INPUT_JUMP)) {
+    player->super.velocity.y = -JUMP_VELOCITY;
   }
 
   /* Move player left and right */
-  bool is_running = keyboard_state[SDL_SCANCODE_LSHIFT];
+  bool is_running = InputIsDown(input, INPUT_RUN);
   player->super.velocity.x = 0.0f;
-  if (player->super.position.x <= 0.0f) {
-    /* Player is colliding with left wall */
-    player->super.position.x = 0.0f;
-  } else {
-    if (keyboard_state[SDL_SCANCODE_A]) {
-      /* Player wants to walk to the left */
-      player->super.velocity.x -= (is_running) ? RUN_VELOCITY : WALK_VELOCITY;
-    }
+  if (InputIsDown(input, INPUT_MOVE_LEFT) &&
+      !(player->contacts & COLLISION_WALL_LEFT)) {
+    /* Player wants to walk to the left */
+    player->super.velocity.x -= (is_running) ? RUN_VELOCITY : WALK_VELOCITY;
   }
-  if (player->super.position.x >=
-      (RENDER_TARGET_WIDTH - player->super.size.width)) {
-    /* Player is colliding with right wall */
-    player->super.position.x = (RENDER_TARGET_WIDTH - player->super.size.width);
-  } else {
-    if (keyboard_state[SDL_SCANCODE_D]) {
-      /* Player wants to walk to the right */
-      player->super.velocity.x += (is_running) ? RUN_VELOCITY : WALK_VELOCITY;
-    }
+  if (InputIsDown(input, INPUT_MOVE_RIGHT) &&
+      !(player->contacts & COLLISION_WALL_RIGHT)) {
+    /* Player wants to walk to the right */
+    player->super.velocity.x += (is_running) ? RUN_VELOCITY : WALK_VELOCITY;
   }
 
-  /* Update sprite sheet */
+  /* Choose the sprite sheet, which the animation system switches to */
+  uint32_t conditions = 0;
   if (player->super.velocity.y < 0.0f) {
-    if (player->state != PLAYER_JUMP) {
-      player->state = PLAYER_JUMP;
-      player->frame_start = frame_time;
-      player->frame_index = 0;
-    }
+    conditions |= PLAYER_RISING;
   } else if (player->super.velocity.y > 0.0f) {
-    if (player->state != PLAYER_FALL) {
-      player->state = PLAYER_FALL;
-      player->frame_start = frame_time;
-      player->frame_index = 0;
-    }
-  } else if (player->super.velocity.x != 0.0f) {
-    if (is_running) {
-      if (player->state != PLAYER_RUN) {
-        player->state = PLAYER_RUN;
-        player->frame_start = frame_time;
-        player->frame_index = 0;
-      }
-    } else {
-      if (player->state != PLAYER_WALK) {
-        player->state = PLAYER_WALK;
-        player->frame_start = frame_time;
-        player->frame_index = 0;
-      }
-    }
-  } else {
-    if (player->state != PLAYER_IDLE) {
-      player->state = PLAYER_IDLE;
-      player->frame_start = frame_time;
-      player->frame_index = 0;
-    }
+    conditions |= PLAYER_FALLING;
+  }
+  if (player->super.velocity.x != 0.0f) {
+    conditions |= PLAYER_MOVING;
   }
+  if (is_running) {
+    conditions |= PLAYER_RUNNING;
+  }
+  AnimationSystemSetConditions(player->animations, player->animator,
+                               conditions);
 
   /* Flip texture based on direction */
   if (player->super.velocity.x < 0.0f) {
@@ -139,40 +134,32 @@ static bool OnUpdate(GameObject *game_object) {
     player->flip = SDL_FLIP_HORIZONTAL;
   }
 
-  /* Update fame index */
-  if ((frame_time - player->frame_start) >= FRAME_DURATION) {
-    player->frame_index += 1;
-    player->frame_start = frame_time;
-  }
-
-  /* Update player position */
-  VectorAdd(&player->super.position, &player->super.velocity);
+  /* Apply gravity and move, stopping at solids */
+  CollisionBox box = {player->super.position, player->super.size};
+  player->contacts = PhysicsStep(player->world, &PHYSICS, &box,
+                                 &player->super.velocity, dt);
+  player->super.position = box.position;
 
   return true;
 }
 
 static bool OnDraw(GameObject *game_object, TextureMap *texture_map,
-                   SDL_Renderer *renderer) {
+                   SDL_Renderer *renderer, const Vector *camera) {
   assert(game_object != NULL);
   assert(renderer != NULL);
 
   Player *player = (Player *)game_object;
-  const char *texture_id = texture_ids[player->state];
-
-  float texture_width;
-  if (!TextureMapGetTextureSize(texture_map, texture_id, &texture_width,
-                                NULL)) {
-    LOG_ERROR("Failed to get size of texture '%s'", texture_id);
-    return false;
-  }
 
-  int num_frames = (int)(texture_width / player->super.size.width);
-  int column = player->frame_index % num_frames;
+  Atom texture_id;
+  unsigned column;
+  AnimationSystemGetFrame(player->animations, player->animator, &texture_id,
+                          &column);
 
   if (!TextureMapDrawFrame(texture_map, texture_id, renderer,
-                           player->super.position.x, player->super.position.y,
+                           player->super.position.x - camera->x,
+                           player->super.position.y - camera->y,
                            player->super.size.width, player->super.size.height,
-                           column, 0, 0.0, 255, player->flip)) {
+                           (int)column, 0, 0.0, 255, player->flip)) {
     LOG_ERROR("Failed to draw frame");
     return false;
   }
@@ -180,22 +167,60 @@ static bool OnDraw(GameObject *game_object, TextureMap *texture_map,
   return true;
 }
 
+static void OnSave(const GameObject *game_object, void *state) {
+  const Player *player = (const Player *)game_object;
+
+  SavedPlayer saved;
+  memset(&saved, 0, sizeof(saved));
+  saved.position = player->super.position;
+  saved.velocity = player->super.velocity;
+  saved.contacts = player->contacts;
+  saved.flip = (uint32_t)player->flip;
+  AnimationSystemSave(player->animations, player->animator, &saved.animator);
+  memcpy(state, &saved, sizeof(saved));
+}
+
+static void OnLoad(GameObject *game_object, const void *state) {
+  Player *player = (Player *)game_object;
+
+  SavedPlayer saved;
+  memcpy(&saved, state, sizeof(saved));
+  player->super.position = saved.position;
+  player->super.velocity = saved.velocity;
+  player->contacts = saved.contacts;
+  player->flip = (SDL_FlipMode)saved.flip;
+  AnimationSystemLoad(player->animations, player->animator, &saved.animator);
+}
+
 static void OnClean(GameObject *game_object, TextureMap *texture_map) {
   assert(game_object != NULL);
   assert(texture_map != NULL);
 
   Player *player = (Player *)game_object;
 
-  for (size_t i = 0; i < LENGTH(texture_ids); i++) {
-    const char *id = texture_ids[i];
+  if (player->graph != NULL) {
+    AnimationSystemRemove(player->animations, player->animator);
+    AnimationGraphDestroy(player->graph);
+  }
+
+  for (size_t i = 0; i < LENGTH(player->texture_ids); i++) {
+    const Atom id = player->texture_ids[i];
+    if (id == NULL) {
+      /* Texture was never loaded */
+      continue;
+    }
     LOG_DEBUG("Destroying texture '%s'", id);
     TextureMapClearTexture(texture_map, id);
   }
 
-  free(player);
+  xfree(player);
 }
 
-GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer) {
+GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer,
+                         CollisionWorld *world, AnimationSystem *animations) {
+  assert(world != NULL);
+  assert(animations != NULL);
+
   int width, height;
   if (!SDL_GetRenderOutputSize(renderer, &width, &height)) {
     LOG_ERROR("Failed to get render output size");
@@ -205,6 +230,9 @@ GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer) {
   Player *player = xmalloc(sizeof(Player));
   memset(player, 0, sizeof(Player));
 
+  player->world = world;
+  player->animations = animations;
+
   player->super.size.width = 80.0f;
   player->super.size.height = 64.0f;
 
@@ -215,18 +243,17 @@ GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer) {
   player->super.velocity.x = 0.0f;
   player->super.velocity.y = 0.0f;
 
-  player->super.callback.event = OnEvent;
   player->super.callback.update = OnUpdate;
   player->super.callback.draw = OnDraw;
   player->super.callback.clean = OnClean;
+  player->super.callback.save = OnSave;
+  player->super.callback.load = OnLoad;
+  player->super.state_size = sizeof(SavedPlayer);
 
-  player->state = PLAYER_FALL;
-  player->jump_start = player->frame_start = SDL_GetTicks();
-  player->frame_index = 0;
   player->flip = SDL_FLIP_NONE;
 
-  for (size_t i = 0; i < LENGTH(texture_ids); i++) {
-    const char *id = texture_ids[i];
+  for (size_t i = 0; i < LENGTH(texture_names); i++) {
+    const Atom id = AtomIntern(texture_names[i]);
 
     char file[PATH_MAX];
     int ret = snprintf(file, sizeof(file), "assets/%s.png", id);
@@ -242,7 +269,33 @@ GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer) {
       GameObjectDestroy((GameObject *)player, texture_map);
       return NULL;
     }
+    player->texture_ids[i] = id;
   }
 
+  /* One clip per sprite sheet, with as many frames as fit in its width */
+  AnimationClip clips[LENGTH(texture_names)];
+  for (size_t i = 0; i < LENGTH(texture_names); i++) {
+    const Atom id = player->texture_ids[i];
+    float texture_width;
+    if (!TextureMapGetTextureSize(texture_map, id, &texture_width, NULL)) {
+      LOG_ERROR("Failed to get size of texture '%s'", id);
+      GameObjectDestroy((GameObject *)player, texture_map);
+      return NULL;
+    }
+
+    const unsigned n_frames =
+        (unsigned)(texture_width / player->super.size.width);
+    clips[i] = (AnimationClip){
+        .texture = id,
+        .n_frames = MAX(n_frames, 1u),
+        .frame_duration = FRAME_DURATION,
+        .loop = true,
+    };
+  }
+
+  player->graph = AnimationGraphCreate(clips, LENGTH(clips), TRANSITIONS,
+                                       LENGTH(TRANSITIONS), PLAYER_FALL);
+  player->animator = AnimationSystemAdd(animations, player->graph);
+
   return (GameObject *)player;
 }
@@ -1,8 +1,11 @@
 #ifndef __ETERNO_PLAYER_H__
 #define __ETERNO_PLAYER_H__
 
+#include "animation.h"
+#include "collision.h"
 #include "game_object.h"
 
-GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer);
+GameObject *PlayerCreate(TextureMap *texture_map, SDL_Renderer *renderer,
+                         CollisionWorld *world, AnimationSystem *animations);
 
 #endif /* __ETERNO_PLAYER_H__ */
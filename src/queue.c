@@ -0,0 +1,558 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "logger.h"
+#include "queue.h"
+#include "utils.h"
+
+#define CACHE_LINE_SIZE 64
+
+/* Number of attempts before a blocking call goes to sleep */
+#define SPIN_COUNT 128
+
+/**
+ * @brief Sleeping side of a queue, e.g. consumers waiting for elements.
+ * @note The other side only takes the lock if someone is waiting, so the
+ *       non-blocking fast path never touches the mutex.
+ */
+typedef struct Waiter {
+  SDL_Mutex *lock;
+  SDL_Condition *condition;
+  atomic_uint waiting;
+} Waiter;
+
+struct SpscQueue {
+  /* Written by the consumer */
+  alignas(CACHE_LINE_SIZE) atomic_size_t head;
+  size_t cached_tail;
+  /* Written by the producer */
+  alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+  size_t cached_head;
+  /* Read-only after creation */
+  alignas(CACHE_LINE_SIZE) size_t mask;
+  size_t element_size;
+  unsigned char *slots;
+  Waiter not_empty;
+  Waiter not_full;
+};
+
+struct MpmcQueue {
+  alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+  alignas(CACHE_LINE_SIZE) atomic_size_t head;
+  /* Read-only after creation */
+  alignas(CACHE_LINE_SIZE) size_t mask;
+  size_t element_size;
+  size_t stride; /* Size of a cell, i.e. sequence number and element */
+  unsigned char *cells;
+  Waiter not_empty;
+  Waiter not_full;
+};
+
+static size_t RoundUpPowerOfTwo(const size_t n) {
+  size_t power = 1;
+  while (power < n) {
+    power *= 2;
+  }
+  return power;
+}
+
+static void *AllocateQueue(const size_t size) {
+  /* Queues are over-aligned to keep the indices on separate cache lines */
+  void *const queue = aligned_alloc(CACHE_LINE_SIZE, size);
+  if (queue == NULL) {
+    LOG_CRITICAL("Failed to allocate memory");
+  }
+  memset(queue, 0, size);
+  return queue;
+}
+
+static void WaiterInit(Waiter *const waiter) {
+  assert(waiter != NULL);
+
+  waiter->lock = SDL_CreateMutex();
+  if (waiter->lock == NULL) {
+    LOG_CRITICAL("Failed to create mutex: %s", SDL_GetError());
+  }
+  waiter->condition = SDL_CreateCondition();
+  if (waiter->condition == NULL) {
+    LOG_CRITICAL("Failed to create condition variable: %s", SDL_GetError());
+  }
+  atomic_init(&waiter->waiting, 0);
+}
+
+static void WaiterDestroy(Waiter *const waiter) {
+  assert(waiter != NULL);
+  assert(atomic_load(&waiter->waiting) == 0);
+
+  SDL_DestroyCondition(waiter->condition);
+  SDL_DestroyMutex(waiter->lock);
+}
+
+/**
+ * @brief Wake up threads sleeping in WaiterWait().
+ * @note Must be called after publishing the change they are waiting for. The
+ *       fence pairs with the one in WaiterWait(), so either the sleeper sees
+ *       the change or we see the sleeper.
+ */
+static inline void WaiterNotify(Waiter *const waiter) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&waiter->waiting, memory_order_relaxed) > 0) {
+    SDL_LockMutex(waiter->lock);
+    SDL_BroadcastCondition(waiter->condition);
+    SDL_UnlockMutex(waiter->lock);
+  }
+}
+
+/**
+ * @brief Retry an operation until it succeeds or the timeout expires.
+ * @param waiter The waiter notified when the operation may succeed.
+ * @param attempt The non-blocking operation.
+ * @param queue First argument to attempt.
+ * @param element Second argument to attempt.
+ * @param timeout_ms Timeout in milliseconds or -1 to wait indefinitely.
+ * @return True if the operation succeeded.
+ */
+static bool WaiterWait(Waiter *const waiter, bool (*attempt)(void *, void *),
+                       void *const queue, void *const element,
+                       const int32_t timeout_ms) {
+  for (int i = 0; i < SPIN_COUNT; i++) {
+    if (attempt(queue, element)) {
+      return true;
+    }
+    SDL_CPUPauseInstruction();
+  }
+
+  if (timeout_ms == 0) {
+    return false;
+  }
+  const Uint64 deadline =
+      (timeout_ms > 0) ? SDL_GetTicks() + (Uint64)timeout_ms : 0;
+
+  SDL_LockMutex(waiter->lock);
+  atomic_fetch_add_explicit(&waiter->waiting, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+
+  bool success;
+  while (!(success = attempt(queue, element))) {
+    if (timeout_ms < 0) {
+      SDL_WaitCondition(waiter->condition, waiter->lock);
+      continue;
+    }
+
+    const Uint64 now = SDL_GetTicks();
+    if (now >= deadline) {
+      break;
+    }
+    SDL_WaitConditionTimeout(waiter->condition, waiter->lock,
+                             (Sint32)(deadline - now));
+  }
+
+  atomic_fetch_sub_explicit(&waiter->waiting, 1, memory_order_relaxed);
+  SDL_UnlockMutex(waiter->lock);
+  return success;
+}
+
+/**
+ * @brief Copy elements into a ring, wrapping around at the end.
+ */
+static void CopyIntoRing(unsigned char *const slots, const size_t mask,
+                         const size_t element_size, const size_t position,
+                         const void *const src, const size_t n) {
+  const size_t begin = position & mask;
+  const size_t first = MIN(n, (mask + 1) - begin);
+  memcpy(slots + (begin * element_size), src, first * element_size);
+  memcpy(slots, (const unsigned char *)src + (first * element_size),
+         (n - first) * element_size);
+}
+
+/**
+ * @brief Copy elements out of a ring, wrapping around at the end.
+ */
+static void CopyFromRing(const unsigned char *const slots, const size_t mask,
+                         const size_t element_size, const size_t position,
+                         void *const dst, const size_t n) {
+  const size_t begin = position & mask;
+  const size_t first = MIN(n, (mask + 1) - begin);
+  memcpy(dst, slots + (begin * element_size), first * element_size);
+  memcpy((unsigned char *)dst + (first * element_size), slots,
+         (n - first) * element_size);
+}
+
+SpscQueue *SpscQueueCreate(const size_t capacity, const size_t element_size) {
+  assert(capacity > 0);
+  assert(element_size > 0);
+
+  SpscQueue *const queue = AllocateQueue(sizeof(SpscQueue));
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+  queue->mask = RoundUpPowerOfTwo(capacity) - 1;
+  queue->element_size = element_size;
+  queue->slots = xmalloc((queue->mask + 1) * element_size);
+  WaiterInit(&queue->not_empty);
+  WaiterInit(&queue->not_full);
+  return queue;
+}
+
+void SpscQueueDestroy(void *const ptr) {
+  SpscQueue *const queue = ptr;
+  if (queue == NULL) {
+    return;
+  }
+
+  WaiterDestroy(&queue->not_empty);
+  WaiterDestroy(&queue->not_full);
+  xfree(queue->slots);
+  free(queue);
+}
+
+size_t SpscQueueLength(const SpscQueue *const queue) {
+  assert(queue != NULL);
+
+  const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  return tail - head;
+}
+
+/**
+ * @brief Reserve room for up to n elements.
+ * @return Number of free slots, at most n.
+ */
+static size_t SpscReserve(SpscQueue *const queue, const size_t tail,
+                          const size_t n) {
+  const size_t capacity = queue->mask + 1;
+  size_t available = capacity - (tail - queue->cached_head);
+  if (available < n) {
+    /* Only look at the consumer's cache line when we appear to be full */
+    queue->cached_head =
+        atomic_load_explicit(&queue->head, memory_order_acquire);
+    available = capacity - (tail - queue->cached_head);
+  }
+  return MIN(available, n);
+}
+
+/**
+ * @brief Check for up to n elements.
+ * @return Number of filled slots, at most n.
+ */
+static size_t SpscAcquire(SpscQueue *const queue, const size_t head,
+                          const size_t n) {
+  size_t available = queue->cached_tail - head;
+  if (available < n) {
+    queue->cached_tail =
+        atomic_load_explicit(&queue->tail, memory_order_acquire);
+    available = queue->cached_tail - head;
+  }
+  return MIN(available, n);
+}
+
+static size_t SpscTryPush(SpscQueue *const queue, const void *const elements,
+                          const size_t n) {
+  const size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  const size_t count = SpscReserve(queue, tail, n);
+  if (count == 0) {
+    return 0;
+  }
+
+  CopyIntoRing(queue->slots, queue->mask, queue->element_size, tail, elements,
+               count);
+  atomic_store_explicit(&queue->tail, tail + count, memory_order_release);
+  return count;
+}
+
+static size_t SpscTryPop(SpscQueue *const queue, void *const elements,
+                         const size_t n) {
+  const size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  const size_t count = SpscAcquire(queue, head, n);
+  if (count == 0) {
+    return 0;
+  }
+
+  CopyFromRing(queue->slots, queue->mask, queue->element_size, head, elements,
+               count);
+  atomic_store_explicit(&queue->head, head + count, memory_order_release);
+  return count;
+}
+
+size_t SpscQueuePushMany(SpscQueue *const queue, const void *const elements,
+                         const size_t n) {
+  assert(queue != NULL);
+  assert(elements != NULL || n == 0);
+
+  const size_t count = SpscTryPush(queue, elements, n);
+  if (count > 0) {
+    WaiterNotify(&queue->not_empty);
+  }
+  return count;
+}
+
+size_t SpscQueuePopMany(SpscQueue *const queue, void *const elements,
+                        const size_t n) {
+  assert(queue != NULL);
+  assert(elements != NULL || n == 0);
+
+  const size_t count = SpscTryPop(queue, elements, n);
+  if (count > 0) {
+    WaiterNotify(&queue->not_full);
+  }
+  return count;
+}
+
+bool SpscQueuePush(SpscQueue *const queue, const void *const element) {
+  return SpscQueuePushMany(queue, element, 1) == 1;
+}
+
+bool SpscQueuePop(SpscQueue *const queue, void *const element) {
+  return SpscQueuePopMany(queue, element, 1) == 1;
+}
+
+static bool SpscAttemptPush(void *const queue, void *const element) {
+  return SpscTryPush(queue, element, 1) == 1;
+}
+
+static bool SpscAttemptPop(void *const queue, void *const element) {
+  return SpscTryPop(queue, element, 1) == 1;
+}
+
+bool SpscQueuePushWait(SpscQueue *const queue, const void *const element,
+                       const int32_t timeout_ms) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!WaiterWait(&queue->not_full, SpscAttemptPush, queue, (void *)element,
+                  timeout_ms)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_empty);
+  return true;
+}
+
+bool SpscQueuePopWait(SpscQueue *const queue, void *const element,
+                      const int32_t timeout_ms) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!WaiterWait(&queue->not_empty, SpscAttemptPop, queue, element,
+                  timeout_ms)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_full);
+  return true;
+}
+
+static inline atomic_size_t *CellSequence(const MpmcQueue *const queue,
+                                          const size_t position) {
+  return (atomic_size_t *)(queue->cells +
+                           ((position & queue->mask) * queue->stride));
+}
+
+static inline unsigned char *CellData(const MpmcQueue *const queue,
+                                      const size_t position) {
+  return queue->cells + ((position & queue->mask) * queue->stride) +
+         sizeof(atomic_size_t);
+}
+
+MpmcQueue *MpmcQueueCreate(const size_t capacity, const size_t element_size) {
+  assert(capacity > 0);
+  assert(element_size > 0);
+
+  MpmcQueue *const queue = AllocateQueue(sizeof(MpmcQueue));
+  atomic_init(&queue->head, 0);
+  atomic_init(&queue->tail, 0);
+
+  /* With a single cell, a full and an empty queue look the same */
+  queue->mask = RoundUpPowerOfTwo(MAX(capacity, (size_t)2)) - 1;
+  queue->element_size = element_size;
+
+  const size_t alignment = alignof(max_align_t);
+  queue->stride = (sizeof(atomic_size_t) + element_size + (alignment - 1)) &
+                  ~(alignment - 1);
+  queue->cells = xmalloc((queue->mask + 1) * queue->stride);
+
+  /* A cell is free for the producer at position p when its sequence is p */
+  for (size_t i = 0; i <= queue->mask; i++) {
+    atomic_init(CellSequence(queue, i), i);
+  }
+
+  WaiterInit(&queue->not_empty);
+  WaiterInit(&queue->not_full);
+  return queue;
+}
+
+void MpmcQueueDestroy(void *const ptr) {
+  MpmcQueue *const queue = ptr;
+  if (queue == NULL) {
+    return;
+  }
+
+  WaiterDestroy(&queue->not_empty);
+  WaiterDestroy(&queue->not_full);
+  xfree(queue->cells);
+  free(queue);
+}
+
+size_t MpmcQueueLength(const MpmcQueue *const queue) {
+  assert(queue != NULL);
+
+  /* Load head first, so that tail can never appear to be behind it */
+  const size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+  const size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+  return tail - head;
+}
+
+static bool MpmcTryPush(MpmcQueue *const queue, const void *const element) {
+  size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+  while (true) {
+    atomic_size_t *const sequence = CellSequence(queue, position);
+    const size_t seq = atomic_load_explicit(sequence, memory_order_acquire);
+    const ptrdiff_t diff = (ptrdiff_t)(seq - position);
+
+    if (diff == 0) {
+      /* The cell is free, try to claim it */
+      if (atomic_compare_exchange_weak_explicit(&queue->tail, &position,
+                                                position + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false; /* The cell still holds an element from the last lap */
+    } else {
+      /* Another producer claimed the cell */
+      position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    }
+  }
+
+  memcpy(CellData(queue, position), element, queue->element_size);
+  atomic_store_explicit(CellSequence(queue, position), position + 1,
+                        memory_order_release);
+  return true;
+}
+
+static bool MpmcTryPop(MpmcQueue *const queue, void *const element) {
+  size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+  while (true) {
+    atomic_size_t *const sequence = CellSequence(queue, position);
+    const size_t seq = atomic_load_explicit(sequence, memory_order_acquire);
+    const ptrdiff_t diff = (ptrdiff_t)(seq - (position + 1));
+
+    if (diff == 0) {
+      /* The cell is filled, try to claim it */
+      if (atomic_compare_exchange_weak_explicit(&queue->head, &position,
+                                                position + 1,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      return false; /* The cell has not been filled yet */
+    } else {
+      /* Another consumer claimed the cell */
+      position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    }
+  }
+
+  memcpy(element, CellData(queue, position), queue->element_size);
+  /* Hand the cell to the producer of the next lap */
+  atomic_store_explicit(CellSequence(queue, position),
+                        position + queue->mask + 1, memory_order_release);
+  return true;
+}
+
+bool MpmcQueuePush(MpmcQueue *const queue, const void *const element) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!MpmcTryPush(queue, element)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_empty);
+  return true;
+}
+
+bool MpmcQueuePop(MpmcQueue *const queue, void *const element) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!MpmcTryPop(queue, element)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_full);
+  return true;
+}
+
+size_t MpmcQueuePushMany(MpmcQueue *const queue, const void *const elements,
+                         const size_t n) {
+  assert(queue != NULL);
+  assert(elements != NULL || n == 0);
+
+  const unsigned char *const src = elements;
+  size_t count = 0;
+  while (count < n &&
+         MpmcTryPush(queue, src + (count * queue->element_size))) {
+    count += 1;
+  }
+
+  if (count > 0) {
+    WaiterNotify(&queue->not_empty);
+  }
+  return count;
+}
+
+size_t MpmcQueuePopMany(MpmcQueue *const queue, void *const elements,
+                        const size_t n) {
+  assert(queue != NULL);
+  assert(elements != NULL || n == 0);
+
+  unsigned char *const dst = elements;
+  size_t count = 0;
+  while (count < n && MpmcTryPop(queue, dst + (count * queue->element_size))) {
+    count += 1;
+  }
+
+  if (count > 0) {
+    WaiterNotify(&queue->not_full);
+  }
+  return count;
+}
+
+static bool MpmcAttemptPush(void *const queue, void *const element) {
+  return MpmcTryPush(queue, element);
+}
+
+static bool MpmcAttemptPop(void *const queue, void *const element) {
+  return MpmcTryPop(queue, element);
+}
+
+bool MpmcQueuePushWait(MpmcQueue *const queue, const void *const element,
+                       const int32_t timeout_ms) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!WaiterWait(&queue->not_full, MpmcAttemptPush, queue, (void *)element,
+                  timeout_ms)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_empty);
+  return true;
+}
+
+bool MpmcQueuePopWait(MpmcQueue *const queue, void *const element,
+                      const int32_t timeout_ms) {
+  assert(queue != NULL);
+  assert(element != NULL);
+
+  if (!WaiterWait(&queue->not_empty, MpmcAttemptPop, queue, element,
+                  timeout_ms)) {
+    return false;
+  }
+  WaiterNotify(&queue->not_full);
+  return true;
+}
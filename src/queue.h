@@ -0,0 +1,192 @@
+#ifndef __ETERNO_QUEUE_H__
+#define __ETERNO_QUEUE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Bounded lock-free ring for exactly one producer and one consumer
+ *        thread.
+ * @note Elements are copied in and out by value. The producer and consumer
+ *       indices live on separate cache lines, and each side caches the other
+ *       side's index so that it only touches the shared line when the ring
+ *       looks full or empty.
+ */
+typedef struct SpscQueue SpscQueue;
+
+/**
+ * @brief Bounded lock-free ring for any number of producer and consumer
+ *        threads.
+ * @note Based on Dmitry Vyukov's bounded MPMC queue: every slot carries a
+ *       sequence number, so producers and consumers only contend on a single
+ *       compare-and-swap each.
+ */
+typedef struct MpmcQueue MpmcQueue;
+
+/**
+ * @brief Create a single-producer/single-consumer queue.
+ * @param capacity Minimum number of elements. Rounded up to a power of two.
+ * @param element_size Size of each element in bytes.
+ * @return The queue.
+ * @note Caller takes ownership of returned value.
+ */
+SpscQueue *SpscQueueCreate(size_t capacity, size_t element_size);
+
+/**
+ * @brief Destroy the queue.
+ * @param ptr Pointer to the queue.
+ * @note If ptr is NULL, no operation is performed. No thread may be blocked
+ *       on the queue.
+ */
+void SpscQueueDestroy(void *ptr);
+
+/**
+ * @brief Get number of elements in the queue.
+ * @param queue The queue.
+ * @return Number of elements.
+ * @note The result is approximate while other threads use the queue.
+ */
+size_t SpscQueueLength(const SpscQueue *queue);
+
+/**
+ * @brief Push an element without blocking. Producer only.
+ * @param queue The queue.
+ * @param element Pointer to the element to copy in.
+ * @return False if the queue is full.
+ */
+bool SpscQueuePush(SpscQueue *queue, const void *element);
+
+/**
+ * @brief Pop an element without blocking. Consumer only.
+ * @param queue The queue.
+ * @param element Buffer the element is copied to.
+ * @return False if the queue is empty.
+ */
+bool SpscQueuePop(SpscQueue *queue, void *element);
+
+/**
+ * @brief Push as many elements as fit without blocking. Producer only.
+ * @param queue The queue.
+ * @param elements Array of elements to copy in.
+ * @param n Number of elements in array.
+ * @return Number of elements pushed.
+ * @note The elements are published with a single index update.
+ */
+size_t SpscQueuePushMany(SpscQueue *queue, const void *elements, size_t n);
+
+/**
+ * @brief Pop up to n elements without blocking. Consumer only.
+ * @param queue The queue.
+ * @param elements Buffer for up to n elements.
+ * @param n Maximum number of elements to pop.
+ * @return Number of elements popped.
+ */
+size_t SpscQueuePopMany(SpscQueue *queue, void *elements, size_t n);
+
+/**
+ * @brief Push an element, waiting while the queue is full. Producer only.
+ * @param queue The queue.
+ * @param element Pointer to the element to copy in.
+ * @param timeout_ms Maximum time to wait in milliseconds or -1 to wait
+ *                   indefinitely.
+ * @return False if the timeout expired.
+ * @note The producer spins briefly before sleeping on a condition variable.
+ */
+bool SpscQueuePushWait(SpscQueue *queue, const void *element,
+                       int32_t timeout_ms);
+
+/**
+ * @brief Pop an element, waiting while the queue is empty. Consumer only.
+ * @param queue The queue.
+ * @param element Buffer the element is copied to.
+ * @param timeout_ms Maximum time to wait in milliseconds or -1 to wait
+ *                   indefinitely.
+ * @return False if the timeout expired.
+ */
+bool SpscQueuePopWait(SpscQueue *queue, void *element, int32_t timeout_ms);
+
+/**
+ * @brief Create a multi-producer/multi-consumer queue.
+ * @param capacity Minimum number of elements. Rounded up to a power of two
+ *                 and at least 2.
+ * @param element_size Size of each element in bytes.
+ * @return The queue.
+ * @note Caller takes ownership of returned value.
+ */
+MpmcQueue *MpmcQueueCreate(size_t capacity, size_t element_size);
+
+/**
+ * @brief Destroy the queue.
+ * @param ptr Pointer to the queue.
+ * @note If ptr is NULL, no operation is performed. No thread may be blocked
+ *       on the queue.
+ */
+void MpmcQueueDestroy(void *ptr);
+
+/**
+ * @brief Get number of elements in the queue.
+ * @param queue The queue.
+ * @return Number of elements.
+ * @note The result is approximate while other threads use the queue.
+ */
+size_t MpmcQueueLength(const MpmcQueue *queue);
+
+/**
+ * @brief Push an element without blocking.
+ * @param queue The queue.
+ * @param element Pointer to the element to copy in.
+ * @return False if the queue is full.
+ */
+bool MpmcQueuePush(MpmcQueue *queue, const void *element);
+
+/**
+ * @brief Pop an element without blocking.
+ * @param queue The queue.
+ * @param element Buffer the element is copied to.
+ * @return False if the queue is empty.
+ */
+bool MpmcQueuePop(MpmcQueue *queue, void *element);
+
+/**
+ * @brief Push as many elements as fit without blocking.
+ * @param queue The queue.
+ * @param elements Array of elements to copy in.
+ * @param n Number of elements in array.
+ * @return Number of elements pushed.
+ * @note Elements from one batch may be interleaved with elements pushed by
+ *       other producers. Blocked consumers are woken once per batch.
+ */
+size_t MpmcQueuePushMany(MpmcQueue *queue, const void *elements, size_t n);
+
+/**
+ * @brief Pop up to n elements without blocking.
+ * @param queue The queue.
+ * @param elements Buffer for up to n elements.
+ * @param n Maximum number of elements to pop.
+ * @return Number of elements popped.
+ */
+size_t MpmcQueuePopMany(MpmcQueue *queue, void *elements, size_t n);
+
+/**
+ * @brief Push an element, waiting while the queue is full.
+ * @param queue The queue.
+ * @param element Pointer to the element to copy in.
+ * @param timeout_ms Maximum time to wait in milliseconds or -1 to wait
+ *                   indefinitely.
+ * @return False if the timeout expired.
+ */
+bool MpmcQueuePushWait(MpmcQueue *queue, const void *element,
+                       int32_t timeout_ms);
+
+/**
+ * @brief Pop an element, waiting while the queue is empty.
+ * @param queue The queue.
+ * @param element Buffer the element is copied to.
+ * @param timeout_ms Maximum time to wait in milliseconds or -1 to wait
+ *                   indefinitely.
+ * @return False if the timeout expired.
+ */
+bool MpmcQueuePopWait(MpmcQueue *queue, void *element, int32_t timeout_ms);
+
+#endif // __ETERNO_QUEUE_H__
@@ -0,0 +1,227 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+
+#include "slice.h"
+#include "utils.h"
+
+/* Longest number SliceParseDouble() copies to the stack for strtod(3) */
+#define MAX_NUMBER_LENGTH 64
+
+Slice SliceSub(const Slice slice, const size_t begin, const size_t end) {
+  assert(begin <= end);
+  assert(end <= slice.length);
+  return SliceCreate(slice.data + begin, end - begin);
+}
+
+bool SliceEqual(const Slice a, const Slice b) {
+  return (a.length == b.length) &&
+         (a.length == 0 || memcmp(a.data, b.data, a.length) == 0);
+}
+
+bool SliceEqualString(const Slice slice, const char *const str) {
+  assert(str != NULL);
+  /* Never read past the end of str, even if the slice is longer */
+  return (strnlen(str, slice.length + 1) == slice.length) &&
+         (slice.length == 0 || memcmp(slice.data, str, slice.length) == 0);
+}
+
+int SliceCompare(const Slice a, const Slice b) {
+  const size_t length = MIN(a.length, b.length);
+  const int ret = (length > 0) ? memcmp(a.data, b.data, length) : 0;
+  if (ret != 0) {
+    return ret;
+  }
+  return (a.length > b.length) - (a.length < b.length);
+}
+
+bool SliceStartsWith(const Slice slice, const Slice prefix) {
+  return (slice.length >= prefix.length) &&
+         SliceEqual(SliceSub(slice, 0, prefix.length), prefix);
+}
+
+bool SliceEndsWith(const Slice slice, const Slice suffix) {
+  return (slice.length >= suffix.length) &&
+         SliceEqual(SliceSub(slice, slice.length - suffix.length, slice.length),
+                    suffix);
+}
+
+bool SliceFind(const Slice slice, const char ch, size_t *const index) {
+  if (slice.length == 0) {
+    return false;
+  }
+
+  const char *const found = memchr(slice.data, ch, slice.length);
+  if (found == NULL) {
+    return false;
+  }
+
+  if (index != NULL) {
+    *index = (size_t)(found - slice.data);
+  }
+  return true;
+}
+
+Slice SliceTrimLeft(const Slice slice) {
+  size_t begin = 0;
+  while (begin < slice.length && isspace((unsigned char)slice.data[begin])) {
+    begin += 1;
+  }
+  return SliceSub(slice, begin, slice.length);
+}
+
+Slice SliceTrimRight(const Slice slice) {
+  size_t end = slice.length;
+  while (end > 0 && isspace((unsigned char)slice.data[end - 1])) {
+    end -= 1;
+  }
+  return SliceSub(slice, 0, end);
+}
+
+Slice SliceTrim(const Slice slice) {
+  return SliceTrimRight(SliceTrimLeft(slice));
+}
+
+bool SliceSplit(Slice *const rest, const char delimiter, Slice *const field) {
+  assert(rest != NULL);
+  assert(field != NULL);
+
+  /* A NULL data pointer marks that the last field has been returned */
+  if (rest->data == NULL) {
+    return false;
+  }
+
+  size_t index;
+  if (SliceFind(*rest, delimiter, &index)) {
+    *field = SliceSub(*rest, 0, index);
+    *rest = SliceSub(*rest, index + 1, rest->length);
+  } else {
+    *field = *rest;
+    *rest = SliceCreate(NULL, 0);
+  }
+  return true;
+}
+
+bool SliceTokenize(Slice *const rest, const char *const delimiters,
+                   Slice *const token) {
+  assert(rest != NULL);
+  assert(delimiters != NULL);
+  assert(token != NULL);
+
+  size_t begin = 0;
+  while (begin < rest->length &&
+         strchr(delimiters, rest->data[begin]) != NULL &&
+         rest->data[begin] != '\0') {
+    begin += 1;
+  }
+  if (begin == rest->length) {
+    *rest = SliceSub(*rest, begin, begin);
+    return false;
+  }
+
+  size_t end = begin;
+  while (end < rest->length &&
+         (strchr(delimiters, rest->data[end]) == NULL ||
+          rest->data[end] == '\0')) {
+    end += 1;
+  }
+
+  *token = SliceSub(*rest, begin, end);
+  *rest = SliceSub(*rest, end, rest->length);
+  return true;
+}
+
+bool SliceNextLine(Slice *const rest, Slice *const line) {
+  assert(rest != NULL);
+  assert(line != NULL);
+
+  if (rest->length == 0) {
+    return false;
+  }
+
+  size_t index;
+  if (SliceFind(*rest, '\n', &index)) {
+    *line = SliceSub(*rest, 0, index);
+    *rest = SliceSub(*rest, index + 1, rest->length);
+  } else {
+    *line = *rest;
+    *rest = SliceSub(*rest, rest->length, rest->length);
+  }
+
+  if (line->length > 0 && line->data[line->length - 1] == '\r') {
+    line->length -= 1;
+  }
+  return true;
+}
+
+bool SliceParseLong(const Slice slice, long *const value) {
+  assert(value != NULL);
+
+  size_t i = 0;
+  bool negative = false;
+  if (i < slice.length && (slice.data[i] == '-' || slice.data[i] == '+')) {
+    negative = (slice.data[i] == '-');
+    i += 1;
+  }
+  if (i == slice.length) {
+    return false;
+  }
+
+  /* Accumulate as a negative number, since its range is larger */
+  long result = 0;
+  for (; i < slice.length; i++) {
+    const char ch = slice.data[i];
+    if (ch < '0' || ch > '9') {
+      return false;
+    }
+
+    const int digit = ch - '0';
+    if (result < (LONG_MIN + digit) / 10) {
+      return false;
+    }
+    result = (result * 10) - digit;
+  }
+
+  if (!negative) {
+    if (result == LONG_MIN) {
+      return false;
+    }
+    result = -result;
+  }
+
+  *value = result;
+  return true;
+}
+
+bool SliceParseDouble(const Slice slice, double *const value) {
+  assert(value != NULL);
+
+  /* strtod(3) needs a null-terminated string, but the slice usually points
+   * into the middle of a buffer. Numbers are short, so copy to the stack. */
+  char str[MAX_NUMBER_LENGTH];
+  if (slice.length == 0 || slice.length >= sizeof(str)) {
+    return false;
+  }
+  memcpy(str, slice.data, slice.length);
+  str[slice.length] = '\0';
+
+  if (isspace((unsigned char)str[0])) {
+    return false; /* strtod(3) would skip it */
+  }
+
+  char *end;
+  errno = 0;
+  const double result = strtod(str, &end);
+  if (errno != 0 || end != str + slice.length) {
+    return false;
+  }
+
+  *value = result;
+  return true;
+}
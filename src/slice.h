@@ -0,0 +1,172 @@
+#ifndef __ETERNO_SLICE_H__
+#define __ETERNO_SLICE_H__
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Non-owning view of a string.
+ * @note Slices are passed by value and are not null-terminated. They are only
+ *       valid as long as the memory they point into, e.g. a Buffer. None of
+ *       the functions below allocate memory.
+ */
+typedef struct Slice {
+  const char *data;
+  size_t length;
+} Slice;
+
+/**
+ * @brief Format and argument for printing a slice with printf(3) style
+ *        functions, e.g. LOG_DEBUG("Key '" SLICE_FMT "'", SLICE_ARG(key)).
+ */
+#define SLICE_FMT "%.*s"
+#define SLICE_ARG(slice) (int)(slice).length, (slice).data
+
+/**
+ * @brief Create a slice from a pointer and a length.
+ * @param data Start of the slice.
+ * @param length Length of the slice.
+ * @return The slice.
+ */
+static inline Slice SliceCreate(const char *data, size_t length) {
+  return (Slice){data, length};
+}
+
+/**
+ * @brief Create a slice covering a null-terminated string.
+ * @param str The string.
+ * @return The slice.
+ */
+static inline Slice SliceFromString(const char *str) {
+  return (Slice){str, strlen(str)};
+}
+
+/**
+ * @brief Get a part of a slice.
+ * @param slice The slice.
+ * @param begin Index of first byte.
+ * @param end Index one past the last byte.
+ * @return The part of the slice.
+ */
+Slice SliceSub(Slice slice, size_t begin, size_t end);
+
+/**
+ * @brief Check whether two slices have the same contents.
+ * @param a First slice.
+ * @param b Second slice.
+ * @return True if equal.
+ */
+bool SliceEqual(Slice a, Slice b);
+
+/**
+ * @brief Check whether a slice has the same contents as a string.
+ * @param slice The slice.
+ * @param str Null-terminated string.
+ * @return True if equal.
+ */
+bool SliceEqualString(Slice slice, const char *str);
+
+/**
+ * @brief Compare two slices lexicographically.
+ * @param a First slice.
+ * @param b Second slice.
+ * @return Less than, equal to or greater than zero as for strcmp(3).
+ */
+int SliceCompare(Slice a, Slice b);
+
+/**
+ * @brief Check whether a slice starts with a prefix.
+ * @param slice The slice.
+ * @param prefix The prefix.
+ * @return True if slice starts with prefix.
+ */
+bool SliceStartsWith(Slice slice, Slice prefix);
+
+/**
+ * @brief Check whether a slice ends with a suffix.
+ * @param slice The slice.
+ * @param suffix The suffix.
+ * @return True if slice ends with suffix.
+ */
+bool SliceEndsWith(Slice slice, Slice suffix);
+
+/**
+ * @brief Find first occurrence of a byte in a slice.
+ * @param slice The slice.
+ * @param ch The byte.
+ * @param index Set to index of the byte unless NULL.
+ * @return True if found.
+ */
+bool SliceFind(Slice slice, char ch, size_t *index);
+
+/**
+ * @brief Remove leading and trailing whitespace.
+ * @param slice The slice.
+ * @return The trimmed slice.
+ */
+Slice SliceTrim(Slice slice);
+
+/**
+ * @brief Remove leading whitespace.
+ * @param slice The slice.
+ * @return The trimmed slice.
+ */
+Slice SliceTrimLeft(Slice slice);
+
+/**
+ * @brief Remove trailing whitespace.
+ * @param slice The slice.
+ * @return The trimmed slice.
+ */
+Slice SliceTrimRight(Slice slice);
+
+/**
+ * @brief Split off the next field separated by a delimiter.
+ * @param rest Remaining input. Advanced past the field and delimiter.
+ * @param delimiter The delimiter.
+ * @param field Set to the field.
+ * @return False once the input is exhausted.
+ * @note Empty fields are kept, e.g. "a,,b" gives "a", "" and "b". An empty
+ *       input gives one empty field.
+ */
+bool SliceSplit(Slice *rest, char delimiter, Slice *field);
+
+/**
+ * @brief Split off the next token separated by any of the delimiters.
+ * @param rest Remaining input. Advanced past the token.
+ * @param delimiters Null-terminated set of delimiter bytes, e.g. " \t".
+ * @param token Set to the token.
+ * @return False if there are no more tokens.
+ * @note Runs of delimiters are skipped, so tokens are never empty.
+ */
+bool SliceTokenize(Slice *rest, const char *delimiters, Slice *token);
+
+/**
+ * @brief Split off the next line.
+ * @param rest Remaining input. Advanced past the line.
+ * @param line Set to the line without its line terminator.
+ * @return False once the input is exhausted.
+ * @note Both "\n" and "\r\n" terminate lines. A final line without a
+ *       terminator is returned too.
+ */
+bool SliceNextLine(Slice *rest, Slice *line);
+
+/**
+ * @brief Parse a decimal integer.
+ * @param slice The slice, with optional sign. Must contain nothing else.
+ * @param value Set to the integer on success.
+ * @return False if the slice is not an integer or out of range.
+ */
+bool SliceParseLong(Slice slice, long *value);
+
+/**
+ * @brief Parse a floating point number.
+ * @param slice The slice in any format accepted by strtod(3). Must contain
+ *              nothing else.
+ * @param value Set to the number on success.
+ * @return False if the slice is not a number.
+ */
+bool SliceParseDouble(Slice slice, double *value);
+
+#endif // __ETERNO_SLICE_H__
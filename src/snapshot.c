@@ -0,0 +1,266 @@
+#include "config.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "utils.h"
+
+/* Deltas are sequences of words. The first holds the size of the older
+ * snapshot in bytes. Each following run is a word with the number of zero
+ * words skipped in the low half and the number of literal words in the high
+ * half, followed by the literal words. Trailing zero words are left out. */
+#define WORD_SIZE sizeof(uint64_t)
+#define RUN(zeros, literals) ((uint64_t)(zeros) | ((uint64_t)(literals) << 32))
+#define RUN_ZEROS(run) ((size_t)((run) & 0xffffffff))
+#define RUN_LITERALS(run) ((size_t)((run) >> 32))
+
+typedef struct {
+  size_t offset; /* In words */
+  size_t length; /* In words */
+} Record;
+
+struct SnapshotRing {
+  uint64_t *data; /* Deltas */
+  size_t capacity;
+  size_t head;     /* Where the next delta is written */
+  Record *records; /* Oldest first, starting at first */
+  size_t history;
+  size_t first;
+  size_t count;
+  uint64_t *latest; /* Newest snapshot, zero beyond its size */
+  size_t latest_words;
+  size_t latest_size; /* In bytes */
+  bool has_latest;
+  uint64_t *scratch; /* Delta being encoded */
+  size_t scratch_words;
+};
+
+static size_t Words(const size_t size) {
+  return (size + WORD_SIZE - 1) / WORD_SIZE;
+}
+
+SnapshotRing *SnapshotRingCreate(size_t history, size_t capacity) {
+  if (history == 0) {
+    history = DEFAULT_SNAPSHOT_HISTORY;
+  }
+  if (capacity == 0) {
+    capacity = DEFAULT_SNAPSHOT_RING_SIZE;
+  }
+
+  SnapshotRing *const ring = xcalloc(1, sizeof(SnapshotRing));
+  ring->capacity = MAX(Words(capacity), 1);
+  ring->data = xmalloc(ring->capacity * WORD_SIZE);
+  ring->history = history;
+  ring->records = xmalloc(history * sizeof(Record));
+  return ring;
+}
+
+void SnapshotRingDestroy(SnapshotRing *const ring) {
+  if (ring == NULL) {
+    return;
+  }
+  xfree(ring->data);
+  xfree(ring->records);
+  xfree(ring->latest);
+  xfree(ring->scratch);
+  xfree(ring);
+}
+
+static void DropOldest(SnapshotRing *const ring) {
+  assert(ring->count > 0);
+  ring->first = (ring->first + 1) % ring->history;
+  ring->count -= 1;
+}
+
+static const Record *Oldest(const SnapshotRing *const ring) {
+  return &ring->records[ring->first];
+}
+
+static const Record *Newest(const SnapshotRing *const ring) {
+  return &ring->records[(ring->first + ring->count - 1) % ring->history];
+}
+
+/* Copy an encoded delta into the ring, dropping the oldest deltas in its
+ * way. Older deltas are only reachable through newer ones, so they are
+ * always dropped in order. */
+static void Store(SnapshotRing *const ring, const uint64_t *const delta,
+                  const size_t length) {
+  if (length > ring->capacity) {
+    /* Too large to keep any history */
+    ring->count = 0;
+    ring->head = 0;
+    return;
+  }
+
+  if (ring->count == ring->history) {
+    DropOldest(ring);
+  }
+
+  if (ring->head + length > ring->capacity) {
+    /* Wrap around. Deltas past the head are from the previous lap, and
+     * older than all those before it. */
+    while (ring->count > 0 && Oldest(ring)->offset >= ring->head) {
+      DropOldest(ring);
+    }
+    ring->head = 0;
+  }
+
+  const size_t end = ring->head + length;
+  while (ring->count > 0 && Oldest(ring)->offset < end &&
+         Oldest(ring)->offset + Oldest(ring)->length > ring->head) {
+    DropOldest(ring);
+  }
+
+  memcpy(ring->data + ring->head, delta, length * WORD_SIZE);
+  ring->records[(ring->first + ring->count) % ring->history] = (Record){
+      .offset = ring->head,
+      .length = length,
+  };
+  ring->count += 1;
+  ring->head = end;
+}
+
+static void Reserve(uint64_t **const words, size_t *const allocated,
+                    const size_t needed) {
+  if (needed <= *allocated) {
+    return;
+  }
+  *words = xrealloc(*words, needed * WORD_SIZE);
+  memset(*words + *allocated, 0, (needed - *allocated) * WORD_SIZE);
+  *allocated = needed;
+}
+
+/* Word of a snapshot, padded with zeros past its end */
+static inline uint64_t LoadWord(const unsigned char *const state,
+                                const size_t size, const size_t index) {
+  uint64_t word = 0;
+  const size_t offset = index * WORD_SIZE;
+  if (offset + WORD_SIZE <= size) {
+    memcpy(&word, state + offset, WORD_SIZE);
+  } else if (offset < size) {
+    memcpy(&word, state + offset, size - offset);
+  }
+  return word;
+}
+
+void SnapshotRingPush(SnapshotRing *const ring, const void *const state,
+                      const size_t size) {
+  assert(ring != NULL);
+  assert(state != NULL || size == 0);
+
+  const unsigned char *const src = state;
+  const size_t n_words = MAX(Words(size), Words(ring->latest_size));
+  Reserve(&ring->latest, &ring->latest_words, n_words);
+
+  if (!ring->has_latest) {
+    for (size_t i = 0; i < n_words; i++) {
+      ring->latest[i] = LoadWord(src, size, i);
+    }
+    ring->latest_size = size;
+    ring->has_latest = true;
+    return;
+  }
+
+  /* Each run costs at most one word on top of its literals */
+  Reserve(&ring->scratch, &ring->scratch_words, (2 * n_words) + 1);
+  uint64_t *const delta = ring->scratch;
+  uint64_t *const latest = ring->latest;
+  size_t length = 0;
+  delta[length++] = ring->latest_size;
+
+  size_t i = 0;
+  while (i < n_words) {
+    const size_t zeros_begin = i;
+    while (i < n_words && latest[i] == LoadWord(src, size, i)) {
+      i += 1;
+    }
+    if (i == n_words) {
+      break;
+    }
+
+    const size_t run = length++;
+    const size_t literals_begin = i;
+    while (i < n_words) {
+      const uint64_t word = LoadWord(src, size, i);
+      if (word == latest[i]) {
+        break;
+      }
+      delta[length++] = word ^ latest[i];
+      latest[i] = word;
+      i += 1;
+    }
+    delta[run] = RUN(literals_begin - zeros_begin, i - literals_begin);
+  }
+
+  ring->latest_size = size;
+  Store(ring, delta, length);
+}
+
+const void *SnapshotRingLatest(const SnapshotRing *const ring,
+                               size_t *const size) {
+  assert(ring != NULL);
+  assert(size != NULL);
+
+  if (!ring->has_latest) {
+    return NULL;
+  }
+  *size = ring->latest_size;
+  return ring->latest;
+}
+
+const void *SnapshotRingRewind(SnapshotRing *const ring, size_t *const size) {
+  assert(ring != NULL);
+  assert(size != NULL);
+
+  if (ring->count == 0) {
+    return NULL;
+  }
+
+  const Record *const record = Newest(ring);
+  const uint64_t *const delta = ring->data + record->offset;
+  uint64_t *const latest = ring->latest;
+
+  /* The newest snapshot was pushed with room for the older one */
+  const size_t older_size = (size_t)delta[0];
+  assert(Words(older_size) <= ring->latest_words);
+
+  size_t position = 1;
+  size_t i = 0;
+  while (position < record->length) {
+    const uint64_t run = delta[position++];
+    i += RUN_ZEROS(run);
+    const size_t literals = RUN_LITERALS(run);
+    for (size_t j = 0; j < literals; j++) {
+      latest[i++] ^= delta[position++];
+    }
+  }
+  assert(position == record->length);
+
+  /* The space of the newest delta is reused by the next one */
+  ring->head = record->offset;
+  ring->count -= 1;
+  ring->latest_size = older_size;
+
+  *size = older_size;
+  return latest;
+}
+
+size_t SnapshotRingLength(const SnapshotRing *const ring) {
+  assert(ring != NULL);
+  return ring->count;
+}
+
+void SnapshotRingClear(SnapshotRing *const ring) {
+  assert(ring != NULL);
+  ring->first = 0;
+  ring->count = 0;
+  ring->head = 0;
+  if (ring->latest != NULL) {
+    memset(ring->latest, 0, ring->latest_words * WORD_SIZE);
+  }
+  ring->latest_size = 0;
+  ring->has_latest = false;
+}
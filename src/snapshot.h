@@ -0,0 +1,77 @@
+#ifndef __ETERNO_SNAPSHOT_H__
+#define __ETERNO_SNAPSHOT_H__
+
+#include <stddef.h>
+
+/**
+ * @brief History of game state for rewinding and finding desyncs.
+ * @note A snapshot is a plain byte image of the state, e.g. the structs of
+ *       all entities one after another, without pointers that change between
+ *       ticks and with padding zeroed. Only the newest snapshot is kept in
+ *       full. Each older one is stored as the XOR of it and the snapshot
+ *       after it, with runs of zero words left out, so that state that
+ *       barely changed between ticks takes little space. The deltas live in
+ *       a ring of bytes allocated up front, and the oldest are dropped to
+ *       make room for new ones.
+ */
+typedef struct SnapshotRing SnapshotRing;
+
+/**
+ * @brief Create an empty snapshot ring.
+ * @param history Maximum number of older snapshots kept or 0 for
+ *                DEFAULT_SNAPSHOT_HISTORY.
+ * @param capacity Size of the ring in bytes or 0 for
+ *                 DEFAULT_SNAPSHOT_RING_SIZE.
+ * @return The snapshot ring.
+ * @note Caller takes ownership of returned value.
+ */
+SnapshotRing *SnapshotRingCreate(size_t history, size_t capacity);
+
+/**
+ * @brief Destroy a snapshot ring.
+ * @param ring The snapshot ring.
+ * @note If ring is NULL, no operation is performed.
+ */
+void SnapshotRingDestroy(SnapshotRing *ring);
+
+/**
+ * @brief Make a snapshot the newest.
+ * @param ring The snapshot ring.
+ * @param state The snapshot.
+ * @param size Size of the snapshot in bytes, may differ between snapshots.
+ * @note Only allocates while the largest snapshot so far grows.
+ */
+void SnapshotRingPush(SnapshotRing *ring, const void *state, size_t size);
+
+/**
+ * @brief Get the newest snapshot.
+ * @param ring The snapshot ring.
+ * @param size Set to the size of the snapshot in bytes.
+ * @return The snapshot, valid until the ring is modified, or NULL if nothing
+ *         was pushed.
+ */
+const void *SnapshotRingLatest(const SnapshotRing *ring, size_t *size);
+
+/**
+ * @brief Drop the newest snapshot, making the one before it the newest.
+ * @param ring The snapshot ring.
+ * @param size Set to the size of the snapshot in bytes.
+ * @return The snapshot before the dropped one, valid until the ring is
+ *         modified, or NULL if there is no older snapshot.
+ */
+const void *SnapshotRingRewind(SnapshotRing *ring, size_t *size);
+
+/**
+ * @brief Get the number of snapshots older than the newest.
+ * @param ring The snapshot ring.
+ * @return Number of times SnapshotRingRewind() can step back.
+ */
+size_t SnapshotRingLength(const SnapshotRing *ring);
+
+/**
+ * @brief Drop all snapshots.
+ * @param ring The snapshot ring.
+ */
+void SnapshotRingClear(SnapshotRing *ring);
+
+#endif // __ETERNO_SNAPSHOT_H__
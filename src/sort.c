@@ -0,0 +1,229 @@
+#include "config.h"
+
+#define LOG_MODULE LOG_MODULE_CORE
+
+#include <SDL3/SDL.h>
+#include <assert.h>
+#include <string.h>
+
+#include "logger.h"
+#include "sort.h"
+#include "utils.h"
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define PARALLEL_SORT_MIN_CHUNK 16384
+
+/**
+ * @brief Define an LSD radix sort over a key type.
+ * @note All digit histograms are built in a single pass over the keys. Passes
+ *       where every key has the same digit are skipped entirely.
+ */
+#define DEFINE_RADIX_SORT(Name, Type, KeyBytes)                                \
+  void Name(Type *const items, Type *const scratch, const size_t n) {          \
+    assert(items != NULL || n == 0);                                           \
+    if (n < 2) {                                                               \
+      return;                                                                  \
+    }                                                                          \
+                                                                               \
+    size_t counts[KeyBytes][RADIX_SIZE];                                       \
+    memset(counts, 0, sizeof(counts));                                         \
+    for (size_t i = 0; i < n; i++) {                                           \
+      for (size_t pass = 0; pass < (KeyBytes); pass++) {                       \
+        counts[pass][(items[i].key >> (pass * RADIX_BITS)) &                   \
+                     (RADIX_SIZE - 1)] += 1;                                   \
+      }                                                                        \
+    }                                                                          \
+                                                                               \
+    Type *const buffer =                                                       \
+        (scratch != NULL) ? scratch : xmalloc(n * sizeof(Type));               \
+    Type *src = items;                                                         \
+    Type *dst = buffer;                                                        \
+                                                                               \
+    for (size_t pass = 0; pass < (KeyBytes); pass++) {                         \
+      const unsigned shift = (unsigned)(pass * RADIX_BITS);                    \
+      size_t *const count = counts[pass];                                      \
+      if (count[(src[0].key >> shift) & (RADIX_SIZE - 1)] == n) {              \
+        continue; /* All keys share this digit */                              \
+      }                                                                        \
+                                                                               \
+      size_t offset = 0;                                                       \
+      for (size_t digit = 0; digit < RADIX_SIZE; digit++) {                    \
+        const size_t tmp = count[digit];                                       \
+        count[digit] = offset;                                                 \
+        offset += tmp;                                                         \
+      }                                                                        \
+                                                                               \
+      for (size_t i = 0; i < n; i++) {                                         \
+        dst[count[(src[i].key >> shift) & (RADIX_SIZE - 1)]++] = src[i];       \
+      }                                                                        \
+                                                                               \
+      Type *const tmp = src;                                                   \
+      src = dst;                                                               \
+      dst = tmp;                                                               \
+    }                                                                          \
+                                                                               \
+    if (src != items) {                                                        \
+      memcpy(items, src, n * sizeof(Type));                                    \
+    }                                                                          \
+    if (scratch == NULL) {                                                     \
+      xfree(buffer);                                                           \
+    }                                                                          \
+  }
+
+DEFINE_RADIX_SORT(RadixSort32, SortKey32, sizeof(uint32_t))
+DEFINE_RADIX_SORT(RadixSort64, SortKey64, sizeof(uint64_t))
+
+typedef struct {
+  /* Chunk sorting */
+  char *base;
+  size_t n;
+  /* Merging */
+  const char *left;
+  size_t n_left;
+  const char *right;
+  size_t n_right;
+  char *dst;
+  /* Common */
+  size_t size;
+  int (*compare)(const void *, const void *);
+} SortTask;
+
+static int SortChunk(void *const data) {
+  SortTask *const task = data;
+  qsort(task->base, task->n, task->size, task->compare);
+  return 0;
+}
+
+static int MergeRuns(void *const data) {
+  SortTask *const task = data;
+  const char *left = task->left;
+  const char *right = task->right;
+  const char *const left_end = left + (task->n_left * task->size);
+  const char *const right_end = right + (task->n_right * task->size);
+  char *dst = task->dst;
+
+  while (left < left_end && right < right_end) {
+    if (task->compare(right, left) < 0) {
+      memcpy(dst, right, task->size);
+      right += task->size;
+    } else {
+      memcpy(dst, left, task->size);
+      left += task->size;
+    }
+    dst += task->size;
+  }
+
+  memcpy(dst, left, (size_t)(left_end - left));
+  dst += left_end - left;
+  memcpy(dst, right, (size_t)(right_end - right));
+  return 0;
+}
+
+/**
+ * @brief Run tasks on separate threads and wait for them to finish.
+ * @note Tasks that could not get a thread are run on the calling thread.
+ */
+static void RunTasks(SDL_ThreadFunction func, SortTask *const tasks,
+                     const size_t n_tasks) {
+  SDL_Thread **const threads = xcalloc(n_tasks, sizeof(SDL_Thread *));
+
+  /* The calling thread takes the first task itself */
+  for (size_t i = 1; i < n_tasks; i++) {
+    threads[i] = SDL_CreateThread(func, "sort", &tasks[i]);
+    if (threads[i] == NULL) {
+      LOG_DEBUG("Failed to create sort thread: %s", SDL_GetError());
+      func(&tasks[i]);
+    }
+  }
+
+  func(&tasks[0]);
+
+  for (size_t i = 1; i < n_tasks; i++) {
+    SDL_WaitThread(threads[i], NULL);
+  }
+  xfree(threads);
+}
+
+void ParallelMergeSort(void *const base, const size_t n, const size_t size,
+                       int (*compare)(const void *, const void *),
+                       unsigned n_threads) {
+  assert(base != NULL || n == 0);
+  assert(size > 0);
+  assert(compare != NULL);
+
+  if (n_threads == 0) {
+    const int n_cores = SDL_GetNumLogicalCPUCores();
+    n_threads = (n_cores > 0) ? (unsigned)n_cores : 1;
+  }
+
+  size_t n_runs = MIN((size_t)n_threads, n / PARALLEL_SORT_MIN_CHUNK);
+  if (n_runs <= 1) {
+    qsort(base, n, size, compare);
+    return;
+  }
+
+  /* Sort equally sized chunks in parallel */
+  size_t *const offsets = xcalloc(n_runs + 1, sizeof(size_t));
+  SortTask *const tasks = xcalloc(n_runs, sizeof(SortTask));
+  for (size_t i = 0; i < n_runs; i++) {
+    offsets[i] = (n * i) / n_runs;
+  }
+  offsets[n_runs] = n;
+
+  for (size_t i = 0; i < n_runs; i++) {
+    tasks[i].base = (char *)base + (offsets[i] * size);
+    tasks[i].n = offsets[i + 1] - offsets[i];
+    tasks[i].size = size;
+    tasks[i].compare = compare;
+  }
+  RunTasks(SortChunk, tasks, n_runs);
+
+  /* Merge adjacent runs pairwise, ping-ponging between the array and the
+   * scratch buffer, until a single run is left */
+  char *const scratch = xmalloc(n * size);
+  char *src = base;
+  char *dst = scratch;
+
+  while (n_runs > 1) {
+    const size_t n_merges = n_runs / 2;
+    for (size_t i = 0; i < n_merges; i++) {
+      const size_t begin = offsets[2 * i];
+      const size_t middle = offsets[(2 * i) + 1];
+      const size_t end = offsets[(2 * i) + 2];
+      tasks[i].left = src + (begin * size);
+      tasks[i].n_left = middle - begin;
+      tasks[i].right = src + (middle * size);
+      tasks[i].n_right = end - middle;
+      tasks[i].dst = dst + (begin * size);
+    }
+    RunTasks(MergeRuns, tasks, n_merges);
+
+    if ((n_runs % 2) != 0) {
+      /* Carry the odd run over to the next level */
+      const size_t begin = offsets[n_runs - 1];
+      memcpy(dst + (begin * size), src + (begin * size),
+             (n - begin) * size);
+    }
+
+    /* Every other boundary disappears */
+    size_t n_new_runs = 0;
+    for (size_t i = 0; i < n_runs; i += 2) {
+      offsets[n_new_runs++] = offsets[i];
+    }
+    offsets[n_new_runs] = n;
+    n_runs = n_new_runs;
+
+    char *const tmp = src;
+    src = dst;
+    dst = tmp;
+  }
+
+  if (src != base) {
+    memcpy(base, src, n * size);
+  }
+
+  xfree(scratch);
+  xfree(tasks);
+  xfree(offsets);
+}
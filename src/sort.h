@@ -0,0 +1,71 @@
+#ifndef __ETERNO_SORT_H__
+#define __ETERNO_SORT_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * @brief Key with payload index, e.g. a draw command sort key and the index
+ *        of the draw command.
+ */
+typedef struct SortKey32 {
+  uint32_t key;
+  uint32_t index;
+} SortKey32;
+
+typedef struct SortKey64 {
+  uint64_t key;
+  uint32_t index;
+} SortKey64;
+
+/**
+ * @brief Sort keys in ascending order using LSD radix sort.
+ * @param items Keys to sort.
+ * @param scratch Scratch space for n items or NULL to allocate it.
+ * @param n Number of keys.
+ * @note The sort is stable. Byte positions where all keys are equal are
+ *       skipped, so narrow keys (e.g. a layer in the high byte) are cheap.
+ */
+void RadixSort32(SortKey32 *items, SortKey32 *scratch, size_t n);
+
+/**
+ * @brief Sort 64-bit keys in ascending order using LSD radix sort.
+ * @param items Keys to sort.
+ * @param scratch Scratch space for n items or NULL to allocate it.
+ * @param n Number of keys.
+ * @note The sort is stable.
+ */
+void RadixSort64(SortKey64 *items, SortKey64 *scratch, size_t n);
+
+/**
+ * @brief Map a float to an unsigned key with the same ordering.
+ * @param value The float (not NaN).
+ * @return The key.
+ * @note Useful for building composite keys, e.g. for draw ordering:
+ *       ((uint64_t)layer << 56) | ((uint64_t)SortKeyFromFloat(y) << 24) |
+ *       texture.
+ */
+static inline uint32_t SortKeyFromFloat(float value) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = value};
+  /* Flip all bits of negative numbers, only the sign bit of positive ones */
+  const uint32_t mask = (uint32_t)(-(int32_t)(bits.u >> 31)) | 0x80000000u;
+  return bits.u ^ mask;
+}
+
+/**
+ * @brief Sort an array using a merge sort spread over multiple threads.
+ * @param base Array to sort.
+ * @param n Number of elements.
+ * @param size Size of each element.
+ * @param compare Comparison function as for qsort(3).
+ * @param n_threads Number of threads or 0 to use the number of CPU cores.
+ * @note Small arrays are sorted on the calling thread. The sort is not stable.
+ */
+void ParallelMergeSort(void *base, size_t n, size_t size,
+                       int (*compare)(const void *, const void *),
+                       unsigned n_threads);
+
+#endif // __ETERNO_SORT_H__
@@ -1,13 +1,25 @@
 #include "config.h"
 
+#define LOG_MODULE LOG_MODULE_TEXTURE
+
 #include <SDL3_image/SDL_image.h>
 #include <assert.h>
+#include <inttypes.h>
+#include <limits.h>
 
+#include "buffer.h"
+#include "compress.h"
 #include "dict.h"
 #include "logger.h"
+#include "metrics.h"
 #include "texture.h"
 #include "utils.h"
 
+/* Packed textures are this magic, width and height followed by RGBA32 pixels
+ * without padding */
+#define TEXTURE_PACK_MAGIC "ETXP"
+#define TEXTURE_PACK_HEADER_SIZE 12
+
 typedef struct {
   SDL_Texture *texture;
   unsigned ref_counter;
@@ -25,68 +37,225 @@ static void TextureMapEntryDestroy(void *ptr) {
   }
 
   SDL_DestroyTexture(map_entry->texture);
-  free(map_entry);
+  xfree(map_entry);
+}
+
+/**
+ * @brief Increment the reference counter of a texture if it is loaded.
+ * @return True if the texture was already loaded.
+ */
+static bool TextureMapRetainTexture(TextureMap *texture_map,
+                                    const Atom texture_id) {
+  if (!DictHasAtom(texture_map, texture_id)) {
+    return false;
+  }
+
+  TextureMapEntry *map_entry =
+      (TextureMapEntry *)DictGetAtom(texture_map, texture_id);
+  LOG_DEBUG("Incrementing reference counter for texture '%s' from %d to %d",
+            texture_id, map_entry->ref_counter, map_entry->ref_counter + 1);
+  map_entry->ref_counter += 1;
+  return true;
+}
+
+/**
+ * @brief Create a texture from a surface and add it to the map.
+ * @note Takes ownership of the surface.
+ */
+static bool TextureMapAddSurface(TextureMap *texture_map,
+                                 const Atom texture_id, SDL_Renderer *renderer,
+                                 SDL_Surface *surface) {
+  TextureMapEntry *map_entry = xmalloc(sizeof(TextureMapEntry));
+  memset(map_entry, 0, sizeof(TextureMapEntry));
+
+  LOG_DEBUG("Creating texture from surface");
+  map_entry->texture = SDL_CreateTextureFromSurface(renderer, surface);
+
+  LOG_DEBUG("Destroying surface");
+  SDL_DestroySurface(surface);
+
+  if (map_entry->texture == NULL) {
+    LOG_ERROR("Failed to create texture: %s", SDL_GetError());
+    TextureMapEntryDestroy(map_entry);
+    return false;
+  }
+
+  DictSetAtom(texture_map, texture_id, map_entry, TextureMapEntryDestroy);
+  METRICS_ADD(TEXTURE_LOADS, 1);
+  METRICS_SET(TEXTURES, (int64_t)DictLength(texture_map));
+
+  LOG_DEBUG("Incrementing reference counter for texture '%s' from %d to %d",
+            texture_id, map_entry->ref_counter, map_entry->ref_counter + 1);
+  map_entry->ref_counter += 1;
+  return true;
 }
 
 bool TextureMapLoadTexture(TextureMap *texture_map, const char *filename,
-                           const char *texture_id, SDL_Renderer *renderer) {
+                           const Atom texture_id, SDL_Renderer *renderer) {
   assert(texture_map != NULL);
   assert(filename != NULL);
   assert(texture_id != NULL);
   assert(renderer != NULL);
 
-  if (DictHasKey(texture_map, texture_id)) {
-    TextureMapEntry *map_entry =
-        (TextureMapEntry *)DictGet(texture_map, texture_id);
-    LOG_DEBUG("Incrementing reference counter for texture '%s' from %d to %d",
-              texture_id, map_entry->ref_counter, map_entry->ref_counter + 1);
-    map_entry->ref_counter += 1;
+  if (TextureMapRetainTexture(texture_map, texture_id)) {
     return true;
   }
 
-  TextureMapEntry *map_entry = xmalloc(sizeof(TextureMapEntry));
-  memset(map_entry, 0, sizeof(TextureMapEntry));
-
   LOG_DEBUG("Loading surface from file '%s'", filename);
   SDL_Surface *surface = IMG_Load(filename);
   if (surface == NULL) {
     LOG_ERROR("Failed to load image from '%s'", filename);
-    TextureMapEntryDestroy(map_entry);
     return false;
   }
 
-  LOG_DEBUG("Creating texture from surface");
-  map_entry->texture = SDL_CreateTextureFromSurface(renderer, surface);
+  return TextureMapAddSurface(texture_map, texture_id, renderer, surface);
+}
 
-  LOG_DEBUG("Destroying surface");
-  SDL_DestroySurface(surface);
+/**
+ * @brief Create a surface referring to the pixels of a packed texture.
+ * @return The surface or NULL if the data is not a packed texture.
+ */
+static SDL_Surface *UnpackSurface(const char *data, size_t length) {
+  if (length < TEXTURE_PACK_HEADER_SIZE ||
+      memcmp(data, TEXTURE_PACK_MAGIC, 4) != 0) {
+    return NULL;
+  }
 
-  if (map_entry->texture == NULL) {
-    LOG_ERROR("Failed to create texture: %s", SDL_GetError());
-    TextureMapEntryDestroy(map_entry);
+  const unsigned char *header = (const unsigned char *)data;
+  const uint32_t width = (uint32_t)header[4] | ((uint32_t)header[5] << 8) |
+                         ((uint32_t)header[6] << 16) |
+                         ((uint32_t)header[7] << 24);
+  const uint32_t height = (uint32_t)header[8] | ((uint32_t)header[9] << 8) |
+                          ((uint32_t)header[10] << 16) |
+                          ((uint32_t)header[11] << 24);
+  if (width == 0 || width > INT_MAX / 4 || height > INT_MAX ||
+      (uint64_t)width * height * 4 != length - TEXTURE_PACK_HEADER_SIZE) {
+    LOG_ERROR("Bad packed texture: %" PRIu32 "x%" PRIu32 " pixels in %zu "
+              "bytes",
+              width, height, length - TEXTURE_PACK_HEADER_SIZE);
+    return NULL;
+  }
+
+  /* The surface only reads the pixels while the texture is created */
+  return SDL_CreateSurfaceFrom((int)width, (int)height, SDL_PIXELFORMAT_RGBA32,
+                               (void *)(data + TEXTURE_PACK_HEADER_SIZE),
+                               (int)width * 4);
+}
+
+bool TextureMapLoadTextureFromBuffer(TextureMap *texture_map,
+                                     const Buffer *buffer,
+                                     const Atom texture_id,
+                                     SDL_Renderer *renderer) {
+  assert(texture_map != NULL);
+  assert(buffer != NULL);
+  assert(texture_id != NULL);
+  assert(renderer != NULL);
+
+  if (TextureMapRetainTexture(texture_map, texture_id)) {
+    return true;
+  }
+
+  const char *data = BufferData(buffer);
+  size_t length = BufferLength(buffer);
+
+  Buffer *unpacked = NULL;
+  if (CompressIsFrame(data, length)) {
+    LOG_DEBUG("Decompressing texture '%s'", texture_id);
+    unpacked = BufferCreate();
+    if (!DecompressFrame(unpacked, data, length)) {
+      LOG_ERROR("Failed to decompress texture '%s'", texture_id);
+      BufferDestroy(unpacked);
+      return false;
+    }
+    data = BufferData(unpacked);
+    length = BufferLength(unpacked);
+  }
+
+  SDL_Surface *surface = NULL;
+  if (length >= 4 && memcmp(data, TEXTURE_PACK_MAGIC, 4) == 0) {
+    LOG_DEBUG("Loading surface for texture '%s' from packed pixels",
+              texture_id);
+    surface = UnpackSurface(data, length);
+  } else {
+    LOG_DEBUG("Loading surface for texture '%s' from memory", texture_id);
+    SDL_IOStream *stream = SDL_IOFromConstMem(data, length);
+    if (stream != NULL) {
+      surface = IMG_Load_IO(stream, true); /* Closes the stream */
+    }
+  }
+
+  if (surface == NULL) {
+    LOG_ERROR("Failed to load image for texture '%s': %s", texture_id,
+              SDL_GetError());
+    BufferDestroy(unpacked);
     return false;
   }
 
-  DictSet(texture_map, texture_id, map_entry, TextureMapEntryDestroy);
+  const bool success =
+      TextureMapAddSurface(texture_map, texture_id, renderer, surface);
+  BufferDestroy(unpacked);
+  return success;
+}
 
-  LOG_DEBUG("Incrementing reference counter for texture '%s' from %d to %d",
-            texture_id, map_entry->ref_counter, map_entry->ref_counter + 1);
-  map_entry->ref_counter += 1;
+bool TexturePackImage(Buffer *out, const char *filename, const bool compress) {
+  assert(out != NULL);
+  assert(filename != NULL);
+
+  SDL_Surface *image = IMG_Load(filename);
+  if (image == NULL) {
+    LOG_ERROR("Failed to load image from '%s': %s", filename, SDL_GetError());
+    return false;
+  }
+
+  SDL_Surface *surface = SDL_ConvertSurface(image, SDL_PIXELFORMAT_RGBA32);
+  SDL_DestroySurface(image);
+  if (surface == NULL) {
+    LOG_ERROR("Failed to convert image from '%s': %s", filename,
+              SDL_GetError());
+    return false;
+  }
+
+  const size_t row_size = (size_t)surface->w * 4;
+  const size_t size =
+      TEXTURE_PACK_HEADER_SIZE + (row_size * (size_t)surface->h);
+  Buffer *packed = BufferCreate();
+  unsigned char *dst = (unsigned char *)BufferReserve(packed, size);
+
+  memcpy(dst, TEXTURE_PACK_MAGIC, 4);
+  for (size_t i = 0; i < 4; i++) {
+    dst[4 + i] = (unsigned char)((uint32_t)surface->w >> (8 * i));
+    dst[8 + i] = (unsigned char)((uint32_t)surface->h >> (8 * i));
+  }
+  /* Rows of the surface may be padded */
+  for (int row = 0; row < surface->h; row++) {
+    memcpy(dst + TEXTURE_PACK_HEADER_SIZE + ((size_t)row * row_size),
+           (const char *)surface->pixels + ((size_t)row * surface->pitch),
+           row_size);
+  }
+  BufferCommit(packed, size);
+  SDL_DestroySurface(surface);
+
+  if (compress) {
+    CompressFrame(out, BufferData(packed), BufferLength(packed));
+  } else {
+    BufferAppendSlice(out, BufferSlice(packed));
+  }
+  BufferDestroy(packed);
   return true;
 }
 
-bool TextureMapClearTexture(TextureMap *texture_map, const char *texture_id) {
+bool TextureMapClearTexture(TextureMap *texture_map, const Atom texture_id) {
   assert(texture_map != NULL);
   assert(texture_id != NULL);
 
-  if (!DictHasKey(texture_map, texture_id)) {
+  if (!DictHasAtom(texture_map, texture_id)) {
     LOG_ERROR("Attempted to clear non-existent texture map entry with id '%s'",
               texture_id);
     return false;
   }
 
   TextureMapEntry *map_entry =
-      (TextureMapEntry *)DictGet(texture_map, texture_id);
+      (TextureMapEntry *)DictGetAtom(texture_map, texture_id);
   if (map_entry->ref_counter > 0) {
     LOG_DEBUG("Decrementing reference counter for texture '%s' from %d to %d",
               texture_id, map_entry->ref_counter, map_entry->ref_counter - 1);
@@ -96,25 +265,26 @@ bool TextureMapClearTexture(TextureMap *texture_map, const char *texture_id) {
   if (map_entry->ref_counter == 0) {
     LOG_DEBUG("Destroying texture '%s': Reference counter '%d'", texture_id,
               map_entry->ref_counter);
-    DictRemove(texture_map, texture_id);
+    TextureMapEntryDestroy(DictRemoveAtom(texture_map, texture_id));
+    METRICS_SET(TEXTURES, (int64_t)DictLength(texture_map));
   }
 
   return true;
 }
 
-bool TextureMapDrawFrame(const TextureMap *texture_map, const char *texture_id,
+bool TextureMapDrawFrame(const TextureMap *texture_map, const Atom texture_id,
                          SDL_Renderer *renderer, float x, float y, float width,
                          float height, int column, int row, double angle,
                          Uint8 alpha, SDL_FlipMode flip) {
   assert(texture_map != NULL);
   assert(texture_id != NULL);
 
-  if (!DictHasKey(texture_map, texture_id)) {
+  if (!DictHasAtom(texture_map, texture_id)) {
     LOG_ERROR("Failed to draw frame: Texture '%s' does not exist", texture_id);
     return false;
   }
 
-  const TextureMapEntry *map_entry = DictGet(texture_map, texture_id);
+  const TextureMapEntry *map_entry = DictGetAtom(texture_map, texture_id);
   SDL_Texture *texture = map_entry->texture;
 
   SDL_FRect src_rect = {
@@ -144,16 +314,23 @@ bool TextureMapDrawFrame(const TextureMap *texture_map, const char *texture_id,
     success = false;
   }
 
+  /* Consecutive draws of the same texture can be batched by the renderer.
+   * Frames are only drawn from the main thread. */
+  static const SDL_Texture *last_texture = NULL;
+  METRICS_ADD(DRAW_CALLS, 1);
+  METRICS_ADD(TEXTURE_SWITCHES, texture != last_texture);
+  last_texture = texture;
+
   return success;
 }
 
 bool TextureMapGetTextureSize(const TextureMap *texture_map,
-                              const char *texture_id, float *width,
+                              const Atom texture_id, float *width,
                               float *height) {
   assert(texture_map != NULL);
   assert(texture_id != NULL);
 
-  const TextureMapEntry *map_entry = DictGet(texture_map, texture_id);
+  const TextureMapEntry *map_entry = DictGetAtom(texture_map, texture_id);
   SDL_Texture *texture = map_entry->texture;
 
   if (!SDL_GetTextureSize(texture, width, height)) {
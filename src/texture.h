@@ -2,6 +2,8 @@
 #ifndef __ETERNO_TEXTURE_H__
 #define __ETERNO_TEXTURE_H__
 
+#include "atom.h"
+#include "buffer.h"
 #include "dict.h"
 
 #include <SDL3/SDL.h>
@@ -15,17 +17,37 @@ static inline void TextureMapDestroy(void *texture_map) {
 }
 
 bool TextureMapLoadTexture(TextureMap *texture_map, const char *filename,
-                           const char *texture_id, SDL_Renderer *renderer);
-
-bool TextureMapClearTexture(TextureMap *texture_map, const char *texture_id);
-
-bool TextureMapDrawFrame(const TextureMap *texture_map, const char *texture_id,
+                           Atom texture_id, SDL_Renderer *renderer);
+
+/**
+ * @brief Load a texture from an image file already read into memory, e.g. by
+ *        AioRead(), so that the calling thread does not block on disk.
+ * @note Accepts any format IMG_Load() does as well as packed textures from
+ *       TexturePackImage(), which skip image decoding.
+ */
+bool TextureMapLoadTextureFromBuffer(TextureMap *texture_map,
+                                     const Buffer *buffer, Atom texture_id,
+                                     SDL_Renderer *renderer);
+
+/**
+ * @brief Pack the decoded pixels of an image into a blob that loads without
+ *        image decoding.
+ * @param out Buffer to append blob to.
+ * @param filename Path to image file.
+ * @param compress Whether to compress the blob with CompressFrame().
+ * @return False if the image could not be loaded.
+ */
+bool TexturePackImage(Buffer *out, const char *filename, bool compress);
+
+bool TextureMapClearTexture(TextureMap *texture_map, Atom texture_id);
+
+bool TextureMapDrawFrame(const TextureMap *texture_map, Atom texture_id,
                          SDL_Renderer *renderer, float x, float y, float width,
                          float height, int column, int row, double angle,
                          Uint8 alpha, SDL_FlipMode flip);
 
 bool TextureMapGetTextureSize(const TextureMap *texture_map,
-                              const char *texture_id, float *width,
+                              Atom texture_id, float *width,
                               float *height);
 
 #endif /* __ETERNO_TEXTURE_H__ */
\ No newline at end of file
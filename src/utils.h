@@ -34,6 +34,16 @@
 
 #define StringEqual(a, b) (strcmp(a, b) == 0)
 
+#ifdef ENABLE_MEMTRACK
+#include "memtrack.h"
+
+/* Record the call site of each allocation, see memtrack.h */
+#define xmalloc(size) MemTrackMalloc(size, LOG_FILE, __LINE__)
+#define xcalloc(nmemb, size) MemTrackCalloc(nmemb, size, LOG_FILE, __LINE__)
+#define xrealloc(ptr, size) MemTrackRealloc(ptr, size, LOG_FILE, __LINE__)
+#define xstrdup(str) MemTrackStrdup(str, LOG_FILE, __LINE__)
+#define xfree(ptr) MemTrackFree(ptr)
+#else
 /**
  * @brief Allocate memory using malloc(3). On error, print error message and
  *        abort(3).
@@ -74,4 +84,24 @@ static inline char *xstrdup(const char *str) {
   return dup;
 }
 
+/**
+ * @brief Resize memory using realloc(3). On error, print error message and
+ *        abort(3).
+ */
+static inline void *xrealloc(void *ptr, size_t size) {
+  void *new_ptr = realloc(ptr, size);
+  if (new_ptr == NULL) {
+    LOG_CRITICAL("Failed to allocate memory: %s", strerror(errno));
+  }
+  assert(new_ptr != NULL); /* Program execution should have been aborted */
+  return new_ptr;
+}
+
+/**
+ * @brief Free memory allocated with xmalloc(), xcalloc(), xrealloc() or
+ *        xstrdup() using free(3).
+ */
+static inline void xfree(void *ptr) { free(ptr); }
+#endif /* ENABLE_MEMTRACK */
+
 #endif /* __ETERNO_UTILS_H__ */
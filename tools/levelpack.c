@@ -0,0 +1,231 @@
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "level.h"
+#include "logger.h"
+#include "utils.h"
+
+#define DEFAULT_TILE_SIZE 16
+#define DEFAULT_CHUNK_TILES 32
+
+static const struct option LONG_OPTIONS[] = {
+    {"tile-size", required_argument, NULL, 't'},
+    {"chunk-tiles", required_argument, NULL, 'c'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+};
+
+static const char *const DESCRIPTIONS[] = {
+    "size of tiles in px (default 16)",
+    "width and height of chunks in tiles (default 32)",
+    "print help message",
+};
+
+static void PrintHelp(const char *prog) {
+  printf("%s %s: Pack text levels into level files\n\n", PACKAGE_NAME,
+         PACKAGE_VERSION);
+
+  printf("Usage: %s [OPTIONS] INPUT OUTPUT\n\n", prog);
+
+  size_t longest = 0;
+  for (int i = 0; LONG_OPTIONS[i].val != 0; i++) {
+    const size_t length = strlen(LONG_OPTIONS[i].name);
+    if (length > longest) {
+      longest = length;
+    }
+  }
+
+  char format[64];
+  NDEBUG_UNUSED int ret =
+      snprintf(format, sizeof(format), "  --%%-%zus    %%s\n", longest);
+  assert(ret >= 0 && (size_t)ret < sizeof(format));
+
+  printf("OPTIONS:\n");
+  for (int i = 0; LONG_OPTIONS[i].val != 0; i++) {
+    printf(format, LONG_OPTIONS[i].name, DESCRIPTIONS[i]);
+  }
+
+  printf("\nEach line of INPUT is a row of tiles: '#' is solid, 'P' is the "
+         "player start\nand '1' to '9' spawn an entity of that type. Anything "
+         "else is empty.\n");
+
+  printf("\nReport bugs to: <%s>\n", PACKAGE_BUGREPORT);
+  printf("%s home page: <%s>\n", PACKAGE_NAME, PACKAGE_URL);
+}
+
+static bool ParseSize(const char *const str, const char *const what,
+                      uint16_t *const value) {
+  char *end;
+  errno = 0;
+  const unsigned long parsed = strtoul(str, &end, 10);
+  if (errno != 0 || end == str || *end != '\0' || parsed == 0 ||
+      parsed > 1024) {
+    LOG_ERROR("Bad %s '%s': Expected 1 to 1024", what, str);
+    return false;
+  }
+  *value = (uint16_t)parsed;
+  return true;
+}
+
+/* Convert the text level, and write the level file */
+static bool Pack(const Buffer *const input, const char *const filename,
+                 const uint16_t tile_size, const uint16_t chunk_tiles) {
+  const char *const text = BufferData(input);
+  const size_t length = BufferLength(input);
+
+  /* The widest line decides the width */
+  size_t columns = 0, rows = 0, width = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (text[i] == '\n') {
+      rows += 1;
+      width = 0;
+    } else if (text[i] != '\r') {
+      width += 1;
+      columns = MAX(columns, width);
+    }
+  }
+  rows += (length > 0 && text[length - 1] != '\n');
+  if (columns == 0 || rows == 0 || columns > UINT32_MAX || rows > UINT32_MAX) {
+    LOG_ERROR("Bad level: Empty or too large");
+    return false;
+  }
+
+  uint8_t *const collision = xcalloc(columns * rows, sizeof(uint8_t));
+  uint16_t *const layers = xcalloc(columns * rows, sizeof(uint16_t));
+  LevelSpawn *spawns = NULL;
+  size_t n_spawns = 0;
+  bool has_start = false;
+  LevelDesc desc = {
+      .tile_size = tile_size,
+      .chunk_tiles = chunk_tiles,
+      .n_layers = 1,
+      .columns = (uint32_t)columns,
+      .rows = (uint32_t)rows,
+      .collision = collision,
+      .layers = layers,
+  };
+
+  size_t row = 0, column = 0;
+  for (size_t i = 0; i < length; i++) {
+    const char ch = text[i];
+    const int32_t x = (int32_t)(column * tile_size);
+    const int32_t y = (int32_t)(row * tile_size);
+    if (ch == '\n') {
+      row += 1;
+      column = 0;
+      continue;
+    }
+    if (ch == '\r') {
+      continue;
+    }
+
+    if (ch == '#') {
+      collision[(row * columns) + column] = 1;
+      layers[(row * columns) + column] = 1;
+    } else if (ch == 'P') {
+      desc.spawn_x = x;
+      desc.spawn_y = y;
+      has_start = true;
+    } else if (ch >= '1' && ch <= '9') {
+      spawns = xrealloc(spawns, (n_spawns + 1) * sizeof(LevelSpawn));
+      spawns[n_spawns++] = (LevelSpawn){
+          .type = (uint16_t)(ch - '0'),
+          .x = x,
+          .y = y,
+      };
+    }
+    column += 1;
+  }
+  desc.spawns = spawns;
+  desc.n_spawns = n_spawns;
+
+  if (!has_start) {
+    LOG_WARNING("Level has no player start 'P': Starting at the top-left");
+  }
+
+  Buffer *const out = BufferCreate();
+  LevelPack(out, &desc);
+  xfree(collision);
+  xfree(layers);
+  xfree(spawns);
+
+  bool success = true;
+  FILE *const file = fopen(filename, "wb");
+  if (file == NULL) {
+    LOG_ERROR("Failed to open '%s': %s", filename, strerror(errno));
+    success = false;
+  } else {
+    if (fwrite(BufferData(out), 1, BufferLength(out), file) !=
+        BufferLength(out)) {
+      LOG_ERROR("Failed to write '%s': %s", filename, strerror(errno));
+      success = false;
+    }
+    if (fclose(file) != 0) {
+      LOG_ERROR("Failed to close '%s': %s", filename, strerror(errno));
+      success = false;
+    }
+  }
+
+  if (success) {
+    printf("%s: %zux%zu tiles, %zu spawns, %zu bytes\n", filename, columns,
+           rows, n_spawns, BufferLength(out));
+  }
+  BufferDestroy(out);
+  return success;
+}
+
+int main(int argc, char *argv[]) {
+  uint16_t tile_size = DEFAULT_TILE_SIZE;
+  uint16_t chunk_tiles = DEFAULT_CHUNK_TILES;
+
+  int c;
+  while ((c = getopt_long(argc, argv, "t:c:h", LONG_OPTIONS, NULL)) != -1) {
+    switch (c) {
+    case 't':
+      if (!ParseSize(optarg, "tile size", &tile_size)) {
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'c':
+      if (!ParseSize(optarg, "chunk size", &chunk_tiles)) {
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'h':
+      PrintHelp(argv[0]);
+      return EXIT_SUCCESS;
+
+    case '?':
+      /* Error already printed by getopt_long(3) */
+      return EXIT_FAILURE;
+
+    default:
+      LOG_CRITICAL("Unhandled option '%c'", c);
+    }
+  }
+
+  if (optind + 2 != argc) {
+    LOG_ERROR("Expected an input and an output file (see --help)");
+    return EXIT_FAILURE;
+  }
+
+  Buffer *const input = BufferCreate();
+  if (!BufferReadFile(input, argv[optind])) {
+    BufferDestroy(input);
+    return EXIT_FAILURE;
+  }
+
+  const bool success = Pack(input, argv[optind + 1], tile_size, chunk_tiles);
+  BufferDestroy(input);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,263 @@
+#include "config.h"
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "array.h"
+#include "buffer.h"
+#include "log_record.h"
+#include "logger.h"
+#include "utils.h"
+
+/* Write decoded output in chunks of about this size */
+#define FLUSH_SIZE 65536
+
+typedef LogSite *LogSitePtr;
+ARRAY_DEFINE(SiteArray, LogSitePtr, 64)
+
+typedef struct {
+  const char *data;
+  size_t size;
+  size_t offset;
+} Reader;
+
+static const struct option LONG_OPTIONS[] = {
+    {"timestamps", no_argument, NULL, 't'},
+    {"help", no_argument, NULL, 'h'},
+    {NULL, 0, NULL, 0},
+};
+
+static const char *const DESCRIPTIONS[] = {
+    "prefix each message with its time in seconds",
+    "print help message",
+};
+
+static void PrintHelp(const char *prog) {
+  printf("%s %s: Decode binary log files\n\n", PACKAGE_NAME,
+         PACKAGE_VERSION);
+
+  printf("Usage: %s [OPTIONS] FILE\n\n", prog);
+
+  size_t longest = 0;
+  for (int i = 0; LONG_OPTIONS[i].val != 0; i++) {
+    const size_t length = strlen(LONG_OPTIONS[i].name);
+    if (length > longest) {
+      longest = length;
+    }
+  }
+
+  char format[64];
+  NDEBUG_UNUSED int ret =
+      snprintf(format, sizeof(format), "  --%%-%zus    %%s\n", longest);
+  assert(ret >= 0 && (size_t)ret < sizeof(format));
+
+  printf("OPTIONS:\n");
+  for (int i = 0; LONG_OPTIONS[i].val != 0; i++) {
+    printf(format, LONG_OPTIONS[i].name, DESCRIPTIONS[i]);
+  }
+
+  printf("\nReport bugs to: <%s>\n", PACKAGE_BUGREPORT);
+  printf("%s home page: <%s>\n", PACKAGE_NAME, PACKAGE_URL);
+}
+
+static bool Read(Reader *const reader, void *const value, const size_t size) {
+  if (reader->size - reader->offset < size) {
+    return false;
+  }
+  memcpy(value, reader->data + reader->offset, size);
+  reader->offset += size;
+  return true;
+}
+
+static char *ReadString(Reader *const reader) {
+  uint16_t length;
+  if (!Read(reader, &length, sizeof(length))) {
+    return NULL;
+  }
+  char *const str = xmalloc((size_t)length + 1);
+  if (!Read(reader, str, length)) {
+    free(str);
+    return NULL;
+  }
+  str[length] = '\0';
+  return str;
+}
+
+static bool ReadHeader(Reader *const reader) {
+  LogBinaryHeader header;
+  if (!Read(reader, &header, sizeof(header)) ||
+      memcmp(header.magic, LOG_BINARY_MAGIC, sizeof(header.magic)) != 0) {
+    LOG_ERROR("Not a binary log file");
+    return false;
+  }
+  if (header.version != LOG_BINARY_VERSION) {
+    LOG_ERROR("Unsupported binary log version %u", (unsigned)header.version);
+    return false;
+  }
+  /* Arguments are stored in the byte order and sizes of the writer */
+  if (header.byte_order != LOG_BINARY_BYTE_ORDER ||
+      header.long_double_size != sizeof(long double)) {
+    LOG_ERROR("Binary log was written on an incompatible platform");
+    return false;
+  }
+  return true;
+}
+
+static bool ReadSite(Reader *const reader, SiteArray *const sites) {
+  uint32_t id, line;
+  uint8_t level, module;
+  if (!Read(reader, &id, sizeof(id)) ||
+      !Read(reader, &level, sizeof(level)) ||
+      !Read(reader, &module, sizeof(module)) ||
+      !Read(reader, &line, sizeof(line))) {
+    return false;
+  }
+  /* Statements are numbered in the order they are written */
+  if (id != SiteArrayLength(sites) || level > LOG_LEVEL_CRITICAL ||
+      LogModuleName(module) == NULL) {
+    return false;
+  }
+
+  char *const file = ReadString(reader);
+  char *const format = (file != NULL) ? ReadString(reader) : NULL;
+  if (format == NULL) {
+    free(file);
+    return false;
+  }
+
+  LogSite *const site = xcalloc(1, sizeof(LogSite));
+  site->file = file;
+  site->format = format;
+  site->line = (int)line;
+  site->level = level;
+  site->module = module;
+  SiteArrayAppend(sites, site);
+  return true;
+}
+
+static bool ReadRecord(Reader *const reader, SiteArray *const sites,
+                       Buffer *const out, const bool timestamps) {
+  uint32_t id;
+  uint8_t truncated;
+  LogRecord record;
+  if (!Read(reader, &id, sizeof(id)) ||
+      !Read(reader, &record.timestamp, sizeof(record.timestamp)) ||
+      !Read(reader, &truncated, sizeof(truncated)) ||
+      !Read(reader, &record.size, sizeof(record.size)) ||
+      id >= SiteArrayLength(sites) || record.size > LOG_PAYLOAD_SIZE ||
+      !Read(reader, record.payload, record.size)) {
+    return false;
+  }
+  record.site = *SiteArrayAt(sites, id);
+  record.sequence = 0;
+  record.truncated = (truncated != 0);
+
+  if (timestamps) {
+    BufferPrintFormat(out, "%12.6f  ", (double)record.timestamp / 1e9);
+  }
+  LogRecordFormat(out, &record);
+  return true;
+}
+
+static bool Decode(const Buffer *const input, const bool timestamps) {
+  Reader reader = {BufferData(input), BufferLength(input), 0};
+  if (!ReadHeader(&reader)) {
+    return false;
+  }
+
+  SiteArray sites;
+  SiteArrayInit(&sites);
+  Buffer *const out = BufferCreate();
+
+  bool success = true;
+  uint8_t tag;
+  while (success && Read(&reader, &tag, sizeof(tag))) {
+    switch (tag) {
+    case LOG_BINARY_SITE:
+      success = ReadSite(&reader, &sites);
+      break;
+
+    case LOG_BINARY_RECORD:
+      success = ReadRecord(&reader, &sites, out, timestamps);
+      break;
+
+    case LOG_BINARY_DROPPED: {
+      uint64_t count;
+      success = Read(&reader, &count, sizeof(count));
+      if (success) {
+        BufferPrintFormat(out, "<wrn>  Dropped %llu log messages: Ring full\n",
+                          (unsigned long long)count);
+      }
+      break;
+    }
+
+    default:
+      success = false;
+      break;
+    }
+
+    if (BufferLength(out) >= FLUSH_SIZE) {
+      fwrite(BufferData(out), 1, BufferLength(out), stdout);
+      BufferTruncate(out, 0);
+    }
+  }
+
+  if (!success) {
+    /* A log cut short by a crash still decodes up to the damage */
+    LOG_ERROR("Corrupt entry at offset %zu", reader.offset);
+  }
+  fwrite(BufferData(out), 1, BufferLength(out), stdout);
+  BufferDestroy(out);
+
+  for (size_t i = 0; i < SiteArrayLength(&sites); i++) {
+    LogSite *const site = *SiteArrayAt(&sites, i);
+    free((char *)site->file);
+    free((char *)site->format);
+    free(site);
+  }
+  SiteArrayDestroy(&sites);
+  return success;
+}
+
+int main(int argc, char *argv[]) {
+  bool timestamps = false;
+
+  int c;
+  while ((c = getopt_long(argc, argv, "th", LONG_OPTIONS, NULL)) != -1) {
+    switch (c) {
+    case 't':
+      timestamps = true;
+      break;
+
+    case 'h':
+      PrintHelp(argv[0]);
+      return EXIT_SUCCESS;
+
+    case '?':
+      /* Error already printed by getopt_long(3) */
+      return EXIT_FAILURE;
+
+    default:
+      LOG_CRITICAL("Unhandled option '%c'", c);
+    }
+  }
+
+  if (optind + 1 != argc) {
+    LOG_ERROR("Expected exactly one file (see --help)");
+    return EXIT_FAILURE;
+  }
+
+  Buffer *const input = BufferCreate();
+  if (!BufferReadFile(input, argv[optind])) {
+    BufferDestroy(input);
+    return EXIT_FAILURE;
+  }
+
+  const bool success = Decode(input, timestamps);
+  BufferDestroy(input);
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,138 @@
+#!/bin/sh
+# Build profiles of eterno and time them on the same scripted workload: the
+# demo level played headless with the input of assets/replays/workload.txt,
+# one tick per frame and as fast as possible.
+#
+# Usage: tools/profiles.sh workload BUILD_DIR
+#        tools/profiles.sh compare OUTPUT_DIR [PROFILE]...
+#
+# The first runs the workload once with the binaries in BUILD_DIR. The second
+# builds each PROFILE (all by default) in OUTPUT_DIR/PROFILE and runs the
+# workload RUNS times (3 by default) with each, reporting the fastest run.
+# Profiles are debug, release, lto, native, pgo and pgo-native.
+#
+# Run from the source directory, since the game loads assets relative to it.
+# The pgo-train and compare-profiles targets of CMake do so.
+
+set -e
+
+LEVEL=assets/levels/demo.txt
+REPLAY=assets/replays/workload.txt
+PROFILES="debug release lto native pgo pgo-native"
+RUNS=${RUNS:-3}
+
+# Print the seconds spent in the frame loop, updating and rendering
+workload() {
+    n='\([0-9.]*\)'
+    "$1/eterno-levelpack" "$LEVEL" "$1/workload.etlv" >/dev/null
+    "$1/eterno" --headless --level "$1/workload.etlv" --replay "$REPLAY" |
+        sed -n "s/.* in $n s: $n s updating, $n s rendering/\1 \2 \3/p"
+}
+
+# Configure and build the game and level packer, logging to DIR/build.log
+build() {
+    dir=$1
+    shift
+    cmake -S . -B "$dir" "$@" >>"$dir/build.log" 2>&1 &&
+        cmake --build "$dir" --parallel --target eterno eterno-levelpack \
+            >>"$dir/build.log" 2>&1
+}
+
+# Build a profile in DIR
+profile() {
+    name=$1
+    dir=$2
+    mkdir -p "$dir"
+    : >"$dir/build.log"
+
+    case $name in
+    debug) build "$dir" -DCMAKE_BUILD_TYPE=Debug ;;
+    release) build "$dir" -DCMAKE_BUILD_TYPE=Release -DENABLE_LTO=OFF ;;
+    lto) build "$dir" -DCMAKE_BUILD_TYPE=Release ;;
+    native) build "$dir" -DCMAKE_BUILD_TYPE=Release -DENABLE_NATIVE=ON ;;
+    pgo | pgo-native)
+        native=OFF
+        [ "$name" = pgo-native ] && native=ON
+        build "$dir" -DCMAKE_BUILD_TYPE=Release -DENABLE_NATIVE=$native \
+            -DPGO=GENERATE &&
+            cmake --build "$dir" --target pgo-train >>"$dir/build.log" 2>&1 &&
+            build "$dir" -DPGO=USE
+        ;;
+    *)
+        echo "Unknown profile '$name'" >&2
+        return 1
+        ;;
+    esac
+}
+
+compare() {
+    out=$1
+    shift
+    [ $# -gt 0 ] || set -- $PROFILES
+
+    results=
+    for name in "$@"; do
+        echo "Building $name"
+        if ! profile "$name" "$out/$name"; then
+            echo "Failed to build $name, see $out/$name/build.log" >&2
+            exit 1
+        fi
+
+        # Keep the fastest run by total time
+        best=
+        run=0
+        while [ $run -lt "$RUNS" ]; do
+            seconds=$(workload "$out/$name")
+            if [ -z "$seconds" ]; then
+                echo "Workload failed with $name" >&2
+                exit 1
+            fi
+            if [ -z "$best" ] || [ "$(echo "$seconds $best" |
+                awk '{print ($1 < $4)}')" = 1 ]; then
+                best=$seconds
+            fi
+            run=$((run + 1))
+        done
+        results="$results$name $best
+"
+    done
+
+    # Speedups are relative to release, or the first profile without it
+    printf '%s' "$results" | awk '
+        {
+            name[NR] = $1; total[NR] = $2; update[NR] = $3; render[NR] = $4
+            if ($1 == "release") base = $2
+        }
+        END {
+            if (base == "") base = total[1]
+            printf "%-12s %8s %8s %8s %8s\n", "profile", "total", "update",
+                "render", "speedup"
+            for (i = 1; i <= NR; i++)
+                printf "%-12s %8.3f %8.3f %8.3f %7.2fx\n", name[i], total[i],
+                    update[i], render[i], base / total[i]
+        }'
+}
+
+case $1 in
+workload)
+    [ $# -eq 2 ] || { echo "Usage: $0 workload BUILD_DIR" >&2; exit 1; }
+    seconds=$(workload "$2")
+    [ -n "$seconds" ] || { echo "Workload failed" >&2; exit 1; }
+    echo "$seconds" | awk '{
+        printf "Workload ran in %s s: %s s updating, %s s rendering\n",
+            $1, $2, $3
+    }'
+    ;;
+compare)
+    [ $# -ge 2 ] || {
+        echo "Usage: $0 compare OUTPUT_DIR [PROFILE]..." >&2
+        exit 1
+    }
+    shift
+    compare "$@"
+    ;;
+*)
+    echo "Usage: $0 workload BUILD_DIR | compare OUTPUT_DIR [PROFILE]..." >&2
+    exit 1
+    ;;
+esac